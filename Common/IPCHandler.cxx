@@ -1,46 +1,209 @@
 #include "IPCHandler.h"
 #include <cstdlib>
 #include <cstring>
+#include <cstdio>
 #include <iostream>
 #include <cerrno>
 #include <chrono>
+#include <thread>
+#include <climits>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#elif defined(__APPLE__)
+// Darwin's address wait primitive. It is not in the public headers, but it is
+// what libc++ uses to implement std::atomic::wait, and the _SHARED variant
+// works across processes for shared memory (macOS 10.12 and later)
+extern "C" int __ulock_wait(std::uint32_t operation, void *addr,
+                            std::uint64_t value, std::uint32_t timeout_us);
+extern "C" int __ulock_wake(std::uint32_t operation, void *addr,
+                            std::uint64_t wake_value);
+#define IPC_UL_COMPARE_AND_WAIT_SHARED 3
+#define IPC_ULF_WAKE_ALL 0x00000100
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <semaphore.h>
+#include <fcntl.h>
+#include <ctime>
+#endif
 
 using namespace std;
 
+const unsigned int IPCHandler::SLOT_COUNT = 64;
+
+// Shared memory layout identifier, combined with the message version
+static const std::uint32_t IPC_RING_LAYOUT = 0x52490000;
+
+// How long a writer waits for a slot held by another writer before taking it
+static const int IPC_MAX_SLOT_SPINS = 1000;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "IPC requires lock-free 64-bit atomics in shared memory");
+
+/**
+ * Open the named object used to wake up listeners in other processes. This is
+ * only needed on platforms that cannot wait on an address in shared memory:
+ * on Windows, WaitOnAddress only works within a process, so a named semaphore
+ * is used instead. Returns nullptr on Linux and macOS.
+ */
+static void *ipc_open_wake_object(const std::string &key)
+{
+#if defined(__linux__) || defined(__APPLE__)
+  (void) key;
+  return nullptr;
+#elif defined(_WIN32)
+  std::string name = "Local\\" + key + ".wake";
+  return CreateSemaphoreA(nullptr, 0, LONG_MAX, name.c_str());
+#else
+  std::string name = "/" + key + ".wake";
+  sem_t *sem = sem_open(name.c_str(), O_CREAT, 0600, 0);
+  return sem == SEM_FAILED ? nullptr : sem;
+#endif
+}
+
+static void ipc_close_wake_object(void *wake_object)
+{
+  if(!wake_object)
+    return;
+#if defined(_WIN32)
+  CloseHandle(static_cast<HANDLE>(wake_object));
+#elif !defined(__linux__) && !defined(__APPLE__)
+  sem_close(static_cast<sem_t *>(wake_object));
+#endif
+}
+
+/**
+ * Wait until the value at the shared address differs from the expected value,
+ * the address is woken up, or the timeout expires. On Linux this uses a futex
+ * and on macOS __ulock_wait, both of which work across processes for shared
+ * memory. Elsewhere, the listener blocks on the named semaphore, which writers
+ * post once for every registered waiter. Only if that could not be created is
+ * the value polled.
+ */
+static void ipc_wait_on_address(std::atomic<std::uint32_t> *addr,
+                                std::uint32_t expected, int timeout_ms,
+                                void *wake_object)
+{
+#if defined(__linux__)
+  (void) wake_object;
+  timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(addr), FUTEX_WAIT,
+          expected, &ts, nullptr, 0);
+#elif defined(__APPLE__)
+  (void) wake_object;
+  __ulock_wait(IPC_UL_COMPARE_AND_WAIT_SHARED, addr, expected,
+               (std::uint32_t) std::max(timeout_ms, 1) * 1000u);
+#else
+  if(wake_object)
+    {
+#if defined(_WIN32)
+    WaitForSingleObject(static_cast<HANDLE>(wake_object), (DWORD) timeout_ms);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L)
+      {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+      }
+    while(sem_timedwait(static_cast<sem_t *>(wake_object), &ts) != 0 && errno == EINTR)
+      ;
+#endif
+    return;
+    }
+
+  auto t_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while(addr->load() == expected && std::chrono::steady_clock::now() < t_end)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+#endif
+}
+
+/**
+ * Wake up the listeners waiting on the shared address. With a named semaphore,
+ * it is posted once per waiter. A waiter that timed out at the same moment
+ * leaves a stale post behind, which only causes one spurious wakeup later.
+ */
+static void ipc_wake_address(std::atomic<std::uint32_t> *addr,
+                             std::uint32_t n_waiters, void *wake_object)
+{
+#if defined(__linux__)
+  (void) n_waiters; (void) wake_object;
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(addr), FUTEX_WAKE,
+          INT_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+  (void) n_waiters; (void) wake_object;
+  __ulock_wake(IPC_UL_COMPARE_AND_WAIT_SHARED | IPC_ULF_WAKE_ALL, addr, 0);
+#else
+  (void) addr;
+  if(!wake_object || n_waiters == 0)
+    return;
+#if defined(_WIN32)
+  ReleaseSemaphore(static_cast<HANDLE>(wake_object), (LONG) n_waiters, nullptr);
+#else
+  for(std::uint32_t i = 0; i < n_waiters; i++)
+    sem_post(static_cast<sem_t *>(wake_object));
+#endif
+#endif
+}
+
 IPCHandler::AttachStatus
 IPCHandler::Attach(const char *path, short version, size_t message_size)
 {
   // Initialize the data pointer
   m_SharedData = nullptr;
-  m_UserData = nullptr;
 
   // Store the size of the actual message
   m_MessageSize = message_size;
+  m_ReadBuffer.resize(message_size);
 
   // Save the protocol version
   m_ProtocolVersion = version;
 
-  // Determine size of shared memory
-  size_t msize = message_size + sizeof(Header);
-
-  // Set the shared memory key
-  m_Interface->SetKey("5A636Q488E.itksnap");
-
-  // Attach or create shared memory
+  // Determine size of shared memory. Slots are aligned to cache lines so that
+  // concurrent writers to adjacent slots do not contend
+  m_SlotSize = (sizeof(SlotHeader) + message_size + 63) & ~((size_t) 63);
+  size_t msize = ((sizeof(Header) + 63) & ~((size_t) 63)) + SLOT_COUNT * m_SlotSize;
+
+  // Set the shared memory key. The key is versioned by the layout and the
+  // message version, so that sessions of ITK-SNAP that cannot understand each
+  // other's messages use separate shared memory instead of failing to attach.
+  // Versions that predate the ring buffer used the unversioned key, and keep
+  // synchronizing among themselves there.
+  std::uint32_t full_version = IPC_RING_LAYOUT | (std::uint16_t) version;
+  char key[64];
+  snprintf(key, sizeof(key), "5A636Q488E.itksnap.%08x", (unsigned int) full_version);
+  m_Interface->SetKey(key);
+
+  // Open the object used to wake listeners on platforms that need one
+  ipc_close_wake_object(m_WakeObject);
+  m_WakeObject = ipc_open_wake_object(key);
+
+  // Attach or create shared memory. If another process creates the memory at
+  // the same time, creation fails and we attach to theirs
   AttachStatus status = IPC_ATTACHED;
   if (!m_Interface->Attach())
   {
-    m_Interface->Create(msize);
-    status = IPC_CREATED;
+    if(m_Interface->Create(msize))
+      status = IPC_CREATED;
+    else
+      m_Interface->Attach();
   }
 
   // Check if attached
-  if (m_Interface->IsAttached())
-  {
-    m_SharedData = m_Interface->Data();
-  }
-
-  if (!m_SharedData)
+  void *data = m_Interface->IsAttached() ? m_Interface->Data() : nullptr;
+  if (!data)
   {
     cerr << "Error attaching to or creating shared memory: " << strerror(errno) << endl;
     cerr << "This error may occur if a user is running two versions of ITK-SNAP" << endl;
@@ -48,44 +211,93 @@ IPCHandler::Attach(const char *path, short version, size_t message_size)
     return IPC_ERROR;
   }
 
-  // Set the user data pointer
-  if (m_SharedData)
+  // Initialize the header of new memory (which is zero-filled), or check that
+  // the existing memory has the same layout
+  Header *header = static_cast<Header *>(data);
+  m_Interface->Lock();
+  if(header->version.load() == 0)
   {
-    Header *hptr = static_cast<Header *>(m_SharedData);
-    m_UserData = static_cast<void *>(hptr + 1);
+    header->slot_count = SLOT_COUNT;
+    header->message_size = message_size;
+    header->write_ticket.store(0);
+    header->wake_count.store(0);
+    header->waiter_count.store(0);
+    header->version.store(full_version);
+  }
+  bool compatible = header->version.load() == full_version
+                    && header->slot_count == SLOT_COUNT
+                    && header->message_size == message_size;
+  m_Interface->Unlock();
+
+  if (!compatible)
+  {
+    cerr << "Shared memory was created by an incompatible version of ITK-SNAP" << endl;
+    cerr << "Multisession support is disabled" << endl;
+    m_Interface->Detach();
+    return IPC_ERROR;
   }
 
+  // Only messages written from now on are new to us
+  std::lock_guard<std::mutex> lock(m_WaitMutex);
+  m_SharedData = data;
+  m_ReadTicket = m_NextUnappliedTicket = header->write_ticket.load();
+  m_LastWakeCount = header->wake_count.load();
+  m_AttachCondition.notify_all();
+
   return status;
 }
 
+IPCHandler::SlotHeader *
+IPCHandler::GetSlot(std::uint64_t ticket)
+{
+  char *slots = static_cast<char *>(m_SharedData) + ((sizeof(Header) + 63) & ~((size_t) 63));
+  return reinterpret_cast<SlotHeader *>(slots + (ticket % SLOT_COUNT) * m_SlotSize);
+}
+
+IPCHandler::SlotStatus
+IPCHandler::ReadSlot(std::uint64_t ticket, long &sender)
+{
+  SlotHeader *slot = GetSlot(ticket);
+  std::uint64_t done = 2 * ticket + 2;
+
+  // Check that the message is complete and has not been overwritten
+  std::uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+  if(seq < done)
+    return SLOT_NOT_READY;
+  if(seq > done)
+    return SLOT_OVERWRITTEN;
+
+  // Copy the message, then check that it was not overwritten while copying
+  sender = (long) slot->sender_pid.load(std::memory_order_relaxed);
+  memcpy(m_ReadBuffer.data(), reinterpret_cast<char *>(slot + 1), m_MessageSize);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(slot->sequence.load(std::memory_order_relaxed) != done)
+    return SLOT_OVERWRITTEN;
+
+  return SLOT_OK;
+}
+
 bool IPCHandler::Read(void *target_ptr)
 {
   // Must have some shared memory
   if(!m_SharedData)
     return false;
 
-  // Lock the segment before reading it
-  m_Interface->Lock();
-
-  // Read the header, make sure it's the right version number
-  Header *header = static_cast<Header *>(m_SharedData);
-  bool success = false;
-  if(header->version == m_ProtocolVersion)
+  // Find the most recent complete message from a live process
+  std::uint64_t head = GetHeader()->write_ticket.load(std::memory_order_acquire);
+  std::uint64_t first = head > SLOT_COUNT ? head - SLOT_COUNT : 0;
+  for(std::uint64_t t = head; t > first; t--)
   {
-    // Store the last sender / id
-    m_LastSender = header->sender_pid;
-    m_LastReceivedMessageID = header->message_id;
-
-    // Copy the message to the target pointer
-    memcpy(target_ptr, m_UserData, m_MessageSize);
-    success = true;
+    long sender;
+    if(ReadSlot(t - 1, sender) == SLOT_OK && sender != -1)
+    {
+      m_LastSender = sender;
+      memcpy(target_ptr, m_ReadBuffer.data(), m_MessageSize);
+      return true;
+    }
   }
 
-  // Unlock the segment
-  m_Interface->Unlock();
-
-  // Success!
-  return success;
+  return false;
 }
 
 bool
@@ -95,39 +307,35 @@ IPCHandler::ReadIfNew(void *target_ptr)
   if (!m_SharedData)
     return false;
 
-  // Lock the segment before reading it
-  m_Interface->Lock();
-
-  // Read the header, make sure it's the right version number
-  Header *header = static_cast<Header *>(m_SharedData);
-  bool    success = false;
-  if (header->version == m_ProtocolVersion)
+  // Scan the unseen messages from the newest down. Only the newest message
+  // from another process matters, since each message holds the complete state.
+  // Messages still being written are revisited on the next call.
+  std::uint64_t head = GetHeader()->write_ticket.load(std::memory_order_acquire);
+  std::uint64_t first = std::max(std::max(m_ReadTicket, m_NextUnappliedTicket),
+                                 head > SLOT_COUNT ? head - SLOT_COUNT : 0);
+  std::uint64_t pending = head;
+  bool success = false;
+  for(std::uint64_t t = head; t > first && !success; t--)
   {
-    // Ignore our own messages or messages from dead processes
-    if (header->sender_pid != m_ProcessID && header->sender_pid != -1)
+    long sender;
+    SlotStatus status = ReadSlot(t - 1, sender);
+    if(status == SLOT_NOT_READY)
     {
-      // If we have already seen this message from this sender, also ignore it
-      if (m_LastSender != header->sender_pid || m_LastReceivedMessageID != header->message_id)
-      {
-        std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-        auto duration = now.time_since_epoch();
-        auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration);
-
-        // Store the last sender / id
-        m_LastSender = header->sender_pid;
-        m_LastReceivedMessageID = header->message_id;
+      pending = t - 1;
+    }
+    else if(status == SLOT_OK && sender != m_ProcessID && sender != -1)
+    {
+      // Store the last sender
+      m_LastSender = sender;
+      m_NextUnappliedTicket = t;
 
-        // Copy the message to the target pointer
-        memcpy(target_ptr, m_UserData, m_MessageSize);
-        success = true;
-      }
+      // Copy the message to the target pointer
+      memcpy(target_ptr, m_ReadBuffer.data(), m_MessageSize);
+      success = true;
     }
   }
 
-  // Unlock the segment
-  m_Interface->Unlock();
-
-  // Success!
+  m_ReadTicket = pending;
   return success;
 }
 
@@ -136,62 +344,123 @@ bool
 IPCHandler::Broadcast(const void *message_ptr)
 {
   // Write to the shared memory
-  if (m_SharedData)
+  if (!m_SharedData)
+    return false;
+
+  // Take a ticket, which determines the slot
+  Header *header = GetHeader();
+  std::uint64_t ticket = header->write_ticket.fetch_add(1);
+  SlotHeader *slot = GetSlot(ticket);
+  std::uint64_t writing = 2 * ticket + 1;
+
+  // Claim the slot. If another writer is still filling it with an older
+  // message, give it a moment to finish, but do not wait on a writer that
+  // may have crashed. If a newer writer has claimed the slot, the ring has
+  // wrapped around and our message is already superseded.
+  std::uint64_t seq = slot->sequence.load();
+  for(int spins = 0; ; )
   {
-    // Lock the segment before reading it
-    m_Interface->Lock();
+    if(seq >= writing)
+      return true;
+    if((seq & 1) && spins++ < IPC_MAX_SLOT_SPINS)
+    {
+      std::this_thread::yield();
+      seq = slot->sequence.load();
+    }
+    else if(slot->sequence.compare_exchange_weak(seq, writing))
+      break;
+  }
 
-    // Access the message header
-    Header *header = static_cast<Header *>(m_SharedData);
+  // Copy the message contents into the slot and publish it
+  slot->sender_pid.store(m_ProcessID, std::memory_order_relaxed);
+  memcpy(reinterpret_cast<char *>(slot + 1), message_ptr, m_MessageSize);
+  slot->sequence.compare_exchange_strong(writing, writing + 1, std::memory_order_release);
 
-    // Write version number
-    header->version = m_ProtocolVersion;
+  // Wake up the listeners
+  header->wake_count.fetch_add(1);
+  std::uint32_t n_waiters = header->waiter_count.load();
+  if(n_waiters > 0)
+    ipc_wake_address(&header->wake_count, n_waiters, m_WakeObject);
 
-    // Write the process ID
-    header->sender_pid = m_ProcessID;
-    header->message_id = ++m_MessageID;
+  return true;
+}
 
-    // Copy the message contents into the shared memory
-    memcpy(m_UserData, message_ptr, m_MessageSize);
+bool
+IPCHandler::WaitForMessage(int timeout_ms)
+{
+  // Let a pending Detach() take the lock
+  if(m_Detaching)
+  {
+    std::this_thread::yield();
+    return false;
+  }
 
-    std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-    auto duration = now.time_since_epoch();
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+  std::unique_lock<std::mutex> lock(m_WaitMutex);
 
-    // Unlock the segment
-    m_Interface->Unlock();
+  // Not attached: sleep until we are
+  if(!m_SharedData)
+  {
+    m_AttachCondition.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+    return false;
+  }
 
-    // Done
-    return true;
+  // Block until the wake counter changes. Registering as a waiter before
+  // checking the counter ensures that writers do not skip the wakeup.
+  Header *header = GetHeader();
+  header->waiter_count.fetch_add(1);
+  std::uint32_t wake = header->wake_count.load();
+  if(wake == m_LastWakeCount && !m_Detaching)
+  {
+    ipc_wait_on_address(&header->wake_count, wake, timeout_ms, m_WakeObject);
+    wake = header->wake_count.load();
   }
+  header->waiter_count.fetch_sub(1);
 
-  return false;
+  bool changed = (wake != m_LastWakeCount);
+  m_LastWakeCount = wake;
+  return changed;
+}
+
+void
+IPCHandler::InterruptWait()
+{
+  // Bump the counter so that the listener returns; other processes' listeners
+  // wake up as well, but find no new messages
+  if(m_SharedData)
+  {
+    Header *header = GetHeader();
+    header->wake_count.fetch_add(1);
+    ipc_wake_address(&header->wake_count,
+                     std::max(header->waiter_count.load(), 1u), m_WakeObject);
+  }
+  m_AttachCondition.notify_all();
 }
 
 void
 IPCHandler::Detach()
 {
-  // Update the message with sender PID of -1 so that if shared memory is retained
-  // for future runs of ITK-SNAP, it will be ignored
+  // Mark our messages with sender PID of -1 so that if shared memory is retained
+  // for future runs of ITK-SNAP, they will be ignored
   if (m_SharedData)
   {
-    // Lock the segment before reading it
-    m_Interface->Lock();
-
-    // Access the message header
-    Header *header = static_cast<Header *>(m_SharedData);
-
-    // Is the current shared memory created by us? If so, we need to clear it
-    if (header->version == m_ProtocolVersion && header->sender_pid == m_ProcessID)
-      header->sender_pid = -1;
+    for(unsigned int i = 0; i < SLOT_COUNT; i++)
+    {
+      std::int64_t pid = m_ProcessID;
+      GetSlot(i)->sender_pid.compare_exchange_strong(pid, -1);
+    }
 
-    // Lock the segment before reading it
-    m_Interface->Unlock();
+    // Release the listener thread before the memory goes away
+    m_Detaching = true;
+    InterruptWait();
   }
 
   // Detach from shared memory
+  std::lock_guard<std::mutex> lock(m_WaitMutex);
   m_Interface->Detach();
   m_SharedData = NULL;
+  m_Detaching = false;
+  ipc_close_wake_object(m_WakeObject);
+  m_WakeObject = nullptr;
 }
 
 bool
@@ -205,10 +474,8 @@ IPCHandler::IPCHandler(AbstractSharedMemorySystemInterface *interface)
   // Save the pointer to the interface
   m_Interface = interface;
 
-  // Set the message ID and last sender/message id values
-  m_LastReceivedMessageID = -1;
+  // Set the last sender
   m_LastSender = -1;
-  m_MessageID = 0;
 
   // Reset the shared memory
   m_SharedData = NULL;
@@ -219,4 +486,5 @@ IPCHandler::IPCHandler(AbstractSharedMemorySystemInterface *interface)
 
 IPCHandler::~IPCHandler()
 {
+  ipc_close_wake_object(m_WakeObject);
 }
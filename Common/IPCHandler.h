@@ -2,8 +2,13 @@
 #define IPCHANDLER_H
 
 #include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <set>
 #include <string>
+#include <vector>
 
 class AbstractSharedMemorySystemInterface
 {
@@ -24,6 +29,17 @@ public:
 /**
  * Base class for IPCHandler. This class contains the definitions of the
  * core methods and is independent of the data structure being shared.
+ *
+ * The shared memory holds a ring buffer of messages that any number of
+ * processes can write to without locking. Each writer takes a ticket from
+ * a shared counter, and each slot is guarded by a sequence number, so that
+ * readers can detect messages that are incomplete or have been overwritten.
+ * Listeners block in WaitForMessage() until a message is published, which
+ * costs nothing when idle: Linux and macOS wait on the shared memory itself
+ * (futex, __ulock_wait), and other platforms on a named semaphore.
+ *
+ * The shared memory key includes the layout and message version, so sessions
+ * only link with sessions that use the same protocol.
  */
 class IPCHandler
 {
@@ -52,15 +68,29 @@ public:
   /** Whether the shared memory is attached */
   bool IsAttached();
 
-  /** Read a 'message', i.e., the contents of shared memory */
+  /** Read the most recent 'message' in shared memory */
   bool Read(void *target_ptr);
 
-  /** Read a 'message' but only if it has not been seen before */
+  /**
+   * Read the most recent 'message' from another process, but only if it has
+   * not been seen before. Older unseen messages are superseded by it.
+   */
   bool ReadIfNew(void *target_ptr);
 
-  /** Broadcast a 'message' (i.e. replace shared memory contents */
+  /** Broadcast a 'message' (i.e. append it to the shared ring buffer) */
   bool Broadcast(const void *message_ptr);
 
+  /**
+   * Block until a message may have been published or the timeout expires.
+   * Returns true if messages were published since the last call. This is
+   * meant to be called from a listener thread, which should then schedule
+   * ReadIfNew() on the thread that owns the handler.
+   */
+  bool WaitForMessage(int timeout_ms);
+
+  /** Wake up a thread blocked in WaitForMessage() */
+  void InterruptWait();
+
   /** Get the process Id */
   long GetProcessID() { return m_ProcessID; };
 
@@ -69,19 +99,64 @@ public:
 
 protected:
 
+  // Header of the shared memory, followed by the message slots
   struct Header
   {
-    short version;
-    long sender_pid;
-    long message_id;
+    // Protocol and layout, validated by processes attaching to the memory
+    std::atomic<std::uint32_t> version;
+    std::uint32_t slot_count;
+    std::uint64_t message_size;
+
+    // The ticket of the next message to be written
+    std::atomic<std::uint64_t> write_ticket;
+
+    // Incremented after each message is published to wake up listeners
+    std::atomic<std::uint32_t> wake_count;
+
+    // Number of listeners blocked waiting on wake_count
+    std::atomic<std::uint32_t> waiter_count;
   };
 
+  // Header of each slot, followed by the message contents
+  struct SlotHeader
+  {
+    // Odd (2t+1) while the message with ticket t is written, 2t+2 when done
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::int64_t> sender_pid;
+  };
+
+  // Number of slots in the ring buffer
+  static const unsigned int SLOT_COUNT;
+
+  // Result of reading a slot
+  enum SlotStatus { SLOT_OK, SLOT_NOT_READY, SLOT_OVERWRITTEN };
+
+  Header *GetHeader() { return static_cast<Header *>(m_SharedData); }
+  SlotHeader *GetSlot(std::uint64_t ticket);
+
+  // Copy the message with the given ticket into the read buffer
+  SlotStatus ReadSlot(std::uint64_t ticket, long &sender);
 
   // Shared data pointer
-  void *m_SharedData = nullptr, *m_UserData = nullptr;
+  void *m_SharedData = nullptr;
 
-  // Size of the shared data message
-  size_t m_MessageSize;
+  // Size of the shared data message and of the slots holding them
+  size_t m_MessageSize, m_SlotSize;
+
+  // Message contents are copied here before they are validated
+  std::vector<char> m_ReadBuffer;
+
+  // Tickets below m_ReadTicket have been scanned by ReadIfNew, except those
+  // that were still being written. Tickets below m_NextUnappliedTicket are
+  // superseded by a message that has been returned.
+  std::uint64_t m_ReadTicket = 0, m_NextUnappliedTicket = 0;
+
+  // Listener state, guarded by the mutex, which is held while waiting so
+  // that the memory is not detached from under the listener
+  std::mutex m_WaitMutex;
+  std::condition_variable m_AttachCondition;
+  std::uint32_t m_LastWakeCount = 0;
+  std::atomic<bool> m_Detaching { false };
 
   // Version of the protocol (to avoid problems with older code)
   short m_ProtocolVersion;
@@ -89,13 +164,17 @@ protected:
   // System-specific IPC related stuff
   AbstractSharedMemorySystemInterface *m_Interface;
 
+  // Named semaphore that wakes up listeners, on platforms that cannot wait on
+  // an address in shared memory across processes
+  void *m_WakeObject = nullptr;
+
   // The version of the SNAP-IPC protocol. This way, when versions are different
   // IPC will not work. This is to account for an off chance of a someone running
   // two different versions of SNAP
   static const short IPC_VERSION;
 
   // Process ID and other values used by IPC
-  long m_ProcessID, m_MessageID, m_LastSender, m_LastReceivedMessageID;
+  long m_ProcessID, m_LastSender;
 
   bool IsProcessRunning(int pid);
 
@@ -37,11 +37,17 @@
 #include "itkXMLFile.h"
 
 #include <stdio.h>
+#include <algorithm>
 #include <cstdlib>
 #include <cstdarg>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <locale>
 #include <regex>
+#include <set>
 #include "itksys/SystemTools.hxx"
 #include "IRISException.h"
 
@@ -161,6 +167,320 @@ void RegistryXMLFileReader::CharacterDataHandler(const char *inData, int inLengt
 }
 
 
+/**
+ * Layout of the binary format: the magic string, the format version, the
+ * key table, then the root folder. All integers are stored as base-128
+ * varints. A folder is the number of entries, followed by each entry's key
+ * index, type tag and value, then the number of subfolders, followed by
+ * each subfolder's key index, size in bytes and contents. Signed integers
+ * are zigzag encoded. Doubles are stored as a decimal mantissa and exponent.
+ * A list is the number of its elements, followed by each element's type tag
+ * and value. Version 1 files have no doubles or lists.
+ */
+static const char REGISTRY_BINARY_MAGIC[] = "SNAPREGB";
+static const size_t REGISTRY_BINARY_MAGIC_LENGTH = 8;
+static const uint64_t REGISTRY_BINARY_VERSION = 2;
+
+enum RegistryBinaryValueType
+{
+  REGISTRY_BINARY_STRING = 0,
+  REGISTRY_BINARY_INTEGER = 1,
+  REGISTRY_BINARY_DOUBLE = 2,
+  REGISTRY_BINARY_LIST = 3
+};
+
+/** Reads the varints and byte strings of the binary format */
+class RegistryBinaryReader
+{
+public:
+  RegistryBinaryReader(const char *data, size_t length)
+    : m_Pos(data), m_End(data + length) {}
+
+  uint64_t ReadVarint()
+  {
+    uint64_t value = 0;
+    for(unsigned int shift = 0; shift < 64; shift += 7)
+      {
+      unsigned char b = (unsigned char) *Skip(1);
+      value |= (uint64_t) (b & 0x7f) << shift;
+      if(!(b & 0x80))
+        return value;
+      }
+    throw Registry::IOException("Invalid integer in binary Registry data");
+  }
+
+  // Read a size that must fit in the remaining data
+  size_t ReadSize()
+  {
+    uint64_t size = ReadVarint();
+    if(size > (uint64_t) (m_End - m_Pos))
+      throw Registry::IOException("Truncated binary Registry data");
+    return (size_t) size;
+  }
+
+  // Read a key index that must fit in the key table
+  size_t ReadKey(size_t n_keys)
+  {
+    uint64_t key = ReadVarint();
+    if(key >= n_keys)
+      throw Registry::IOException("Invalid key in binary Registry data");
+    return (size_t) key;
+  }
+
+  const char *Skip(size_t n)
+  {
+    if(n > (size_t) (m_End - m_Pos))
+      throw Registry::IOException("Truncated binary Registry data");
+    const char *p = m_Pos;
+    m_Pos += n;
+    return p;
+  }
+
+  const char *GetPosition() const { return m_Pos; }
+  bool AtEnd() const { return m_Pos == m_End; }
+
+private:
+  const char *m_Pos, *m_End;
+};
+
+static void RegistryBinaryWriteVarint(std::string &out, uint64_t value)
+{
+  while(value >= 0x80)
+    {
+    out.push_back((char) ((value & 0x7f) | 0x80));
+    value >>= 7;
+    }
+  out.push_back((char) value);
+}
+
+// Check a value of the given type, so that parsing it later can not fail
+static void RegistryBinaryValidateValue(RegistryBinaryReader &r, char type, bool in_list)
+{
+  if(type == REGISTRY_BINARY_STRING && !in_list)
+    r.Skip(r.ReadSize());
+  else if(type == REGISTRY_BINARY_INTEGER)
+    r.ReadVarint();
+  else if(type == REGISTRY_BINARY_DOUBLE)
+    {
+    r.ReadVarint();
+    r.ReadVarint();
+    }
+  else if(type == REGISTRY_BINARY_LIST && !in_list)
+    {
+    uint64_t n = r.ReadVarint();
+    for(uint64_t j = 0; j < n; j++)
+      RegistryBinaryValidateValue(r, *r.Skip(1), true);
+    }
+  else
+    throw Registry::IOException("Invalid value type in binary Registry data");
+}
+
+// Check the structure of a folder, so that parsing it later can not fail
+static void RegistryBinaryValidateFolder(RegistryBinaryReader &r, size_t n_keys)
+{
+  uint64_t n_entries = r.ReadVarint();
+  for(uint64_t i = 0; i < n_entries; i++)
+    {
+    r.ReadKey(n_keys);
+    RegistryBinaryValidateValue(r, *r.Skip(1), false);
+    }
+
+  uint64_t n_folders = r.ReadVarint();
+  for(uint64_t i = 0; i < n_folders; i++)
+    {
+    r.ReadKey(n_keys);
+    size_t length = r.ReadSize();
+    RegistryBinaryReader sub(r.Skip(length), length);
+    RegistryBinaryValidateFolder(sub, n_keys);
+    if(!sub.AtEnd())
+      throw Registry::IOException("Invalid folder size in binary Registry data");
+    }
+}
+
+// Values that are integers in canonical form are stored as integers, so
+// that they read back as the same string
+static bool RegistryBinaryIsInteger(const std::string &s, long long &value)
+{
+  size_t i = (s.length() && s[0] == '-') ? 1 : 0;
+  size_t n_digits = s.length() - i;
+  if(n_digits == 0 || n_digits > 18)
+    return false;
+  if(s[i] == '0' && (n_digits > 1 || i > 0))
+    return false;
+  for(size_t j = i; j < s.length(); j++)
+    if(s[j] < '0' || s[j] > '9')
+      return false;
+
+  value = strtoll(s.c_str(), NULL, 10);
+  return true;
+}
+
+static void RegistryBinaryWriteSigned(std::string &out, long long value)
+{
+  RegistryBinaryWriteVarint(out, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static long long RegistryBinaryReadSigned(RegistryBinaryReader &r)
+{
+  uint64_t z = r.ReadVarint();
+  return (long long) (z >> 1) ^ -(long long) (z & 1);
+}
+
+// Doubles are written to registry values with the default formatting of an
+// output stream, i.e., with six significant digits. The double stored as
+// mantissa * 10^exponent is formatted the same way when it is read back
+static std::string RegistryBinaryFormatDouble(long long mantissa, long long exponent)
+{
+  std::istringstream iss(std::to_string(mantissa) + "e" + std::to_string(exponent));
+  iss.imbue(std::locale::classic());
+  double value = 0.0;
+  iss >> value;
+
+  std::ostringstream oss;
+  oss.imbue(std::locale::classic());
+  oss << value;
+  return oss.str();
+}
+
+// Split a decimal number, such as -1.5e-07, into its mantissa (-15) and
+// exponent (-8), if formatting them gives back the same string
+static bool RegistryBinaryIsDouble(const std::string &s, long long &mantissa, long long &exponent)
+{
+  std::string digits;
+  long long exp10 = 0;
+  size_t i = (s.length() && s[0] == '-') ? 1 : 0;
+  bool seen_point = false;
+  for(; i < s.length() && s[i] != 'e'; i++)
+    {
+    if(s[i] == '.' && !seen_point)
+      seen_point = true;
+    else if(s[i] >= '0' && s[i] <= '9')
+      {
+      digits.push_back(s[i]);
+      exp10 -= seen_point ? 1 : 0;
+      }
+    else
+      return false;
+    }
+
+  if(i < s.length())
+    {
+    char *end;
+    const char *p = s.c_str() + i + 1;
+    long long e = strtoll(p, &end, 10);
+    if(end == p || *end != 0)
+      return false;
+    exp10 += e;
+    }
+
+  digits.erase(0, std::min(digits.find_first_not_of('0'), digits.length()));
+  if(digits.length() > 18)
+    return false;
+
+  mantissa = digits.length() ? strtoll(digits.c_str(), NULL, 10) : 0;
+  if(s[0] == '-')
+    mantissa = -mantissa;
+  exponent = exp10;
+  return RegistryBinaryFormatDouble(mantissa, exponent) == s;
+}
+
+// Write an element of a value: an integer, a double, or failing that a string.
+// Returns false if the element can not be stored as a number
+static bool RegistryBinaryWriteNumber(std::string &out, const std::string &s)
+{
+  long long ivalue, mantissa, exponent;
+  if(RegistryBinaryIsInteger(s, ivalue))
+    {
+    out.push_back((char) REGISTRY_BINARY_INTEGER);
+    RegistryBinaryWriteSigned(out, ivalue);
+    return true;
+    }
+  if(RegistryBinaryIsDouble(s, mantissa, exponent))
+    {
+    out.push_back((char) REGISTRY_BINARY_DOUBLE);
+    RegistryBinaryWriteSigned(out, mantissa);
+    RegistryBinaryWriteSigned(out, exponent);
+    return true;
+    }
+  return false;
+}
+
+// Read back an element written by RegistryBinaryWriteNumber
+static std::string RegistryBinaryReadNumber(RegistryBinaryReader &r, char type)
+{
+  if(type == REGISTRY_BINARY_INTEGER)
+    return std::to_string(RegistryBinaryReadSigned(r));
+
+  long long mantissa = RegistryBinaryReadSigned(r);
+  return RegistryBinaryFormatDouble(mantissa, RegistryBinaryReadSigned(r));
+}
+
+// Write a value with the most compact encoding that reads back as the same
+// string. Vectors, such as "0.5 0.5 1.2", are stored as lists of numbers
+static void RegistryBinaryWriteValue(std::string &out, const std::string &value)
+{
+  std::string as_string;
+  as_string.push_back((char) REGISTRY_BINARY_STRING);
+  RegistryBinaryWriteVarint(as_string, value.length());
+  as_string.append(value);
+
+  std::string encoded;
+  if(value.find(' ') == std::string::npos)
+    {
+    if(!RegistryBinaryWriteNumber(encoded, value))
+      encoded.clear();
+    }
+  else
+    {
+    std::vector<std::string> elements;
+    for(size_t pos = 0, next; pos <= value.length(); pos = next + 1)
+      {
+      next = value.find(' ', pos);
+      if(next == std::string::npos)
+        next = value.length();
+      elements.push_back(value.substr(pos, next - pos));
+      }
+
+    encoded.push_back((char) REGISTRY_BINARY_LIST);
+    RegistryBinaryWriteVarint(encoded, elements.size());
+    for(const std::string &element : elements)
+      {
+      if(!RegistryBinaryWriteNumber(encoded, element))
+        {
+        encoded.clear();
+        break;
+        }
+      }
+    }
+
+  out.append(encoded.length() && encoded.length() < as_string.length() ? encoded : as_string);
+}
+
+// Read back a value written by RegistryBinaryWriteValue
+static std::string RegistryBinaryReadValue(RegistryBinaryReader &r)
+{
+  char type = *r.Skip(1);
+  if(type == REGISTRY_BINARY_STRING)
+    {
+    size_t len = r.ReadSize();
+    return std::string(r.Skip(len), len);
+    }
+  else if(type == REGISTRY_BINARY_LIST)
+    {
+    std::string value;
+    uint64_t n = r.ReadVarint();
+    for(uint64_t j = 0; j < n; j++)
+      {
+      if(j > 0)
+        value.push_back(' ');
+      value.append(RegistryBinaryReadNumber(r, *r.Skip(1)));
+      }
+    return value;
+    }
+  return RegistryBinaryReadNumber(r, type);
+}
+
+
 RegistryValue
 ::RegistryValue()
 {
@@ -190,6 +510,7 @@ Registry::Entry(const std::string &key)
     }
 
   // Search for the key and return it if found
+  Materialize();
   EntryIterator it = m_EntryMap.find(key);
   if(it != m_EntryMap.end())
     return it->second;
@@ -202,8 +523,8 @@ Registry::Entry(const std::string &key)
 Registry::StringType
 Registry::Key(const char *format,...)
 {
-  // A string for prinf-ing
-  static char buffer[1024];
+  // A string for prinf-ing (not static, keys are made on several threads)
+  char buffer[1024];
   
   // Do the printf operation
   va_list al;
@@ -219,6 +540,8 @@ int
 Registry
 ::GetEntryKeys(StringListType &targetArray) 
 {
+  Materialize();
+
   // Iterate through keys in ascending order
   for(EntryIterator it=m_EntryMap.begin();it!=m_EntryMap.end();++it)
     {
@@ -234,6 +557,8 @@ int
 Registry
 ::GetFolderKeys(StringListType &targetArray) 
 {
+  Materialize();
+
   // Iterate through keys in ascending order
   for(FolderIterator it=m_FolderMap.begin();it!=m_FolderMap.end();++it)
     {
@@ -247,6 +572,8 @@ Registry
 
 bool Registry::HasEntry(const Registry::StringType &key) const
 {
+  Materialize();
+
   // Get the containing folder
   StringType::size_type iDot = key.find_first_of('.');
 
@@ -272,6 +599,8 @@ bool Registry::HasEntry(const Registry::StringType &key) const
 
 bool Registry::HasFolder(const Registry::StringType &key) const
 {
+  Materialize();
+
   // Get the containing folder
   StringType::size_type iDot = key.find_first_of('.');
 
@@ -299,6 +628,8 @@ void
 Registry
 ::Write(ostream &sout,const StringType &prefix)
 {
+  Materialize();
+
   // Write the entries in this folder
   for(EntryIterator ite = m_EntryMap.begin();ite != m_EntryMap.end(); ++ite)
     {
@@ -325,6 +656,8 @@ void
 Registry
 ::Print(ostream &sout, StringType indent, StringType prefix)
 {
+  Materialize();
+
   // Print the folders
   for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
     {
@@ -354,6 +687,8 @@ void
 Registry
 ::WriteXML(ostream &sout, const StringType &prefix)
 {
+  Materialize();
+
   // Write the entries in this folder
   for(EntryIterator ite = m_EntryMap.begin();ite != m_EntryMap.end(); ++ite)
     {
@@ -364,7 +699,7 @@ Registry
       sout << prefix << "<entry key=\"" << EncodeXML(ite->first) << "\"";
 
       // Write the encoded value
-      sout << " value=\"" << EncodeXML(ite->second.GetInternalString()) << "\" />" << endl;
+      sout << " value=\"" << EncodeXML(ite->second.GetInternalString()) << "\" />" << '\n';
       }
     }
 
@@ -372,13 +707,13 @@ Registry
   for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
     {
     // Write the folder tag
-    sout << prefix << "<folder key=\"" << EncodeXML(itf->first) << "\" >" << endl;
+    sout << prefix << "<folder key=\"" << EncodeXML(itf->first) << "\" >" << '\n';
 
     // Write the folder contents (recursive, contents prefixed with full path name)
     itf->second->WriteXML(sout, prefix + "  ");
 
     // Close the folder
-    sout << prefix << "</folder>" << endl;
+    sout << prefix << "</folder>" << '\n';
     }
 }
 
@@ -389,6 +724,10 @@ Registry
   // Set the internal value
   m_AddIfNotFound = yesno;
 
+  // Folders created when this folder is parsed will inherit the flag
+  if(m_Unparsed)
+    return;
+
   // Propagate to all the children folders
   for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
     {
@@ -398,6 +737,8 @@ Registry
 
 void Registry::CleanEmptyFolders()
 {
+  Materialize();
+
   // Iterate over all the subfolders
   FolderMapType::iterator itf = m_FolderMap.begin();
   while(itf != m_FolderMap.end())
@@ -412,6 +753,7 @@ void Registry::CleanEmptyFolders()
 
 bool Registry::IsZeroSizeArray()
 {
+  Materialize();
   return
       this->HasEntry("ArraySize") &&
       this->Entry("ArraySize")[(unsigned int) 0] == 0 &&
@@ -421,6 +763,8 @@ bool Registry::IsZeroSizeArray()
 
 void Registry::CleanZeroSizeArrays()
 {
+  Materialize();
+
   // Iterate over all the subfolders
   FolderMapType::iterator itf = m_FolderMap.begin();
   while(itf != m_FolderMap.end())
@@ -440,6 +784,8 @@ void
 Registry
 ::CollectKeys(StringListType &keyList,const StringType &prefix) 
 {
+  Materialize();
+
   // Go through the children
   for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
     {
@@ -459,6 +805,8 @@ void
 Registry
 ::Update(const Registry &reg) 
 {
+  reg.Materialize();
+
   // Go through the children
   for(FolderIterator itf = reg.m_FolderMap.begin(); 
     itf != reg.m_FolderMap.end(); ++itf)
@@ -483,6 +831,8 @@ Registry::StringType
 Registry
 ::FindValue(const StringType& value)
 {
+  Materialize();
+
   // Add the keys in this folder
   for(EntryIterator ite = m_EntryMap.begin();ite != m_EntryMap.end(); ++ite)
     {
@@ -496,6 +846,8 @@ Registry::StringListType
 Registry
 ::FindFoldersFromPattern(const StringType &_pattern) const
 {
+  Materialize();
+
   StringListType ret;
   std::regex pattern(_pattern);
   std::smatch match;
@@ -513,6 +865,8 @@ void
 Registry
 ::RemoveKeys(const char *match)
 {
+  Materialize();
+
   // Create a match substring
   string sMatch = (match) ? match : 0;
 
@@ -531,12 +885,14 @@ void
 Registry
 ::Clear()
 {
+  m_Unparsed.reset();
   m_EntryMap.clear();
   m_FolderMap.clear();
 }
 
 bool Registry::IsEmpty() const
 {
+  Materialize();
   return m_EntryMap.size() == 0 && m_FolderMap.size() == 0;
 }
 
@@ -544,32 +900,35 @@ Registry::StringType
 Registry
 ::EncodeXML(const StringType &input)
 {
-  IRISOStringStream oss;
+  // Most keys and values have no special characters
+  if(input.find_first_of("<>&'\"") == StringType::npos)
+    return input;
+
+  StringType out;
+  out.reserve(input.length() + 16);
   for(unsigned int i=0; i < input.length() ; i++)
     {
-    // Map the character to positive integer (0..255)
-    char c = input[i];
-
     // There are special characters not allowed in XML
+    char c = input[i];
     switch(c)
       {
       case '<' :
-        oss << "&lt;"; break;
+        out += "&lt;"; break;
       case '>' :
-        oss << "&gt;"; break;
+        out += "&gt;"; break;
       case '&' :
-        oss << "&amp;"; break;
+        out += "&amp;"; break;
       case '\'' :
-        oss << "&apos;"; break;
+        out += "&apos;"; break;
       case '\"' :
-        oss << "&quot;"; break;
+        out += "&quot;"; break;
       default:
-        oss << c; break;
+        out += c; break;
       }
    }
 
   // Return the resulting string
-  return oss.str();
+  return out;
 }
 
 Registry::StringType Registry::DecodeXML(const Registry::StringType &input)
@@ -729,6 +1088,7 @@ Registry
     }
 
   // Get the folder, adding if necessary
+  Materialize();
   FolderIterator it = m_FolderMap.find(key);
   if(it != m_FolderMap.end())
     return *(it->second);
@@ -774,6 +1134,9 @@ Registry::
 
 bool Registry::operator == (const Registry &other) const
 {
+  Materialize();
+  other.Materialize();
+
   // Compare the folders
   if(m_FolderMap.size() != other.m_FolderMap.size())
     return false;
@@ -849,26 +1212,26 @@ void Registry::WriteToXMLFile(const char *pathname, const char *header)
   sout.exceptions(std::ios::failbit);
 
   // Write the XML string
-  sout << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>" << endl;
+  sout << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>" << '\n';
 
   // Write the header
   if(header)
-    sout << "<!--" << header << "-->" << endl;
+    sout << "<!--" << header << "-->" << '\n';
 
   // Write the DOCTYPE content
-  sout << "<!DOCTYPE registry [" << endl
-       << "<!ELEMENT registry (entry*,folder*)>" << endl
-       << "<!ELEMENT folder (entry*,folder*)>" << endl
-       << "<!ELEMENT entry EMPTY>" << endl
-       << "<!ATTLIST folder key CDATA #REQUIRED>" << endl
-       << "<!ATTLIST entry key CDATA #REQUIRED>" << endl
-       << "<!ATTLIST entry value CDATA #REQUIRED>" << endl
-       << "]>" << endl;
+  sout << "<!DOCTYPE registry [" << '\n'
+       << "<!ELEMENT registry (entry*,folder*)>" << '\n'
+       << "<!ELEMENT folder (entry*,folder*)>" << '\n'
+       << "<!ELEMENT entry EMPTY>" << '\n'
+       << "<!ATTLIST folder key CDATA #REQUIRED>" << '\n'
+       << "<!ATTLIST entry key CDATA #REQUIRED>" << '\n'
+       << "<!ATTLIST entry value CDATA #REQUIRED>" << '\n'
+       << "]>" << '\n';
 
   // Write to the stream
-  sout << "<registry>" << endl;
+  sout << "<registry>" << '\n';
   WriteXML(sout, "  ");
-  sout << "</registry>" << endl;
+  sout << "</registry>" << '\n';
 }
 
 
@@ -920,3 +1283,223 @@ void Registry::ReadFromXMLFile(const char *pathname)
 }
 
 
+struct Registry::BinaryData
+{
+  std::string buffer;
+  std::vector<StringType> keys;
+};
+
+void Registry::Materialize() const
+{
+  // Const methods may be called on the same folder from several threads.
+  // The first call parses the folder, and the others wait until it is done.
+  // The folder is only given unparsed contents before it is first accessed
+  std::call_once(m_MaterializeFlag, [this]()
+  {
+    if(!m_Unparsed)
+      return;
+
+    // Parsing does not change the contents of the folder as seen by the caller
+    std::unique_ptr<BinaryFolder> folder = std::move(m_Unparsed);
+    const_cast<Registry *>(this)->ParseBinary(folder->data, folder->offset, folder->length);
+  });
+}
+
+void Registry::ParseBinary(const std::shared_ptr<const BinaryData> &data,
+                           size_t offset, size_t length)
+{
+  // The data has been validated when it was read
+  const char *base = data->buffer.data();
+  RegistryBinaryReader r(base + offset, length);
+
+  uint64_t n_entries = r.ReadVarint();
+  for(uint64_t i = 0; i < n_entries; i++)
+    {
+    const StringType &key = data->keys[r.ReadVarint()];
+    m_EntryMap[key] = RegistryValue(RegistryBinaryReadValue(r));
+    }
+
+  uint64_t n_folders = r.ReadVarint();
+  for(uint64_t i = 0; i < n_folders; i++)
+    {
+    const StringType &key = data->keys[r.ReadVarint()];
+    size_t len = r.ReadSize();
+    size_t sub_offset = r.Skip(len) - base;
+
+    // Existing folders are merged with the data right away, new folders
+    // are parsed when they are first accessed
+    FolderIterator it = m_FolderMap.find(key);
+    if(it != m_FolderMap.end())
+      {
+      it->second->Materialize();
+      it->second->ParseBinary(data, sub_offset, len);
+      }
+    else
+      {
+      Registry *folder = new Registry();
+      folder->m_AddIfNotFound = m_AddIfNotFound;
+      folder->m_Unparsed.reset(new BinaryFolder { data, sub_offset, len });
+      m_FolderMap[key] = folder;
+      }
+    }
+}
+
+const Registry::BinaryData *Registry::FindUnparsedData() const
+{
+  if(m_Unparsed)
+    return m_Unparsed->data.get();
+
+  for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
+    {
+    const BinaryData *data = itf->second->FindUnparsedData();
+    if(data)
+      return data;
+    }
+
+  return NULL;
+}
+
+void Registry::WriteBinary(std::string &out, std::map<StringType, size_t> &keys,
+                           const BinaryData *base) const
+{
+  // A folder that was never parsed is copied as is. Its key indices are
+  // valid because the key table of the base data is kept as a prefix
+  if(m_Unparsed && m_Unparsed->data.get() == base)
+    {
+    out.append(base->buffer, m_Unparsed->offset, m_Unparsed->length);
+    return;
+    }
+
+  Materialize();
+
+  // Key index, adding the key to the table if needed
+  auto key_index = [&keys](const StringType &key)
+  {
+    return keys.insert(std::make_pair(key, keys.size())).first->second;
+  };
+
+  // Write the non-null entries
+  size_t n_entries = 0;
+  for(EntryConstIterator ite = m_EntryMap.begin(); ite != m_EntryMap.end(); ++ite)
+    if(!ite->second.IsNull())
+      n_entries++;
+
+  RegistryBinaryWriteVarint(out, n_entries);
+  for(EntryConstIterator ite = m_EntryMap.begin(); ite != m_EntryMap.end(); ++ite)
+    {
+    if(ite->second.IsNull())
+      continue;
+
+    RegistryBinaryWriteVarint(out, key_index(ite->first));
+    RegistryBinaryWriteValue(out, ite->second.GetInternalString());
+    }
+
+  // Write the folders, each preceded by its size
+  RegistryBinaryWriteVarint(out, m_FolderMap.size());
+  for(FolderIterator itf = m_FolderMap.begin(); itf != m_FolderMap.end(); ++itf)
+    {
+    RegistryBinaryWriteVarint(out, key_index(itf->first));
+
+    StringType folder;
+    itf->second->WriteBinary(folder, keys, base);
+    RegistryBinaryWriteVarint(out, folder.length());
+    out.append(folder);
+    }
+}
+
+void Registry::WriteToBinaryStream(std::ostream &sout)
+{
+  // Keep the key table of data read earlier, so that the folders that were
+  // not accessed since can be copied without parsing them
+  const BinaryData *base = FindUnparsedData();
+  std::map<StringType, size_t> keys;
+  if(base)
+    for(size_t i = 0; i < base->keys.size(); i++)
+      keys[base->keys[i]] = i;
+
+  StringType body;
+  WriteBinary(body, keys, base);
+
+  // Key table in index order
+  std::vector<const StringType *> table(keys.size());
+  for(auto it = keys.begin(); it != keys.end(); ++it)
+    table[it->second] = &it->first;
+
+  StringType header(REGISTRY_BINARY_MAGIC, REGISTRY_BINARY_MAGIC_LENGTH);
+  RegistryBinaryWriteVarint(header, REGISTRY_BINARY_VERSION);
+  RegistryBinaryWriteVarint(header, table.size());
+  for(const StringType *key : table)
+    {
+    RegistryBinaryWriteVarint(header, key->length());
+    header.append(*key);
+    }
+
+  sout.write(header.data(), header.length());
+  sout.write(body.data(), body.length());
+}
+
+void Registry::WriteToBinaryFile(const char *pathname)
+{
+  // Open the file
+  ofstream sout(pathname, std::ios::out | std::ios::binary);
+
+  // Set the stream to be picky
+  sout.exceptions(std::ios::failbit);
+
+  WriteToBinaryStream(sout);
+}
+
+void Registry::ReadFromBinaryStream(std::istream &sin)
+{
+  std::shared_ptr<BinaryData> data = std::make_shared<BinaryData>();
+  data->buffer.assign(std::istreambuf_iterator<char>(sin), std::istreambuf_iterator<char>());
+
+  if(data->buffer.length() < REGISTRY_BINARY_MAGIC_LENGTH
+     || memcmp(data->buffer.data(), REGISTRY_BINARY_MAGIC, REGISTRY_BINARY_MAGIC_LENGTH))
+    throw IOException("Not a binary Registry file");
+
+  RegistryBinaryReader r(data->buffer.data() + REGISTRY_BINARY_MAGIC_LENGTH,
+                         data->buffer.length() - REGISTRY_BINARY_MAGIC_LENGTH);
+  uint64_t version = r.ReadVarint();
+  if(version < 1 || version > REGISTRY_BINARY_VERSION)
+    throw IOException("Unsupported binary Registry file version");
+
+  // Read the key table, which must not have duplicates
+  uint64_t n_keys = r.ReadVarint();
+  std::set<StringType> unique_keys;
+  for(uint64_t i = 0; i < n_keys; i++)
+    {
+    size_t len = r.ReadSize();
+    data->keys.push_back(StringType(r.Skip(len), len));
+    if(!unique_keys.insert(data->keys.back()).second)
+      throw IOException("Duplicate key in binary Registry file");
+    }
+
+  // Check the whole tree now, so that parsing folders later can not fail
+  size_t offset = r.GetPosition() - data->buffer.data();
+  size_t length = data->buffer.length() - offset;
+  RegistryBinaryReader v(r.GetPosition(), length);
+  RegistryBinaryValidateFolder(v, data->keys.size());
+  if(!v.AtEnd())
+    throw IOException("Unexpected data at the end of binary Registry file");
+
+  Materialize();
+  ParseBinary(data, offset, length);
+}
+
+void Registry::ReadFromBinaryFile(const char *pathname)
+{
+  ifstream sin(pathname, std::ios::in | std::ios::binary);
+  if(!sin.good())
+    throw IOException("Unable to open the Registry file");
+
+  ReadFromBinaryStream(sin);
+}
+
+bool Registry::IsBinary(const char *name)
+{
+  char magic[REGISTRY_BINARY_MAGIC_LENGTH];
+  ifstream file(name, std::ios::in | std::ios::binary);
+  return file.read(magic, REGISTRY_BINARY_MAGIC_LENGTH)
+      && !memcmp(magic, REGISTRY_BINARY_MAGIC, REGISTRY_BINARY_MAGIC_LENGTH);
+}
@@ -43,6 +43,8 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -403,6 +405,15 @@ private:
 /**
  * \class Registry
  * \brief A tree of key-value pair maps
+ *
+ * In addition to XML, the registry can be stored in a compact binary format
+ * (see WriteToBinaryFile). Keys are stored once in a table and referenced by
+ * index, integer and floating point values and vectors of them are stored
+ * as numbers when that is shorter, and each folder is prefixed by its size.
+ * When such a file is read, only the top-level entries are parsed. Each
+ * folder is parsed the first time it is accessed, also from const methods,
+ * which may be called from several threads. Folders that are never accessed
+ * are written back by copying their bytes.
  */
 class Registry
 {
@@ -498,6 +509,21 @@ public:
   /** Read from XML file */
   void ReadFromXMLFile(const char *pathname);
 
+  /** Write the Registry to a binary file */
+  void WriteToBinaryFile(const char *pathname);
+
+  /** Write the Registry in binary format to a stream */
+  void WriteToBinaryStream(std::ostream &sout);
+
+  /**
+   * Read from a binary file. As with the other read methods, the contents
+   * are added to the registry. Throws IOException if the file is not valid.
+   */
+  void ReadFromBinaryFile(const char *pathname);
+
+  /** Read binary data from a stream */
+  void ReadFromBinaryStream(std::istream &sin);
+
   /** Print the registry in a tab-formatted way */
   void Print(std::ostream &sout, StringType indent = "  ", StringType prefix = "");
 
@@ -580,6 +606,9 @@ public:
     return false;
   }
 
+  /** quick method check if a file was written by WriteToBinaryFile */
+  static bool IsBinary(const char *name);
+
 private:
 
   // Hashtable type definition
@@ -603,6 +632,35 @@ private:
    */
   bool m_AddIfNotFound;
 
+  // Binary data shared by the folders read from one file
+  struct BinaryData;
+
+  // The binary contents of a folder that has not been parsed yet
+  struct BinaryFolder
+  {
+    std::shared_ptr<const BinaryData> data;
+    size_t offset, length;
+  };
+
+  /** Unparsed contents, or null once the folder has been parsed */
+  mutable std::unique_ptr<BinaryFolder> m_Unparsed;
+
+  /** Makes sure that the folder is parsed once, also by concurrent readers */
+  mutable std::once_flag m_MaterializeFlag;
+
+  /** Parse the contents of this folder if they have not been yet */
+  void Materialize() const;
+
+  /** Add the contents of a folder stored in binary format to this folder */
+  void ParseBinary(const std::shared_ptr<const BinaryData> &data, size_t offset, size_t length);
+
+  /** Write this folder recursively in binary format */
+  void WriteBinary(std::string &out, std::map<StringType, size_t> &keys,
+                   const BinaryData *base) const;
+
+  /** Find the binary data of an unparsed folder, without parsing any */
+  const BinaryData *FindUnparsedData() const;
+
   /** Write this folder recursively to a stream */
   void Write(std::ostream &sout,const StringType &keyPrefix);
 
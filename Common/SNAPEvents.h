@@ -168,6 +168,11 @@ itkEventMacro(SegmentationROIChangedEvent, IRISEvent)
 /** The mapping between display coordinates and anatomical coordinates changed */
 itkEventMacro(DisplayToAnatomyCoordinateMappingChangeEvent, IRISEvent)
 
+/** Background tasks (see TaskExecutionService) reported progress or finished */
+itkEventMacro(TaskEvent, IRISEvent)
+itkEventMacro(TaskProgressEvent, TaskEvent)
+itkEventMacro(TaskFinishedEvent, TaskEvent)
+
 // A setter method that fires events
 #define irisSetWithEventMacro(name,type,event) \
     virtual void Set##name (type _arg) \
@@ -0,0 +1,174 @@
+#include "SNAPInstrumentation.h"
+#include "json/json.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+std::atomic<bool> SNAPInstrumentation::m_Enabled(true);
+
+void
+InstrumentationHistogram
+::Add(uint64_t value)
+{
+  // Index of the highest bit set, plus one
+  int bin = 0;
+  for(uint64_t v = value; v; v >>= 1)
+    bin++;
+
+  m_Bins[std::min(bin, NUMBER_OF_BINS - 1)].fetch_add(1, std::memory_order_relaxed);
+  m_Count.fetch_add(1, std::memory_order_relaxed);
+  m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t max = m_Max.load(std::memory_order_relaxed);
+  while(value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    ;
+}
+
+uint64_t
+InstrumentationHistogram
+::GetQuantile(double q) const
+{
+  uint64_t n = this->GetCount();
+  if(n == 0)
+    return 0;
+
+  uint64_t target = (uint64_t) (q * n), cum = 0;
+  for(int bin = 0; bin < NUMBER_OF_BINS; bin++)
+    {
+    cum += this->GetBinCount(bin);
+    if(cum > target)
+      return std::min(bin ? (((uint64_t) 1) << bin) - 1 : 0, this->GetMax());
+    }
+  return this->GetMax();
+}
+
+void
+InstrumentationHistogram
+::Reset()
+{
+  m_Count = 0;
+  m_Sum = 0;
+  m_Max = 0;
+  for(int bin = 0; bin < NUMBER_OF_BINS; bin++)
+    m_Bins[bin] = 0;
+}
+
+SNAPInstrumentation *
+SNAPInstrumentation
+::GetInstance()
+{
+  static SNAPInstrumentation instance;
+  return &instance;
+}
+
+InstrumentationCounter *
+SNAPInstrumentation
+::GetCounter(const std::string &subsystem, const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto &ptr = m_Counters[KeyType(subsystem, name)];
+  if(!ptr)
+    ptr.reset(new InstrumentationCounter());
+  return ptr.get();
+}
+
+InstrumentationHistogram *
+SNAPInstrumentation
+::GetTimer(const std::string &subsystem, const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto &ptr = m_Timers[KeyType(subsystem, name)];
+  if(!ptr)
+    ptr.reset(new InstrumentationHistogram());
+  return ptr.get();
+}
+
+InstrumentationHistogram *
+SNAPInstrumentation
+::GetHistogram(const std::string &subsystem, const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto &ptr = m_Histograms[KeyType(subsystem, name)];
+  if(!ptr)
+    ptr.reset(new InstrumentationHistogram());
+  return ptr.get();
+}
+
+void
+SNAPInstrumentation
+::Reset()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  for(auto &it : m_Counters)
+    it.second->Reset();
+  for(auto &it : m_Timers)
+    it.second->Reset();
+  for(auto &it : m_Histograms)
+    it.second->Reset();
+}
+
+static void ExportHistogram(const InstrumentationHistogram *h, Json::Value &node, double scale)
+{
+  node["count"] = (Json::UInt64) h->GetCount();
+  node["total"] = h->GetSum() * scale;
+  node["mean"] = h->GetCount() ? h->GetSum() * scale / h->GetCount() : 0.0;
+  node["max"] = h->GetMax() * scale;
+  node["p50"] = h->GetQuantile(0.5) * scale;
+  node["p90"] = h->GetQuantile(0.9) * scale;
+  node["p99"] = h->GetQuantile(0.99) * scale;
+
+  // Non-empty bins, keyed by their upper edge
+  Json::Value &bins = node["bins"];
+  bins = Json::Value(Json::objectValue);
+  for(int bin = 0; bin < InstrumentationHistogram::NUMBER_OF_BINS; bin++)
+    {
+    uint64_t n = h->GetBinCount(bin);
+    if(n)
+      {
+      uint64_t upper = bin ? (((uint64_t) 1) << bin) - 1 : 0;
+      std::ostringstream key;
+      key << upper * scale;
+      bins[key.str()] = (Json::UInt64) n;
+      }
+    }
+}
+
+void
+SNAPInstrumentation
+::ExportToJSON(Json::Value &root) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  root = Json::Value(Json::objectValue);
+
+  // Timers are stored in nanoseconds and reported in milliseconds
+  for(auto &it : m_Timers)
+    ExportHistogram(it.second.get(), root[it.first.first]["timers"][it.first.second], 1.0e-6);
+
+  for(auto &it : m_Counters)
+    root[it.first.first]["counters"][it.first.second] = (Json::Int64) it.second->GetValue();
+
+  for(auto &it : m_Histograms)
+    ExportHistogram(it.second.get(), root[it.first.first]["histograms"][it.first.second], 1.0);
+}
+
+std::string
+SNAPInstrumentation
+::ExportToJSONString() const
+{
+  Json::Value root;
+  this->ExportToJSON(root);
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "  ";
+  return Json::writeString(builder, root);
+}
+
+bool
+SNAPInstrumentation
+::WriteJSON(const std::string &filename) const
+{
+  std::ofstream out(filename.c_str());
+  if(!out.good())
+    return false;
+  out << this->ExportToJSONString() << std::endl;
+  return out.good();
+}
@@ -0,0 +1,192 @@
+#ifndef SNAPINSTRUMENTATION_H
+#define SNAPINSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Json
+{
+class Value;
+}
+
+/**
+ * A counter that can be incremented from any thread.
+ */
+class InstrumentationCounter
+{
+public:
+  InstrumentationCounter() : m_Value(0) {}
+
+  void Add(int64_t n = 1) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+  int64_t GetValue() const { return m_Value.load(std::memory_order_relaxed); }
+  void Reset() { m_Value = 0; }
+
+private:
+  std::atomic<int64_t> m_Value;
+};
+
+/**
+ * A histogram of non-negative integer values, with bins whose edges are
+ * powers of two. Also keeps track of the count, the sum and the maximum of
+ * the values. It can be updated from any thread without locking. Timers are
+ * histograms of durations in nanoseconds.
+ */
+class InstrumentationHistogram
+{
+public:
+  static constexpr int NUMBER_OF_BINS = 64;
+
+  InstrumentationHistogram() { this->Reset(); }
+
+  /** Add a value. Bin k holds values in [2^(k-1), 2^k), bin 0 holds zero */
+  void Add(uint64_t value);
+
+  uint64_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+  uint64_t GetSum() const { return m_Sum.load(std::memory_order_relaxed); }
+  uint64_t GetMax() const { return m_Max.load(std::memory_order_relaxed); }
+  uint64_t GetBinCount(int bin) const { return m_Bins[bin].load(std::memory_order_relaxed); }
+
+  /** Approximate quantile: the upper edge of the bin that contains it */
+  uint64_t GetQuantile(double q) const;
+
+  void Reset();
+
+private:
+  std::atomic<uint64_t> m_Count, m_Sum, m_Max;
+  std::atomic<uint64_t> m_Bins[NUMBER_OF_BINS];
+};
+
+/**
+ * \class SNAPInstrumentation
+ * \brief Global collection of timers, counters and histograms.
+ *
+ * Measurements are keyed by a subsystem (e.g., "Slicing", "Mesh", "IO") and a
+ * name within the subsystem. Looking up a measurement takes a lock, so the
+ * macros below do the lookup once per call site and keep the pointer in a
+ * static variable. Recording a measurement only involves atomic operations.
+ *
+ * Recording can be switched off globally (SetEnabled), in which case scoped
+ * timers do not even read the clock. The collected data can be dumped as JSON
+ * (see the --dump-stats command line option) and queried through
+ * IRISApplication::GetInstrumentation().
+ */
+class SNAPInstrumentation
+{
+public:
+
+  /** Get the global instance */
+  static SNAPInstrumentation *GetInstance();
+
+  /** Globally enable or disable recording (enabled by default) */
+  static void SetEnabled(bool flag) { m_Enabled = flag; }
+  static bool IsEnabled() { return m_Enabled.load(std::memory_order_relaxed); }
+
+  /** Get (creating if needed) a measurement */
+  InstrumentationCounter *GetCounter(const std::string &subsystem, const std::string &name);
+  InstrumentationHistogram *GetTimer(const std::string &subsystem, const std::string &name);
+  InstrumentationHistogram *GetHistogram(const std::string &subsystem, const std::string &name);
+
+  /** Reset all measurements to zero (the measurements are not removed) */
+  void Reset();
+
+  /**
+   * Export all measurements. The output is an object with an entry for each
+   * subsystem, each containing "timers", "counters" and "histograms". Times
+   * are reported in milliseconds.
+   */
+  void ExportToJSON(Json::Value &root) const;
+
+  /** Export as a JSON string */
+  std::string ExportToJSONString() const;
+
+  /** Write the JSON to a file, returns false on failure */
+  bool WriteJSON(const std::string &filename) const;
+
+private:
+  SNAPInstrumentation() {}
+
+  typedef std::pair<std::string, std::string> KeyType;
+
+  std::map<KeyType, std::unique_ptr<InstrumentationCounter> > m_Counters;
+  std::map<KeyType, std::unique_ptr<InstrumentationHistogram> > m_Timers;
+  std::map<KeyType, std::unique_ptr<InstrumentationHistogram> > m_Histograms;
+
+  mutable std::mutex m_Mutex;
+
+  static std::atomic<bool> m_Enabled;
+};
+
+/**
+ * Measures the time between construction and destruction (or Stop()) and
+ * records it in a timer.
+ */
+class ScopedInstrumentationTimer
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  ScopedInstrumentationTimer(InstrumentationHistogram *timer)
+    : m_Timer(SNAPInstrumentation::IsEnabled() ? timer : nullptr)
+  {
+    if(m_Timer)
+      m_Start = Clock::now();
+  }
+
+  ~ScopedInstrumentationTimer() { this->Stop(); }
+
+  /** Record the elapsed time now rather than at the end of the scope */
+  void Stop()
+  {
+    if(m_Timer)
+      {
+      auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_Start);
+      m_Timer->Add((uint64_t) dt.count());
+      m_Timer = nullptr;
+      }
+  }
+
+private:
+  InstrumentationHistogram *m_Timer;
+  Clock::time_point m_Start;
+};
+
+#define irisInstrumentConcat_(a, b) a##b
+#define irisInstrumentConcat(a, b) irisInstrumentConcat_(a, b)
+
+/** Time the rest of the enclosing scope */
+#define irisInstrumentScopeMacro(subsystem, name) \
+  static InstrumentationHistogram *irisInstrumentConcat(_iris_timer_, __LINE__) = \
+    SNAPInstrumentation::GetInstance()->GetTimer(subsystem, name); \
+  ScopedInstrumentationTimer irisInstrumentConcat(_iris_scope_, __LINE__)( \
+    irisInstrumentConcat(_iris_timer_, __LINE__));
+
+/** Time a named scope, which can be stopped early by calling var.Stop() */
+#define irisInstrumentNamedScopeMacro(var, subsystem, name) \
+  static InstrumentationHistogram *irisInstrumentConcat(_iris_timer_, __LINE__) = \
+    SNAPInstrumentation::GetInstance()->GetTimer(subsystem, name); \
+  ScopedInstrumentationTimer var(irisInstrumentConcat(_iris_timer_, __LINE__));
+
+/** Increment a counter */
+#define irisInstrumentCountMacro(subsystem, name, n) \
+  { \
+    static InstrumentationCounter *_iris_counter = \
+      SNAPInstrumentation::GetInstance()->GetCounter(subsystem, name); \
+    if(SNAPInstrumentation::IsEnabled()) \
+      _iris_counter->Add(n); \
+  }
+
+/** Add a value to a histogram */
+#define irisInstrumentValueMacro(subsystem, name, value) \
+  { \
+    static InstrumentationHistogram *_iris_histogram = \
+      SNAPInstrumentation::GetInstance()->GetHistogram(subsystem, name); \
+    if(SNAPInstrumentation::IsEnabled()) \
+      _iris_histogram->Add(value); \
+  }
+
+#endif // SNAPINSTRUMENTATION_H
@@ -46,10 +46,12 @@
 #include "GlobalState.h"
 #include "SNAPRegistryIO.h"
 #include "HistoryManager.h"
+#include "ThumbnailService.h"
 #include "UIReporterDelegates.h"
 #include <itksys/Directory.hxx>
 #include <itksys/SystemTools.hxx>
 #include "itkVoxBoCUBImageIOFactory.h"
+#include "RLELabelImageIOFactory.h"
 #include <algorithm>
 #include <ctime>
 #include <cerrno>
@@ -166,22 +168,32 @@ SystemInterface
   // Initialize the history manager
   m_HistoryManager = new HistoryManager();
 
+  // Start the thumbnail writer
+  m_ThumbnailService = new ThumbnailService(m_SystemInfoDelegate);
+
   // Register the Image IO factories that are not part of ITK
   itk::ObjectFactoryBase::RegisterFactory( 
     itk::VoxBoCUBImageIOFactory::New() );
+  itk::ObjectFactoryBase::RegisterFactory(
+    RLELabelImageIOFactory::New() );
 
   // Make sure we have a preferences directory
   std::string appdir = GetApplicationDataDirectory();
   if(!itksys::SystemTools::MakeDirectory(appdir.c_str()))
      throw IRISException("Unable to create application data directory %s.", appdir.c_str());
 
-  // Set the preferences file
-  m_UserPreferenceFile = appdir + "/UserPreferences.xml";
+  // Set the preferences file. Preferences are stored in binary format, but
+  // older versions of SNAP wrote (and may still write) XML
+  m_UserPreferenceFile = appdir + "/UserPreferences.reg";
+  m_UserPreferenceXMLFile = appdir + "/UserPreferences.xml";
 }
 
 SystemInterface
 ::~SystemInterface()
 {
+  // Finishes writing the queued thumbnails
+  delete m_ThumbnailService;
+
   delete m_RegistryIO;
   delete m_HistoryManager;
 }
@@ -193,6 +205,18 @@ string SystemInterface::GetFullPathToExecutable() const
 }
 
 
+bool
+SystemInterface
+::IsXMLRegistryFileNewer(const std::string &fn_binary, const std::string &fn_xml)
+{
+  if(!SystemTools::FileExists(fn_xml.c_str(), true))
+    return false;
+
+  int cmp = 0;
+  return !SystemTools::FileExists(fn_binary.c_str(), true)
+      || (SystemTools::FileTimeCompare(fn_xml, fn_binary, &cmp) && cmp > 0);
+}
+
 void
 SystemInterface
 ::SaveUserPreferences()
@@ -201,7 +225,7 @@ SystemInterface
   m_HistoryManager->SaveGlobalHistory(this->Folder("IOHistory"));
 
   // Write the registry to disk
-  WriteToXMLFile(m_UserPreferenceFile.c_str());
+  WriteToBinaryFile(m_UserPreferenceFile.c_str());
 }
 
 
@@ -210,10 +234,14 @@ SystemInterface
 ::LoadUserPreferences()
 {
   // Check if the file exists, may throw an exception here
-  if(SystemTools::FileExists(m_UserPreferenceFile.c_str()))
+  bool use_xml = IsXMLRegistryFileNewer(m_UserPreferenceFile, m_UserPreferenceXMLFile);
+  if(use_xml || SystemTools::FileExists(m_UserPreferenceFile.c_str(), true))
     {
     // Read the contents of the preferences from file
-    ReadFromXMLFile(m_UserPreferenceFile.c_str());
+    if(use_xml)
+      ReadFromXMLFile(m_UserPreferenceXMLFile.c_str());
+    else
+      ReadFromBinaryFile(m_UserPreferenceFile.c_str());
 
     // Check if the preferences contain a version string
     string version = Entry("System.CreatedBySNAPVersion")["00000000"];
@@ -392,14 +420,22 @@ SystemInterface
   // If the code does not exist, return w/o success
   if(code.length() == 0) return false;
 
-  // Generate the association filename
+  // Generate the association filenames. Associations are stored in binary
+  // format, but older versions of SNAP wrote (and may still write) XML
   string appdir = GetApplicationDataDirectory();
-  string assfil = appdir + "/ImageAssociations/" + code + ".xml";
+  string assbin = appdir + "/ImageAssociations/" + code + ".reg";
+  string assxml = appdir + "/ImageAssociations/" + code + ".xml";
+
+  // Use the XML file if there is no binary file or if it is newer
+  bool use_xml = IsXMLRegistryFileNewer(assbin, assxml);
 
   // Try loading the registry
   try 
     {
-    registry.ReadFromXMLFile(assfil.c_str());
+    if(use_xml)
+      registry.ReadFromXMLFile(assxml.c_str());
+    else
+      registry.ReadFromBinaryFile(assbin.c_str());
     return true;
     }
   catch(...)
@@ -591,12 +627,12 @@ SystemInterface
                         assdir.c_str());
 
   // Create the association filename
-  string assfil = assdir + "/" + code + ".xml";
+  string assfil = assdir + "/" + code + ".reg";
 
   // Store the registry to that path
   try 
     {
-    registry.WriteToXMLFile(assfil.c_str());
+    registry.WriteToBinaryFile(assfil.c_str());
     return true;
     }
   catch(...)
@@ -638,12 +674,69 @@ SystemInterface
   return thumbdir + "/" + code + ".png";
 }
 
+std::string
+SystemInterface
+::GetStatisticsCacheAssociatedWithFile(const char *file)
+{
+  // Statistics are keyed by the same code as the thumbnails
+  string code = this->FindUniqueCodeForFile(file, true);
+
+  string appdir = this->GetApplicationDataDirectory();
+  string statdir = appdir + "/Statistics";
+  if(!SystemTools::MakeDirectory(statdir.c_str()))
+    throw IRISException("Unable to create statistics directory %s",
+                        statdir.c_str());
+
+  return statdir + "/" + code + ".stats";
+}
+
+void
+SystemInterface
+::TrimCacheDirectory(const std::string &dir, const char *extension,
+                     unsigned int max_files)
+{
+  // List the cache files with their modification times
+  vector<pair<long, string> > files;
+  Directory dlist;
+  if(!dlist.Load(dir.c_str()))
+    return;
+  for(size_t i = 0; i < dlist.GetNumberOfFiles(); i++)
+    {
+    string fname = dlist.GetFile(i);
+    string ffull = dir + "/" + fname;
+    if(SystemTools::GetFilenameLastExtension(fname) == extension
+       && SystemTools::FileExists(ffull.c_str(), true))
+      files.push_back(make_pair(SystemTools::ModifiedTime(ffull), ffull));
+    }
+
+  // Delete the oldest files
+  if(files.size() <= max_files)
+    return;
+  std::sort(files.begin(), files.end());
+  for(size_t i = 0; i < files.size() - max_files; i++)
+    SystemTools::RemoveFile(files[i].second);
+}
+
+std::string
+SystemInterface
+::GetImageSwapDirectory()
+{
+  string appdir = this->GetApplicationDataDirectory();
+  string swapdir = appdir + "/ImageSwap";
+  if(!SystemTools::MakeDirectory(swapdir.c_str()))
+    throw IRISException("Unable to create image swap directory %s",
+                        swapdir.c_str());
+
+  return swapdir;
+}
+
 void SystemInterface
-::WriteThumbnail(
-    const char *associated_file, ThumbnailImageType *thumbnail)
+::QueueThumbnail(
+    const char *associated_file, ThumbnailImageType *display_slice, unsigned int maxdim)
 {
+  // The filename is found here, since the code lookup uses the registry
   std::string thumb_fn = this->GetThumbnailAssociatedWithFile(associated_file);
-  this->m_SystemInfoDelegate->WriteRGBAImage2D(thumb_fn, thumbnail);
+  m_ThumbnailService->Submit(thumb_fn, display_slice, maxdim);
 }
 
 bool 
@@ -43,6 +43,7 @@ class IRISApplication;
 class SNAPRegistryIO;
 class HistoryManager;
 class SystemInfoDelegate;
+class ThumbnailService;
 class vtkCamera;
 
 
@@ -120,8 +121,26 @@ public:
   /** Get the thumbnail filename associated with an image file */
   std::string GetThumbnailAssociatedWithFile(const char *file);
 
-  /** Write a thumbnail */
-  void WriteThumbnail(const char *associated_file, ThumbnailImageType *thumbnail);
+  /**
+   * Queue a thumbnail made from a display slice to be written in the
+   * background (see ThumbnailService). The slice is copied, so it may be
+   * modified as soon as this method returns.
+   */
+  void QueueThumbnail(const char *associated_file, ThumbnailImageType *display_slice,
+                      unsigned int maxdim);
+
+  /** Get the filename of the cached intensity statistics of an image file */
+  std::string GetStatisticsCacheAssociatedWithFile(const char *file);
+
+  /**
+   * Delete the least recently modified files with the given extension from a
+   * directory, so that at most max_files remain. Used to bound caches.
+   */
+  static void TrimCacheDirectory(const std::string &dir, const char *extension,
+                                 unsigned int max_files);
+
+  /** Get the directory for the files that back very large images */
+  std::string GetImageSwapDirectory();
 
   /** A higher level method: associates current settings with the current image
    * so that the next time the image is loaded, it can be saved */
@@ -179,7 +198,11 @@ public:
   void LaunchChildSNAPSimple(std::list<std::string> args);
 
 private:
-  std::string m_UserPreferenceFile;
+  /** Whether a registry stored in binary format should be read from the XML
+    * file written by an older version instead, because it is newer */
+  static bool IsXMLRegistryFileNewer(const std::string &fn_binary, const std::string &fn_xml);
+
+  std::string m_UserPreferenceFile, m_UserPreferenceXMLFile;
   std::string m_DocumentationDirectory;
 
   // An object used to write large chunks of SNAP data to the registry
@@ -188,6 +211,9 @@ private:
   // History manager
   HistoryManager *m_HistoryManager;
 
+  // Writes thumbnails in the background
+  ThumbnailService *m_ThumbnailService;
+
   // Delegate
   static SystemInfoDelegate *m_SystemInfoDelegate;
 
@@ -0,0 +1,149 @@
+#include "ThumbnailService.h"
+#include "UIReporterDelegates.h"
+#include <itksys/SystemTools.hxx>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+ThumbnailService::ThumbnailService(SystemInfoDelegate *delegate, unsigned int max_queue_size)
+  : m_Delegate(delegate), m_MaxQueueSize(std::max(1u, max_queue_size))
+{
+  m_Worker = std::thread(&ThumbnailService::WorkerLoop, this);
+}
+
+ThumbnailService::~ThumbnailService()
+{
+  {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Stopping = true;
+  }
+  m_QueueCondition.notify_all();
+  m_Worker.join();
+}
+
+void
+ThumbnailService::Submit(const std::string &thumb_file, const ImageType *slice, unsigned int maxdim)
+{
+  if(!slice || slice->GetBufferedRegion().GetNumberOfPixels() == 0)
+    return;
+
+  // Copy the slice, since the display pipeline will overwrite it
+  Request request;
+  request.file = thumb_file;
+  request.maxdim = maxdim;
+  request.slice = ImageType::New();
+  request.slice->CopyInformation(slice);
+  request.slice->SetRegions(slice->GetBufferedRegion());
+  request.slice->Allocate();
+  std::copy(slice->GetBufferPointer(),
+            slice->GetBufferPointer() + slice->GetBufferedRegion().GetNumberOfPixels(),
+            request.slice->GetBufferPointer());
+
+  {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  // Replace a pending request for the same file
+  auto it = std::find_if(m_Queue.begin(), m_Queue.end(),
+                         [&thumb_file](const Request &r) { return r.file == thumb_file; });
+  if(it != m_Queue.end())
+    m_Queue.erase(it);
+
+  // Drop the oldest requests if the queue is full
+  while(m_Queue.size() >= m_MaxQueueSize)
+    m_Queue.pop_front();
+
+  m_Queue.push_back(request);
+  }
+  m_QueueCondition.notify_one();
+}
+
+void
+ThumbnailService::WorkerLoop()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(true)
+    {
+    // Pending requests are still written when stopping
+    m_QueueCondition.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+    if(m_Queue.empty())
+      break;
+
+    Request request = m_Queue.front();
+    m_Queue.pop_front();
+
+    lock.unlock();
+    this->Process(request);
+    lock.lock();
+    }
+}
+
+void
+ThumbnailService::Process(const Request &request)
+{
+  // A missing thumbnail is not worth interrupting the user for
+  try
+    {
+    SmartPtr<ImageType> thumb = MakeThumbnail(request.slice, request.maxdim);
+
+    // Write to a temporary file that is renamed when complete. The suffix
+    // determines the format, so it must remain .png
+    std::string base = itksys::SystemTools::GetFilenameWithoutLastExtension(request.file);
+    std::string dir = itksys::SystemTools::GetFilenamePath(request.file);
+    std::string temp_file = dir + "/" + base + ".part.png";
+    m_Delegate->WriteRGBAImage2D(temp_file, thumb);
+    if(!itksys::SystemTools::RenameFile(temp_file, request.file))
+      itksys::SystemTools::RemoveFile(temp_file);
+    }
+  catch(std::exception &exc)
+    {
+    std::cerr << "Failed to write thumbnail " << request.file << ": " << exc.what() << std::endl;
+    }
+}
+
+SmartPtr<ThumbnailService::ImageType>
+ThumbnailService::MakeThumbnail(const ImageType *slice, unsigned int maxdim)
+{
+  ImageType::SizeType sz = slice->GetBufferedRegion().GetSize();
+  ImageType::SpacingType spc = slice->GetSpacing();
+
+  // Spacing of the thumbnail, such that the longer side of the slice fits
+  double ext_x = sz[0] * spc[0], ext_y = sz[1] * spc[1];
+  double spc_thumb = std::max(ext_x, ext_y) / maxdim;
+
+  SmartPtr<ImageType> thumb = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(0, maxdim);
+  region.SetSize(1, maxdim);
+  thumb->SetRegions(region);
+  thumb->Allocate();
+
+  PixelType background;
+  background.Set(0, 0, 0, 255);
+
+  // Sample the slice at the center of each thumbnail pixel, with the center
+  // of the thumbnail at the center of the slice
+  const PixelType *src = slice->GetBufferPointer();
+  PixelType *out = thumb->GetBufferPointer();
+  for(unsigned int v = 0; v < maxdim; v++)
+    {
+    double y = (v + 0.5 - 0.5 * maxdim) * spc_thumb + 0.5 * ext_y;
+    long j = (long) std::floor(y / spc[1]);
+    PixelType *out_line = out + (maxdim - 1 - v) * maxdim;
+    for(unsigned int u = 0; u < maxdim; u++)
+      {
+      double x = (u + 0.5 - 0.5 * maxdim) * spc_thumb + 0.5 * ext_x;
+      long i = (long) std::floor(x / spc[0]);
+      if(i >= 0 && j >= 0 && i < (long) sz[0] && j < (long) sz[1])
+        {
+        out_line[u] = src[j * sz[0] + i];
+        out_line[u][3] = 255;
+        }
+      else
+        {
+        out_line[u] = background;
+        }
+      }
+    }
+
+  return thumb;
+}
@@ -0,0 +1,77 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include "SNAPCommon.h"
+#include <itkImage.h>
+#include <itkRGBAPixel.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class SystemInfoDelegate;
+
+/**
+ * \class ThumbnailService
+ * \brief Writes the thumbnails of the recent file lists on a background thread.
+ *
+ * The caller passes a display slice that it has already computed. The slice
+ * is copied, and the scaling, flipping and PNG encoding are done on a worker
+ * thread, so that opening and saving images does not wait for thumbnails.
+ * The queue is bounded: a new request for a file replaces a pending request
+ * for the same file, and when the queue is full, the oldest request is
+ * dropped. Thumbnails are written to a temporary file and renamed, so that
+ * readers never see a partially written file. Pending requests are completed
+ * before the service is destroyed.
+ */
+class ThumbnailService
+{
+public:
+  typedef itk::RGBAPixel<unsigned char> PixelType;
+  typedef itk::Image<PixelType, 2> ImageType;
+
+  ThumbnailService(SystemInfoDelegate *delegate, unsigned int max_queue_size = 8);
+  ~ThumbnailService();
+
+  /**
+   * Queue a thumbnail of at most maxdim by maxdim pixels made from the
+   * slice, to be written to the given PNG file
+   */
+  void Submit(const std::string &thumb_file, const ImageType *slice, unsigned int maxdim);
+
+  /**
+   * Make a square, opaque thumbnail from a display slice. The slice is scaled
+   * to fit, preserving its physical aspect ratio, and centered on a black
+   * background. The rows are flipped, since display slices are stored with
+   * the origin at the bottom and images files with the origin at the top.
+   */
+  static SmartPtr<ImageType> MakeThumbnail(const ImageType *slice, unsigned int maxdim);
+
+protected:
+
+  struct Request
+  {
+    std::string file;
+    SmartPtr<ImageType> slice;
+    unsigned int maxdim;
+  };
+
+  // Worker thread main loop
+  void WorkerLoop();
+
+  // Make and write one thumbnail
+  void Process(const Request &request);
+
+  SystemInfoDelegate *m_Delegate;
+  unsigned int m_MaxQueueSize;
+
+  std::deque<Request> m_Queue;
+  bool m_Stopping = false;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_QueueCondition;
+  std::thread m_Worker;
+};
+
+#endif // THUMBNAILSERVICE_H
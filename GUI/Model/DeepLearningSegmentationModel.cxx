@@ -9,13 +9,11 @@
 #include "UIReporterDelegates.h"
 #include "SegmentationUpdateIterator.h"
 #include "AllPurposeProgressAccumulator.h"
+#include "SNAPInstrumentation.h"
 #include "base64.h"
-#include <chrono>
 #include <regex>
 #include "itksys/MD5.h"
 
-typedef std::chrono::high_resolution_clock Clock;
-
 
 #if defined(ITKZLIB) && !defined(ITK_USE_SYSTEM_ZLIB)
 #include "itk_zlib.h"
@@ -661,11 +659,10 @@ DeepLearningSegmentationModel::SetSourceImage(ImageWrapperBase *layer)
   // Check if we have an open session with the server, if not establish it
   if(m_ActiveSession.size() == 0)
   {
-    Clock::time_point t0, t1;
-    t0 = Clock::now();
+    irisInstrumentNamedScopeMacro(tSession, "DeepLearning", "Initialize session");
     if(!cli.Get("start_session"))
       throw IRISException("Error creating session on DLS server: %s", cli.GetErrorString());
-    t1 = Clock::now();
+    tSession.Stop();
 
     Json::Reader json_reader;
     Json::Value root;
@@ -676,10 +673,6 @@ DeepLearningSegmentationModel::SetSourceImage(ImageWrapperBase *layer)
     }
     else
       throw IRISException("Error creating session on DSL server: unexpected return value '%s'", cli.GetOutput());
-
-    std::cout << "Initialize session time: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms "
-              << std::endl;
   }
 
   // Send the current image to the server
@@ -688,22 +681,21 @@ DeepLearningSegmentationModel::SetSourceImage(ImageWrapperBase *layer)
   LayerSelection sel = std::make_tuple(layer->GetUniqueId(), tp);
   if(m_ActiveLayer != sel)
   {
-    Clock::time_point t0, t1, t2, t3, t4, t5;
-
     // Export the current image to a file that can be uploaded
-    t0 = Clock::now();
+    irisInstrumentNamedScopeMacro(tPipeline, "DeepLearning", "Image export pipeline");
     auto *id = driver->GetCurrentImageData();
     using FloatImageType = typename ImageWrapperBase::FloatImageType;
     FloatImageType *src = layer->GetDefaultScalarRepresentation()->CreateCastToFloatPipeline("DLSExport");
     src->Update();
-    t1 = Clock::now();
+    tPipeline.Stop();
 
     // Create a Mime packet
     RESTMultipartData mpd;
     std::string gzip_buffer;
-    t2 = Clock::now();
+    irisInstrumentNamedScopeMacro(tCompress, "DeepLearning", "Image compression");
     EncodeImage(mpd, src, gzip_buffer);
-    t3 = Clock::now();
+    tCompress.Stop();
+    irisInstrumentValueMacro("DeepLearning", "Upload size (bytes)", gzip_buffer.size());
 
     // Create a command for progress reporting
     auto *pdel = m_ParentModel->GetProgressReporterDelegate();
@@ -716,12 +708,12 @@ DeepLearningSegmentationModel::SetSourceImage(ImageWrapperBase *layer)
     // Write the image in NIFTI format to a temporary location
     cli.SetProgressCallback(transfer_progress_src, AllPurposeProgressAccumulator::GenericProgressCallback);
 
-    t4 = Clock::now();
+    irisInstrumentNamedScopeMacro(tUpload, "DeepLearning", "Image upload");
     if(!cli.PostMultipart("upload_raw/%s?filename=upload.nii.gz", &mpd, m_ActiveSession.c_str()))
     {
       throw IRISException("Error uploading image to DSL server: %s", cli.GetErrorString());
     }
-    t5 = Clock::now();
+    tUpload.Stop();
 
     // Hide the progress reporter
     pdel->Hide();
@@ -730,18 +722,6 @@ DeepLearningSegmentationModel::SetSourceImage(ImageWrapperBase *layer)
     layer->ReleaseInternalPipeline("DLSExport");
     accum->UnregisterAllSources();
 
-    std::cout << "Pipeline time: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms "
-              << std::endl;
-
-    std::cout << "Compression time: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(t3 - t2).count() << " ms "
-              << std::endl;
-
-    std::cout << "Server time: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(t5 - t4).count() << " ms "
-              << std::endl;
-
     m_ActiveLayer = sel;
     m_LabelState = -1;
     // pdel->Hide();
@@ -805,15 +785,12 @@ DeepLearningSegmentationModel::UpdateSegmentation(const char *json, const char *
               << (int)((unsigned char)result_gzip[1]) << std::endl;
     // std::string result_raw = gzip_decompress(result_gzip, expected_size);
     std::string result_raw;
-    auto        t2 = Clock::now();
+    irisInstrumentValueMacro("DeepLearning", "Result payload size (bytes)", result_b64.size());
+    irisInstrumentNamedScopeMacro(tInflate, "DeepLearning", "Result decompression");
     result_raw.reserve(expected_size);
     if (!gzipInflate(result_gzip, result_raw))
       throw IRISException("Error decompressing gzipped payload");
-    auto t3 = Clock::now();
-
-    std::cout << "Gzip time: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(t3 - t2).count() << " ms "
-              << std::endl;
+    tInflate.Stop();
 
     std::cout << "After gzip decoding: " << result_raw.size() << std::endl;
     std::cout << "Expected: " << expected_size << std::endl;
@@ -892,8 +869,7 @@ DeepLearningSegmentationModel::PerformPointInteraction(ImageWrapperBase *layer,
   std::lock_guard<std::mutex> guard(m_Mutex); // Prevent two threads doing IO at once
 
          // Perform the drawing command
-  Clock::time_point t0, t1, t2, t3;
-  t0 = Clock::now();
+  irisInstrumentNamedScopeMacro(tInteract, "DeepLearning", "Point interaction");
   RESTClientType cli(m_RESTSharedData);
   cli.SetServerURL(GetActualServerURL().c_str());
   if(!cli.Get("process_point_interaction/%s?x=%d&y=%d&z=%d&foreground=%s",
@@ -904,10 +880,7 @@ DeepLearningSegmentationModel::PerformPointInteraction(ImageWrapperBase *layer,
     std::cerr << "RESP:" << cli.GetOutput() << std::endl;
     throw IRISException("Failed to send current coordinate to the server");
   }
-  t1 = Clock::now();
-  std::cout << "Interaction time: "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms "
-            << std::endl;
+  tInteract.Stop();
 
   return this->UpdateSegmentation(cli.GetOutput(), "nnInteractive point interaction");
 }
@@ -932,15 +905,15 @@ DeepLearningSegmentationModel::PerformScribbleOrLassoInteraction(const char
 
   // TODO: this is a ridiculous waste of time, expanding a small RLE image to then compress
   // it with gzip. Instead, implement RLE on the server.
-  auto t0 = Clock::now();
+  irisInstrumentNamedScopeMacro(tEncode, "DeepLearning", "Segmentation encoding");
   using FloatImageType = typename ImageWrapperBase::FloatImageType;
   FloatImageType *src = seg->CreateCastToFloatPipeline("DLSExport");
   src->Update();
   EncodeImage(mpd, src, gzip_buffer);
-  auto t1 = Clock::now();
+  tEncode.Stop();
 
   // Perform the drawing command
-  auto       t2 = Clock::now();
+  irisInstrumentNamedScopeMacro(tInteract, "DeepLearning", "Scribble interaction");
   RESTClientType cli(m_RESTSharedData);
   cli.SetServerURL(GetActualServerURL().c_str());
   if (!cli.PostMultipart(
@@ -949,13 +922,7 @@ DeepLearningSegmentationModel::PerformScribbleOrLassoInteraction(const char
     std::cerr << "RESP:" << cli.GetOutput() << std::endl;
     throw IRISException("Failed to send current coordinate to the server");
   }
-  auto t3 = Clock::now();
-  std::cout << "Encoding time: "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms "
-            << std::endl;
-  std::cout << "Interaction time: "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(t3 - t2).count() << " ms "
-            << std::endl;
+  tInteract.Stop();
 
   return this->UpdateSegmentation(cli.GetOutput(), "nnInteractive scribble interaction");
 }
@@ -3,6 +3,8 @@
 #include "GlobalUIModel.h"
 #include "SNAPAppearanceSettings.h"
 #include <itkImageLinearConstIteratorWithIndex.h>
+#include <algorithm>
+#include <cmath>
 
 
 DeformationGridModel
@@ -58,6 +60,20 @@ GetVertices(ImageWrapperBase *layer, DeformationGridVertices &v) const
       d_grid_d_ind[b] = m_Parent->ComputeGridPosition(phi, ind, layer) - G0;
       }
 
+    // When the view is zoomed out, the orthogonal slice may be sampled with a
+    // step, each of its pixels averaging a block of voxels. The blocks cover
+    // the slice exactly, so their size is the ratio of the spacings. Map slice
+    // indices to the centers of the blocks.
+    if(layer->IsSlicingOrthogonal())
+      {
+      for(int b = 0; b < 2; b++)
+        {
+        double step = std::max(1.0, slice->GetSpacing()[b] / m_Parent->GetSliceSpacing()[b]);
+        G0 += d_grid_d_ind[b] * (0.5 * (step - 1.0));
+        d_grid_d_ind[b] *= step;
+        }
+      }
+
     size_t nd0[2] {0, 0}, nd1[2] {0, 0};
     bool counted = false;
 
@@ -76,7 +92,7 @@ GetVertices(ImageWrapperBase *layer, DeformationGridVertices &v) const
         // Figure out how frequently to sample lines. The spacing on the screen should be at
         // most every 4 pixels. Zoom is in units of px/mm. Spacing is in units of mm/vox, so
         // zoom * spacing is (display pixels) / (image voxels).
-        double disp_pix_per_vox = m_Parent->GetSliceSpacing()[d] * m_Parent->GetViewZoom();
+        double disp_pix_per_vox = slice->GetSpacing()[d] * m_Parent->GetViewZoom();
         vox_increment = (int) ceil(8.0 / disp_pix_per_vox);
         }
       else
@@ -235,7 +235,8 @@ void Generic3DModel::OnImageGeometryUpdate()
     }
 }
 
-void Generic3DModel::UpdateSegmentationMesh(itk::Command *progressCmd)
+void Generic3DModel::UpdateSegmentationMesh(itk::Command *progressCmd,
+                                            TaskCancellationToken *token)
 {
   // Prevent concurrent access to this method
   std::lock_guard<std::mutex> guard(m_Mutex);
@@ -250,7 +251,7 @@ void Generic3DModel::UpdateSegmentationMesh(itk::Command *progressCmd)
           (GenericImageData*) m_Driver->GetSNAPImageData() : m_Driver->GetIRISImageData();
 
     // Update Mesh Layer
-    imgData->GetMeshLayers()->UpdateActiveMeshLayer(progressCmd);
+    imgData->GetMeshLayers()->UpdateActiveMeshLayer(progressCmd, token);
 
     m_MeshUpdating = false;
 
@@ -261,10 +262,16 @@ void Generic3DModel::UpdateSegmentationMesh(itk::Command *progressCmd)
     m_MeshUpdating = false;
     throw IRISException("Out of memory during mesh computation");
   }
-  catch(IRISException & IRISexc)
+  catch(IRISException &)
   {
+    // Rethrow as is, so that a cancellation reaches the task service
     m_MeshUpdating = false;
-    throw IRISexc;
+    throw;
+  }
+  catch(itk::ProcessAborted &)
+  {
+    m_MeshUpdating = false;
+    throw;
   }
 }
 
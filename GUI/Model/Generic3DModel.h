@@ -14,6 +14,7 @@ class Generic3DRenderer;
 class vtkPolyData;
 class MeshExportSettings;
 class ImageMeshLayers;
+class TaskCancellationToken;
 
 namespace itk
 {
@@ -66,8 +67,10 @@ public:
   // A flag indicating the color bar should be displayed
   irisSimplePropertyAccessMacro(DisplayColorBar, bool)
 
-  // Tell the model to update the segmentation mesh
-  void UpdateSegmentationMesh(itk::Command *progressCmd);
+  // Tell the model to update the segmentation mesh. If a cancellation token
+  // is given, the update is aborted when the token is cancelled
+  void UpdateSegmentationMesh(itk::Command *progressCmd,
+                              TaskCancellationToken *token = nullptr);
 
   // Reentrant function to check if mesh is being constructed in another thread
   bool IsMeshUpdating();
@@ -74,6 +74,7 @@ ImageIOWizardModel
   m_DisplayName = delegate->GetDisplayName();
   m_GuidedIO = GuidedNativeImageIO::New();
   m_LoadDelegate = delegate;
+  m_LoadDelegate->ConfigureImageIO(m_GuidedIO);
   m_SaveDelegate = NULL;
   m_Overlay = delegate->IsOverlay();
   m_LoadedImage = NULL;
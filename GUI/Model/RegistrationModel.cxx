@@ -680,8 +680,10 @@ void RegistrationModel::RunAutoRegistration()
   //   Greedy is using BufferredRegion to create cost functions.
   //   Without updating, the bufferred region will be [0,0,0],
   //   and it will cause divide-by-zero error on the greedy side
-  if(fixed_cast->GetSource()) fixed_cast->GetSource()->Update();
-  if(moving_cast->GetSource()) moving_cast->GetSource()->Update();
+  //   The cast outputs are shared with other consumers and only hold the
+  //   region that was last requested, so the whole image is requested here
+  if(fixed_cast->GetSource()) fixed_cast->GetSource()->UpdateLargestPossibleRegion();
+  if(moving_cast->GetSource()) moving_cast->GetSource()->UpdateLargestPossibleRegion();
 
   // Caster for the mask image - declared here so that SmartPtr does not go out of scope
   ImageWrapperBase::FloatImageType *mask_cast;
@@ -819,8 +821,10 @@ void RegistrationModel::MatchByMoments(int order)
   //   Greedy is using BufferredRegion to create cost functions.
   //   Without updating, the bufferred region will be [0,0,0],
   //   and it will cause divide-by-zero error on the greedy side
-  if(fixed_cast->GetSource()) fixed_cast->GetSource()->Update();
-  if(moving_cast->GetSource()) moving_cast->GetSource()->Update();
+  //   The cast outputs are shared with other consumers and only hold the
+  //   region that was last requested, so the whole image is requested here
+  if(fixed_cast->GetSource()) fixed_cast->GetSource()->UpdateLargestPossibleRegion();
+  if(moving_cast->GetSource()) moving_cast->GetSource()->UpdateLargestPossibleRegion();
 
   // Set up the parameters for greedy registration
   GreedyParameters param;
@@ -26,6 +26,10 @@ SnakeParameterModel::SnakeParameterModel()
   m_SpeedupFactorModel = wrapGetterSetterPairAsProperty(
         this, &Self::GetSpeedupFactorValueAndRange, &Self::SetSpeedupFactorValue);
 
+  m_MultiResolutionLevelsModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetMultiResolutionLevelsValueAndRange,
+        &Self::SetMultiResolutionLevelsValue);
+
   m_AdvancedEquationModeModel = NewSimpleConcreteProperty(false);
 
   m_CasellesOrAdvancedModeModel = wrapGetterSetterPairAsProperty(
@@ -372,6 +376,27 @@ SnakeParameterModel
   m_ParametersModel->SetValue(param);
 }
 
+bool
+SnakeParameterModel
+::GetMultiResolutionLevelsValueAndRange(int &value, NumericValueRange<int> *domain)
+{
+  value = m_ParametersModel->GetValue().GetMultiResolutionLevels();
+
+  if(domain)
+    domain->Set(1, 4, 1);
+
+  return true;
+}
+
+void
+SnakeParameterModel
+::SetMultiResolutionLevelsValue(int value)
+{
+  SnakeParameters param = m_ParametersModel->GetValue();
+  param.SetMultiResolutionLevels(value);
+  m_ParametersModel->SetValue(param);
+}
+
 bool SnakeParameterModel::GetCasellesOrAdvancedModeValue()
 {
   return this->GetAdvancedEquationModeModel()->GetValue() || (!this->IsRegionSnake());
@@ -55,6 +55,9 @@ public:
   // Speedup factor
   irisRangedPropertyAccessMacro(SpeedupFactor, double)
 
+  // Number of resolution levels for coarse-to-fine evolution
+  irisRangedPropertyAccessMacro(MultiResolutionLevels, int)
+
   // The model for whether the advanced mode (exponents) is on
   irisSimplePropertyAccessMacro(AdvancedEquationMode, bool)
   irisSimplePropertyAccessMacro(CasellesOrAdvancedMode, bool)
@@ -100,6 +103,11 @@ protected:
       double &value, NumericValueRange<double> *domain);
   void SetSpeedupFactorValue(double value);
 
+  SmartPtr<AbstractRangedIntProperty> m_MultiResolutionLevelsModel;
+  bool GetMultiResolutionLevelsValueAndRange(
+      int &value, NumericValueRange<int> *domain);
+  void SetMultiResolutionLevelsValue(int value);
+
   SmartPtr<ConcreteSimpleBooleanProperty> m_AdvancedEquationModeModel;
 
   SmartPtr<AbstractSimpleBooleanProperty> m_CasellesOrAdvancedModeModel;
@@ -1432,6 +1432,34 @@ bool SnakeWizardModel::PerformEvolutionStep()
   return false;
 }
 
+void SnakeWizardModel::StartEvolution()
+{
+  m_Driver->GetSNAPImageData()->StartSegmentation(m_StepSizeModel->GetValue());
+}
+
+void SnakeWizardModel::StopEvolution()
+{
+  SNAPImageData *sid = m_Driver->GetSNAPImageData();
+  if(sid && sid->IsSegmentationActive())
+    {
+    sid->StopSegmentation();
+
+    // Fire an event
+    InvokeEvent(EvolutionIterationEvent());
+    }
+}
+
+bool SnakeWizardModel::RefreshEvolutionDisplay()
+{
+  SNAPImageData *sid = m_Driver->GetSNAPImageData();
+
+  // Fire an event if there is a new snapshot on display
+  if(sid->UpdateSegmentationSnapshot())
+    InvokeEvent(EvolutionIterationEvent());
+
+  return !sid->IsSegmentationRunning();
+}
+
 int SnakeWizardModel::GetEvolutionIterationValue()
 {
   if(m_Driver->IsSnakeModeActive() &&
@@ -208,6 +208,18 @@ public:
    */
   bool PerformEvolutionStep();
 
+  /** Start evolving the snake on a worker thread */
+  void StartEvolution();
+
+  /** Stop the evolution started by StartEvolution() */
+  void StopEvolution();
+
+  /**
+   * Display the latest state of the snake evolving on the worker thread.
+   * Returns true if the evolution is no longer running.
+   */
+  bool RefreshEvolutionDisplay();
+
   /** Rewind the evolution */
   void RewindEvolution();
 
@@ -331,6 +331,19 @@ void SynchronizationModel::SetWarpLayerValue(unsigned long value)
 }
 
 
+bool
+SynchronizationModel::WaitForIPCMessage(int timeout_ms)
+{
+  return m_IPCHandler && m_IPCHandler->WaitForMessage(timeout_ms);
+}
+
+void
+SynchronizationModel::InterruptIPCWait()
+{
+  if(m_IPCHandler)
+    m_IPCHandler->InterruptWait();
+}
+
 void
 SynchronizationModel::ReadIPCState(bool only_read_new)
 {
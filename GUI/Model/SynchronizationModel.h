@@ -48,9 +48,19 @@ public:
   /** Enable sync debugging */
   irisGetSetMacro(DebugSync, bool)
 
-  /** This method should be called by UI at regular intervals to read IPC state */
+  /** This method should be called by UI when IPC messages arrive to read IPC state */
   void ReadIPCState(bool only_read_new=true);
 
+  /**
+   * Block until another session may have broadcast a message, or until the
+   * timeout expires. This may be called from a listener thread, which should
+   * then have the UI thread call ReadIPCState().
+   */
+  bool WaitForIPCMessage(int timeout_ms);
+
+  /** Wake up a thread blocked in WaitForIPCMessage() */
+  void InterruptIPCWait();
+
 protected:
 
   SynchronizationModel();
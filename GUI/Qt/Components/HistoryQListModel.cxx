@@ -16,7 +16,6 @@
 #include <QPixmapCache>
 #include <QFileInfo>
 #include <QIcon>
-#include <QTimer>
 
 HistoryQListModel::HistoryQListModel(QObject *parent) :
   QStandardItemModel(parent)
@@ -39,72 +38,42 @@ void HistoryQListItem::setItem(
   // Set the filename
   this->setToolTip(history_entry);
   this->setData(history_entry, Qt::UserRole);
-  QPixmap dummy(128, 128);
-  dummy.fill(Qt::black);
-  this->setIcon(QIcon(dummy));
 
   // At the moment, these are hard-coded
   this->setSizeHint(QSize(188,144));
 
-  // Deal with the icon later
+  // The icon is loaded when it is first displayed
   std::string hist_str = to_utf8(history_entry);
   std::string thumbnail =
       model->GetDriver()->GetSystemInterface()->GetThumbnailAssociatedWithFile(hist_str.c_str());
 
   m_IconFilename = from_utf8(thumbnail);
-
-  // TODO: for debugging change 0 to a random number
-  QTimer::singleShot(0, this, SLOT(onTimer()));
 }
 
-void HistoryQListItem::onTimer()
+QVariant HistoryQListItem::data(int role) const
 {
+  if(role != Qt::DecorationRole)
+    return QStandardItem::data(role);
+
   // Construct a string from the filenane and the timestamp
+  QFileInfo info(m_IconFilename);
   QString key = QString("%1::%2")
                 .arg(m_IconFilename)
-                .arg(QFileInfo(m_IconFilename).lastModified().toString());
+                .arg(info.lastModified().toString());
 
   QPixmap pixmap;
-  if(QPixmapCache::find(key, &pixmap))
-    this->setIcon(QIcon(pixmap));
-  else
+  if(!QPixmapCache::find(key, &pixmap))
     {
-    try
+    // Missing thumbnails are shown as black squares
+    if(!info.exists() || !pixmap.load(m_IconFilename))
       {
-    /*
-      // Load the icon using ITK to avoid this really annoying warning
-      // from the PNG library. The only problem is that QIcon caches
-      typedef itk::RGBAPixel<unsigned char> PNGPixelType;
-      typedef itk::Image<PNGPixelType, 2> PNGSliceType;
-      typedef itk::ImageFileReader<PNGSliceType> PNGReaderType;
-      SmartPtr<PNGReaderType> reader = PNGReaderType::New();
-      reader->SetFileName(to_utf8(m_IconFilename).c_str());
-      reader->Update();
-
-      // Need to load the icon
-      SmartPtr<PNGSliceType> slice = reader->GetOutput();
-      int w = slice->GetBufferedRegion().GetSize()[0];
-      int h = slice->GetBufferedRegion().GetSize()[1];
-      QImage image(w, h, QImage::Format_ARGB32);
-      PNGPixelType *input = slice->GetBufferPointer();
-      QRgb *output = reinterpret_cast<QRgb*>(image.bits());
-      for(int i = 0; i < slice->GetPixelContainer()->Size(); i++)
-        {
-        *output++ = qRgba(input[i].GetRed(), input[i].GetGreen(), input[i].GetBlue(), input[i].GetAlpha());
-        } */
-
-      QPixmap load_pixmap(m_IconFilename);
-      this->setIcon(QIcon(load_pixmap));
-      QPixmapCache::insert(key, load_pixmap);
-      }
-    catch(itk::ExceptionObject &)
-      {
-      QPixmap dummy(128, 128);
-      dummy.fill(Qt::black);
-      this->setIcon(QIcon(dummy));
-      QPixmapCache::insert(key, dummy);
+      pixmap = QPixmap(128, 128);
+      pixmap.fill(Qt::black);
       }
+    QPixmapCache::insert(key, pixmap);
     }
+
+  return QIcon(pixmap);
 }
 
 void HistoryQListModel::rebuildModel()
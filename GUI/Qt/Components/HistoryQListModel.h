@@ -20,9 +20,12 @@ public:
 
   virtual void setItem(GlobalUIModel *model, const QString &history_entry);
 
-protected slots:
-
-  void onTimer();
+  /**
+   * Returns the thumbnail as the decoration. The thumbnail is read from disk
+   * only when the view asks for it, i.e., when the item is shown, and is read
+   * again when the file changes, e.g., after it is written in the background.
+   */
+  virtual QVariant data(int role = Qt::UserRole + 1) const override;
 
 protected:
 
@@ -1,13 +1,24 @@
 #include "QtIPCManager.h"
 #include "SNAPEvents.h"
 #include "SynchronizationModel.h"
+#include <QThread>
 
 
 QtIPCManager::QtIPCManager(QWidget *parent) :
   SNAPComponent(parent)
 {
-  // Start the IPC timer at 30ms intervals
-  startTimer(30);
+}
+
+QtIPCManager::~QtIPCManager()
+{
+  // Stop the listener thread
+  if(m_ListenerThread)
+    {
+    m_StopListening = true;
+    m_Model->InterruptIPCWait();
+    m_ListenerThread->wait();
+    delete m_ListenerThread;
+    }
 }
 
 void QtIPCManager::SetModel(SynchronizationModel *model)
@@ -16,6 +27,18 @@ void QtIPCManager::SetModel(SynchronizationModel *model)
 
   // Listen to update events from the model
   connectITK(m_Model, ModelUpdateEvent());
+
+  // Start a thread that waits for messages from other sessions. The wait
+  // times out periodically so that the thread can check if it should stop.
+  m_ListenerThread = QThread::create([this]() {
+    while(!m_StopListening)
+      {
+      // Schedule a single read on the GUI thread for any number of messages
+      if(m_Model->WaitForIPCMessage(250) && !m_ReadPending.exchange(true))
+        QMetaObject::invokeMethod(this, "onIPCMessage", Qt::QueuedConnection);
+      }
+  });
+  m_ListenerThread->start();
 }
 
 void QtIPCManager::onModelUpdate(const EventBucket &bucket)
@@ -24,10 +47,9 @@ void QtIPCManager::onModelUpdate(const EventBucket &bucket)
   m_Model->Update();
 }
 
-void QtIPCManager::timerEvent(QTimerEvent *)
+void QtIPCManager::onIPCMessage()
 {
+  m_ReadPending = false;
   if(!m_Model) return;
   m_Model->ReadIPCState();
 }
-
-
@@ -3,20 +3,24 @@
 
 #include <QObject>
 #include <SNAPComponent.h>
+#include <atomic>
 
 class SynchronizationModel;
+class QThread;
 
 /**
  * @brief This class manages IPC communications between SNAP sessions on the
- * GUI level. It uses Qt's timers to schedule checks for IPC updates, and it
- * listens to the events from the model layer in order to send IPC messages
- * out.
+ * GUI level. A listener thread blocks until another session broadcasts a
+ * message and then schedules a read of the IPC state on the GUI thread. It
+ * also listens to the events from the model layer in order to send IPC
+ * messages out.
  */
 class QtIPCManager : public SNAPComponent
 {
   Q_OBJECT
 public:
   explicit QtIPCManager(QWidget *parent = 0);
+  virtual ~QtIPCManager();
 
   void SetModel(SynchronizationModel *model);
   
@@ -26,13 +30,20 @@ public slots:
 
   virtual void onModelUpdate(const EventBucket &bucket);
 
-protected:
+protected slots:
 
-  virtual void timerEvent(QTimerEvent *);
+  void onIPCMessage();
 
 private:
 
-  SynchronizationModel *m_Model;
+  SynchronizationModel *m_Model = nullptr;
+
+  // Thread waiting for IPC messages
+  QThread *m_ListenerThread = nullptr;
+  std::atomic<bool> m_StopListening { false };
+
+  // Whether a read is already scheduled on the GUI thread
+  std::atomic<bool> m_ReadPending { false };
 };
 
 #endif // QTIPCMANAGER_H
@@ -340,17 +340,26 @@ void SnakeWizardPanel::on_stack_currentChanged(int page)
 
 void SnakeWizardPanel::on_btnPlay_toggled(bool checked)
 {
-  // This is where we toggle the snake evolution!
+  // This is where we toggle the snake evolution! The snake evolves on a
+  // worker thread, and the timer refreshes the display at most 30 times
+  // per second, independently of the iteration rate.
   if(checked)
-    m_EvolutionTimer->start(10);
+    {
+    m_Model->StartEvolution();
+    m_EvolutionTimer->start(33);
+    }
   else
+    {
     m_EvolutionTimer->stop();
+    m_Model->StopEvolution();
+    }
 }
 
 void SnakeWizardPanel::idleCallback()
 {
-  // Step the snake. If converged (returns true), stop playing
-  if(m_Model->PerformEvolutionStep())
+  // Show the latest state of the snake. If the evolution has stopped
+  // (returns true), stop playing
+  if(m_Model->RefreshEvolutionDisplay())
     ui->btnPlay->setChecked(false);
 }
 
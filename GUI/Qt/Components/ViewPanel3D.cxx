@@ -5,6 +5,7 @@
 #include "itkCommand.h"
 #include "IRISException.h"
 #include "IRISApplication.h"
+#include "TaskExecutionService.h"
 #include "IRISImageData.h"
 #include "ImageMeshLayers.h"
 #include "StandaloneMeshWrapper.h"
@@ -14,7 +15,6 @@
 #include "QtWidgetActivator.h"
 #include "DisplayLayoutModel.h"
 #include <QtCore>
-#include <qtconcurrentrun.h>
 #include "itkProcessObject.h"
 #include <QMenu>
 #include "QtWidgetCoupling.h"
@@ -34,10 +34,6 @@ ViewPanel3D::ViewPanel3D(QWidget *parent) :
   m_RenderTimer->setInterval(100);
   connect(m_RenderTimer, SIGNAL(timeout()), SLOT(onTimer()));
 
-  // Create a progress command
-  m_RenderProgressCommand = CommandType::New();
-  m_RenderProgressCommand->SetCallbackFunction(this, &ViewPanel3D::ProgressCallback);
-
   // Connect the progress event
   ui->progressBar->setRange(0, 1000);
   QObject::connect(this, SIGNAL(renderProgress(int)), ui->progressBar, SLOT(setValue(int)),
@@ -61,6 +57,13 @@ ViewPanel3D::ViewPanel3D(QWidget *parent) :
 
 ViewPanel3D::~ViewPanel3D()
 {
+  // The background task refers to this panel
+  if(m_RenderTask)
+    {
+    m_RenderTask->Cancel();
+    m_RenderTask->Wait();
+    }
+
   delete ui;
 }
 
@@ -194,25 +197,19 @@ void ViewPanel3D::UpdateExpandViewButton()
     }
 }
 
-// This method is run in a concurrent thread
-void ViewPanel3D::UpdateMeshesInBackground()
+// This method is run by a worker thread of the task execution service
+void ViewPanel3D::UpdateMeshesInBackground(AsyncTask *task)
 {
   // Make sure the model actually requires updating
   if(m_Model && m_Model->CheckState(Generic3DModel::UIF_MESH_DIRTY))
     {
-    m_Model->UpdateSegmentationMesh(m_RenderProgressCommand);
+    // Mesh progress is reported through the task
+    SmartPtr<itk::Command> progress =
+        task->GetProgressAccumulator()->RegisterITKSourceViaCommand(1.0f);
+    m_Model->UpdateSegmentationMesh(progress, task->GetCancellationToken());
     }
 }
 
-void ViewPanel3D::ProgressCallback(itk::Object *source, const itk::EventObject &)
-{
-  itk::ProcessObject *po = static_cast<itk::ProcessObject *>(source);
-
-  m_RenderProgressMutex.lock();
-  m_RenderProgressValue = po->GetProgress();
-  m_RenderProgressMutex.unlock();
-}
-
 void ViewPanel3D::on_btnScreenshot_clicked()
 {
   MainImageWindow *window = findParentWidget<MainImageWindow>(this);
@@ -256,16 +253,17 @@ void ViewPanel3D::on_btnColorBar_clicked(bool isUser)
 
 void ViewPanel3D::onTimer()
 {
-  if(!m_RenderFuture.isRunning())
+  if(!m_RenderTask || m_RenderTask->IsFinished())
     {
     // Does work need to be done?
     if(m_Model && ui->actionContinuous_Update->isChecked()
        && m_Model->CheckState(Generic3DModel::UIF_MESH_DIRTY))
       {
       // Launch the worker thread
-      m_RenderProgressValue = 0;
       m_RenderElapsedTicks = 0;
-      m_RenderFuture = QtConcurrent::run(&ViewPanel3D::UpdateMeshesInBackground, this);
+      TaskExecutionService *tes = m_Model->GetParentUI()->GetDriver()->GetTaskExecutionService();
+      m_RenderTask = tes->Submit("Updating 3D meshes",
+                                 [this](AsyncTask *task) { this->UpdateMeshesInBackground(task); });
       }
     else
       {
@@ -279,9 +277,7 @@ void ViewPanel3D::onTimer()
       {
       ui->progressBar->setVisible(true);
 
-      m_RenderProgressMutex.lock();
-      emit renderProgress((int)(1000 * m_RenderProgressValue));
-      m_RenderProgressMutex.unlock();
+      emit renderProgress((int)(1000 * m_RenderTask->GetProgress()));
       }
     }
 }
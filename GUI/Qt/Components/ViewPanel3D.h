@@ -8,7 +8,6 @@
 #include <QWaitCondition>
 #include <QDebug>
 #include <QTimer>
-#include <QFutureWatcher>
 #include <itkCommand.h>
 
 namespace Ui {
@@ -20,6 +19,7 @@ namespace itk {
 }
 
 class Generic3DModel;
+class AsyncTask;
 class GenericView3D;
 class QMenu;
 
@@ -84,32 +84,21 @@ private:
 
   QTimer *m_RenderTimer;
 
-  // A future used to track background rendering
-  QFuture<void> m_RenderFuture;
-
-  // A mutex on the progress value, which is accesed by multiple threads
-  mutable QMutex m_RenderProgressMutex;
-
-  // Progress of the rendering operation
-  double m_RenderProgressValue;
+  // The background task used to update the meshes
+  SmartPtr<AsyncTask> m_RenderTask;
 
   // Elapsed time since begin of render operation
   int m_RenderElapsedTicks;
 
-  typedef itk::MemberCommand<ViewPanel3D> CommandType;
-  SmartPtr<CommandType> m_RenderProgressCommand;
-
   void UpdateExpandViewButton();
 
-  void UpdateMeshesInBackground();
+  void UpdateMeshesInBackground(AsyncTask *task);
 
   void UpdateActionButtons();
 
   // Apply color bar visibility based on the active mesh layer type
   void ApplyDefaultColorBarVisibility();
 
-  void ProgressCallback(itk::Object *source, const itk::EventObject &event);
-
   bool m_ColorBarUserInputOverride = false;
 };
 
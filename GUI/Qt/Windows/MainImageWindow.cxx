@@ -1639,6 +1639,11 @@ void MainImageWindow::LoadAnotherDicomActionTriggered()
 
 void MainImageWindow::LoadProject(const QString &file)
 {
+  // Show a progress dialog
+  using namespace imageiowiz;
+  ImageIOProgressDialog::ScopedPointer progress(new ImageIOProgressDialog(this));
+  progress->display();
+
   // Try loading the image
   try
     {
@@ -1647,10 +1652,11 @@ void MainImageWindow::LoadProject(const QString &file)
     IRISWarningList warnings;
 
     // Load the project
-    m_Model->GetDriver()->OpenProject(to_utf8(file), warnings);
+    m_Model->GetDriver()->OpenProject(to_utf8(file), warnings, progress->createCommand());
     }
   catch(exception &exc)
     {
+    progress->close();
     ReportNonLethalException(this, exc, "Error Opening Project",
                              QString("Failed to open project %1").arg(file));
   }
@@ -2191,6 +2197,11 @@ void MainImageWindow::on_actionOpenWorkspace_triggered()
   // Make sure to get an absolute path, because the project needs that info
   QString file_abs = QFileInfo(file).absoluteFilePath();
 
+  // Show a progress dialog
+  using namespace imageiowiz;
+  ImageIOProgressDialog::ScopedPointer progress(new ImageIOProgressDialog(this));
+  progress->display();
+
   // Try loading the image
   try
     {
@@ -2199,10 +2210,11 @@ void MainImageWindow::on_actionOpenWorkspace_triggered()
     IRISWarningList warnings;
 
     // Load the project
-    m_Model->GetDriver()->OpenProject(to_utf8(file_abs), warnings);
+    m_Model->GetDriver()->OpenProject(to_utf8(file_abs), warnings, progress->createCommand());
     }
   catch(exception &exc)
     {
+    progress->close();
     ReportNonLethalException(this, exc, "Error Opening Project",
                              QString("Failed to open project %1").arg(file_abs));
     }
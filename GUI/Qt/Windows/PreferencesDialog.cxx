@@ -214,6 +214,8 @@ PreferencesDialog::SetModel(GlobalPreferencesModel *model)
   makeCoupling(ui->inDecimateTargetReduction, mo->GetDecimateTargetReductionModel());
   makeCoupling(ui->chkDecimatePreserveTopology, mo->GetDecimatePreserveTopologyModel());
 
+  makeCoupling(ui->chkMultiLabelSurfaceExtraction, mo->GetUseMultiLabelSurfaceExtractionModel());
+
   // Tool page
   makeCoupling(ui->inPaintBrushMaxSize, dbs->GetPaintbrushDefaultMaximumSizeModel());
   makeCoupling(ui->inPaintBrushInitSize, dbs->GetPaintbrushDefaultInitialSizeModel());
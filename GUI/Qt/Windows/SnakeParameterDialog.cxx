@@ -73,6 +73,7 @@ void SnakeParameterDialog::SetModel(SnakeParameterModel *model)
 
   makeCoupling(ui->inSpeedup, m_Model->GetSpeedupFactorModel());
   makeCoupling(ui->inSpeedupSlider, m_Model->GetSpeedupFactorModel());
+  makeCoupling(ui->inMultiResolutionLevels, m_Model->GetMultiResolutionLevelsModel());
 
   // Couple the advanced checkbox
   makeCoupling(ui->chkAdvanced, m_Model->GetAdvancedEquationModeModel());
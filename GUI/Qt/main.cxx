@@ -1,4 +1,6 @@
 #include "IRISApplication.h"
+#include "TaskExecutionService.h"
+#include "SNAPInstrumentation.h"
 #include "MeshImportModel.h"
 #include "QtLocalDeepLearningServerDelegate.h"
 #include "RESTClient.h"
@@ -55,6 +57,7 @@
 #include <QMessageBox>
 #include <QDesktopServices>
 #include "IRISImageData.h"
+#include "FileBackedImageContainer.h"
 
 
 using namespace std;
@@ -311,6 +314,7 @@ usage(const char *progname)
   cout << "   -z FACTOR            : Specify initial zoom in screen pixels/mm" << endl;
   cout << "   --cwd PATH           : Start with PATH as the initial directory" << endl;
   cout << "   --threads N          : Limit maximum number of CPU cores used to N." << endl;
+  cout << "   --swap-dir DIR       : Back very large images with files in DIR (on disk, not tmpfs)." << endl;
   cout << "   --scale N            : Scale all GUI elements by factor of N (e.g., 2)." << endl;
   cout << "   --geometry WxH+X+Y   : Initial geometry of the main window." << endl;
   cout << "Debugging/Testing Options:" << endl;
@@ -326,6 +330,8 @@ usage(const char *progname)
   cout << "   --css file           : Read stylesheet from file." << endl;
   cout << "   --opengl MAJOR MINOR : Set the OpenGL major and minor version. Experimental." << endl;
   cout << "   --testgl             : Diagnose OpenGL/VTK issues." << endl;
+  cout << "   --dump-stats FILE    : Write performance timers and counters to FILE (JSON) on exit."
+       << endl;
   cout << "Platform-Specific Options:" << endl;
 #if QT_VERSION < 0x050000
 #  ifdef Q_WS_X11
@@ -369,6 +375,9 @@ public:
   std::string fnTestDir;
   double      xTestAccel = 1.0;
 
+  // File where performance statistics are written on exit
+  std::string fnInstrumentationDump;
+
   // Current working directory
   std::string cwd;
 
@@ -382,6 +391,9 @@ public:
   // Number of threads
   int nThreads = 0;
 
+  // Directory for the files backing very large images
+  std::string fnSwapDir;
+
   // GUI scaling
   int nDevicePixelRatio = 0;
 
@@ -495,6 +507,9 @@ parse(int argc, char *argv[], CommandLineRequest &argdata)
   // TODO: use and document this
   parser.AddOption("--threads", 1);
 
+  // Directory for file-backed images
+  parser.AddOption("--swap-dir", 1);
+
   // Current working directory
   parser.AddOption("--cwd", 1);
 
@@ -516,6 +531,8 @@ parse(int argc, char *argv[], CommandLineRequest &argdata)
 
   parser.AddOption("--testgl", 0);
 
+  parser.AddOption("--dump-stats", 1);
+
   // Standard Qt options
   parser.AddOption("--geometry", 1);
   parser.AddSynonim("--geometry", "-geometry");
@@ -695,6 +712,10 @@ parse(int argc, char *argv[], CommandLineRequest &argdata)
       argdata.xTestAccel = 1.0;
   }
 
+  // Performance statistics
+  if (parseResult.IsOptionPresent("--dump-stats"))
+    argdata.fnInstrumentationDump = DecodeFilename(parseResult.GetOptionParameter("--dump-stats"));
+
   // GUI stuff
   if (parseResult.IsOptionPresent("--style"))
     argdata.style = parseResult.GetOptionParameter("--style");
@@ -720,6 +741,10 @@ parse(int argc, char *argv[], CommandLineRequest &argdata)
   if (parseResult.IsOptionPresent("--threads"))
     argdata.nThreads = atoi(parseResult.GetOptionParameter("--threads"));
 
+  // Swap directory
+  if (parseResult.IsOptionPresent("--swap-dir"))
+    argdata.fnSwapDir = DecodeFilename(parseResult.GetOptionParameter("--swap-dir"));
+
   // Number of threads
   if (parseResult.IsOptionPresent("--scale"))
     argdata.nDevicePixelRatio = atoi(parseResult.GetOptionParameter("--scale"));
@@ -856,6 +881,10 @@ main(int argc, char *argv[])
     itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads(argdata.nThreads);
   }
 
+  // Directory for file-backed images (the default is set by IRISApplication)
+  if (argdata.fnSwapDir.size())
+    FileBackedMemory::SetDirectory(argdata.fnSwapDir);
+
   // VTK verbosity
   vtkLogger::SetStderrVerbosity(vtkLogger::VERBOSITY_WARNING);
 
@@ -976,6 +1005,13 @@ main(int argc, char *argv[])
     gui->GetSynchronizationModel()->SetSystemInterface(&siSharedMem);
     gui->GetSynchronizationModel()->SetDebugSync(argdata.flagDebugSync);
 
+    // Events from background tasks are delivered on the GUI thread
+    driver->GetTaskExecutionService()->SetEventsPendingCallback([driver]() {
+      QMetaObject::invokeMethod(qApp, [driver]() {
+        driver->GetTaskExecutionService()->ProcessPendingEvents();
+      }, Qt::QueuedConnection);
+    });
+
     // Set the initial directory. The fallthough is to set to the user's home
     // directory
     QString init_dir = QDir::homePath();
@@ -1066,50 +1102,67 @@ main(int argc, char *argv[])
         // Try loading the image
         try
         {
-          // Load the main image. If that fails, all else should fail too
-          driver->OpenImage(argdata.fnMain.c_str(), MAIN_ROLE, warnings);
+          // Read the main image, segmentations and overlays concurrently
+          std::vector<IRISApplication::ImageLoadRequest> requests;
+          IRISApplication::ImageLoadRequest req;
+          req.filename = argdata.fnMain;
+          req.role = MAIN_ROLE;
+          requests.push_back(req);
+
+          req.role = LABEL_ROLE;
+          for (int i = 0; i < argdata.fnSegmentation.size(); ++i)
+          {
+            req.filename = argdata.fnSegmentation[i];
+            req.additive = i > 0;
+            requests.push_back(req);
+          }
 
-          // Load the segmentation
-          if (argdata.fnSegmentation.size())
+          req.role = OVERLAY_ROLE;
+          req.additive = false;
+          for (int i = 0; i < argdata.fnOverlay.size(); i++)
           {
-            std::string current_seg;
-            try
-            {
-              for (int i = 0; i < argdata.fnSegmentation.size(); ++i)
-              {
-                current_seg = argdata.fnSegmentation[i];
-                driver->OpenImage(current_seg.c_str(), LABEL_ROLE, warnings, nullptr, nullptr, i > 0);
-              }
-            }
-            catch (std::exception &exc)
-            {
-              ReportNonLethalException(
-                mainwin,
-                exc,
-                "Image IO Error",
-                QString("Failed to load segmentation %1").arg(from_utf8(current_seg)));
-            }
+            req.filename = argdata.fnOverlay[i];
+            requests.push_back(req);
           }
 
-          // Load the overlays
-          if (argdata.fnOverlay.size())
+          std::vector<std::exception_ptr> errors = driver->OpenImages(requests, warnings);
+
+          // If the main image failed, all else has failed too
+          if (errors[0])
+            std::rethrow_exception(errors[0]);
+
+          // Report the first failed segmentation and the first failed overlay
+          bool seg_reported = false, overlay_reported = false;
+          for (unsigned int i = 1; i < requests.size(); i++)
           {
-            std::string current_overlay;
+            bool is_seg = requests[i].role == LABEL_ROLE;
+            if (!errors[i] || (is_seg ? seg_reported : overlay_reported))
+              continue;
+
             try
             {
-              for (int i = 0; i < argdata.fnOverlay.size(); i++)
-              {
-                current_overlay = argdata.fnOverlay[i];
-                driver->OpenImage(current_overlay.c_str(), OVERLAY_ROLE, warnings);
-              }
+              std::rethrow_exception(errors[i]);
             }
             catch (std::exception &exc)
             {
-              ReportNonLethalException(
-                mainwin,
-                exc,
-                "Overlay IO Error",
-                QString("Failed to load overlay %1").arg(from_utf8(current_overlay)));
+              if (is_seg)
+              {
+                ReportNonLethalException(
+                  mainwin,
+                  exc,
+                  "Image IO Error",
+                  QString("Failed to load segmentation %1").arg(from_utf8(requests[i].filename)));
+                seg_reported = true;
+              }
+              else
+              {
+                ReportNonLethalException(
+                  mainwin,
+                  exc,
+                  "Overlay IO Error",
+                  QString("Failed to load overlay %1").arg(from_utf8(requests[i].filename)));
+                overlay_reported = true;
+              }
             }
           }
 
@@ -1283,6 +1336,11 @@ main(int argc, char *argv[])
       rc = -1;
     }
 
+    // Dump the performance statistics collected during the session
+    if (argdata.fnInstrumentationDump.size()
+        && !SNAPInstrumentation::GetInstance()->WriteJSON(argdata.fnInstrumentationDump))
+      std::cerr << "Failed to write statistics to " << argdata.fnInstrumentationDump << std::endl;
+
     // If everything cool, save the preferences, but not when testing because preferences
     // set in test mode should not be kept
     if (!rc && !ui_testing)
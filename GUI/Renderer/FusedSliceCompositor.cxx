@@ -0,0 +1,115 @@
+#include "FusedSliceCompositor.h"
+#include "itkMultiThreaderBase.h"
+#include <algorithm>
+#include <cmath>
+
+FusedSliceCompositor::FusedSliceCompositor()
+{
+  m_Output = DisplaySliceType::New();
+  m_Background.Set(0, 0, 0, 255);
+  m_CompositedBackground = m_Background;
+}
+
+void
+FusedSliceCompositor::SetBackgroundColor(const Vector3d &color)
+{
+  for(unsigned int c = 0; c < 3; c++)
+    m_Background[c] = (unsigned char) std::round(255.0 * std::max(0.0, std::min(1.0, color[c])));
+  m_Background[3] = 255;
+}
+
+void
+FusedSliceCompositor::ClearLayers()
+{
+  m_Layers.clear();
+}
+
+void
+FusedSliceCompositor::AddLayer(DisplaySliceType *slice, double opacity)
+{
+  LayerEntry entry;
+  entry.slice = slice;
+  entry.mtime = slice->GetMTime();
+  entry.weight = (unsigned int) std::round(256.0 * std::max(0.0, std::min(1.0, opacity)));
+  m_Layers.push_back(entry);
+}
+
+bool
+FusedSliceCompositor::Update()
+{
+  if(m_Layers.empty())
+    return false;
+
+  // All slices must cover the same region
+  auto region = m_Layers.front().slice->GetBufferedRegion();
+  for(auto &l : m_Layers)
+    if(l.slice->GetBufferedRegion() != region)
+      return false;
+
+  // Nothing to do if the stack is unchanged
+  if(m_OutputValid && m_Layers == m_CompositedLayers && m_Background == m_CompositedBackground
+     && m_Output->GetBufferedRegion() == region)
+    return true;
+
+  if(m_Output->GetBufferedRegion() != region)
+  {
+    m_Output->SetRegions(region);
+    m_Output->Allocate();
+  }
+
+  unsigned int n_rows = region.GetSize()[1];
+  unsigned int n_blocks = (n_rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, n_blocks, [this, n_rows](itk::SizeValueType b)
+  {
+    unsigned int row_start = b * BLOCK_ROWS;
+    this->CompositeRows(row_start, std::min(row_start + BLOCK_ROWS, n_rows));
+  }, nullptr);
+
+  m_CompositedLayers = m_Layers;
+  m_CompositedBackground = m_Background;
+  m_OutputValid = true;
+  m_Output->Modified();
+  return true;
+}
+
+void
+FusedSliceCompositor::CompositeRows(unsigned int row_start, unsigned int row_end)
+{
+  unsigned int width = m_Output->GetBufferedRegion().GetSize()[0];
+  DisplayPixelType *out = m_Output->GetBufferPointer();
+
+  for(unsigned int x0 = 0; x0 < width; x0 += TILE_WIDTH)
+  {
+    unsigned int x1 = std::min(x0 + TILE_WIDTH, width);
+
+    // Start with the background
+    for(unsigned int y = row_start; y < row_end; y++)
+      std::fill(out + y * width + x0, out + y * width + x1, m_Background);
+
+    // Blend each layer into the tile while it is in cache
+    for(auto &l : m_Layers)
+    {
+      if(l.weight == 0)
+        continue;
+
+      const DisplayPixelType *src = l.slice->GetBufferPointer();
+      for(unsigned int y = row_start; y < row_end; y++)
+      {
+        const unsigned char *ps = reinterpret_cast<const unsigned char *>(src + y * width + x0);
+        unsigned char *pd = reinterpret_cast<unsigned char *>(out + y * width + x0);
+        for(unsigned int x = x0; x < x1; x++, ps += 4, pd += 4)
+        {
+          // Effective opacity of the pixel, between 0 and 256
+          unsigned int w = (ps[3] * l.weight + 127) / 255;
+          if(w == 0)
+            continue;
+          unsigned int v = 256 - w;
+          pd[0] = (unsigned char) ((ps[0] * w + pd[0] * v) >> 8);
+          pd[1] = (unsigned char) ((ps[1] * w + pd[1] * v) >> 8);
+          pd[2] = (unsigned char) ((ps[2] * w + pd[2] * v) >> 8);
+        }
+      }
+    }
+  }
+}
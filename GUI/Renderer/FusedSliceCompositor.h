@@ -0,0 +1,87 @@
+#ifndef FUSEDSLICECOMPOSITOR_H
+#define FUSEDSLICECOMPOSITOR_H
+
+#include "SNAPCommon.h"
+#include "IRISVectorTypes.h"
+#include "ImageWrapperBase.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <vector>
+
+/**
+ * Composites the RGBA display slices of a stack of layers into a single
+ * slice, producing the same result as drawing each slice over the previous
+ * one in SOURCE_OVER mode with its own opacity, starting from an opaque
+ * background color. This way a slice view with many overlays uploads and
+ * draws one texture instead of one per layer.
+ *
+ * The slices must all have the same size. The blending is split between
+ * threads by blocks of rows, and each block is processed in tiles of columns,
+ * so that a tile of the output stays in cache while every layer is blended
+ * into it. The output is only recomputed when a slice, an opacity or the
+ * background has changed since the last update.
+ */
+class FusedSliceCompositor : public itk::Object
+{
+public:
+  irisITKObjectMacro(FusedSliceCompositor, itk::Object)
+
+  typedef ImageWrapperBase::DisplaySliceType DisplaySliceType;
+  typedef ImageWrapperBase::DisplayPixelType DisplayPixelType;
+
+  /** Set the background color, with components between 0 and 1 */
+  void SetBackgroundColor(const Vector3d &color);
+
+  /** Remove all layers from the stack */
+  void ClearLayers();
+
+  /** Add a slice to the top of the stack. The slice should be up to date */
+  void AddLayer(DisplaySliceType *slice, double opacity);
+
+  /** Number of layers in the stack */
+  unsigned int GetNumberOfLayers() const { return m_Layers.size(); }
+
+  /**
+   * Composite the stack if it has changed. Returns false if the slices are
+   * not all the same size, in which case they can not be fused.
+   */
+  bool Update();
+
+  /** The composited slice */
+  DisplaySliceType *GetOutput() { return m_Output; }
+
+protected:
+  FusedSliceCompositor();
+  virtual ~FusedSliceCompositor() {}
+
+  // Width of the column tiles, in pixels
+  static constexpr unsigned int TILE_WIDTH = 256;
+
+  // Number of rows in a block given to a thread
+  static constexpr unsigned int BLOCK_ROWS = 32;
+
+  struct LayerEntry
+  {
+    DisplaySliceType *slice;
+    itk::ModifiedTimeType mtime;
+
+    // Opacity scaled to the range 0 to 256
+    unsigned int weight;
+
+    bool operator == (const LayerEntry &other) const
+    {
+      return slice == other.slice && mtime == other.mtime && weight == other.weight;
+    }
+  };
+
+  // Blend the layers into a range of rows of the output
+  void CompositeRows(unsigned int row_start, unsigned int row_end);
+
+  std::vector<LayerEntry> m_Layers, m_CompositedLayers;
+  DisplayPixelType m_Background, m_CompositedBackground;
+  bool m_OutputValid = false;
+
+  SmartPtr<DisplaySliceType> m_Output;
+};
+
+#endif // FUSEDSLICECOMPOSITOR_H
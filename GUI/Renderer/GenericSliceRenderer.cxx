@@ -179,8 +179,7 @@ GenericSliceRenderer::SetModel(GenericSliceModel *model)
               ModelUpdateEvent());
 }
 
-#include <chrono>
-typedef std::chrono::high_resolution_clock Clock;
+#include "SNAPInstrumentation.h"
 
 
 GenericSliceRenderer::TextureInfo
@@ -208,27 +207,7 @@ GenericSliceRenderer::GetTexture(AbstractRenderContext *context,
       // pipeline (main window and zoom thumbnail when in non-orthogonal slicing mode)
 
       // Get the display slice that we will render as the base layer
-      auto rgba = layer->GetDisplaySlice(DisplaySliceIndex(m_Model->GetId(), intent));
-
-      // CODE below can be used to check what caused pipeline update
-      // auto pipe_mtime = check_pipeline_mtime(rgba);
-      // if(pipe_mtime > rgba->GetMTime())
-      //   check_pipeline_mtime_detail(rgba, rgba->GetMTime(), "  ");
-
-      // Update the display slice
-      auto ts_before = rgba->GetMTime();
-      auto start_time = Clock::now();
-      rgba->GetSource()->UpdateLargestPossibleRegion();
-      auto end_time = Clock::now();
-      auto ts_after = rgba->GetMTime();
-      bool updated = ts_after != ts_before;
-
-      /*
-      std::cout << "Texture update: " << updated << " duration : "
-      << std::chrono::duration_cast<std::chrono::nanoseconds>(end_time -
-                                                  start_time)
-      .count()
-      */
+      auto rgba = this->UpdateDisplaySlice(layer, intent);
 
       // Check if a texture is cached in the layer
       Texture::Pointer texptr = dynamic_cast<Texture *>(layer->GetUserData(layer_key));
@@ -245,11 +224,15 @@ GenericSliceRenderer::GetTexture(AbstractRenderContext *context,
         layer->SetUserData(layer_key, texptr.GetPointer());
       }
 
-      // Store the texture in local texture cache
+      // Store the texture in local texture cache. Orthogonal slices are drawn
+      // in voxel units, and may have been sampled at a coarser resolution
       auto rgba_size = rgba->GetBufferedRegion().GetSize();
+      Vector2d extent = layer->IsSlicingOrthogonal()
+                          ? this->GetDisplaySliceExtent(rgba)
+                          : Vector2d(rgba_size[0], rgba_size[1]);
       tex.texture = texptr;
-      tex.w = rgba_size[0];
-      tex.h = rgba_size[1];
+      tex.w = extent[0];
+      tex.h = extent[1];
       texture_cache[cache_key] = tex;
     }
     else
@@ -285,6 +268,113 @@ GenericSliceRenderer::GetTexture(AbstractRenderContext *context,
   return tex;
 }
 
+ImageWrapperBase::DisplaySliceType *
+GenericSliceRenderer::UpdateDisplaySlice(ImageWrapperBase *layer, DisplaySliceIntent intent)
+{
+  auto rgba = layer->GetDisplaySlice(DisplaySliceIndex(m_Model->GetId(), intent));
+
+  // CODE below can be used to check what caused pipeline update
+  // auto pipe_mtime = check_pipeline_mtime(rgba);
+  // if(pipe_mtime > rgba->GetMTime())
+  //   check_pipeline_mtime_detail(rgba, rgba->GetMTime(), "  ");
+
+  // Update the display slice (slicing and display mapping)
+  auto ts_before = rgba->GetMTime();
+  irisInstrumentNamedScopeMacro(tSliceUpdate, "Slicing", "Display slice update");
+  rgba->GetSource()->UpdateLargestPossibleRegion();
+  tSliceUpdate.Stop();
+  auto ts_after = rgba->GetMTime();
+  bool updated = ts_after != ts_before;
+  if(updated)
+    irisInstrumentCountMacro("Slicing", "Display slices recomputed", 1);
+
+  return rgba;
+}
+
+Vector2d
+GenericSliceRenderer::GetDisplaySliceExtent(ImageWrapperBase::DisplaySliceType *rgba)
+{
+  // When the view is zoomed out, the slicer splits the slice into blocks of
+  // voxels, one for each pixel. The blocks cover the slice exactly, so the
+  // pixels are drawn over the physical extent of the full resolution slice
+  auto     size = rgba->GetBufferedRegion().GetSize();
+  Vector2d extent;
+  for (unsigned int d = 0; d < 2; d++)
+    extent[d] = size[d] > 0 ? m_Model->GetSliceSize()[d] : 0;
+  return extent;
+}
+
+bool
+GenericSliceRenderer::RenderFusedLayers(AbstractRenderContext *context,
+                                        TextureCache          &texture_cache,
+                                        ImageWrapperBase      *base_layer,
+                                        bool                   bilinear,
+                                        const Vector3d        &background)
+{
+  auto *id = m_Model->GetImageData();
+
+  // The layers drawn in this tile, bottom to top, with their opacities
+  std::vector<std::pair<ImageWrapperBase *, double>> stack;
+  stack.push_back(std::make_pair(base_layer, 1.0));
+  for (LayerIterator it_ovl(id); !it_ovl.IsAtEnd(); ++it_ovl)
+  {
+    if (it_ovl.GetRole() != LABEL_ROLE && it_ovl.GetLayer()->IsSticky())
+    {
+      double opacity = it_ovl.GetLayer()->GetAlpha();
+      if (opacity > 0)
+        stack.push_back(std::make_pair(it_ovl.GetLayer(), opacity));
+    }
+  }
+
+  // The segmentation is always drawn without interpolation, so it can only
+  // be fused with the other layers when they are not interpolated either
+  unsigned int ssid = m_Model->GetDriver()->GetGlobalState()->GetSelectedSegmentationLayerId();
+  auto        *seg_layer = id->FindLayer(ssid, false, LABEL_ROLE);
+  double       seg_opacity = m_Model->GetDriver()->GetGlobalState()->GetSegmentationAlpha();
+  bool         fuse_seg = seg_layer && seg_opacity > 0 && !bilinear;
+  if (fuse_seg)
+    stack.push_back(std::make_pair(seg_layer, seg_opacity));
+
+  // Fusing a single layer gains nothing, and obliquely sliced layers are
+  // drawn in a different coordinate system
+  if (stack.size() < 2)
+    return false;
+  for (auto &l : stack)
+    if (!l.first->IsSlicingOrthogonal())
+      return false;
+
+  // Composite the display slices
+  FusedLayerStack &fused = m_FusedStacks[base_layer->GetUniqueId()];
+  if (!fused.compositor)
+    fused.compositor = FusedSliceCompositor::New();
+  fused.used = true;
+
+  fused.compositor->ClearLayers();
+  fused.compositor->SetBackgroundColor(background);
+  for (auto &l : stack)
+    fused.compositor->AddLayer(this->UpdateDisplaySlice(l.first, DISPLAY_SLICE_MAIN), l.second);
+
+  irisInstrumentNamedScopeMacro(tComposite, "Slicing", "Fused layer compositing");
+  bool fused_ok = fused.compositor->Update();
+  tComposite.Stop();
+  if (!fused_ok)
+    return false;
+
+  // Upload the composited slice if it has changed
+  auto *output = fused.compositor->GetOutput();
+  if (!fused.texture || fused.texture->GetMTime() < output->GetMTime())
+    fused.texture = context->CreateTexture(output);
+
+  Vector2d extent = this->GetDisplaySliceExtent(output);
+  context->DrawImage(0, 0, extent[0], extent[1], fused.texture, bilinear, 1.0);
+
+  // Draw the segmentation separately if it could not be fused
+  if (seg_layer && seg_opacity > 0 && !fuse_seg)
+    this->RenderLayer(context, texture_cache, seg_layer, false, 1.0, seg_opacity, DISPLAY_SLICE_MAIN);
+
+  return true;
+}
+
 void
 GenericSliceRenderer::RenderLayer(AbstractRenderContext *context,
                                   TextureCache          &texture_cache,
@@ -350,15 +440,15 @@ GenericSliceRenderer::RenderMeshes(AbstractRenderContext *context)
         mtime = std::max(mtime, layer->GetMesh(tp, i)->GetMTime());
 
     // Update the stored path
-    Clock clk;
     if (!stored_contour || stored_contour->GetMTime() < mtime)
     {
       stored_contour = context->CreateContourSet();
       for (unsigned int i = 0; i < layer->GetNumberOfMeshes(tp); i++)
       {
-        auto         t0 = clk.now();
+        irisInstrumentNamedScopeMacro(tIntersect, "Mesh", "Slice plane intersection");
         vtkPolyData *pd = layer->GetIntersectionWithSlicePlane(tp, i, index);
-        auto         t1 = clk.now();
+        tIntersect.Stop();
+        irisInstrumentNamedScopeMacro(tPath, "Mesh", "Slice contour path build");
 
         // Transform the polydata into slice coordinates that we are rendering
         if(pd)
@@ -435,11 +525,6 @@ GenericSliceRenderer::RenderMeshes(AbstractRenderContext *context)
             }
           }
         }
-
-        auto                                      t2 = clk.now();
-        std::chrono::duration<double, std::milli> dt01 = t1 - t0, dt12 = t2 - t1;
-        // std::cout << "Time for VTK filter: " << dt01.count() << std::endl;
-        // std::cout << "Time for path build: " << dt12.count() << std::endl;
       }
 
       // Build the contour set
@@ -451,11 +536,8 @@ GenericSliceRenderer::RenderMeshes(AbstractRenderContext *context)
     context->SetPenAppearance(*eltMesh);
     context->SetPenColor(layer->GetSolidColor());
     context->SetPenOpacity(layer->GetSliceViewOpacity() * eltMesh->GetAlpha());
-    auto t0 = clk.now();
+    irisInstrumentScopeMacro("Mesh", "Slice contour drawing");
     context->DrawContourSet(stored_contour);
-    auto                                      t1 = clk.now();
-    std::chrono::duration<double, std::milli> dt01 = t1 - t0;
-    // std::cout << "Time for QPainter drawing: " << dt01.count() << std::endl;
   }
 }
 
@@ -536,12 +618,18 @@ GenericSliceRenderer::Render(AbstractRenderContext *context)
     context->Translate(-v_pos[0], -v_pos[1]);
     context->Scale(spacing[0], spacing[1]);
 
+    // Outside of thumbnails, try drawing the base layer, overlays and
+    // segmentation as a single composited texture
+    bool fused = !vp.isThumbnail && m_FusedCompositing &&
+                 this->RenderFusedLayers(context, tcache, layer, global_linear_mode, clrBack);
+
     // Render the base layer in this viewport
-    this->RenderLayer(
-      context, tcache, layer, global_linear_mode, thumbnail_zoom, 1.0, DISPLAY_SLICE_MAIN);
+    if (!fused)
+      this->RenderLayer(
+        context, tcache, layer, global_linear_mode, thumbnail_zoom, 1.0, DISPLAY_SLICE_MAIN);
 
     // If the base layer is not in thumbnail mode, draw overlays and segmentation
-    if (!vp.isThumbnail)
+    if (!vp.isThumbnail && !fused)
     {
       // Draw the sticky overlays on top of this image
       for (LayerIterator it_ovl(id); !it_ovl.IsAtEnd(); ++it_ovl)
@@ -565,10 +653,12 @@ GenericSliceRenderer::Render(AbstractRenderContext *context)
           this->RenderLayer(context, tcache, seg_layer, false, 1.0, opacity, DISPLAY_SLICE_MAIN);
       }
 
-      // Draw the meshes intersection with the cutting plane
-      this->RenderMeshes(context);
     }
 
+    // Draw the meshes intersection with the cutting plane
+    if (!vp.isThumbnail)
+      this->RenderMeshes(context);
+
     // Draw decorators around the layer selection thumbnail, if hovered over by the mouse or selected
     bool is_hover = layer->GetUniqueId() == m_Model->GetHoveredImageLayerId();
     bool is_selected = layer->GetUniqueId() == gs->GetSelectedLayerId();
@@ -597,6 +687,18 @@ GenericSliceRenderer::Render(AbstractRenderContext *context)
     context->PopMatrix();
   }
 
+  // Release the composited slices of layers that are no longer base layers
+  for (auto it = m_FusedStacks.begin(); it != m_FusedStacks.end(); )
+  {
+    if (it->second.used)
+    {
+      it->second.used = false;
+      ++it;
+    }
+    else
+      it = m_FusedStacks.erase(it);
+  }
+
   // Set the viewport to the full viewport
   Vector2ui vp_full = m_Model->GetSizeReporter()->GetViewportSize();
   context->SetViewport(0, 0, vp_full[0] / vppr, vp_full[1] / vppr);
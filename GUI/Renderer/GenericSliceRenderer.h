@@ -32,6 +32,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <list>
 #include <LayerAssociation.h>
 #include "AbstractContextBasedRenderer.h"
+#include "FusedSliceCompositor.h"
 
 class SliceRendererDelegate : public AbstractModel
 {
@@ -93,6 +94,13 @@ public:
   /** Set the array of delegates who perform overlay rendering tasks */
   void SetDelegates(const RendererDelegateList &ovl);
 
+  /**
+   * Whether the base layer, sticky overlays and segmentation of each tile
+   * are composited on the CPU into a single texture (default) instead of
+   * being drawn as separate textures
+   */
+  irisGetSetMacro(FusedCompositing, bool)
+
   // A callback for when the model is reinitialized
   // void OnModelReinitialize();
 
@@ -128,7 +136,7 @@ protected:
   struct TextureInfo
   {
     Texture *texture = nullptr;
-    unsigned int w = 0, h = 0;
+    double w = 0, h = 0;
   };
   using TextureInfoKey = std::pair<unsigned int, DisplaySliceIntent>;
   using TextureCache = std::map<TextureInfoKey, TextureInfo>;
@@ -139,6 +147,9 @@ protected:
                          ImageWrapperBase         *layer,
                          DisplaySliceIntent       intent);
 
+  // Extent in voxels at which an orthogonal display slice is drawn
+  Vector2d GetDisplaySliceExtent(ImageWrapperBase::DisplaySliceType *rgba);
+
   // Internal function to render the texture for a layer
   void RenderLayer(AbstractRenderContext *context,
                    TextureCache             &texture_cache,
@@ -150,6 +161,31 @@ protected:
 
   // Internal function to render mesh intersections with the cutting plane
   void RenderMeshes(AbstractRenderContext *context);
+
+  // Internal function to update the display slice of a layer
+  ImageWrapperBase::DisplaySliceType *UpdateDisplaySlice(ImageWrapperBase  *layer,
+                                                         DisplaySliceIntent intent);
+
+  // Internal function to render the base layer with its sticky overlays and
+  // segmentation as one composited texture. Returns false if the layers can
+  // not be fused, in which case nothing is drawn.
+  bool RenderFusedLayers(AbstractRenderContext *context,
+                         TextureCache          &texture_cache,
+                         ImageWrapperBase      *base_layer,
+                         bool                   bilinear,
+                         const Vector3d        &background);
+
+  // Whether fused compositing is enabled
+  bool m_FusedCompositing = true;
+
+  // Composited slices and their textures, for each base layer
+  struct FusedLayerStack
+  {
+    SmartPtr<FusedSliceCompositor> compositor;
+    SmartPtr<Texture> texture;
+    bool used = false;
+  };
+  std::map<unsigned long, FusedLayerStack> m_FusedStacks;
 };
 
 
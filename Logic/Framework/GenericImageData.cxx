@@ -398,25 +398,42 @@ GenericImageData
         m_MainImageWrapper->IsInitialized(),
         "Main image not initialized in GenericImageData::CompressSegmentation");
 
-  // This is the uncompressed representation of the segmentation
-  typedef itk::Image<LabelType, 4> UncompressedImage4DType;
-
-  // Cast the native to label type
-  CastNativeImage<UncompressedImage4DType> caster;
-  UncompressedImage4DType::Pointer imgUncompressed = caster(io);
-
-  //use specialized RoI filter to convert to RLEImage
   typedef LabelImageWrapper::Image4DType LabelImage4DType;
-  typedef itk::RegionOfInterestImageFilter<UncompressedImage4DType, LabelImage4DType> inConverterType;
-  inConverterType::Pointer inConv = inConverterType::New();
-  inConv->SetInput(imgUncompressed);
-  inConv->SetRegionOfInterest(imgUncompressed->GetLargestPossibleRegion());
-  inConv->Update();
-  LabelImage4DType::Pointer imgLabel = inConv->GetOutput();
-  imgUncompressed = NULL; //deallocate intermediate image to save memory
-
-  // Disconnect from the pipeline right away
-  imgLabel->DisconnectPipeline();
+  LabelImage4DType::Pointer imgLabel;
+
+  if(io->IsNativeImageRLE())
+    {
+    // The IO has already decoded the file into RLE. Share its lines, but not
+    // its header, which is modified below
+    LabelImage4DType *native = dynamic_cast<LabelImage4DType *>(io->GetNativeImage());
+    assert(native);
+    imgLabel = LabelImage4DType::New();
+    imgLabel->CopyInformation(native);
+    imgLabel->SetRegions(native->GetLargestPossibleRegion());
+    imgLabel->SetMetaDataDictionary(native->GetMetaDataDictionary());
+    imgLabel->SetPixelContainer(native->GetPixelContainer());
+    }
+  else
+    {
+    // This is the uncompressed representation of the segmentation
+    typedef itk::Image<LabelType, 4> UncompressedImage4DType;
+
+    // Cast the native to label type
+    CastNativeImage<UncompressedImage4DType> caster;
+    UncompressedImage4DType::Pointer imgUncompressed = caster(io);
+
+    //use specialized RoI filter to convert to RLEImage
+    typedef itk::RegionOfInterestImageFilter<UncompressedImage4DType, LabelImage4DType> inConverterType;
+    inConverterType::Pointer inConv = inConverterType::New();
+    inConv->SetInput(imgUncompressed);
+    inConv->SetRegionOfInterest(imgUncompressed->GetLargestPossibleRegion());
+    inConv->Update();
+    imgLabel = inConv->GetOutput();
+    imgUncompressed = NULL; //deallocate intermediate image to save memory
+
+    // Disconnect from the pipeline right away
+    imgLabel->DisconnectPipeline();
+    }
 
   // The header of the label image is made to match that of the grey image
   imgLabel->SetOrigin(this->GetMain()->GetImage4DBase()->GetOrigin());
@@ -49,6 +49,8 @@
 #include "IRISVectorTypesToITKConversion.h"
 #include "SNAPImageData.h"
 #include "MeshManager.h"
+#include "TaskExecutionService.h"
+#include "SNAPInstrumentation.h"
 #include "MeshExportSettings.h"
 #include "SegmentationStatistics.h"
 #include "RLEImageRegionIterator.h"
@@ -64,6 +66,7 @@
 #include "itkConstantBoundaryCondition.h"
 
 #include <itksys/SystemTools.hxx>
+#include <itksys/MD5.h>
 #include "vtkAppendPolyData.h"
 #include "vtkUnsignedShortArray.h"
 #include "vtkPointData.h"
@@ -93,10 +96,18 @@
 #include "ImageMeshLayers.h"
 #include "StandaloneMeshWrapper.h"
 #include "AllPurposeProgressAccumulator.h"
+#include "TDigestImageFilter.h"
+#include "FileBackedImageContainer.h"
 
 #include <stdio.h>
 #include <sstream>
+#include <fstream>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 IRISApplication
 ::IRISApplication() 
@@ -105,6 +116,20 @@ IRISApplication
   m_SystemInterface = new SystemInterface();
   m_HistoryManager = m_SystemInterface->GetHistoryManager();
 
+  // Very large images are backed by files in the application data directory,
+  // unless another directory has been configured
+  if(FileBackedMemory::GetDirectory().empty())
+    {
+    try
+      {
+      FileBackedMemory::SetDirectory(m_SystemInterface->GetImageSwapDirectory());
+      }
+    catch(IRISException &)
+      {
+      // Without a directory, large images are kept in memory
+      }
+    }
+
   // Create a color map preset manager
   m_ColorMapPresetManager = ColorMapPresetManager::New();
   m_ColorMapPresetManager->Initialize(m_SystemInterface);
@@ -170,6 +195,11 @@ IRISApplication
   m_MeshManager = MeshManager::New();
   m_MeshManager->Initialize(this);
 
+  // Initialize the background task service and pass on its events
+  m_TaskExecutionService = TaskExecutionService::New();
+  Rebroadcaster::RebroadcastAsSourceEvent(m_TaskExecutionService, TaskProgressEvent(), this);
+  Rebroadcaster::RebroadcastAsSourceEvent(m_TaskExecutionService, TaskFinishedEvent(), this);
+
   // Data saved for restoring IRIS state while in SNAP state
   m_SavedIRISSelectedSegmentationLayerId = 0;
 }
@@ -194,9 +224,20 @@ GetImageToAnatomyRAI()
     m_CurrentImageData->GetImageGeometry()->GetImageDirectionCosineMatrix());
 }
 
+SNAPInstrumentation *
+IRISApplication
+::GetInstrumentation() const
+{
+  return SNAPInstrumentation::GetInstance();
+}
+
 IRISApplication
 ::~IRISApplication() 
 {
+  // Stop any background work before tearing down
+  m_TaskExecutionService->CancelAll();
+  m_TaskExecutionService->WaitForAll();
+
   delete m_SystemInterface;
 }
 
@@ -1094,12 +1135,12 @@ IRISApplication ::ExportSlice(AnatomicalDirection iSliceAnat, const char *file)
   // Find the slicer that slices along that direction
   typedef ImageWrapperBase::DisplaySliceType SliceType;
   SmartPtr<SliceType>                        imgGrey = NULL;
+  ImageWrapperBase                          *main = m_CurrentImageData->GetMain();
   for (size_t i = 0; i < 3; i++)
   {
-    if (iSliceImg == m_CurrentImageData->GetMain()->GetDisplaySliceImageAxis(i))
+    if (iSliceImg == main->GetDisplaySliceImageAxis(i))
     {
-      imgGrey =
-        m_CurrentImageData->GetMain()->GetDisplaySlice(DisplaySliceIndex(i, DISPLAY_SLICE_MAIN));
+      imgGrey = main->GetDisplaySlice(DisplaySliceIndex(i, DISPLAY_SLICE_MAIN));
       break;
     }
   }
@@ -1121,7 +1162,21 @@ IRISApplication ::ExportSlice(AnatomicalDirection iSliceAnat, const char *file)
   WriterType::Pointer                     writer = WriterType::New();
   writer->SetInput(fltFlip->GetOutput());
   writer->SetFileName(file);
-  writer->Update();
+
+  // The slice shown on screen may be sampled at the resolution of the
+  // viewport, but the exported slice should have the resolution of the image
+  bool adaptive = main->IsSliceResolutionAdaptive();
+  main->SetSliceResolutionAdaptive(false);
+  try
+  {
+    writer->Update();
+  }
+  catch (...)
+  {
+    main->SetSliceResolutionAdaptive(adaptive);
+    throw;
+  }
+  main->SetSliceResolutionAdaptive(adaptive);
 }
 
 void 
@@ -1555,6 +1610,9 @@ IRISApplication
   // GuidedNativeImageIO without passing all this junk around?
   layer->SetFileName(io->GetFileNameOfNativeImage());
 
+  // Reuse the intensity statistics from an earlier session if available
+  RestoreOrCacheLayerStatistics(layer, io);
+
   // Add the overlay to the history
   m_HistoryManager->UpdateHistory("AnatomicImage", io->GetFileNameOfNativeImage(), true);
 
@@ -1648,6 +1706,150 @@ IRISApplication
     }
 }
 
+// Maximum number of image statistics kept in the cache
+static const unsigned int MAX_CACHED_STATISTICS = 1000;
+
+/** Write the statistics of an image to the cache, and trim the cache */
+static void WriteStatisticsCache(const std::string &stats_file, const std::string &signature,
+                                 const TDigestDataObject *tdigest)
+{
+  std::ofstream fout(stats_file.c_str(), std::ios::binary);
+  fout << signature << std::endl;
+  tdigest->Write(fout);
+  fout.close();
+
+  SystemInterface::TrimCacheDirectory(
+        itksys::SystemTools::GetFilenamePath(stats_file), ".stats", MAX_CACHED_STATISTICS);
+}
+
+/**
+ * Observes the t-digest of a layer whose statistics were not in the cache, and
+ * writes them to the cache the first time they are computed, unless the image
+ * has been modified since it was loaded.
+ */
+class StatisticsCacheWriterCommand : public itk::Command
+{
+public:
+  irisITKObjectMacro(StatisticsCacheWriterCommand, itk::Command)
+
+  void Execute(itk::Object *caller, const itk::EventObject &event) override
+    { this->Execute((const itk::Object *) caller, event); }
+
+  void Execute(const itk::Object *caller, const itk::EventObject &event) override
+    {
+    const TDigestDataObject *tdigest = dynamic_cast<const TDigestDataObject *>(caller);
+    if(m_Done || !tdigest || !itk::ModifiedEvent().CheckEvent(&event))
+      return;
+    if(!tdigest->IsExact() && tdigest->GetTotalWeight() == 0)
+      return;
+
+    // Only cache statistics of the image as it was read from the file
+    m_Done = true;
+    if(GetInputTime(tdigest) == m_InputTime)
+      {
+      try { WriteStatisticsCache(m_StatisticsFile, m_Signature, tdigest); }
+      catch(std::exception &) {}
+      }
+    }
+
+  static itk::ModifiedTimeType GetInputTime(const TDigestDataObject *tdigest)
+    {
+    itk::ProcessObject::Pointer source = tdigest->GetSource();
+    if(!source)
+      return 0;
+    itk::ProcessObject::DataObjectPointerArray inputs = source->GetInputs();
+    return (inputs.size() && inputs.front()) ? inputs.front()->GetMTime() : 0;
+    }
+
+  std::string m_StatisticsFile, m_Signature;
+  itk::ModifiedTimeType m_InputTime = 0;
+
+protected:
+  StatisticsCacheWriterCommand() {}
+
+  bool m_Done = false;
+};
+
+void
+IRISApplication
+::RestoreOrCacheLayerStatistics(ImageWrapperBase *layer, GuidedNativeImageIO *io)
+{
+  // The statistics are stored in a sidecar file in the application data
+  // directory, along with a signature of the image file and of the hints it
+  // was read with, which select, e.g., the DICOM series. If the file has been
+  // modified since the statistics were cached, they are computed again.
+  namespace sys = itksys;
+  std::string filename = io->GetFileNameOfNativeImage();
+
+  // The nickname does not affect the image data
+  Registry hints = io->GetHintsOfNativeImage();
+  hints.RemoveKeys("Nickname");
+  std::ostringstream hss;
+  hints.Print(hss);
+  std::string hstr = hss.str();
+
+  char hints_md5[33];
+  hints_md5[32] = 0;
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, reinterpret_cast<const unsigned char *>(hstr.c_str()), (int) hstr.size());
+  itksysMD5_FinalizeHex(md5, hints_md5);
+  itksysMD5_Delete(md5);
+
+  std::ostringstream oss;
+  oss << sys::SystemTools::ModifiedTime(filename) << " "
+      << sys::SystemTools::FileLength(filename) << " "
+      << layer->GetNumberOfVoxels() << " "
+      << layer->GetNumberOfComponents() << " "
+      << hints_md5;
+  std::string signature = oss.str();
+
+  try
+    {
+    std::string stats_file =
+        m_SystemInterface->GetStatisticsCacheAssociatedWithFile(filename.c_str());
+
+    // Try reading the cached statistics
+    std::ifstream fin(stats_file.c_str(), std::ios::binary);
+    std::string cached_signature;
+    if(fin && std::getline(fin, cached_signature) && cached_signature == signature)
+      {
+      SmartPtr<TDigestDataObject> stats = TDigestDataObject::New();
+      if(stats->Read(fin))
+        {
+        layer->SetCachedStatistics(stats);
+
+        // Mark the entry as recently used, so that it is not trimmed
+        fin.close();
+        sys::SystemTools::Touch(stats_file, false);
+        return;
+        }
+      }
+    fin.close();
+
+    // The statistics are not computed here, since they may not be needed
+    // right away. Instead, they are written for the next session once they
+    // are first computed. If that has already happened, write them now.
+    TDigestDataObject *tdigest = layer->GetTDigest();
+    if(tdigest->IsExact() || tdigest->GetTotalWeight() > 0)
+      {
+      WriteStatisticsCache(stats_file, signature, tdigest);
+      }
+    else
+      {
+      SmartPtr<StatisticsCacheWriterCommand> cmd = StatisticsCacheWriterCommand::New();
+      cmd->m_StatisticsFile = stats_file;
+      cmd->m_Signature = signature;
+      cmd->m_InputTime = StatisticsCacheWriterCommand::GetInputTime(tdigest);
+      tdigest->AddObserver(itk::ModifiedEvent(), cmd);
+      }
+    }
+  catch(std::exception &)
+    {
+    // The cache is an optimization, failing to use it is not an error
+    }
+}
+
 void
 IRISApplication
 ::CreateSegmentationSettings(ImageWrapperBase *wrapper, LayerRole role)
@@ -1684,6 +1886,9 @@ IRISApplication
   // Set the filename and nickname of the image wrapper
   layer->SetFileName(io->GetFileNameOfNativeImage());
 
+  // Reuse the intensity statistics from an earlier session if available
+  RestoreOrCacheLayerStatistics(layer, io);
+
   // Initialize the color label table to defaults
   m_ColorLabelTable->InitializeToDefaults();
 
@@ -1721,9 +1926,10 @@ IRISApplication
     AutoContrastLayerOnLoad(layer);
 
   // Save the thumbnail for the current image. This ensures that a thumbnail
-  // is created even if the application crashes or is killed.
-  ImageWrapperBase::DisplaySlicePointer thumbnail = layer->MakeThumbnail(128);
-  m_SystemInterface->WriteThumbnail(io->GetFileNameOfNativeImage().c_str(), thumbnail);
+  // is created even if the application crashes or is killed. The thumbnail
+  // is written in the background from a small slice through the middle.
+  m_SystemInterface->QueueThumbnail(io->GetFileNameOfNativeImage().c_str(),
+                                    layer->GetThumbnailDisplaySlice(128), 128);
 
   // We also want to reset the label history at this point, as these are
   // very different labels
@@ -1857,9 +2063,9 @@ IRISApplication
     // Write the image-level and project-level associations
     SaveMetaDataAssociatedWithLayer(main_image, MAIN_ROLE);
 
-    // Create a thumbnail from the one of the image slices
-    ImageWrapperBase::DisplaySlicePointer thumbnail = main_image->MakeThumbnail(128);
-    m_SystemInterface->WriteThumbnail(fnMain, thumbnail);
+    // Create a thumbnail from the middle slice of the image
+    ImageWrapperBase::DisplaySlicePointer slice = main_image->GetThumbnailDisplaySlice(128);
+    m_SystemInterface->QueueThumbnail(fnMain, slice, 128);
 
     // Do likewise for the project if one exists
     if(m_GlobalState->GetProjectFilename().length())
@@ -1867,7 +2073,7 @@ IRISApplication
       // TODO: it would look nicer if we actually saved the state of the SNAP
       // windows rather than just the image in its current colormap. But this
       // would require doing this elsewhere
-      m_SystemInterface->WriteThumbnail(m_GlobalState->GetProjectFilename().c_str(), thumbnail);
+      m_SystemInterface->QueueThumbnail(m_GlobalState->GetProjectFilename().c_str(), slice, 128);
       }
     }
 
@@ -2073,9 +2279,9 @@ void IRISApplication
     }
 }
 
-void IRISApplication
-::OpenImage(const char *fname, LayerRole role, IRISWarningList &wl,
-            Registry *meta_data_reg, Registry *io_hints_reg, bool additive)
+SmartPtr<AbstractOpenImageDelegate>
+IRISApplication
+::CreateOpenImageDelegate(LayerRole role, Registry *meta_data_reg, bool additive)
 {
   // Pointer to the delegate
   SmartPtr<AbstractOpenImageDelegate> delegate;
@@ -2103,10 +2309,289 @@ void IRISApplication
   if(meta_data_reg)
     delegate->SetMetaDataRegistry(meta_data_reg);
 
+  return delegate;
+}
+
+void IRISApplication
+::OpenImage(const char *fname, LayerRole role, IRISWarningList &wl,
+            Registry *meta_data_reg, Registry *io_hints_reg, bool additive)
+{
+  SmartPtr<AbstractOpenImageDelegate> delegate =
+      CreateOpenImageDelegate(role, meta_data_reg, additive);
+
   // Load via delegate, providing the IO hints
   this->OpenImageViaDelegate(fname, delegate, wl, io_hints_reg);
 }
 
+/**
+ * A command that records the progress of the process object observed by it.
+ * The progress may be reported on any thread and read on another.
+ */
+class ConcurrentProgressCommand : public itk::Command
+{
+public:
+  irisITKObjectMacro(ConcurrentProgressCommand, itk::Command)
+
+  void Execute(itk::Object *caller, const itk::EventObject &event) override
+    { this->Execute((const itk::Object *) caller, event); }
+
+  void Execute(const itk::Object *caller, const itk::EventObject &event) override
+    {
+    const itk::ProcessObject *po = dynamic_cast<const itk::ProcessObject *>(caller);
+    if(po && itk::ProgressEvent().CheckEvent(&event))
+      m_Progress = po->GetProgress();
+    }
+
+  float GetProgress() const { return m_Progress; }
+
+protected:
+  ConcurrentProgressCommand() : m_Progress(0.0f) {}
+
+  std::atomic<float> m_Progress;
+};
+
+std::vector<std::exception_ptr>
+IRISApplication
+::OpenImages(const std::vector<ImageLoadRequest> &requests, IRISWarningList &wl,
+             itk::Command *progressCmd)
+{
+  unsigned int n = requests.size();
+  if(n == 0)
+    return std::vector<std::exception_ptr>();
+
+  // The state of loading each image
+  struct LoadJob
+  {
+    SmartPtr<AbstractOpenImageDelegate> delegate;
+    SmartPtr<GuidedNativeImageIO> io;
+    Registry assoc_hints;
+    Registry *io_hints = NULL;
+    IRISWarningList warnings;
+    std::exception_ptr error;
+    SmartPtr<ConcurrentProgressCommand> header_progress, data_progress;
+    bool validated = false;
+  };
+  std::vector<LoadJob> jobs(n);
+
+  // Set up the delegates and find the IO hints on this thread
+  for(unsigned int i = 0; i < n; i++)
+    {
+    LoadJob &job = jobs[i];
+    job.header_progress = ConcurrentProgressCommand::New();
+    job.data_progress = ConcurrentProgressCommand::New();
+    try
+      {
+      job.delegate = CreateOpenImageDelegate(
+                       requests[i].role, requests[i].meta_data_reg, requests[i].additive);
+
+      job.io_hints = requests[i].io_hints_reg;
+      if(!job.io_hints)
+        {
+        m_SystemInterface->FindRegistryAssociatedWithFile(
+              requests[i].filename.c_str(), job.assoc_hints);
+        job.io_hints = &job.assoc_hints.Folder("Files.Grey");
+        }
+
+      job.io = GuidedNativeImageIO::New();
+      job.delegate->ConfigureImageIO(job.io);
+      }
+    catch(...)
+      {
+      job.error = std::current_exception();
+      }
+    }
+
+  // The images being decoded at any one time may take up at most half of the
+  // physical memory (as estimated from their headers). A larger image is
+  // still read, but on its own. If the size of the memory is unknown, there
+  // is no limit.
+  size_t memory_budget = FileBackedMemory::GetPhysicalMemorySize() / 2;
+  size_t memory_in_use = 0;
+  std::mutex memory_mutex;
+  std::condition_variable memory_cv;
+
+  // Read the headers and the image data concurrently. Each thread takes the
+  // next unread image, so a large file does not hold up the smaller ones.
+  // DICOM images are read one at a time, see GuidedNativeImageIO.
+  std::atomic<unsigned int> next_job(0);
+  unsigned int n_done = 0;
+  std::mutex done_mutex;
+  std::condition_variable done_cv;
+  auto reader = [&]()
+    {
+    for(unsigned int i; (i = next_job++) < n; )
+      {
+      LoadJob &job = jobs[i];
+      if(!job.error)
+        {
+        try
+          {
+          job.io->ReadNativeImageHeader(requests[i].filename.c_str(), *job.io_hints,
+                                        job.header_progress.GetPointer());
+          }
+        catch(...)
+          {
+          job.error = std::current_exception();
+          }
+        }
+
+      if(!job.error)
+        {
+        // Wait until there is room in memory for this image
+        size_t bytes = job.io->GetFileSizeOfNativeImage();
+          {
+          std::unique_lock<std::mutex> lock(memory_mutex);
+          memory_cv.wait(lock, [&]()
+            {
+            return memory_budget == 0 || memory_in_use == 0
+                || memory_in_use + bytes <= memory_budget;
+            });
+          memory_in_use += bytes;
+          }
+
+        try
+          {
+          job.io->ReadNativeImageData(job.data_progress.GetPointer());
+          }
+        catch(...)
+          {
+          job.error = std::current_exception();
+          }
+
+          {
+          std::lock_guard<std::mutex> lock(memory_mutex);
+          memory_in_use -= bytes;
+          }
+        memory_cv.notify_all();
+        }
+
+        {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        n_done++;
+        }
+      done_cv.notify_all();
+      }
+    };
+
+  // When progress is reported, this thread forwards it to the caller rather
+  // than reading, so that the progress command is only called on this thread
+  unsigned int n_threads = std::min(n, std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for(unsigned int k = progressCmd ? 0 : 1; k < n_threads; k++)
+    threads.emplace_back(reader);
+
+  if(progressCmd)
+    {
+    SmartPtr<TrivalProgressSource> progress = TrivalProgressSource::New();
+    progress->AddObserverToProgressEvents(progressCmd);
+    progress->StartProgress();
+
+    for(bool done = false; !done; )
+      {
+        {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done = done_cv.wait_for(lock, std::chrono::milliseconds(100),
+                                [&]() { return n_done == n; });
+        }
+
+      // Each image counts equally, and reading the data takes most of the time
+      double total = 0.0;
+      for(LoadJob &job : jobs)
+        total += 0.1 * job.header_progress->GetProgress()
+                 + 0.9 * job.data_progress->GetProgress();
+      progress->AddProgress(total / n - progress->GetProgress());
+      }
+
+    progress->EndProgress();
+    }
+  else
+    {
+    reader();
+    }
+
+  for(std::thread &t : threads)
+    t.join();
+
+  // Add the images to the application in order. The validation is done here
+  // because it depends on the images that precede this one.
+  std::vector<std::exception_ptr> errors(n);
+  std::exception_ptr main_error;
+  bool segmentations_validated = false;
+  for(unsigned int i = 0; i < n; i++)
+    {
+    LoadJob &job = jobs[i];
+    if(main_error)
+      {
+      job.error = main_error;
+      }
+    else
+      {
+      // The segmentations are loaded as a group: they are all validated
+      // against the main image before the first one is added, and if any of
+      // them fails, none are added and all fail with the same error.
+      if(requests[i].role == LABEL_ROLE && !segmentations_validated)
+        {
+        std::exception_ptr seg_error;
+        for(unsigned int j = i; j < n && !seg_error; j++)
+          {
+          if(requests[j].role != LABEL_ROLE)
+            continue;
+
+          if(!jobs[j].error)
+            {
+            try
+              {
+              jobs[j].delegate->ValidateHeader(jobs[j].io, jobs[j].warnings);
+              jobs[j].delegate->ValidateImage(jobs[j].io, jobs[j].warnings);
+              jobs[j].validated = true;
+              }
+            catch(...)
+              {
+              jobs[j].error = std::current_exception();
+              }
+            }
+          seg_error = jobs[j].error;
+          }
+
+        if(seg_error)
+          for(unsigned int j = i; j < n; j++)
+            if(requests[j].role == LABEL_ROLE)
+              jobs[j].error = seg_error;
+
+        segmentations_validated = true;
+        }
+
+      if(!job.error)
+        {
+        try
+          {
+          if(!job.validated)
+            job.delegate->ValidateHeader(job.io, job.warnings);
+          job.delegate->UnloadCurrentImage();
+          if(!job.validated)
+            job.delegate->ValidateImage(job.io, job.warnings);
+          ImageWrapperBase *layer = job.delegate->UpdateApplicationWithImage(job.io);
+          layer->SetIOHints(*job.io_hints);
+          }
+        catch(...)
+          {
+          job.error = std::current_exception();
+          }
+        wl.insert(wl.end(), job.warnings.begin(), job.warnings.end());
+        }
+      }
+
+    if(job.error && requests[i].role == MAIN_ROLE)
+      main_error = job.error;
+
+    // Release the native image as soon as it has been copied into the layer
+    job.io = NULL;
+    errors[i] = job.error;
+    }
+
+  return errors;
+}
+
 SmartPtr<AbstractSaveImageDelegate>
 IRISApplication::CreateSaveDelegateForLayer(ImageWrapperBase *layer, LayerRole role)
 {
@@ -2305,7 +2790,7 @@ IRISApplication
 }
 
 void IRISApplication::OpenProject(
-    const std::string &proj_file, IRISWarningList &warn)
+    const std::string &proj_file, IRISWarningList &warn, itk::Command *progressCmd)
 {
   // Load the registry file
   Registry preg;
@@ -2327,6 +2812,7 @@ void IRISApplication::OpenProject(
   std::string key;
   bool main_loaded = false;
   int n_segs_loaded = 0;
+  std::vector<ImageLoadRequest> requests;
   for(int i = 0;
       preg.HasFolder(key = Registry::Key("Layers.Layer[%03d]", i));
       i++)
@@ -2374,8 +2860,14 @@ void IRISApplication::OpenProject(
     if(role == LABEL_ROLE && n_segs_loaded > 0)
       load_additive = true;
 
-    // Load the image and its metadata
-    OpenImage(layer_file_full.c_str(), role, warn, &folder, io_hints, load_additive);
+    // Queue the image and its metadata for loading
+    ImageLoadRequest req;
+    req.filename = layer_file_full;
+    req.role = role;
+    req.meta_data_reg = &folder;
+    req.io_hints_reg = io_hints;
+    req.additive = load_additive;
+    requests.push_back(req);
 
     // Check if the main has been loaded
     if(role == MAIN_ROLE)
@@ -2392,6 +2884,11 @@ void IRISApplication::OpenProject(
   if(!main_loaded)
     throw IRISException("Empty or invalid project (main image not found in the project file).");
 
+  // Load all the layers at once, and report the first failure
+  for(std::exception_ptr &error : OpenImages(requests, warn, progressCmd))
+    if(error)
+      std::rethrow_exception(error);
+
   // Load Mesh Layers
   GetCurrentImageData()->GetMeshLayers()->
       LoadFromRegistry(preg, project_save_dir, project_dir);
@@ -47,6 +47,8 @@
 #include "SystemInterface.h"
 #include "UndoDataManager.h"
 #include "SNAPEvents.h"
+#include <exception>
+#include <vector>
 
 // #include "itkImage.h"
 
@@ -63,6 +65,8 @@ class AbstractSlicePreviewFilterWrapper;
 class UnsupervisedClustering;
 class ImageWrapperBase;
 class MeshManager;
+class TaskExecutionService;
+class SNAPInstrumentation;
 class AbstractOpenImageDelegate;
 class AbstractSaveImageDelegate;
 class IRISWarningList;
@@ -257,6 +261,38 @@ public:
                  Registry *io_hints_reg = NULL,
                  bool additive = false);
 
+  /** A request to load an image, with the same parameters as OpenImage() */
+  struct ImageLoadRequest
+  {
+    std::string filename;
+    LayerRole role;
+    Registry *meta_data_reg = NULL;
+    Registry *io_hints_reg = NULL;
+    bool additive = false;
+  };
+
+  /**
+   * Load several images, as if OpenImage() was called for each request in
+   * turn. The image files are read and decoded concurrently, and the images
+   * are then added to the application in the order of the requests. The
+   * time to load is therefore bounded by the largest file rather than by the
+   * sum of all files. Fewer images are decoded at once when together they
+   * would take up more than half of the physical memory, and DICOM images
+   * are read one at a time because GDCM is not thread-safe.
+   *
+   * The returned list holds the exception thrown for each request that
+   * failed (null for those that succeeded). If the main image fails to load,
+   * the requests that follow it fail with the same error. The segmentations
+   * are loaded as a group: if one of them fails, none are loaded, and all of
+   * them fail with that error.
+   *
+   * The optional progress command receives the combined progress of all the
+   * images. It is only called on the calling thread.
+   */
+  std::vector<std::exception_ptr> OpenImages(
+      const std::vector<ImageLoadRequest> &requests, IRISWarningList &wl,
+      itk::Command *progressCmd = nullptr);
+
   /**
    * Create a delegate for saving an image interactively or non-interactively
    * via a wizard.
@@ -637,6 +673,19 @@ public:
   /** Get the preset manager for color maps */
   irisGetMacro(ColorMapPresetManager, ColorMapPresetManager *)
 
+  /**
+   * Get the service used to run long operations in the background. Progress
+   * and completion events of background tasks are rebroadcast by this object
+   * as TaskProgressEvent and TaskFinishedEvent.
+   */
+  irisGetMacro(TaskExecutionService, TaskExecutionService *)
+
+  /**
+   * Get the timers, counters and histograms collected by the hot paths of
+   * the application (slicing, meshing, IO, etc.)
+   */
+  SNAPInstrumentation *GetInstrumentation() const;
+
   // ----------------------- Project support ------------------------------
 
   /**
@@ -649,9 +698,11 @@ public:
   void SaveProject(const std::string &proj_file);
 
   /**
-   * Open an existing project.
+   * Open an existing project. The optional progress command receives the
+   * progress of reading the images in the project.
    */
-  void OpenProject(const std::string &proj_file, IRISWarningList &warn);
+  void OpenProject(const std::string &proj_file, IRISWarningList &warn,
+                   itk::Command *progressCmd = nullptr);
 
   /**
    * Get Moved File Path from the absolute file path in the original project file
@@ -835,9 +886,20 @@ protected:
   // Auto-adjust contrast of a layer on load
   void AutoContrastLayerOnLoad(ImageWrapperBase *layer);
 
+  // Create the default delegate for loading an image in a given role
+  SmartPtr<AbstractOpenImageDelegate> CreateOpenImageDelegate(
+      LayerRole role, Registry *meta_data_reg, bool additive);
+
+  // Restore the intensity statistics of a layer cached from an earlier
+  // session, or cache them for the next one once they are computed
+  void RestoreOrCacheLayerStatistics(ImageWrapperBase *layer, GuidedNativeImageIO *io);
+
   // -------------- Saving IRIS state during SNAP mode --------------------
   unsigned long m_SavedIRISSelectedSegmentationLayerId;
 
+  // Background task execution. This is the last member, so that the worker
+  // threads are stopped before any of the data they may use is destroyed
+  SmartPtr<TaskExecutionService> m_TaskExecutionService;
 };
 
 #endif // __IRISApplication_h_
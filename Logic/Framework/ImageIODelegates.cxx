@@ -268,6 +268,13 @@ LoadSegmentationImageDelegate::LoadSegmentationImageDelegate()
   this->m_AdditiveMode = false;
 }
 
+void
+LoadSegmentationImageDelegate
+::ConfigureImageIO(GuidedNativeImageIO *io)
+{
+  io->SetReadLabelsAsRLE(true);
+}
+
 void
 LoadSegmentationImageDelegate
 ::UnloadCurrentImage()
@@ -490,6 +497,7 @@ void
 ReloadSegmentationWrapperDelegate
 ::UpdateWrapper()
 {
+  m_IO->SetReadLabelsAsRLE(true);
   m_IO->ReadNativeImageData();
 
   auto labelWrapper = dynamic_cast<LabelImageWrapper*>(m_Wrapper.GetPointer());
@@ -154,6 +154,9 @@ public:
   void UnloadCurrentImage() override;
   ImageWrapperBase * UpdateApplicationWithImage(GuidedNativeImageIO *io) override;
 
+  /** Segmentations are decoded straight into run-length encoding */
+  void ConfigureImageIO(GuidedNativeImageIO *io) override;
+
   /* check if the load could overwrite unsaved changes */
   bool CanLoadOverwriteUnsavedChanges(GuidedNativeImageIO *io, std::string filename);
 
@@ -39,6 +39,7 @@
 #endif
 
 #include "SNAPLevelSetDriver.h"
+#include "itkMultiThreaderBase.h"
 #include "itkGroupSpatialObject.h"
 #include "itkEllipseSpatialObject.h"
 #include "itkSpatialObjectToImageFilter.h"
@@ -52,6 +53,7 @@
 #include "IRISVectorTypesToITKConversion.h"
 #include "IRISException.h"
 #include "IRISApplication.h"
+#include "TaskExecutionService.h"
 #include "ThresholdSettings.h"
 #include "ColorMap.h"
 #include "SNAPImageData.h"
@@ -62,6 +64,8 @@
 #include "SlicePreviewFilterWrapper.h"
 #include "PreprocessingFilterConfigTraits.h"
 
+#include <algorithm>
+
 
 SNAPImageData
 ::SNAPImageData()
@@ -76,6 +80,12 @@ SNAPImageData
 
   m_CompressedAlternateLabelImage = NULL;
 
+  // No evolution on a worker thread
+  m_ReadySnapshot = -1;
+  m_SnapshotIterations[0] = m_SnapshotIterations[1] = 0;
+  m_DisplayedSnapshotIterations = 0;
+  m_EvolutionIterations = 0;
+
   // Initialize Mesh Layers storage
   m_MeshLayers = ImageMeshLayers::New();
   m_MeshLayers->Initialize(this);
@@ -87,6 +97,12 @@ SNAPImageData
 SNAPImageData
 ::~SNAPImageData() 
 {
+  if(m_EvolutionTask)
+    {
+    m_EvolutionTask->Cancel();
+    m_EvolutionTask->Wait();
+    }
+
   if(m_LevelSetDriver)
     delete m_LevelSetDriver;
 
@@ -188,40 +204,68 @@ SNAPImageData
   // data, not an image into a needless copy of an IRIS region.
   LabelImageType::RegionType region = imgInput->GetBufferedRegion();
 
-  // Create iterators to perform the copy
-  typedef itk::ImageRegionConstIterator<LabelImageType> SourceIterator;
-  typedef itk::ImageRegionIteratorWithIndex<FloatImageType> TargetIterator;
-  SourceIterator itSource(imgInput,region);
-  TargetIterator itTarget(imgLevelSet,region);
-
-  // During the copy loop, compute the extents of the initialization
+  // During the copy, compute the extents of the initialization
   Vector3i bbLower = region.GetSize();
   Vector3i bbUpper = region.GetIndex();
 
   unsigned long nInitVoxels = 0;
 
   // Convert the input label image into a binary function whose 0 level set
-  // is the boundary of the current label's region
-  while(!itSource.IsAtEnd())
+  // is the boundary of the current label's region. Only the runs of the label
+  // image are visited, so that the cost depends on the complexity of the
+  // segmentation rather than on the size of the ROI. Slices are handled in
+  // parallel, each keeping its own extents
+  typedef LabelImageType::BufferType LineImageType;
+  typedef LabelImageType::RLLine RLLine;
+  const LineImageType *imgLines = imgInput->GetBuffer();
+  unsigned int ny = region.GetSize(1), nz = region.GetSize(2);
+
+  struct SliceExtents
+  {
+    Vector3i lower, upper;
+    unsigned long count;
+  };
+  std::vector<SliceExtents> extents(nz, SliceExtents{bbLower, bbUpper, 0});
+
+  itk::MultiThreaderBase::New()->ParallelizeArray(
+        0, nz, [&](itk::SizeValueType z)
     {
-    if(itSource.Value() == m_SnakeColorLabel)
+    SliceExtents &ext = extents[z];
+    for(unsigned int y = 0; y < ny; y++)
       {
-      // Expand the bounding box accordingly
-      Vector3i point = itTarget.GetIndex();
-      bbLower = vector_min(bbLower,point);
-      bbUpper = vector_max(bbUpper,point);
-      
-      // Increase the number of initialization voxels
-      nInitVoxels++;
+      const RLLine &line = imgLines->GetBufferPointer()[z * ny + y];
+      FloatImageType::IndexType idx = region.GetIndex();
+      idx[1] += y; idx[2] += z;
+      float *row = imgLevelSet->GetBufferPointer() + imgLevelSet->ComputeOffset(idx);
 
-      // Set the target value to inside
-      itTarget.Value() = INSIDE_VALUE;
+      unsigned int x = 0;
+      for(const auto &seg : line)
+        {
+        if(seg.second == m_SnakeColorLabel)
+          {
+          // Set the target values to inside and expand the bounding box
+          std::fill(row + x, row + x + seg.first, INSIDE_VALUE);
+          Vector3i first((int) (idx[0] + x), (int) idx[1], (int) idx[2]);
+          Vector3i last((int) (idx[0] + x + seg.first - 1), (int) idx[1], (int) idx[2]);
+          ext.lower = vector_min(ext.lower, first);
+          ext.upper = vector_max(ext.upper, last);
+          ext.count += seg.first;
+          }
+        x += seg.first;
+        }
       }
+    }, nullptr);
 
-    // Go to the next pixel
-    ++itTarget; ++itSource;
+  for(const SliceExtents &ext : extents)
+    {
+    bbLower = vector_min(bbLower, ext.lower);
+    bbUpper = vector_max(bbUpper, ext.upper);
+    nInitVoxels += ext.count;
     }
 
+  // Bubbles are filled voxel by voxel, within their bounding boxes
+  typedef itk::ImageRegionIteratorWithIndex<FloatImageType> TargetIterator;
+
   // Fill in the bubbles by computing their
   for(unsigned int iBubble=0; iBubble < bubbles.size(); iBubble++)
     {
@@ -426,6 +470,13 @@ SNAPImageData
 
   // clock_t c1 = clock();
   m_LevelSetDriver->Run(nIterations);
+
+  // When a multiresolution evolution reaches full resolution, the level set
+  // filter is reinitialized and may have reallocated its output
+  FloatImageType::PixelContainer *output =
+      m_LevelSetDriver->GetOutput()->GetPixelContainer();
+  if(m_SnakeWrapper->GetImage()->GetPixelContainer() != output)
+    m_SnakeWrapper->SetPixelContainer(output);
   
   // The wrapper has to be notified that pixels have been updated
   m_SnakeWrapper->PixelsModified();
@@ -442,6 +493,149 @@ SNAPImageData
   this->InvokeEvent(LevelSetImageChangeEvent());
 }
 
+void
+SNAPImageData
+::StartSegmentation(unsigned int nIterations)
+{
+  // Should be in level set mode
+  assert(m_LevelSetDriver);
+
+  if(this->IsSegmentationRunning())
+    return;
+
+  // The worker thread will be writing to the level set filter output, so the
+  // snake wrapper is pointed to a snapshot of it while the evolution runs
+  FloatImageType *output = m_LevelSetDriver->GetOutput();
+  size_t n = output->GetPixelContainer()->Size();
+  for(unsigned int i = 0; i < 2; i++)
+    {
+    m_SnapshotBuffer[i] = LevelSetPixelContainer::New();
+    m_SnapshotBuffer[i]->Reserve(n);
+    }
+
+  std::copy(output->GetBufferPointer(), output->GetBufferPointer() + n,
+            m_SnapshotBuffer[0]->GetBufferPointer());
+  m_SnapshotIterations[0] = m_LevelSetDriver->GetElapsedIterations();
+  m_DisplayedSnapshotIterations = m_SnapshotIterations[0];
+  m_ReadySnapshot = -1;
+
+  m_LevelSetPipelineMutex.lock();
+  m_SnakeWrapper->SetPixelContainer(m_SnapshotBuffer[0]);
+  m_LevelSetPipelineMutex.unlock();
+
+  // Launch the evolution
+  TaskExecutionService *tes = m_Parent->GetTaskExecutionService();
+  m_EvolutionTask = tes->Submit(
+        "Evolving the active contour",
+        [this, nIterations](AsyncTask *task) { this->EvolveInBackground(task, nIterations); });
+  m_EvolutionIterations = nIterations;
+}
+
+void
+SNAPImageData
+::EvolveInBackground(AsyncTask *task, unsigned int nIterations)
+{
+  // The snapshot in buffer 0 is currently on display
+  int last = 0;
+
+  while(!task->GetCancellationToken()->IsCancelled())
+    {
+    // The level set pipeline mutex is not taken here: the display and the
+    // mesh pipeline only see the snapshot buffers
+    m_LevelSetDriver->Run(nIterations);
+
+    // Publish a snapshot only if the display has taken the last one, which
+    // leaves the other buffer free. Otherwise, keep iterating rather than
+    // wait for the display.
+    if(m_ReadySnapshot.load() < 0)
+      {
+      FloatImageType *output = m_LevelSetDriver->GetOutput();
+      const float *source = output->GetBufferPointer();
+      size_t n = output->GetPixelContainer()->Size();
+
+      // Copy the level set one chunk per thread
+      int target = 1 - last;
+      float *dest = m_SnapshotBuffer[target]->GetBufferPointer();
+      const size_t chunk = 1 << 20;
+      itk::MultiThreaderBase::New()->ParallelizeArray(
+            0, (n + chunk - 1) / chunk,
+            [source, dest, n, chunk](itk::SizeValueType k)
+        {
+        size_t i0 = k * chunk, i1 = std::min(n, i0 + chunk);
+        std::copy(source + i0, source + i1, dest + i0);
+        }, nullptr);
+
+      m_SnapshotIterations[target] = m_LevelSetDriver->GetElapsedIterations();
+      m_ReadySnapshot = target;
+      last = target;
+      }
+    }
+}
+
+void
+SNAPImageData
+::StopSegmentation()
+{
+  if(!m_EvolutionTask)
+    return;
+
+  // Let the current batch of iterations finish
+  m_EvolutionTask->Cancel();
+  m_EvolutionTask->Wait();
+  m_EvolutionTask = NULL;
+
+  // Point the wrapper back to the level set filter output
+  m_LevelSetPipelineMutex.lock();
+  m_SnakeWrapper->SetPixelContainer(m_LevelSetDriver->GetOutput()->GetPixelContainer());
+  m_SnakeWrapper->PixelsModified();
+  m_LevelSetPipelineMutex.unlock();
+
+  // Release the snapshots
+  m_ReadySnapshot = -1;
+  m_SnapshotBuffer[0] = NULL;
+  m_SnapshotBuffer[1] = NULL;
+
+  // Fire the update event
+  this->InvokeEvent(LevelSetImageChangeEvent());
+}
+
+bool
+SNAPImageData
+::IsSegmentationRunning() const
+{
+  return m_EvolutionTask && !m_EvolutionTask->IsFinished();
+}
+
+bool
+SNAPImageData
+::UpdateSegmentationSnapshot()
+{
+  if(!m_EvolutionTask)
+    return false;
+
+  // If the mesh pipeline is reading the displayed snapshot, try again on the
+  // next refresh rather than block the GUI
+  if(!m_LevelSetPipelineMutex.try_lock())
+    return false;
+
+  // Take the published snapshot, if any
+  int ready = m_ReadySnapshot.exchange(-1);
+  if(ready < 0)
+    {
+    m_LevelSetPipelineMutex.unlock();
+    return false;
+    }
+
+  m_SnakeWrapper->SetPixelContainer(m_SnapshotBuffer[ready]);
+  m_SnakeWrapper->PixelsModified();
+  m_DisplayedSnapshotIterations = m_SnapshotIterations[ready];
+  m_LevelSetPipelineMutex.unlock();
+
+  // Fire the update event
+  this->InvokeEvent(LevelSetImageChangeEvent());
+  return true;
+}
+
 bool
 SNAPImageData
 ::IsEvolutionConverged()
@@ -459,6 +653,9 @@ SNAPImageData
   // Should be in level set mode
   assert(m_LevelSetDriver);
 
+  // Stop the evolution on the worker thread
+  this->StopSegmentation();
+
   // Enter a thread-safe section
   m_LevelSetPipelineMutex.lock();
 
@@ -485,6 +682,9 @@ SNAPImageData
   // Should be in level set mode
   assert(m_LevelSetDriver);
 
+  // Stop the evolution on the worker thread
+  this->StopSegmentation();
+
   // Enter a thread-safe section
   m_LevelSetPipelineMutex.lock();
 
@@ -505,14 +705,27 @@ SNAPImageData
   // Should be in level set mode
   assert(m_LevelSetDriver);
 
+  // The driver can not be modified while the worker thread is using it, so
+  // the evolution is paused and then resumed with the new parameters
+  unsigned int nIterations = m_EvolutionIterations;
+  bool running = this->IsSegmentationRunning();
+  this->StopSegmentation();
+
   // Pass through to the level set driver
   m_LevelSetDriver->SetSnakeParameters(parameters);
+
+  if(running)
+    this->StartSegmentation(nIterations);
 }
 
 unsigned int 
 SNAPImageData::
 GetElapsedSegmentationIterations() const
 {
+  // While the worker thread is running, report the displayed snapshot
+  if(m_EvolutionTask)
+    return m_DisplayedSnapshotIterations;
+
   return m_LevelSetDriver->GetElapsedIterations();
 }
 
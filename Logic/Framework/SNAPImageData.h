@@ -48,6 +48,7 @@
 #include "SNAPLevelSetDriver.h"
 
 #include <vector>
+#include <atomic>
 
 #include "SNAPLevelSetFunction.h"
 #include "itkImageAdaptor.h"
@@ -58,6 +59,8 @@ namespace itk {
   class FastMutexLock;
 }
 
+class AsyncTask;
+
 class SNAPSegmentationROISettings;
 
 
@@ -163,6 +166,34 @@ public:
   /** Run the segmentation for a fixed number of iterations */
   void RunSegmentation(unsigned int nIterations);
 
+  /**
+   * Run the segmentation on a worker thread (see TaskExecutionService) in
+   * batches of nIterations, until StopSegmentation() is called. The evolving
+   * level set is not displayed directly. After each batch, if the display has
+   * picked up the previous snapshot, the worker copies the level set into a
+   * free snapshot buffer and publishes it. The GUI should call
+   * UpdateSegmentationSnapshot() at its refresh rate to display the latest
+   * snapshot. Neither side waits for the other, so the iteration rate does
+   * not depend on the cost of rendering.
+   */
+  void StartSegmentation(unsigned int nIterations);
+
+  /**
+   * Stop the evolution started by StartSegmentation(). This returns once the
+   * current batch of iterations has finished, and displays the final level set.
+   */
+  void StopSegmentation();
+
+  /** Is the segmentation running on a worker thread? */
+  bool IsSegmentationRunning() const;
+
+  /**
+   * Display the most recent snapshot published by the worker thread, if it
+   * has not been displayed yet. Returns true if the display was updated.
+   * Must be called from the main thread.
+   */
+  bool UpdateSegmentationSnapshot();
+
   /** Revert the segmentation to the beginning */
   void RestartSegmentation();
 
@@ -288,6 +319,20 @@ protected:
   // causing the level set pipeline to update at once.
   std::mutex m_LevelSetPipelineMutex;
 
+  // Evolution on a worker thread. The two snapshot buffers alternate between
+  // the worker and the display. m_ReadySnapshot is the index of a published
+  // snapshot that the display has not picked up yet, or -1.
+  typedef FloatImageType::PixelContainer LevelSetPixelContainer;
+  SmartPtr<AsyncTask> m_EvolutionTask;
+  SmartPtr<LevelSetPixelContainer> m_SnapshotBuffer[2];
+  unsigned int m_SnapshotIterations[2];
+  std::atomic<int> m_ReadySnapshot;
+  unsigned int m_DisplayedSnapshotIterations;
+  unsigned int m_EvolutionIterations;
+
+  // Work function for the evolution task
+  void EvolveInBackground(AsyncTask *task, unsigned int nIterations);
+
   // Are we in example mode
   bool m_LabelImageInExampleMode;
 
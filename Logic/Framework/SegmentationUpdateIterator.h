@@ -75,7 +75,9 @@ public:
       m_ActiveLabel(active_label),
       m_DrawOver(draw_over),
       m_Iterator(seg_wrapper->GetModifiableImage(), region),
-      m_ChangedVoxels(0)
+      m_ChangedVoxels(0),
+      m_LastOldLabel(0),
+      m_LastNewLabel(0)
   {
     // Create the delta
     m_Delta = new UndoDelta();
@@ -126,6 +128,7 @@ public:
         m_VoxelDelta += new_label - lOld;
         m_Iterator.Set(new_label);
         m_ChangedVoxels++;
+        this->NoteLabelChange(lOld, new_label);
         }
       }
   }
@@ -157,6 +160,7 @@ public:
         m_VoxelDelta += m_ActiveLabel - lOld;
         m_Iterator.Set(m_ActiveLabel);
         m_ChangedVoxels++;
+        this->NoteLabelChange(lOld, m_ActiveLabel);
         }
       }
   }
@@ -173,6 +177,7 @@ public:
       m_VoxelDelta += 0 - lOld;
       m_Iterator.Set(0);
       m_ChangedVoxels++;
+      this->NoteLabelChange(lOld, 0);
       }
   }
 
@@ -189,6 +194,7 @@ public:
       m_VoxelDelta += new_label - lOld;
       m_Iterator.Set(new_label);
       m_ChangedVoxels++;
+      this->NoteLabelChange(lOld, new_label);
       }
   }
 
@@ -215,6 +221,7 @@ public:
       m_VoxelDelta += new_label - lOld;
       m_Iterator.Set(new_label);
       m_ChangedVoxels++;
+      this->NoteLabelChange(lOld, new_label);
       }
   }
 
@@ -235,7 +242,7 @@ public:
     m_Delta->FinishEncoding();
     if(m_ChangedVoxels > 0)
       {
-      m_Wrapper->PixelsModified();
+      m_Wrapper->PixelsModified(m_Region, m_ChangedLabels);
       if(undo_string)
         m_Wrapper->StoreUndoPoint(undo_string, RelinquishDelta());
       return true;
@@ -263,8 +270,27 @@ public:
     return m_Delta;
   }
 
+  // Get the set of labels that were replaced or painted
+  const std::set<LabelType> &GetChangedLabels() const
+  {
+    return m_ChangedLabels;
+  }
+
 protected:
 
+  // Keep track of the labels affected by the update. Consecutive changes
+  // usually involve the same pair of labels, so we avoid the set lookup
+  void NoteLabelChange(LabelType lOld, LabelType lNew)
+  {
+    if(m_ChangedLabels.empty() || lOld != m_LastOldLabel || lNew != m_LastNewLabel)
+      {
+      m_ChangedLabels.insert(lOld);
+      m_ChangedLabels.insert(lNew);
+      m_LastOldLabel = lOld;
+      m_LastNewLabel = lNew;
+      }
+  }
+
   // The label image wrapper to which segmentation is applied
   LabelImageWrapper *m_Wrapper;
 
@@ -291,6 +317,10 @@ protected:
 
   // Number of voxels actually modified
   unsigned long m_ChangedVoxels;
+
+  // Labels affected by the update, and the last pair of labels recorded
+  std::set<LabelType> m_ChangedLabels;
+  LabelType m_LastOldLabel, m_LastNewLabel;
 };
 
 
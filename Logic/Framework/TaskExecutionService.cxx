@@ -0,0 +1,367 @@
+#include "TaskExecutionService.h"
+#include <itkProcessObject.h>
+#include <itkEventObject.h>
+#include <vtkAlgorithm.h>
+#include <vtkCommand.h>
+#include <algorithm>
+
+bool
+TaskCancellationToken
+::IsCancelled() const
+{
+  return m_Cancelled || (m_Parent && m_Parent->IsCancelled());
+}
+
+void
+TaskCancellationToken
+::ThrowIfCancelled() const
+{
+  if(this->IsCancelled())
+    throw TaskCancelledException("The operation was cancelled");
+}
+
+SmartPtr<TaskCancellationToken>
+TaskCancellationToken
+::CreateChild()
+{
+  SmartPtr<TaskCancellationToken> child = TaskCancellationToken::New();
+  child->m_Parent = this;
+  return child;
+}
+
+TaskCancellationToken
+::~TaskCancellationToken()
+{
+  this->UnwatchFilters();
+}
+
+void
+TaskCancellationToken
+::WatchFilter(itk::ProcessObject *filter)
+{
+  // ITK filters check the abort flag when they report progress. The token
+  // keeps the filter alive until the observer is removed in UnwatchFilters,
+  // which happens before the token goes away, so neither can outlive the other
+  std::lock_guard<std::mutex> lock(m_WatchMutex);
+  for(auto &wf : m_WatchedFilters)
+    if(wf.Filter == filter)
+      return;
+
+  WatchedFilter wf;
+  wf.Filter = filter;
+  wf.ProgressTag = filter->AddObserver(itk::ProgressEvent(), [this, filter](const itk::EventObject &)
+    {
+    if(this->IsCancelled())
+      filter->AbortGenerateDataOn();
+    });
+  m_WatchedFilters.push_back(wf);
+}
+
+void
+TaskCancellationToken
+::WatchAlgorithm(vtkAlgorithm *algorithm)
+{
+  std::lock_guard<std::mutex> lock(m_WatchMutex);
+  for(auto &wa : m_WatchedAlgorithms)
+    if(wa.Algorithm == algorithm)
+      return;
+
+  WatchedAlgorithm wa;
+  wa.Algorithm = algorithm;
+  wa.ProgressTag = algorithm->AddObserver(
+        vtkCommand::ProgressEvent, this, &TaskCancellationToken::OnAlgorithmProgress);
+  m_WatchedAlgorithms.push_back(wa);
+}
+
+void
+TaskCancellationToken
+::OnAlgorithmProgress(vtkObject *caller, unsigned long, void *)
+{
+  // VTK algorithms check the abort flag as they report progress
+  vtkAlgorithm *algorithm = vtkAlgorithm::SafeDownCast(caller);
+  if(algorithm && this->IsCancelled())
+    algorithm->SetAbortExecute(1);
+}
+
+void
+TaskCancellationToken
+::UnwatchFilters()
+{
+  std::lock_guard<std::mutex> lock(m_WatchMutex);
+  for(auto &wf : m_WatchedFilters)
+    wf.Filter->RemoveObserver(wf.ProgressTag);
+  for(auto &wa : m_WatchedAlgorithms)
+    wa.Algorithm->RemoveObserver(wa.ProgressTag);
+  m_WatchedFilters.clear();
+  m_WatchedAlgorithms.clear();
+}
+
+
+AsyncTask
+::AsyncTask()
+  : m_Status(TASK_PENDING), m_ProgressValue(0.0)
+{
+  m_CancellationToken = TaskCancellationToken::New();
+  m_ProgressAccumulator = AllPurposeProgressAccumulator::New();
+}
+
+std::string
+AsyncTask
+::GetErrorMessage() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_ErrorMessage;
+}
+
+void
+AsyncTask
+::WatchFilter(itk::ProcessObject *filter, float weight)
+{
+  m_ProgressAccumulator->RegisterSource(filter, weight);
+  m_CancellationToken->WatchFilter(filter);
+}
+
+void
+AsyncTask
+::SetStatus(Status status, const std::string &error)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_ErrorMessage = error;
+  m_Status = status;
+  if(status > TASK_RUNNING)
+    m_Finished.notify_all();
+}
+
+void
+AsyncTask
+::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_Finished.wait(lock, [this]() { return this->IsFinished(); });
+}
+
+
+TaskExecutionService
+::TaskExecutionService()
+  : m_Stopping(false), m_ProgressPending(false), m_NotificationSent(false)
+{
+  m_NumberOfThreads = std::max(2u, std::thread::hardware_concurrency() / 4);
+}
+
+TaskExecutionService
+::~TaskExecutionService()
+{
+  // Cancel everything and wait for the workers to exit
+  this->CancelAll();
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stopping = true;
+    }
+  m_QueueCondition.notify_all();
+  for(std::thread &worker : m_Workers)
+    worker.join();
+}
+
+void
+TaskExecutionService
+::SetNumberOfThreads(unsigned int n)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if(m_Workers.empty())
+    m_NumberOfThreads = std::max(1u, n);
+}
+
+void
+TaskExecutionService
+::StartWorkers()
+{
+  // Called with the mutex locked
+  while(m_Workers.size() < m_NumberOfThreads)
+    m_Workers.emplace_back(&TaskExecutionService::WorkerLoop, this);
+}
+
+SmartPtr<AsyncTask>
+TaskExecutionService
+::Submit(const std::string &name, WorkFunction work, CompletionFunction completion)
+{
+  SmartPtr<AsyncTask> task = AsyncTask::New();
+  task->m_Name = name;
+  task->m_Work = work;
+  task->m_Completion = completion;
+
+  // Record progress from the task's accumulator (on the worker thread)
+  AsyncTask *tp = task;
+  task->m_ProgressAccumulator->AddObserver(
+        itk::ProgressEvent(), [this, tp](const itk::EventObject &)
+    {
+    tp->m_ProgressValue = tp->m_ProgressAccumulator->GetProgress();
+    m_ProgressPending = true;
+    this->NotifyEventsPending();
+    });
+
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    this->StartWorkers();
+    m_Queue.push_back(task);
+    m_ActiveTasks.push_back(task);
+    }
+  m_QueueCondition.notify_one();
+
+  return task;
+}
+
+void
+TaskExecutionService
+::CancelAll()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  for(auto &task : m_ActiveTasks)
+    task->Cancel();
+}
+
+void
+TaskExecutionService
+::WaitForAll()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_IdleCondition.wait(lock, [this]() { return m_ActiveTasks.empty(); });
+}
+
+unsigned int
+TaskExecutionService
+::GetNumberOfActiveTasks() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_ActiveTasks.size();
+}
+
+std::vector<SmartPtr<AsyncTask> >
+TaskExecutionService
+::GetActiveTasks() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return std::vector<SmartPtr<AsyncTask> >(m_ActiveTasks.begin(), m_ActiveTasks.end());
+}
+
+void
+TaskExecutionService
+::WorkerLoop()
+{
+  while(true)
+    {
+    SmartPtr<AsyncTask> task;
+      {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_QueueCondition.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+      if(m_Queue.empty())
+        return;
+      task = m_Queue.front();
+      m_Queue.pop_front();
+      }
+
+    this->RunTask(task);
+
+      {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_ActiveTasks.remove(task);
+      m_FinishedTasks.push_back(task);
+      if(m_ActiveTasks.empty())
+        m_IdleCondition.notify_all();
+      }
+
+    this->NotifyEventsPending();
+    }
+}
+
+void
+TaskExecutionService
+::RunTask(AsyncTask *task)
+{
+  // Tasks cancelled while in the queue are not started
+  if(task->GetCancellationToken()->IsCancelled())
+    {
+    task->SetStatus(AsyncTask::TASK_CANCELLED);
+    return;
+    }
+
+  task->SetStatus(AsyncTask::TASK_RUNNING);
+  try
+    {
+    task->m_ProgressAccumulator->ResetProgress();
+    task->m_Work(task);
+    task->m_ProgressValue = 1.0;
+    task->SetStatus(AsyncTask::TASK_SUCCEEDED);
+    }
+  catch(TaskCancelledException &)
+    {
+    task->SetStatus(AsyncTask::TASK_CANCELLED);
+    }
+  catch(itk::ProcessAborted &)
+    {
+    task->SetStatus(AsyncTask::TASK_CANCELLED);
+    }
+  catch(std::exception &exc)
+    {
+    if(task->GetCancellationToken()->IsCancelled())
+      task->SetStatus(AsyncTask::TASK_CANCELLED);
+    else
+      task->SetStatus(AsyncTask::TASK_FAILED, exc.what());
+    }
+  catch(...)
+    {
+    task->SetStatus(AsyncTask::TASK_FAILED, "Unknown error");
+    }
+
+  // Disconnect the progress sources and the filters watched for cancellation,
+  // which may belong to the work function
+  task->m_ProgressAccumulator->UnregisterAllSources();
+  task->m_CancellationToken->UnwatchFilters();
+}
+
+void
+TaskExecutionService
+::NotifyEventsPending()
+{
+  std::function<void ()> callback;
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if(m_NotificationSent || !m_EventsPendingCallback)
+      return;
+    m_NotificationSent = true;
+    callback = m_EventsPendingCallback;
+    }
+  callback();
+}
+
+void
+TaskExecutionService
+::SetEventsPendingCallback(std::function<void ()> callback)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_EventsPendingCallback = callback;
+  m_NotificationSent = false;
+}
+
+void
+TaskExecutionService
+::ProcessPendingEvents()
+{
+  std::vector<SmartPtr<AsyncTask> > finished;
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    finished.swap(m_FinishedTasks);
+    m_NotificationSent = false;
+    }
+
+  if(m_ProgressPending.exchange(false))
+    this->InvokeEvent(TaskProgressEvent());
+
+  for(auto &task : finished)
+    {
+    if(task->m_Completion)
+      task->m_Completion(task);
+    }
+
+  if(finished.size())
+    this->InvokeEvent(TaskFinishedEvent());
+}
@@ -0,0 +1,276 @@
+#ifndef TASKEXECUTIONSERVICE_H
+#define TASKEXECUTIONSERVICE_H
+
+#include "SNAPCommon.h"
+#include "SNAPEvents.h"
+#include "IRISException.h"
+#include "AllPurposeProgressAccumulator.h"
+#include <itkObject.h>
+#include <vtkSmartPointer.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+class ProcessObject;
+}
+
+class vtkAlgorithm;
+class vtkObject;
+
+/** Exception thrown by a task that notices that it has been cancelled */
+irisExceptionMacro(TaskCancelledException, IRISException)
+
+/**
+ * A flag shared between the code that requests cancellation of an operation
+ * and the code that performs it. Tokens form a hierarchy: a child token is
+ * cancelled when its parent is cancelled, but cancelling a child does not
+ * affect the parent. The token may be checked from any thread.
+ */
+class TaskCancellationToken : public itk::Object
+{
+public:
+  irisITKObjectMacro(TaskCancellationToken, itk::Object)
+
+  /** Request cancellation */
+  void Cancel() { m_Cancelled = true; }
+
+  /** Check if cancellation has been requested for this token or a parent */
+  bool IsCancelled() const;
+
+  /** Throw TaskCancelledException if cancellation has been requested */
+  void ThrowIfCancelled() const;
+
+  /** Create a token that is cancelled together with this one */
+  SmartPtr<TaskCancellationToken> CreateChild();
+
+  /**
+   * Make an ITK filter observe this token. The filter is aborted (and throws
+   * itk::ProcessAborted) at its next progress update after cancellation.
+   */
+  void WatchFilter(itk::ProcessObject *filter);
+
+  /**
+   * Make a VTK algorithm observe this token. The algorithm stops at its next
+   * progress update after cancellation. VTK does not throw, so its output is
+   * incomplete, and the caller should call ThrowIfCancelled() after updating.
+   */
+  void WatchAlgorithm(vtkAlgorithm *algorithm);
+
+  /**
+   * Remove the observers added by WatchFilter and WatchAlgorithm. The token
+   * holds a reference to the watched objects until then.
+   */
+  void UnwatchFilters();
+
+protected:
+  TaskCancellationToken() : m_Cancelled(false) {}
+  virtual ~TaskCancellationToken();
+
+  std::atomic<bool> m_Cancelled;
+  SmartPtr<TaskCancellationToken> m_Parent;
+
+  // Filters passed to WatchFilter and WatchAlgorithm and the tags of the
+  // observers added to them
+  struct WatchedFilter
+  {
+    SmartPtr<itk::ProcessObject> Filter;
+    unsigned long ProgressTag;
+  };
+  struct WatchedAlgorithm
+  {
+    vtkSmartPointer<vtkAlgorithm> Algorithm;
+    unsigned long ProgressTag;
+  };
+  std::list<WatchedFilter> m_WatchedFilters;
+  std::list<WatchedAlgorithm> m_WatchedAlgorithms;
+  std::mutex m_WatchMutex;
+
+  // Progress callback of the watched VTK algorithms
+  void OnAlgorithmProgress(vtkObject *caller, unsigned long, void *);
+};
+
+/**
+ * A unit of work executed by the TaskExecutionService. The work function
+ * receives the task and uses it to report progress (by registering ITK/VTK
+ * filters or nested accumulators with the progress accumulator) and to check
+ * for cancellation. The status, progress and error message may be queried
+ * from any thread.
+ */
+class AsyncTask : public itk::Object
+{
+public:
+  irisITKObjectMacro(AsyncTask, itk::Object)
+
+  enum Status { TASK_PENDING = 0, TASK_RUNNING, TASK_SUCCEEDED, TASK_FAILED, TASK_CANCELLED };
+
+  typedef std::function<void (AsyncTask *)> WorkFunction;
+  typedef std::function<void (AsyncTask *)> CompletionFunction;
+
+  /** Name of the task, for display */
+  const std::string &GetName() const { return m_Name; }
+
+  /** Current status */
+  Status GetStatus() const { return m_Status; }
+
+  /** Whether the task has finished (successfully or not) */
+  bool IsFinished() const { return m_Status > TASK_RUNNING; }
+
+  /** Progress of the task, between 0 and 1 */
+  double GetProgress() const { return m_ProgressValue; }
+
+  /** Error message for failed tasks */
+  std::string GetErrorMessage() const;
+
+  /** The cancellation token for this task */
+  TaskCancellationToken *GetCancellationToken() { return m_CancellationToken; }
+
+  /**
+   * The root of the progress hierarchy for this task. The work function
+   * registers its sources (filters, pipelines, other accumulators) here.
+   */
+  AllPurposeProgressAccumulator *GetProgressAccumulator() { return m_ProgressAccumulator; }
+
+  /** Request cancellation of the task */
+  void Cancel() { m_CancellationToken->Cancel(); }
+
+  /** Convenience method for the work function: throws if cancelled */
+  void CheckCancelled() const { m_CancellationToken->ThrowIfCancelled(); }
+
+  /**
+   * Convenience method for the work function: registers an ITK filter as a
+   * progress source with the given weight, and aborts it on cancellation.
+   */
+  void WatchFilter(itk::ProcessObject *filter, float weight = 1.0f);
+
+  /** Block until the task has finished */
+  void Wait();
+
+protected:
+  AsyncTask();
+  virtual ~AsyncTask() {}
+
+  friend class TaskExecutionService;
+
+  void SetStatus(Status status, const std::string &error = std::string());
+
+  std::string m_Name;
+  WorkFunction m_Work;
+  CompletionFunction m_Completion;
+
+  std::atomic<Status> m_Status;
+  std::atomic<double> m_ProgressValue;
+  std::string m_ErrorMessage;
+
+  SmartPtr<TaskCancellationToken> m_CancellationToken;
+  SmartPtr<AllPurposeProgressAccumulator> m_ProgressAccumulator;
+
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Finished;
+};
+
+/**
+ * \class TaskExecutionService
+ * \brief Runs long operations on a pool of worker threads.
+ *
+ * Tasks are submitted with a work function, which runs on a worker thread,
+ * and an optional completion function, which runs on the main thread. Events
+ * from the workers are not fired directly. Instead, they are queued and
+ * delivered by ProcessPendingEvents(), which must be called from the main
+ * thread. The GUI can register a callback (SetEventsPendingCallback) that is
+ * invoked from the worker thread whenever events are waiting, and should use
+ * it to schedule a call to ProcessPendingEvents() in its event loop.
+ *
+ * ProcessPendingEvents() fires TaskProgressEvent when the progress of any
+ * task has changed and TaskFinishedEvent after running completion functions.
+ * IRISApplication rebroadcasts these events.
+ */
+class TaskExecutionService : public itk::Object
+{
+public:
+  irisITKObjectMacro(TaskExecutionService, itk::Object)
+
+  typedef AsyncTask::WorkFunction WorkFunction;
+  typedef AsyncTask::CompletionFunction CompletionFunction;
+
+  /**
+   * Set the number of worker threads. The operations themselves are usually
+   * multi-threaded, so a small number of workers is sufficient. This can only
+   * be called before the first task is submitted.
+   */
+  void SetNumberOfThreads(unsigned int n);
+  unsigned int GetNumberOfThreads() const { return m_NumberOfThreads; }
+
+  /** Submit a task for execution */
+  SmartPtr<AsyncTask> Submit(const std::string &name,
+                             WorkFunction work,
+                             CompletionFunction completion = CompletionFunction());
+
+  /** Request cancellation of all pending and running tasks */
+  void CancelAll();
+
+  /** Block until all submitted tasks have finished */
+  void WaitForAll();
+
+  /** Number of tasks that have not finished */
+  unsigned int GetNumberOfActiveTasks() const;
+
+  /** The tasks that have not finished, in order of submission */
+  std::vector<SmartPtr<AsyncTask> > GetActiveTasks() const;
+
+  /**
+   * Deliver the queued events: call the completion functions of finished tasks
+   * and fire progress and completion events. Call from the main thread only.
+   */
+  void ProcessPendingEvents();
+
+  /**
+   * Set the function called (from a worker thread) when events become pending.
+   * It is called once until the next ProcessPendingEvents().
+   */
+  void SetEventsPendingCallback(std::function<void ()> callback);
+
+protected:
+  TaskExecutionService();
+  virtual ~TaskExecutionService();
+
+  // Worker thread main loop
+  void WorkerLoop();
+
+  // Run a single task on the current thread
+  void RunTask(AsyncTask *task);
+
+  // Start the worker threads if needed
+  void StartWorkers();
+
+  // Note that events are pending, and notify the GUI if necessary
+  void NotifyEventsPending();
+
+  unsigned int m_NumberOfThreads;
+  std::vector<std::thread> m_Workers;
+  bool m_Stopping;
+
+  // Tasks waiting for a worker and all unfinished tasks
+  std::deque<SmartPtr<AsyncTask> > m_Queue;
+  std::list<SmartPtr<AsyncTask> > m_ActiveTasks;
+
+  // Finished tasks whose completion has not been delivered
+  std::vector<SmartPtr<AsyncTask> > m_FinishedTasks;
+
+  // Pending event flags
+  std::atomic<bool> m_ProgressPending;
+  bool m_NotificationSent;
+  std::function<void ()> m_EventsPendingCallback;
+
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_QueueCondition, m_IdleCondition;
+};
+
+#endif // TASKEXECUTIONSERVICE_H
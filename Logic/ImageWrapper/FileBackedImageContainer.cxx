@@ -0,0 +1,126 @@
+#include "FileBackedImageContainer.h"
+#include <cstdlib>
+#include <string>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+size_t FileBackedMemory::m_SizeThreshold = 0;
+bool FileBackedMemory::m_SizeThresholdSet = false;
+std::string FileBackedMemory::m_Directory;
+
+size_t
+FileBackedMemory::GetPhysicalMemorySize()
+{
+#ifdef WIN32
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if(GlobalMemoryStatusEx(&status))
+    return (size_t) status.ullTotalPhys;
+  return 0;
+#else
+  long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGE_SIZE);
+  return (pages > 0 && page_size > 0) ? (size_t) pages * (size_t) page_size : 0;
+#endif
+}
+
+void *
+FileBackedMemory::Allocate(size_t bytes)
+{
+  std::string dir = GetDirectory();
+  if(bytes == 0 || dir.empty())
+    return nullptr;
+
+#ifdef WIN32
+  // The file is deleted once the mapping and both handles are gone
+  char path[MAX_PATH + 1];
+  if(!GetTempFileNameA(dir.c_str(), "snp", 0, path))
+    return nullptr;
+
+  HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  unsigned long long size = bytes;
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                      (DWORD) (size >> 32), (DWORD) (size & 0xffffffff), NULL);
+  void *ptr = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes) : NULL;
+  if(mapping)
+    CloseHandle(mapping);
+  CloseHandle(file);
+  return ptr;
+#else
+  // Unlink the file right away, the mapping keeps it alive
+  std::string path = dir + "/itksnap_image_XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if(fd < 0)
+    return nullptr;
+  unlink(path.c_str());
+
+  void *ptr = nullptr;
+  if(ftruncate(fd, (off_t) bytes) == 0)
+    {
+    ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED)
+      ptr = nullptr;
+    }
+  close(fd);
+  return ptr;
+#endif
+}
+
+void
+FileBackedMemory::Release(void *ptr, size_t bytes)
+{
+  if(!ptr)
+    return;
+#ifdef WIN32
+  (void) bytes;
+  UnmapViewOfFile(ptr);
+#else
+  munmap(ptr, bytes);
+#endif
+}
+
+size_t
+FileBackedMemory::GetSizeThreshold()
+{
+  if(!m_SizeThresholdSet)
+    {
+    m_SizeThreshold = GetPhysicalMemorySize() / 2;
+    m_SizeThresholdSet = true;
+    }
+  return m_SizeThreshold;
+}
+
+void
+FileBackedMemory::SetSizeThreshold(size_t bytes)
+{
+  m_SizeThreshold = bytes;
+  m_SizeThresholdSet = true;
+}
+
+bool
+FileBackedMemory::IsFileBackedSize(size_t bytes)
+{
+  size_t threshold = GetSizeThreshold();
+  return threshold > 0 && bytes >= threshold && !GetDirectory().empty();
+}
+
+std::string
+FileBackedMemory::GetDirectory()
+{
+  const char *env = getenv("ITKSNAP_IMAGE_SWAP_DIR");
+  return (env && *env) ? std::string(env) : m_Directory;
+}
+
+void
+FileBackedMemory::SetDirectory(const std::string &dir)
+{
+  m_Directory = dir;
+}
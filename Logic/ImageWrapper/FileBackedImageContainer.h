@@ -0,0 +1,124 @@
+#ifndef FILEBACKEDIMAGECONTAINER_H
+#define FILEBACKEDIMAGECONTAINER_H
+
+#include <itkImportImageContainer.h>
+#include <itkObjectFactory.h>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+/**
+ * Blocks of memory that are mapped from a temporary file rather than
+ * allocated on the heap. The operating system pages such a block in from
+ * the file as it is accessed and writes it back under memory pressure, so
+ * an image larger than the physical memory can be loaded, and slicing it
+ * only brings the pages of the visible slices into memory. The temporary
+ * file is deleted when the block is released or the process exits.
+ *
+ * The files are created in a swap directory, which should be on a disk
+ * rather than in a memory-based file system such as a tmpfs /tmp. The
+ * directory is set by the application (IRISApplication uses ImageSwap in
+ * the application data directory) and can be overridden with the
+ * ITKSNAP_IMAGE_SWAP_DIR environment variable. Without a directory, no
+ * buffers are file-backed.
+ */
+class FileBackedMemory
+{
+public:
+  /** Map a zero-filled block of the given size. Returns nullptr on failure */
+  static void *Allocate(size_t bytes);
+
+  /** Unmap a block returned by Allocate */
+  static void Release(void *ptr, size_t bytes);
+
+  /**
+   * Buffers of at least this many bytes are mapped from a file. The default
+   * is half of the physical memory. Setting the threshold to zero disables
+   * file-backed buffers.
+   */
+  static size_t GetSizeThreshold();
+  static void SetSizeThreshold(size_t bytes);
+
+  /** Whether a buffer of the given size should be mapped from a file */
+  static bool IsFileBackedSize(size_t bytes);
+
+  /** Size of the physical memory, or zero if it can not be determined */
+  static size_t GetPhysicalMemorySize();
+
+  /**
+   * Directory in which the backing files are created. The environment
+   * variable ITKSNAP_IMAGE_SWAP_DIR, if set, takes precedence over the
+   * directory passed to SetDirectory.
+   */
+  static std::string GetDirectory();
+  static void SetDirectory(const std::string &dir);
+
+private:
+  static size_t m_SizeThreshold;
+  static bool m_SizeThresholdSet;
+  static std::string m_Directory;
+};
+
+/**
+ * A pixel container for itk::Image and itk::VectorImage whose buffer is
+ * allocated with FileBackedMemory. Assign it to an image with
+ * SetPixelContainer() before calling Allocate(). The buffer can not be
+ * handed over to another container, and the container can not take over a
+ * heap buffer, so code that passes raw buffers between images must check
+ * for this container type.
+ */
+template <typename TElementIdentifier, typename TElement>
+class FileBackedImageContainer
+    : public itk::ImportImageContainer<TElementIdentifier, TElement>
+{
+public:
+  typedef FileBackedImageContainer Self;
+  typedef itk::ImportImageContainer<TElementIdentifier, TElement> Superclass;
+  typedef itk::SmartPointer<Self> Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  typedef TElementIdentifier ElementIdentifier;
+  typedef TElement Element;
+
+  static_assert(std::is_arithmetic<TElement>::value,
+                "File-backed buffers hold plain numeric data");
+
+  itkNewMacro(Self)
+  itkTypeMacro(FileBackedImageContainer, ImportImageContainer)
+
+protected:
+  FileBackedImageContainer() {}
+
+  virtual ~FileBackedImageContainer()
+  {
+    // The parent destructor would release the buffer with delete[]
+    this->DeallocateManagedMemory();
+  }
+
+  virtual TElement *AllocateElements(ElementIdentifier size,
+                                     bool itkNotUsed(UseValueInitialization) = false) const override
+  {
+    // Mapped memory is zero-filled, so it is always value-initialized
+    void *ptr = FileBackedMemory::Allocate(size * sizeof(TElement));
+    if(!ptr)
+      {
+      itk::MemoryAllocationError exc(__FILE__, __LINE__,
+                                     "Failed to map a temporary file for the image buffer", ITK_LOCATION);
+      throw exc;
+      }
+    return static_cast<TElement *>(ptr);
+  }
+
+  virtual void DeallocateManagedMemory() override
+  {
+    if(this->GetContainerManageMemory() && this->GetImportPointer())
+      FileBackedMemory::Release(this->GetImportPointer(), this->Capacity() * sizeof(TElement));
+
+    // Same bookkeeping as the parent class
+    Superclass::SetImportPointer(nullptr);
+    this->SetCapacity(0);
+    this->SetSize(0);
+  }
+};
+
+#endif // FILEBACKEDIMAGECONTAINER_H
@@ -37,6 +37,7 @@
 #include "SNAPCommon.h"
 #include "SNAPRegistryIO.h"
 #include "ImageCoordinateGeometry.h"
+#include "FileBackedImageContainer.h"
 
 #include "itkImage.h"
 #include "itkImageIOBase.h"
@@ -74,15 +75,32 @@
 #include "MultiFrameDicomSeriesSorter.h"
 #include "itkStringTools.h"
 #include "AllPurposeProgressAccumulator.h"
+#include "RLEImage.h"
+#include "RLELabelImageIO.h"
+#include "RLEDecodeImageFilter.h"
+#include "itkMultiThreaderBase.h"
 
 #include <itk_zlib.h>
 #include "itkImportImageFilter.h"
 #include <algorithm>
+#include <limits>
+#include <mutex>
 #include "itksys/Base64.h"
+#include "itksys/SystemTools.hxx"
 
 
 using namespace std;
 
+// GDCM keeps global state (the data dictionaries, the scanner) that is not
+// safe to use from several threads at once. Images may be read concurrently
+// (see IRISApplication::OpenImages), so all DICOM reading goes through this
+// lock and DICOM images are read one at a time.
+static std::mutex &gdcm_io_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
 bool GuidedNativeImageIO::m_StaticDataInitialized = false;
 
 RegistryEnumMap<GuidedNativeImageIO::FileFormat> GuidedNativeImageIO::m_EnumFileFormat;
@@ -106,6 +124,7 @@ GuidedNativeImageIO
   {"NRRD Volume Sequence", "seq.nrrd",  false, true,  true,  true},
   {"NRRD", "nrrd,nhdr",                 true,  true,  true,  true},
   {"Raw Binary", "raw",                 false, false, true,  true},
+  {"Run-Length Labels", "rle",          true,  true,  false, true},
   {"Siemens Vision", "ima",             false, false, true,  true},
   {"VoxBo CUB", "cub,cub.gz",           true,  false, true,  true},
   {"VTK Image", "vtk",                  true,  false, true,  true},
@@ -304,6 +323,7 @@ GuidedNativeImageIO
     m_StaticDataInitialized = true;
     }
 
+  m_FileFormat = FORMAT_COUNT;
   m_NativeType = itk::IOComponentEnum::UNKNOWNCOMPONENTTYPE;
   m_NativeComponents = 0;
   m_NativeTypeString = m_IOBase->GetComponentTypeAsString(m_NativeType);
@@ -413,6 +433,7 @@ GuidedNativeImageIO
 		case FORMAT_SIEMENS:    m_IOBase = itk::SiemensVisionImageIO::New(); break;
 		case FORMAT_VTK:        m_IOBase = itk::VTKImageIO::New();           break;
 		case FORMAT_VOXBO_CUB:  m_IOBase = itk::VoxBoCUBImageIO::New();      break;
+    case FORMAT_RLE:        m_IOBase = RLELabelImageIO::New();           break;
 		case FORMAT_DICOM_DIR:
 		case FORMAT_DICOM_DIR_4DCTA:
     case FORMAT_ECHO_CARTESIAN_DICOM:
@@ -483,6 +504,11 @@ GuidedNativeImageIO
                         "image '%s' using format '%s'.",
                         FileName, m_Hints["Format"][""]);
 
+  // Read DICOM headers one at a time
+  std::unique_lock<std::mutex> gdcm_lock(gdcm_io_mutex(), std::defer_lock);
+  if(this->UsesGDCM())
+    gdcm_lock.lock();
+
   // Read the information about the image
 	if(m_FileFormat == FORMAT_DICOM_DIR || m_FileFormat == FORMAT_DICOM_DIR_4DCTA)
     {
@@ -676,6 +702,13 @@ GuidedNativeImageIO
   UpdateMemberVariables();
 }
 
+bool
+GuidedNativeImageIO
+::UsesGDCM() const
+{
+  return dynamic_cast<itk::GDCMImageIO *>(m_IOBase.GetPointer()) != nullptr;
+}
+
 GuidedNativeImageIO::DispatchBase*
 GuidedNativeImageIO
 ::CreateDispatch(itk::IOComponentEnum comp_type)
@@ -705,6 +738,13 @@ void
 GuidedNativeImageIO
 ::ReadNativeImageData(itk::Command *progressCmd)
 {
+  m_NativeImageIsRLE = false;
+
+  // Read DICOM data one image at a time
+  std::unique_lock<std::mutex> gdcm_lock(gdcm_io_mutex(), std::defer_lock);
+  if(this->UsesGDCM())
+    gdcm_lock.lock();
+
   // Based on the component type, read image in native mode
   DispatchBase *dispatch = this->CreateDispatch(m_IOBase->GetComponentType());
 	dispatch->ReadNative(this, m_NativeFileName.c_str(), m_Hints, progressCmd);
@@ -1361,6 +1401,11 @@ GuidedNativeImageIO
 			ecdProgSrc->AddProgress(0.2);
 			}
     }
+  else if (m_ReadLabelsAsRLE && this->CanReadNativeAsRLE())
+    {
+    // Label image: encode slabs of the file straight into RLE
+    this->DoReadNativeAsRLE<TScalar>(progressCmd);
+    }
   else
     {
     // Non-DICOM DIR: read from single image
@@ -1375,10 +1420,14 @@ GuidedNativeImageIO
     regularImageReadingProgSrc->AddObserverToProgressEvents(progressCmd);
     regularImageReadingProgSrc->StartProgress();
 
-    // Create the native image
+    // Create the native image. An image too large to comfortably fit in
+    // memory is read into a buffer mapped from a temporary file, so that the
+    // system can page it in and out as its slices are accessed
     typename NativeImageType::Pointer image = NativeImageType::New();
 
     UpdateImageHeader<NativeImageType>(image);
+    if(FileBackedMemory::IsFileBackedSize(m_IOBase->GetImageSizeInBytes()))
+      image->SetPixelContainer(FileBackedImageContainer<itk::SizeValueType, TScalar>::New());
     image->Allocate();
 
     regularImageReadingProgSrc->AddProgress(0.1);
@@ -1471,10 +1520,146 @@ GuidedNativeImageIO
     }
 }
 
+bool
+GuidedNativeImageIO
+::CanReadNativeAsRLE() const
+{
+  typedef RLEImage<LabelType, 4> LabelImageType;
+  typedef LabelImageType::RLSegment::first_type CounterType;
+
+  // Multi-component and 5D+ images are folded into components, sequence NRRD
+  // needs its components converted to time points. These take the usual path
+  return m_IOBase
+      && m_IOBase->GetNumberOfComponents() == 1
+      && m_IOBase->GetNumberOfDimensions() <= 4
+      && m_IOBase->GetDimensions(0) <= std::numeric_limits<CounterType>::max()
+      && m_FileFormat != FORMAT_NRRD_SEQ;
+}
+
+template<class TScalar>
+void
+GuidedNativeImageIO
+::DoReadNativeAsRLE(itk::Command *progressCmd)
+{
+  typedef itk::VectorImage<TScalar, 4> NativeImageType;
+  typedef RLEImage<LabelType, 4> LabelImageType;
+  typedef LabelImageType::RLLine RLLine;
+  typedef LabelImageType::RLSegment RLSegment;
+
+  SmartPtr<TrivalProgressSource> progSrc = TrivalProgressSource::New();
+  progSrc->AddObserverToProgressEvents(progressCmd);
+  progSrc->StartProgress();
+
+  // Let the usual code parse the geometry into an image that is never allocated
+  typename NativeImageType::Pointer header = NativeImageType::New();
+  UpdateImageHeader<NativeImageType>(header);
+
+  // Create the RLE image. Allocation sets every line to a single run
+  SmartPtr<LabelImageType> image = LabelImageType::New();
+  image->CopyInformation(header);
+  image->SetRegions(header->GetLargestPossibleRegion());
+  image->SetMetaDataDictionary(header->GetMetaDataDictionary());
+  image->Allocate();
+
+  // Run-length files are read straight into the lines of the image
+  RLELabelImageIO *rleIO = dynamic_cast<RLELabelImageIO *>(m_IOBase.GetPointer());
+  if(rleIO && sizeof(TScalar) == sizeof(LabelType))
+    {
+    rleIO->ReadRLEImage(image.GetPointer());
+    progSrc->AddProgress(1.0);
+    m_NativeImage = image.GetPointer();
+    m_NativeImageIsRLE = true;
+    return;
+    }
+
+  typename LabelImageType::SizeType dim = image->GetLargestPossibleRegion().GetSize();
+  size_t nx = dim[0], ny = dim[1], nz = dim[2], nt = dim[3];
+  size_t nd = m_IOBase->GetNumberOfDimensions();
+
+  // Slabs are made of whole z-slices of a single time point, with about 16M
+  // voxels in each. If the IO cannot read part of a file, it is read at once.
+  // So is a gzip-compressed file, because reading a slab from it decompresses
+  // the file from the start, which for n slabs takes n times as long
+  const size_t slab_voxels = 1 << 24;
+  size_t nz_slab = nz, nt_slab = nt;
+  std::string ext = itksys::SystemTools::LowerCase(
+        itksys::SystemTools::GetFilenameLastExtension(m_IOBase->GetFileName()));
+  if(m_IOBase->CanStreamRead() && ext != ".gz")
+    {
+    m_IOBase->SetUseStreamedReading(true);
+    nz_slab = std::max((size_t) 1, std::min(nz, slab_voxels / std::max((size_t) 1, nx * ny)));
+    nt_slab = 1;
+    }
+
+  size_t n_slabs = ((nz + nz_slab - 1) / nz_slab) * (nt / nt_slab);
+  std::vector<TScalar> buffer(nx * ny * nz_slab * nt_slab);
+  RLLine *lines = image->GetBuffer()->GetBufferPointer();
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+
+  for(size_t t = 0; t < nt; t += nt_slab)
+    {
+    for(size_t z = 0; z < nz; z += nz_slab)
+      {
+      size_t nz_this = std::min(nz_slab, nz - z);
+
+      // Read the slab from the file
+      itk::ImageIORegion ioRegion(nd);
+      for(size_t i = 0; i < nd; i++)
+        {
+        ioRegion.SetIndex(i, i == 2 ? z : (i == 3 ? t : 0));
+        ioRegion.SetSize(i, i == 2 ? nz_this : (i == 3 ? nt_slab : dim[i]));
+        }
+      m_IOBase->SetIORegion(ioRegion);
+      m_IOBase->Read(buffer.data());
+
+      // The lines of the slab are contiguous in the RLE buffer, which is
+      // indexed by (y, z, t)
+      size_t first_line = ny * (z + nz * t);
+      size_t n_lines = ny * nz_this * nt_slab;
+      const TScalar *data = buffer.data();
+
+      mt->ParallelizeArray(0, n_lines, [&](itk::SizeValueType k)
+        {
+        const TScalar *p = data + k * nx;
+        RLLine rl;
+        RLSegment seg(1, static_cast<LabelType>(p[0]));
+        for(size_t x = 1; x < nx; x++)
+          {
+          LabelType v = static_cast<LabelType>(p[x]);
+          if(v == seg.second)
+            {
+            seg.first++;
+            }
+          else
+            {
+            rl.push_back(seg);
+            seg = RLSegment(1, v);
+            }
+          }
+        rl.push_back(seg);
+        rl.shrink_to_fit();
+        lines[first_line + k].swap(rl);
+        }, nullptr);
+
+      progSrc->AddProgress(1.0 / n_slabs);
+      }
+    }
+
+  m_NativeImage = image.GetPointer();
+  m_NativeImageIsRLE = true;
+}
+
 void
 GuidedNativeImageIO
 ::SaveNativeImage(const char *FileName, Registry &folder)
 {
+  // Labels read as RLE are saved from their runs
+  if(this->IsNativeImageRLE())
+    {
+    this->DoSaveNativeRLE(FileName, folder);
+    return;
+    }
+
   // Cast image from native format to TPixel
   DispatchBase *dispatch = this->CreateDispatch(this->GetComponentTypeInNativeImage());
   dispatch->SaveNative(this, FileName, folder);
@@ -1499,6 +1684,45 @@ GuidedNativeImageIO
   this->SaveImage<InputImageType>(FileName, folder, input);
 }
 
+void
+GuidedNativeImageIO
+::DoSaveNativeRLE(const char *FileName, Registry &folder)
+{
+  typedef RLEImage<LabelType, 4> LabelImageType;
+  typedef itk::Image<LabelType, 4> UncompressedType;
+  LabelImageType *native = dynamic_cast<LabelImageType *>(this->GetNativeImage());
+  assert(native);
+
+  // Create an Image IO based on the folder
+  CreateImageIO(FileName, folder, false);
+
+  // The run-length format is written from the lines without decoding
+  if(RLELabelImageIO *rleIO = dynamic_cast<RLELabelImageIO *>(m_IOBase.GetPointer()))
+    {
+    rleIO->SetFileName(FileName);
+    rleIO->WriteRLEImage(native);
+    return;
+    }
+
+  // Other formats are decoded on demand, in slabs of about 16M voxels if the
+  // format supports streamed writing
+  typedef RLEDecodeImageFilter<LabelImageType, UncompressedType> DecoderType;
+  DecoderType::Pointer decoder = DecoderType::New();
+  decoder->SetInput(native);
+
+  const size_t slab_voxels = 1 << 24;
+  size_t n_voxels = native->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  typedef itk::ImageFileWriter<UncompressedType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(FileName);
+  if(m_IOBase)
+    writer->SetImageIO(m_IOBase);
+  writer->SetInput(decoder->GetOutput());
+  writer->SetNumberOfStreamDivisions(1 + n_voxels / slab_voxels);
+  writer->Update();
+}
+
 template<typename TImageType>
 void
 GuidedNativeImageIO
@@ -1525,6 +1749,10 @@ GuidedNativeImageIO
 {
   std::string md5;
 
+  // Labels read as RLE are hashed from their runs
+  if(this->IsNativeImageRLE())
+    return this->DoGetNativeRLEMD5Hash();
+
   // Cast image from native format to TPixel
   DispatchBase *dispatch = this->CreateDispatch(this->GetComponentTypeInNativeImage());
   md5 = dispatch->GetNativeMD5Hash(this);
@@ -1533,6 +1761,40 @@ GuidedNativeImageIO
   return md5;
 }
 
+std::string
+GuidedNativeImageIO
+::DoGetNativeRLEMD5Hash()
+{
+  typedef RLEImage<LabelType, 4> LabelImageType;
+  LabelImageType *native = dynamic_cast<LabelImageType *>(this->GetNativeImage());
+  assert(native);
+
+  // Decode one line at a time, so that the hash is the same as the hash of
+  // the dense label buffer in the same voxel order
+  size_t nx = native->GetLargestPossibleRegion().GetSize(0);
+  std::vector<LabelType> line_buffer(nx);
+  const LabelImageType::BufferType *lines = native->GetBuffer();
+  const LabelImageType::RLLine *line = lines->GetBufferPointer();
+  size_t n_lines = lines->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  char hex_code[33];
+  hex_code[32] = 0;
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  for(size_t k = 0; k < n_lines; k++)
+    {
+    LabelType *p = line_buffer.data();
+    for(const auto &seg : line[k])
+      p = std::fill_n(p, seg.first, seg.second);
+    itksysMD5_Append(md5,
+      (unsigned char *) line_buffer.data(), nx * sizeof(LabelType));
+    }
+  itksysMD5_FinalizeHex(md5, hex_code);
+  itksysMD5_Delete(md5);
+
+  return std::string(hex_code);
+}
+
 template<typename TNative>
 std::string
 GuidedNativeImageIO
@@ -1902,6 +2164,26 @@ CastNativeImage<TOutputImage,TCastFunctor>
     return;
     }
 
+  // A file-backed buffer can not be resized in place. Instead, the data are
+  // mapped into a new file-backed buffer and the native buffer is released
+  typedef FileBackedImageContainer<typename InPixCon::ElementIdentifier, TNative> FileInPixCon;
+  typedef FileBackedImageContainer<typename OutPixCon::ElementIdentifier, OutputComponentType> FileOutPixCon;
+  if(dynamic_cast<FileInPixCon *>(ipc))
+    {
+    size_t nval = input->GetBufferedRegion().GetNumberOfPixels() * ncomp;
+    SmartPtr<FileOutPixCon> pc = FileOutPixCon::New();
+    pc->Reserve(nval);
+
+    TNative *pn = ipc->GetImportPointer();
+    OutputComponentType *pt = pc->GetImportPointer();
+    for(size_t i = 0; i < nval; i++)
+      m_Functor(pn + i, pt + i);
+
+    ipc->Initialize();
+    m_Output->SetPixelContainer(pc.GetPointer());
+    return;
+    }
+
   // We are going to map data from native to target format in place in order
   // to save memory. This way, SNAP will never use extra memory when loading
   // an image. Some trickery is needed though.
@@ -1991,6 +2273,7 @@ GuidedNativeImageIO::GuessFormatForFileName(
     if(havebuff && !strncmp(buffer+128,"DICM",4))
       {
       // issue #26: Check for Echo Cartesian Dicom
+      std::lock_guard<std::mutex> gdcm_lock(gdcm_io_mutex());
       gdcm::Reader reader;
       reader.SetFileName(fname.c_str());
 
@@ -72,7 +72,8 @@ public:
     FORMAT_DICOM_FILE,      // A single DICOM file
     FORMAT_ECHO_CARTESIAN_DICOM, // A Echocardiography Cartesian DICOM
     FORMAT_GE4, FORMAT_GE5, FORMAT_GIPL,
-    FORMAT_MHA, FORMAT_MINC, FORMAT_NIFTI, FORMAT_NRRD_SEQ, FORMAT_NRRD, FORMAT_RAW, FORMAT_SIEMENS,
+    FORMAT_MHA, FORMAT_MINC, FORMAT_NIFTI, FORMAT_NRRD_SEQ, FORMAT_NRRD, FORMAT_RAW,
+    FORMAT_RLE, FORMAT_SIEMENS,
     FORMAT_VOXBO_CUB, FORMAT_VTK, FORMAT_GENERIC_ITK,
     FORMAT_COUNT};
 
@@ -184,6 +185,14 @@ public:
   vnl_vector_fixed<unsigned int, 4> GetDimensionsOfNativeImage() const
     { return m_NativeDimensions; }
 
+  /** The format of the file read or written, set by CreateImageIO() */
+  FileFormat GetFileFormatOfNativeImage() const
+    { return m_FileFormat; }
+
+  /** The hints (format, DICOM series, etc.) used to read the native image */
+  const Registry &GetHintsOfNativeImage() const
+    { return m_Hints; }
+
   /**
    * This method returns the image internally stored in this object. This is
    * a pointer to an itk::VectorImage of some native format. Use one of the
@@ -198,6 +207,24 @@ public:
   bool IsNativeImageLoaded() const
     { return m_NativeImage.IsNotNull(); }
 
+  /**
+   * Request that label images be decoded straight into run-length encoding.
+   * When set, single-component images with up to four dimensions are read in
+   * slabs of z-slices (or in one piece if the format does not support partial
+   * reads) and each slab is encoded into an RLEImage<LabelType, 4>, which then
+   * becomes the native image. This avoids holding the image in a dense label
+   * buffer. Other images are read as usual.
+   */
+  irisGetSetMacro(ReadLabelsAsRLE, bool)
+
+  /**
+   * Whether the native image is an RLEImage<LabelType, 4> produced because of
+   * ReadLabelsAsRLE. Such images cannot be cast. They are saved and hashed as
+   * images of LabelType, decoded one piece at a time.
+   */
+  bool IsNativeImageRLE() const
+    { return m_NativeImage.IsNotNull() && m_NativeImageIsRLE; }
+
   /** 
    * Save the native image it its native format (to a different location and
    * filename, presumably). This function is not meant as part of the normal
@@ -320,12 +347,24 @@ protected:
   /** Templated function that reads a scalar image in its native datatype */
 	template <typename TScalar> void DoReadNative(const char *fname, Registry &folder, itk::Command *ProgressCmd = nullptr);
 
+  /** Templated function that reads a label image directly into RLE format */
+  template <typename TScalar> void DoReadNativeAsRLE(itk::Command *progressCmd);
+
+  /** Whether the image described by the IO base can be read by DoReadNativeAsRLE */
+  bool CanReadNativeAsRLE() const;
+
   /** Templated function that reads a scalar image in its native datatype */
   template <typename TScalar> void DoSaveNative(const char *fname, Registry &folder);
 
   /** Templated function that computes an MD5 hash from the stored image */
   template <typename TScalar> std::string DoGetNativeMD5Hash();
 
+  /** Save a native image read as RLE, decoding it in slabs */
+  void DoSaveNativeRLE(const char *fname, Registry &folder);
+
+  /** Compute the MD5 hash of a native image read as RLE, line by line */
+  std::string DoGetNativeRLEMD5Hash();
+
 	/** convert 4D itk image into 4D itk vector image */
 	template <typename TScalar> void ConvertToVectorImage(
 			itk::VectorImage<TScalar, 4> *output, itk::Image<TScalar, 4> *input) const;
@@ -378,6 +417,9 @@ protected:
    */
   void UpdateMemberVariables();
 
+  /** Whether the current IO object reads through GDCM (DICOM formats) */
+  bool UsesGDCM() const;
+
   /**
    * Update an image pointer header based on m_IOBase
    */
@@ -456,6 +498,10 @@ protected:
   /** Flags for delegate specific configurations */
   bool m_LoadMultiComponentAs4D = false;
   bool m_Load4DAsMultiComponent = false;
+  bool m_ReadLabelsAsRLE = false;
+
+  // Whether m_NativeImage is a run-length encoded label image
+  bool m_NativeImageIsRLE = false;
 
 };
 
@@ -51,7 +51,6 @@
 #include <itkImageFileWriter.h>
 #include <itkResampleImageFilter.h>
 #include <itkIdentityTransform.h>
-#include <itkFlipImageFilter.h>
 #include <itkUnaryFunctorImageFilter.h>
 #include "UnaryFunctorVectorImageFilter.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
@@ -69,7 +68,11 @@
 #include "MetaDataAccess.h"
 #include "itkCastImageFilter.h"
 #include "RLEImageRegionConstIterator.h"
+#include "RLEDecodeImageFilter.h"
+#include "RLELabelImageIO.h"
 #include "TDigestImageFilter.h"
+#include "TiledMaterializationImageFilter.h"
+#include "FileBackedImageContainer.h"
 #include "AllPurposeProgressAccumulator.h"
 
 #include <vnl/vnl_inverse.h>
@@ -651,25 +654,37 @@ public:
 
   template <class TSavedImage> static void Write(TSavedImage *image, const char *fname, Registry &hints)
   {
-    //use specialized RoI filter to convert to itk::Image
-    typedef itk::Image<TPixel, TSavedImage::ImageDimension> UncompressedType;
-    typedef itk::RegionOfInterestImageFilter<TSavedImage, UncompressedType> outConverterType;
-    typename outConverterType::Pointer outConv = outConverterType::New();
-    outConv->SetInput(image);
-    outConv->SetRegionOfInterest(image->GetLargestPossibleRegion());
-    outConv->Update();
-    typename UncompressedType::Pointer imgUncompressed = outConv->GetOutput();
-
     SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
     io->CreateImageIO(fname, hints, false);
     itk::ImageIOBase *base = io->GetIOBase();
 
+    // The run-length format is written from the lines without decoding
+    if (RLELabelImageIO *rleIO = dynamic_cast<RLELabelImageIO *>(base))
+    {
+        rleIO->SetFileName(fname);
+        rleIO->WriteRLEImage(image);
+        return;
+    }
+
+    // Otherwise decode the RLE image on demand, one streamed piece at a time
+    typedef itk::Image<TPixel, TSavedImage::ImageDimension> UncompressedType;
+    typedef RLEDecodeImageFilter<TSavedImage, UncompressedType> DecoderType;
+    typename DecoderType::Pointer decoder = DecoderType::New();
+    decoder->SetInput(image);
+
+    // Formats that support streamed writing (e.g., uncompressed NIfTI and MHA)
+    // are written in slabs of about 16M voxels. Other formats are written in a
+    // single piece, so the image is fully decoded only for them
+    const size_t slab_voxels = 1 << 24;
+    size_t n_voxels = image->GetLargestPossibleRegion().GetNumberOfPixels();
+
     typedef itk::ImageFileWriter<UncompressedType> WriterType;
     typename WriterType::Pointer writer = WriterType::New();
     writer->SetFileName(fname);
     if (base)
         writer->SetImageIO(base);
-    writer->SetInput(imgUncompressed);
+    writer->SetInput(decoder->GetOutput());
+    writer->SetNumberOfStreamDivisions(1 + n_voxels / slab_voxels);
     writer->Update();
   }
 
@@ -946,9 +961,13 @@ ImageWrapper<TTraits>
   // Create empty IO hints
   m_IOHints = new Registry();
 
-  // Create the slicing pipelines
+  // Create the slicing pipelines, which sample the slices at the resolution
+  // of the viewport when zoomed out, except for labels
   for(auto index : DisplaySliceIndices)
+    {
     m_Slicers[index] = SlicerType::New();
+    m_Slicers[index]->SetResolutionAdaptive(TTraits::ResolutionAdaptiveSlicing);
+    }
 
   // Initialize the display mapping
   m_DisplayMapping = DisplayMapping::New();
@@ -1434,7 +1453,16 @@ ImageWrapper<TTraits>
   // expensive to digest the whole image, so instead we can digest a subset of the pixels.
   // The values here restrict sampling to a value between 500000 and 1000000.
   auto n_values = m_Image4D->GetBufferedRegion().GetNumberOfPixels() * m_Image4D->GetNumberOfComponentsPerPixel();
-  double x_oversampling = n_values * 1.0e-6;
+
+  // Images backed by a file are only read every few slices, so that at most
+  // 256MB of the image are paged in to compute the statistics
+  size_t n_bytes = n_values * sizeof(ComponentType);
+  unsigned int slice_stride = 1;
+  if(FileBackedMemory::IsFileBackedSize(n_bytes))
+    slice_stride = (unsigned int) (1 + n_bytes / (256ul << 20));
+  m_TDigestFilter->SetSliceSamplingStride(slice_stride);
+
+  double x_oversampling = n_values * 1.0e-6 / slice_stride;
   int digest_sampling_rate_log2 = x_oversampling > 1.0 ? (int) std::log2(x_oversampling * 2.0) : 0;
   m_TDigestFilter->SetLog2SamplingRate(digest_sampling_rate_log2);
 
@@ -1504,6 +1532,23 @@ ImageWrapper<TTraits>
   return m_Slicers.front()->GetUseOrthogonalSlicing();
 }
 
+template<class TTraits>
+bool
+ImageWrapper<TTraits>
+::IsSliceResolutionAdaptive() const
+{
+  return m_Slicers.front()->GetResolutionAdaptive();
+}
+
+template<class TTraits>
+void
+ImageWrapper<TTraits>
+::SetSliceResolutionAdaptive(bool flag)
+{
+  for(auto index : DisplaySliceIndices)
+    m_Slicers[index]->SetResolutionAdaptive(flag && TTraits::ResolutionAdaptiveSlicing);
+}
+
 template<class TTraits>
 void
 ImageWrapper<TTraits>
@@ -1883,6 +1928,10 @@ ImageWrapper<TTraits>
 
   // Propagate the mapping to the tdigest
   m_TDigestFilter->SetIntensityTransform(nim.GetScale(), nim.GetShift());
+
+  // Cast pipelines built earlier captured the old mapping, so they must not
+  // be handed out to new consumers (existing consumers keep theirs)
+  m_SharedCastPipelines.clear();
 }
 
 template<class TTraits>
@@ -1971,6 +2020,13 @@ ImageWrapper<TTraits>::GetTDigest()
   return m_TDigestFilter->GetTDigest();
 }
 
+template<class TTraits>
+void
+ImageWrapper<TTraits>::SetCachedStatistics(TDigestDataObject *stats)
+{
+  m_TDigestFilter->SetCachedStatistics(stats);
+}
+
 template<class TTraits>
 const typename ImageWrapper<TTraits>::MinMaxObjectType *
 ImageWrapper<TTraits>::GetImageMinObject()
@@ -2377,21 +2433,10 @@ ImageWrapper<TTraits>
   return m_Slicers.front()->GetPreviewImage() != NULL;
 }
 
-struct RemoveTransparencyFunctor
-{
-  typedef ImageWrapperBase::DisplayPixelType PixelType;
-  PixelType operator()(const PixelType &p)
-  {
-    PixelType pnew = p;
-    pnew[3] = 255;
-    return pnew;
-  }
-};
-
 template<class TTraits>
-typename ImageWrapper<TTraits>::DisplaySlicePointer
+int
 ImageWrapper<TTraits>
-::MakeThumbnail(unsigned int maxdim)
+::ChooseThumbnailDisplayAxis()
 {
   // Determine which axis to use for thumbnail generation. Each axis is assigned
   // a penalty based on the following
@@ -2445,7 +2490,18 @@ ImageWrapper<TTraits>
       break;
       }
     }
+  return display_axis;
+}
+
+template<class TTraits>
+typename ImageWrapper<TTraits>::DisplaySlicePointer
+ImageWrapper<TTraits>
+::GetThumbnailDisplaySlice(unsigned int maxdim)
+{
+  int display_axis = this->ChooseThumbnailDisplayAxis();
+  auto direction = this->GetImageBase()->GetDirection().GetVnlMatrix();
   auto d_to_i = this->GetImageGeometry()->GetDisplayToImageTransform(display_axis);
+  int thumb_z_axis = d_to_i->GetCoordinateIndexZeroBased(2);
 
   // Now that we have done this, we need to create a reference image that matches the slice
   // direction. We already know the axis in image space of the slicing direction, but now
@@ -2474,7 +2530,8 @@ ImageWrapper<TTraits>
   ref_direction.set_column(2, direction.get_column(thumb_z_axis));
 
   // Compute the origin of the reference slice. Here we want the center of the thumbnail
-  // to match the center of the image.
+  // to match the center of the image, so the slice is the middle slice of the image
+  // regardless of the cursor position and of the zoom.
   auto origin_img = this->GetImageBase()->GetOrigin().GetVnlVector();
   Vector3d offset_ctr;
   for(unsigned int d = 0; d < 3; d++)
@@ -2503,138 +2560,12 @@ ImageWrapper<TTraits>
   ref_region.SetSize(0, maxdim); ref_region.SetSize(1, maxdim); ref_region.SetSize(2, 1);
   ref_slice->SetRegions(ref_region);
 
-  // Sample the display slice
-  DisplaySlicePointer thumb_image = this->SampleArbitraryDisplaySlice(ref_slice);
-
-  // Background color for thumbnails
-  unsigned char defrgb[] = {0,0,0,255};
-
-  // For thumbnails, the image needs to be flipped
-  typedef itk::FlipImageFilter<DisplaySliceType> FlipFilter;
-  SmartPtr<FlipFilter> flipper = FlipFilter::New();
-  flipper->SetInput(thumb_image);
-  typename FlipFilter::FlipAxesArrayType flipaxes;
-  flipaxes[0] = false; flipaxes[1] = true;
-  flipper->SetFlipAxes(flipaxes);
-
-  // We also need to replace the transparency
-  typedef itk::UnaryFunctorImageFilter<
-      DisplaySliceType, DisplaySliceType, RemoveTransparencyFunctor> OpaqueFilter;
-  SmartPtr<OpaqueFilter> opaquer = OpaqueFilter::New();
-  opaquer->SetInput(flipper->GetOutput());
-
-  // Return the result
-  opaquer->Update();
-  DisplaySlicePointer result = opaquer->GetOutput();
-  return result;
-}
-
-/*
-
-
-template<class TTraits>
-typename ImageWrapper<TTraits>::DisplaySlicePointer
-ImageWrapper<TTraits>
-::MakeThumbnail(unsigned int maxdim)
-{
-  // For images with extreme aspect ratios (greater than 1:2) we
-  // choose the direction in which the aspect ratio is closest to
-  // one. Otherwise, we choose the axial direction.
-  double aspect_ratio[3];
-  for(int i = 0; i < 3; i++)
-    {
-    // Get the slice
-    DisplaySliceType *slice = this->GetDisplaySlice(2);
-
-    // The size of the slice
-    Vector2ui slice_dim = slice->GetBufferedRegion().GetSize();
-
-    // The physical extents of the slice
-    Vector2d slice_extent(slice->GetSpacing()[0] * slice_dim[0],
-                          slice->GetSpacing()[1] * slice_dim[1]);
-
-    // The aspect ratio of the slice
-    if(slice_extent[0] < slice_extent[1])
-      aspect_ratio[i] = slice_extent[0] / slice_extent[1];
-    else
-      aspect_ratio[i] = slice_extent[1] / slice_extent[0];
-    }
-
-  // Choose which aspect ratio to use
-  int thumb_axis = -1;
-  if(aspect_ratio[2] >= 0.5 || (aspect_ratio[2] > aspect_ratio[0] && aspect_ratio[2] > aspect_ratio[1]))
-    thumb_axis = 2;
-  else if(aspect_ratio[1] > aspect_ratio[0] && aspect_ratio[1] > aspect_ratio[2])
-    thumb_axis = 1;
-  else
-    thumb_axis = 0;
-
-  // Get the display slice
-  // For now, just use the z-axis for exporting the thumbnails
-  DisplaySliceType *slice = this->GetDisplaySlice(thumb_axis);
-  slice->GetSource()->UpdateLargestPossibleRegion();
-
-  // The size of the slice
-  Vector2ui slice_dim = slice->GetBufferedRegion().GetSize();
-
-  // The physical extents of the slice
-  Vector2d slice_extent(slice->GetSpacing()[0] * slice_dim[0],
-                        slice->GetSpacing()[1] * slice_dim[1]);
-
-  // The output thumbnail will have the extents as the slice, but its size
-  // must be at max maxdim
-  double slice_extent_max = slice_extent.max_value();
-
-  // Create a simple square thumbnail
-  Vector2ui thumb_size(maxdim, maxdim);
-
-  // Spacing is such that the slice extent fits into the thumbnail
-  Vector2d thumb_spacing(slice_extent_max / maxdim,
-                         slice_extent_max / maxdim);
-
-  // The origin of the thumbnail is such that the centers coincide
-  Vector2d thumb_origin(0.5 * (slice_extent[0] - slice_extent_max),
-                        0.5 * (slice_extent[1] - slice_extent_max));
-
-  typedef typename itk::IdentityTransform<double, 2> TransformType;
-  TransformType::Pointer transform = TransformType::New();
-
-  typedef typename itk::ResampleImageFilter<
-      DisplaySliceType, DisplaySliceType> ResampleFilter;
-
-  // Background color for thumbnails
-  unsigned char defrgb[] = {0,0,0,255};
-
-  SmartPtr<ResampleFilter> filter = ResampleFilter::New();
-  filter->SetInput(slice);
-  filter->SetTransform(transform);
-  filter->SetSize(to_itkSize(thumb_size));
-  filter->SetOutputSpacing(thumb_spacing.data_block());
-  filter->SetOutputOrigin(thumb_origin.data_block());
-  filter->SetDefaultPixelValue(DisplayPixelType(defrgb));
-
-  // For thumbnails, the image needs to be flipped
-  typedef itk::FlipImageFilter<DisplaySliceType> FlipFilter;
-  SmartPtr<FlipFilter> flipper = FlipFilter::New();
-  flipper->SetInput(filter->GetOutput());
-  typename FlipFilter::FlipAxesArrayType flipaxes;
-  flipaxes[0] = false; flipaxes[1] = true;
-  flipper->SetFlipAxes(flipaxes);
-
-  // We also need to replace the transparency
-  typedef itk::UnaryFunctorImageFilter<
-      DisplaySliceType, DisplaySliceType, RemoveTransparencyFunctor> OpaqueFilter;
-  SmartPtr<OpaqueFilter> opaquer = OpaqueFilter::New();
-  opaquer->SetInput(flipper->GetOutput());
-
-  // Return the result
-  opaquer->Update();
-  DisplaySlicePointer result = opaquer->GetOutput();
-  return result;
+  // Sample the display slice with a slicer of its own. Only maxdim x maxdim
+  // pixels are sampled, so this is quick. The flipping and the removal of the
+  // transparency are left to ThumbnailService.
+  return this->SampleArbitraryDisplaySlice(ref_slice);
 }
 
-*/
-
 template<class TTraits>
 void
 ImageWrapper<TTraits>
@@ -3091,6 +3022,85 @@ class CreateCastToTargetTypePipelinePartialSpecializationTraits<
 };
 
 
+template<class TTraits>
+template<class TOutputImage, class TSpecialization>
+TOutputImage *
+ImageWrapper<TTraits>
+::CreateSharedCastPipeline(const char *key, int index)
+{
+  typedef TiledMaterializationImageFilter<TOutputImage> MaterializationFilter;
+
+  // Try to reuse the pipeline created for an earlier consumer. This only works
+  // if all of its filters are still alive and it is connected to the current
+  // internal image (which changes when new image data is assigned). Tiles of
+  // different time points of a 4D image are never shared.
+  std::string rep_key = std::string(typeid(TOutputImage).name())
+                        + "@" + std::to_string(m_TimePointIndex);
+  auto it = m_SharedCastPipelines.find(rep_key);
+  if(it != m_SharedCastPipelines.end())
+    {
+    MiniPipeline mp;
+    bool alive = it->second.output && it->second.source == m_Image;
+    for(auto &f : it->second.filters)
+      {
+      alive = alive && f;
+      mp.filters.push_back(f.GetPointer());
+      }
+
+    if(alive)
+      {
+      mp.output = it->second.output.GetPointer();
+      this->AddInternalPipeline(mp, key, index);
+      return static_cast<TOutputImage *>(mp.output.GetPointer());
+      }
+
+    m_SharedCastPipelines.erase(it);
+    }
+
+  // Create a new cast pipeline
+  auto p = TSpecialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
+  if(!p.second)
+    return nullptr;
+
+  // If there is no casting involved, the internal image is returned as is
+  if(p.first.filters.empty())
+    {
+    this->AddInternalPipeline(p.first, key, index);
+    return p.second;
+    }
+
+  // Place a tiled cache at the end of the cast pipeline, so that all the
+  // consumers share one set of tiles that are only cast where requested
+  SmartPtr<MaterializationFilter> cache = MaterializationFilter::New();
+  cache->SetInput(p.second);
+
+  // For an image backed by a file, only a bounded number of cast tiles is
+  // kept, or a full pass over the cast image would hold all of it in memory
+  size_t image_bytes = this->GetNumberOfVoxels() * this->GetNumberOfComponents() * sizeof(ComponentType);
+  if(FileBackedMemory::IsFileBackedSize(image_bytes))
+    {
+    auto size = this->m_Image->GetLargestPossibleRegion().GetSize();
+    size_t tile_bytes = cache->GetTileThickness() * sizeof(float) * size[0] * size[1]
+                        * std::max(1u, p.second->GetNumberOfComponentsPerPixel());
+    size_t budget = FileBackedMemory::GetSizeThreshold() / 8;
+    cache->SetMaximumNumberOfTiles(std::max<size_t>(2, budget / std::max<size_t>(1, tile_bytes)));
+    }
+
+  MiniPipeline mp = p.first;
+  mp.filters.push_back(cache.GetPointer());
+  mp.output = cache->GetOutput();
+  this->AddInternalPipeline(mp, key, index);
+
+  // Keep weak references to the shared pipeline
+  SharedCastPipeline &scp = m_SharedCastPipelines[rep_key];
+  for(auto &f : mp.filters)
+    scp.filters.push_back(f.GetPointer());
+  scp.output = mp.output.GetPointer();
+  scp.source = m_Image;
+
+  return cache->GetOutput();
+}
+
 template<class TTraits>
 typename ImageWrapper<TTraits>::FloatImageType *
 ImageWrapper<TTraits>
@@ -3102,12 +3112,7 @@ ImageWrapper<TTraits>
   typedef CreateCastToTargetTypePipelinePartialSpecializationTraits<
       ImageType, FloatImageType, NativeIntensityMapping, IsLinear::value, !IsVector::value> Specialization;
 
-  auto p = Specialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
-
-  if(p.second)
-    this->AddInternalPipeline(p.first, key, index);
-
-  return p.second;
+  return this->template CreateSharedCastPipeline<FloatImageType, Specialization>(key, index);
 }
 
 template<class TTraits>
@@ -3120,15 +3125,8 @@ ImageWrapper<TTraits>
   // Create a pipeline that maps us to the matching image
   typedef CreateCastToTargetTypePipelinePartialSpecializationTraits<
       ImageType, FloatVectorImageType, NativeIntensityMapping, IsLinear::value, IsVector::value> Specialization;
-  auto p = Specialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
 
-  // Now, if MatchingFloatImage is not a FloatVectorImageType, we have to create a filter that
-  // will disguise it as one
-
-  if(p.second)
-    this->AddInternalPipeline(p.first, key, index);
-
-  return p.second;
+  return this->template CreateSharedCastPipeline<FloatVectorImageType, Specialization>(key, index);
 }
 
 template <class TTraits>
@@ -215,6 +215,13 @@ public:
     */
   virtual bool IsSlicingOrthogonal() const override;
 
+  /**
+    Are the display slices sampled at the resolution of the viewport?
+    */
+  virtual bool IsSliceResolutionAdaptive() const override;
+
+  virtual void SetSliceResolutionAdaptive(bool flag) override;
+
   /**
    * Clear the data associated with storing an image
    */
@@ -473,6 +480,9 @@ public:
     */
   virtual TDigestDataObject *GetTDigest() override;
 
+  /** Supply previously computed statistics in place of the t-digest */
+  virtual void SetCachedStatistics(TDigestDataObject *stats) override;
+
   typedef itk::SimpleDataObjectDecorator<ComponentType> MinMaxObjectType;
 
   /** Legacy code returning image min as an object. TODO: refactor this out */
@@ -698,9 +708,9 @@ public:
   virtual void WriteToFile(const char *filename, Registry &hints) override;
 
   /**
-   * Create a thumbnail from the image and write it to a .png file
+   * Sample the display slice from which thumbnails can be made in the background
    */
-  DisplaySlicePointer MakeThumbnail(unsigned int maxdim) override;
+  DisplaySlicePointer GetThumbnailDisplaySlice(unsigned int maxdim) override;
 
   /**
    * Save metadata to a Registry file. The metadata are data that are not
@@ -759,10 +769,12 @@ public:
     be passed to ReleaseInternalPipeline() when it is no longer needed.
 
     The method is intended for use with external pipelines that don't know what
-    the internal data representation is for the image. There is a cost with
-    using this method in terms of memory, so the recommended use is in
-    conjunction with streaming filters, so that the cast mini-pipeline does not
-    allocate the whole floating point image all at once.
+    the internal data representation is for the image. The floating point
+    representation is shared by all the callers: the first caller creates it,
+    and later callers (with different keys) receive the same output image. The
+    shared image is reference-counted through the mini-pipelines, and is freed
+    once all keys have been released. Its buffer is filled in lazily, in tiles,
+    so only the regions requested by downstream filters are actually cast.
     */
   virtual FloatImageType *CreateCastToFloatPipeline(const char *key,
                                                     int index = 0) override;
@@ -811,6 +823,12 @@ protected:
   /** Destructor */
   virtual ~ImageWrapper();
 
+  /**
+   * Choose the display axis for thumbnails, avoiding slices that are 1D or
+   * have an extreme aspect ratio, and preferring the axial direction
+   */
+  int ChooseThumbnailDisplayAxis();
+
   /** A unique Id of this wrapper. Used for the LayerAssociation code */
   unsigned long m_UniqueId;
 
@@ -959,6 +977,28 @@ protected:
    */
   std::map< std::string, std::map<int, MiniPipeline> > m_ManagedPipelines;
 
+  /**
+   * Weak references to the filters in a shared cast-to-float pipeline. The
+   * strong references are held by the mini-pipelines in m_ManagedPipelines
+   * so the shared pipeline goes away when the last consumer releases it.
+   */
+  struct SharedCastPipeline
+  {
+    std::list< itk::WeakPointer<itk::ProcessObject> > filters;
+    itk::WeakPointer<itk::DataObject> output;
+    itk::WeakPointer<itk::DataObject> source;
+  };
+
+  /** Shared cast pipelines, keyed by the type of the output image and time point */
+  std::map<std::string, SharedCastPipeline> m_SharedCastPipelines;
+
+  /**
+   * Find or create the shared pipeline casting the internal image to the
+   * target type, and register it as a managed pipeline with given key/index
+   */
+  template <class TOutputImage, class TSpecialization>
+  TOutputImage *CreateSharedCastPipeline(const char *key, int index);
+
   /** Internally used method to create a mini-pipeline */
   virtual void AddInternalPipeline(const MiniPipeline &mp, const char *key, int index);
 
@@ -307,6 +307,17 @@ public:
    */
   irisVirtualIsMacro(SlicingOrthogonal)
 
+  /**
+   * Whether the orthogonal display slices are sampled at the resolution of the
+   * viewport when the view is zoomed out, rather than at the native resolution
+   * of the image. This is on by default, except for segmentation images, whose
+   * labels can not be averaged and are always sliced at full resolution. Turn
+   * it off temporarily when a display slice is needed at full resolution, e.g.,
+   * for export.
+   */
+  irisVirtualIsMacro(SliceResolutionAdaptive)
+  irisVirtualSetMacro(SliceResolutionAdaptive, bool)
+
   /**
    * Get the buffered region of the image
    */
@@ -394,6 +405,12 @@ public:
    */
   virtual bool ImageSpaceMatchesReferenceSpace() const = 0;
 
+  /**
+   * Supply previously computed intensity statistics of the image, so that
+   * they are not recomputed until the image changes
+   */
+  virtual void SetCachedStatistics(TDigestDataObject *stats) = 0;
+
   /** Return componentwise minimum cast to double, without mapping to native range */
   virtual double GetImageMinAsDouble() = 0;
 
@@ -472,9 +489,12 @@ public:
   virtual const AbstractNativeIntensityMapping *GetNativeIntensityMapping() const = 0;
 
   /**
-    Export one of the slices as a thumbnail (e.g., PNG file)
+    Get the display slice from which a thumbnail is made (see ThumbnailService).
+    This is the middle slice of the image along the axis that gives the most
+    useful thumbnail, sampled at maxdim x maxdim pixels that cover the whole
+    slice. It does not depend on the cursor position or on the zoom.
     */
-  virtual DisplaySlicePointer MakeThumbnail(unsigned int maxdim) = 0;
+  virtual DisplaySlicePointer GetThumbnailDisplaySlice(unsigned int maxdim) = 0;
 
   /**
    * Access the "IO hints" registry associated with this wrapper. The IO hints
@@ -107,6 +107,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, false);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out. Labels can not be averaged, so they are always sliced in full
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, false);
 };
 
 class SpeedImageWrapperTraits
@@ -135,6 +139,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, true);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 class LevelSetImageWrapperTraits
@@ -163,6 +171,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, true);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 template <class TPixel, bool TLinearMapping>
@@ -194,6 +206,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, false);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 template <class TFunctor>
@@ -225,6 +241,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, false);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 
@@ -260,6 +280,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, false);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 
@@ -293,6 +317,10 @@ public:
 
   // Whether this image is produced from another by a pipeline (e.g., speed image)
   itkStaticConstMacro(PipelineOutput, bool, false);
+
+  // Whether the display slices may be sampled below the resolution of the image
+  // when zoomed out
+  itkStaticConstMacro(ResolutionAdaptiveSlicing, bool, true);
 };
 
 /**
@@ -43,6 +43,36 @@
 #include "LabelImageWrapper.h"
 #include "UndoDataManager.h"
 #include "Rebroadcaster.h"
+#include <algorithm>
+
+// Compute the bounding box of two regions, either of which may be empty
+static itk::ImageRegion<3> MergeModifiedRegions(const itk::ImageRegion<3> &r1,
+                                                const itk::ImageRegion<3> &r2)
+{
+  if(r1.GetNumberOfPixels() == 0)
+    return r2;
+  if(r2.GetNumberOfPixels() == 0)
+    return r1;
+
+  itk::ImageRegion<3> r;
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    long i0 = std::min(r1.GetIndex(d), r2.GetIndex(d));
+    long i1 = std::max(r1.GetUpperIndex()[d], r2.GetUpperIndex()[d]);
+    r.SetIndex(d, i0);
+    r.SetSize(d, 1 + i1 - i0);
+    }
+  return r;
+}
+
+LabelImageModifiedRegions::RegionType
+LabelImageModifiedRegions::GetRegionForLabel(LabelType label) const
+{
+  auto it = ByLabel.find(label);
+  return it == ByLabel.end()
+      ? AnyLabel
+      : MergeModifiedRegions(it->second, AnyLabel);
+}
 
 LabelImageWrapper::LabelImageWrapper()
 {
@@ -70,6 +100,10 @@ void LabelImageWrapper::UpdateWrappedImages(
   for(auto &p : m_TimePointUndoManagers)
     p = new UndoManagerType(4, 200000);
 
+  // Discard the record of modified regions
+  m_TimePointModifiedRegions.clear();
+  m_TimePointModifiedRegions.resize(this->GetNumberOfTimePoints());
+
   // Modified event on the image is rebroadcast as the WrapperImageChangeEvent
   Rebroadcaster::Rebroadcast(image_4d, itk::ModifiedEvent(), this, WrapperImageChangeEvent());
 
@@ -108,6 +142,64 @@ void LabelImageWrapper::ClearUndoPointsForAllTimePoints()
     um->Clear();
 }
 
+void LabelImageWrapper::PixelsModified(const itk::ImageRegion<3> &region,
+                                       const std::set<LabelType> &labels)
+{
+  // Record the modified time of the time point before and after the edit
+  ImageType *tp_image = m_ImageTimePoints[m_TimePointIndex];
+  ModifiedRegionRecord rec;
+  rec.PrevMTime = tp_image->GetMTime();
+  this->PixelsModified();
+  rec.MTime = tp_image->GetMTime();
+  rec.Region = region;
+  rec.Labels = labels;
+
+  auto &records = m_TimePointModifiedRegions[m_TimePointIndex];
+  records.push_back(rec);
+  while(records.size() > MAX_MODIFIED_REGION_RECORDS)
+    records.pop_front();
+}
+
+bool LabelImageWrapper::GetModifiedRegionsSince(
+    unsigned int tp, itk::ModifiedTimeType mtime, LabelImageModifiedRegions &result) const
+{
+  result.ByLabel.clear();
+  result.AnyLabel = LabelImageModifiedRegions::RegionType();
+
+  if(tp >= m_TimePointModifiedRegions.size())
+    return false;
+
+  // Nothing has happened since
+  itk::ModifiedTimeType current = m_ImageTimePoints[tp]->GetMTime();
+  if(current == mtime)
+    return true;
+
+  // Find the first edit made after mtime
+  const auto &records = m_TimePointModifiedRegions[tp];
+  auto it = std::find_if(records.begin(), records.end(),
+                         [mtime](const ModifiedRegionRecord &r) { return r.PrevMTime == mtime; });
+
+  // Follow the chain of edits. If there is a gap in the chain, there was an
+  // unrecorded modification and we have to give up
+  for(itk::ModifiedTimeType t = mtime; it != records.end(); ++it)
+    {
+    if(it->PrevMTime != t)
+      return false;
+
+    if(it->Labels.empty())
+      result.AnyLabel = MergeModifiedRegions(result.AnyLabel, it->Region);
+    else
+      for(LabelType l : it->Labels)
+        result.ByLabel[l] = MergeModifiedRegions(result.ByLabel[l], it->Region);
+
+    t = it->MTime;
+    if(t == current)
+      return true;
+    }
+
+  return false;
+}
+
 bool LabelImageWrapper::IsUndoPossible()
 {
   UndoManagerType *um = m_TimePointUndoManagers[m_TimePointIndex];
@@ -125,11 +217,13 @@ void LabelImageWrapper::Undo()
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
 
   // Iterate over all the deltas in reverse order
+  itk::ImageRegion<3> modified_region;
   UndoManagerType::DList::const_reverse_iterator dit = commit.GetDeltas().rbegin();
   for(; dit != commit.GetDeltas().rend(); ++dit)
     {
     // Apply the changes in the current delta
     UndoManagerType::Delta *delta = *dit;
+    modified_region = MergeModifiedRegions(modified_region, delta->GetRegion());
 
     // Iterator for the relevant region in the label image
     IteratorType lit(m_Image, delta->GetRegion());
@@ -148,8 +242,8 @@ void LabelImageWrapper::Undo()
       }
     }
 
-  // Set modified flags
-  this->PixelsModified();
+  // Set modified flags (the labels affected by the undo/redo are not known)
+  this->PixelsModified(modified_region, std::set<LabelType>());
 }
 
 bool LabelImageWrapper::IsRedoPossible()
@@ -169,11 +263,13 @@ void LabelImageWrapper::Redo()
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
 
   // Iterate over all the deltas in reverse order
+  itk::ImageRegion<3> modified_region;
   UndoManagerType::DList::const_iterator dit = commit.GetDeltas().begin();
   for(; dit != commit.GetDeltas().end(); ++dit)
     {
     // Apply the changes in the current delta
     UndoManagerType::Delta *delta = *dit;
+    modified_region = MergeModifiedRegions(modified_region, delta->GetRegion());
 
     // Iterator for the relevant region in the label image
     IteratorType lit(m_Image, delta->GetRegion());
@@ -192,8 +288,8 @@ void LabelImageWrapper::Redo()
       }
     }
 
-  // Set modified flags
-  this->PixelsModified();
+  // Set modified flags (the labels affected by the undo/redo are not known)
+  this->PixelsModified(modified_region, std::set<LabelType>());
 }
 
 const
@@ -4,11 +4,34 @@
 #include "ImageWrapperTraits.h"
 #include "ScalarImageWrapper.h"
 
+#include <deque>
+#include <set>
+
 template <typename TPixel> class UndoDataManager;
 template <typename TPixel> class UndoDataManagerCommit;
 template <typename TPixel> class UndoDelta;
 class SegmentationUpdateIterator;
 
+/**
+ * Regions of a segmentation time point modified by edits over some period of
+ * time. Consumers of the segmentation (e.g., the mesh pipeline) use this to
+ * limit their updates to the modified parts of the image.
+ */
+struct LabelImageModifiedRegions
+{
+  typedef itk::ImageRegion<3> RegionType;
+
+  // Bounding regions of the edits, listed for each label that was affected
+  std::map<LabelType, RegionType> ByLabel;
+
+  // Bounding region of edits for which the affected labels are not known
+  // (e.g., undo and redo); these regions apply to every label
+  RegionType AnyLabel;
+
+  // Get the region modified for a label (empty region if none)
+  RegionType GetRegionForLabel(LabelType label) const;
+};
+
 class LabelImageWrapper : public ScalarImageWrapper<LabelImageWrapperTraits>
 {
 public:
@@ -85,6 +108,24 @@ public:
    * array created in this call. */
   UndoManagerDelta *CompressImage() const;
 
+  /**
+   * Record that the pixels of the current time point in the given region have
+   * been modified, with a known set of labels affected (pass an empty set if
+   * the labels are unknown). This should be called in place of PixelsModified()
+   * by code that modifies the segmentation locally.
+   */
+  void PixelsModified(const itk::ImageRegion<3> &region, const std::set<LabelType> &labels);
+  using Superclass::PixelsModified;
+
+  /**
+   * Get the regions modified since the time point image had modified time
+   * 'mtime'. Returns false if some modifications since that time were not
+   * recorded (or the record has been trimmed), in which case the caller should
+   * assume that the whole image may have changed.
+   */
+  bool GetModifiedRegionsSince(unsigned int tp, itk::ModifiedTimeType mtime,
+                               LabelImageModifiedRegions &result) const;
+
   /**
    * Return type for GenerateImageForRedo
    */
@@ -111,6 +152,22 @@ protected:
   // undo steps with little cost in performance or memory. We currently associate each time
   // point with its own undo manager
   std::vector<UndoManagerType *> m_TimePointUndoManagers;
+
+  // A record of a local modification to the segmentation. The modified times
+  // of the time point image before and after the edit are stored, so that we
+  // can detect edits that were made without being recorded
+  struct ModifiedRegionRecord
+  {
+    itk::ModifiedTimeType PrevMTime, MTime;
+    itk::ImageRegion<3> Region;
+    std::set<LabelType> Labels;
+  };
+
+  // Recent modification records for each time point (bounded in length)
+  std::vector< std::deque<ModifiedRegionRecord> > m_TimePointModifiedRegions;
+
+  // Maximum number of records kept for each time point
+  static constexpr unsigned int MAX_MODIFIED_REGION_RECORDS = 256;
 };
 
 #endif // LABELIMAGEWRAPPER_H
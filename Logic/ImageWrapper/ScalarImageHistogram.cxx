@@ -21,6 +21,22 @@ void ScalarImageHistogram
 ::ComputeFromTDigest(TDigestDataObject *digest, unsigned int nBins)
 {
   digest->Update();
+
+  // Exact statistics: bin the count of every value
+  if(digest->IsExact())
+    {
+    long vmin = (long) digest->GetImageMinimum(), vmax = (long) digest->GetImageMaximum();
+    this->Initialize(vmin, std::max(vmax, vmin + 1), nBins);
+    for(long v = vmin; v <= vmax; v++)
+      {
+      unsigned long freq = digest->GetExactFrequency(v);
+      int index = std::min((int) (m_Scale * (v - m_FirstBinStart)), m_BinCount - 1);
+      m_Bins[index] += freq;
+      m_TotalSamples += freq;
+      }
+    m_MaxFrequency = *std::max_element(m_Bins.begin(), m_Bins.end());
+    return;
+    }
   this->Initialize(digest->GetImageMinimum(), digest->GetImageMaximum(), nBins);
   double cdf_left, cdf_right;
   for(int i = 0; i < m_BinCount; i++)
@@ -0,0 +1,145 @@
+#include "TDigestImageFilter.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// Header of the serialized statistics
+static const char TDIGEST_STATS_MAGIC[8] = { 'S', 'N', 'A', 'P', 'S', 'T', 'A', 'T' };
+static const std::uint32_t TDIGEST_STATS_VERSION = 2;
+
+// What the serialized statistics hold
+enum TDigestStatsKind { STATS_EMPTY = 0, STATS_EXACT, STATS_DIGEST };
+
+template <class T> static void write_value(std::ostream &os, const T &value)
+{
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T> static bool read_value(std::istream &is, T &value)
+{
+  return (bool) is.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+void
+TDigestDataObject
+::CopyStatistics(const TDigestDataObject *source)
+{
+  m_Digest.reset();
+  m_NaNCount = source->m_NaNCount;
+  m_ExactCumulative = source->m_ExactCumulative;
+  m_ExactOrigin = source->m_ExactOrigin;
+
+  if(!source->IsExact() && source->GetTotalWeight() > 0)
+    {
+    m_Digest.insert(source->m_Digest);
+    m_Digest.merge();
+    }
+}
+
+void
+TDigestDataObject
+::Write(std::ostream &os) const
+{
+  os.write(TDIGEST_STATS_MAGIC, 8);
+  write_value(os, TDIGEST_STATS_VERSION);
+  write_value(os, (std::uint64_t) m_NaNCount);
+
+  if(IsExact())
+    {
+    write_value(os, (std::uint32_t) STATS_EXACT);
+    write_value(os, (std::int64_t) m_ExactOrigin);
+    write_value(os, (std::uint64_t) m_ExactCumulative.size());
+    for(unsigned long c : m_ExactCumulative)
+      write_value(os, (std::uint64_t) c);
+    }
+  else if(GetTotalWeight() > 0)
+    {
+    // The digest is written as its centroids, along with the range of values
+    auto centroids = m_Digest.get();
+    write_value(os, (std::uint32_t) STATS_DIGEST);
+    write_value(os, (float) m_Digest.min());
+    write_value(os, (float) m_Digest.max());
+    write_value(os, (std::uint64_t) centroids.size());
+    for(const auto &c : centroids)
+      {
+      write_value(os, (float) c.first);
+      write_value(os, (std::uint64_t) c.second);
+      }
+    }
+  else
+    {
+    write_value(os, (std::uint32_t) STATS_EMPTY);
+    }
+}
+
+bool
+TDigestDataObject
+::Read(std::istream &is)
+{
+  char magic[8];
+  std::uint32_t version, kind;
+  std::uint64_t nan_count, n;
+  if(!is.read(magic, 8) || memcmp(magic, TDIGEST_STATS_MAGIC, 8)
+     || !read_value(is, version) || version != TDIGEST_STATS_VERSION
+     || !read_value(is, nan_count) || !read_value(is, kind))
+    return false;
+
+  m_Digest.reset();
+  m_ExactCumulative.clear();
+  m_NaNCount = nan_count;
+
+  if(kind == STATS_EXACT)
+    {
+    // Exact statistics are only kept for types of up to 16 bits
+    std::int64_t origin;
+    if(!read_value(is, origin) || !read_value(is, n) || n == 0 || n > 0x10000)
+      return false;
+    m_ExactOrigin = (long) origin;
+    m_ExactCumulative.resize(n);
+    for(size_t i = 0; i < n; i++)
+      {
+      std::uint64_t c;
+      if(!read_value(is, c) || (i > 0 && c < m_ExactCumulative[i-1]))
+        {
+        m_ExactCumulative.clear();
+        return false;
+        }
+      m_ExactCumulative[i] = (unsigned long) c;
+      }
+    return true;
+    }
+  else if(kind == STATS_DIGEST)
+    {
+    // The number of centroids is bounded by the compression of the digest
+    float vmin, vmax;
+    if(!read_value(is, vmin) || !read_value(is, vmax) || !(vmin <= vmax)
+       || !read_value(is, n) || n == 0 || n > 0x10000)
+      return false;
+
+    // Rebuild the digest from the centroids
+    for(size_t i = 0; i < n; i++)
+      {
+      float mean;
+      std::uint64_t weight;
+      if(!read_value(is, mean) || !read_value(is, weight)
+         || !(mean >= vmin && mean <= vmax) || weight == 0)
+        {
+        m_Digest.reset();
+        return false;
+        }
+      m_Digest.insert(mean, (unsigned) weight);
+      }
+
+    // The extreme values are normally centroids of their own. If not, they are
+    // added the same way as when the filter skips them while sampling.
+    if(vmax > m_Digest.max())
+      m_Digest.insert(vmax);
+    if(vmin < m_Digest.min())
+      m_Digest.insert(vmin);
+    m_Digest.merge();
+    return true;
+    }
+
+  return kind == STATS_EMPTY;
+}
@@ -9,21 +9,83 @@
 #include <itkVectorImage.h>
 #include <itkImageToImageFilter.h>
 #include <itkImageSink.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iosfwd>
 
 /**
  * A wrapper around the t-digest data structure that can be used in ITK
- * pipelines and can provide basic statistics about an image
+ * pipelines and can provide basic statistics about an image.
+ *
+ * For images with integer components of up to 16 bits, the statistics are
+ * instead served from a histogram that counts every pixel value, so that
+ * the minimum, maximum, quantiles and CDF are exact.
+ *
+ * The statistics can be written to a stream and read back, e.g., to cache
+ * them between sessions. The digest is stored as its list of centroids, from
+ * which it is rebuilt after reading.
  */
 class TDigestDataObject : public itk::DataObject
 {
 public:
   irisITKObjectMacro(TDigestDataObject, itk::DataObject)
 
-  float GetImageMaximum() const { return m_Digest.max(); }
-  float GetImageMinimum() const { return m_Digest.min(); }
-  float GetImageQuantile(double q) const { return m_Digest.quantile(100.0 * q); }
-  float GetCDF(float value) const { return m_Digest.cumulative_distribution(value); }
-  unsigned GetTotalWeight() const { return m_Digest.size(); }
+  float GetImageMaximum() const
+    { return IsExact() ? m_ExactOrigin + (long) m_ExactCumulative.size() - 1 : m_Digest.max(); }
+
+  float GetImageMinimum() const
+    { return IsExact() ? m_ExactOrigin : m_Digest.min(); }
+
+  float GetImageQuantile(double q) const
+    {
+    if(!IsExact())
+      return m_Digest.quantile(100.0 * q);
+
+    // Smallest value whose cumulative count reaches the rank q * N
+    double rank = std::max(1.0, std::ceil(q * m_ExactCumulative.back()));
+    auto it = std::lower_bound(m_ExactCumulative.begin(), m_ExactCumulative.end(), rank);
+    long k = it - m_ExactCumulative.begin();
+    return m_ExactOrigin + std::min(k, (long) m_ExactCumulative.size() - 1);
+    }
+
+  float GetCDF(float value) const
+    {
+    if(!IsExact())
+      return m_Digest.cumulative_distribution(value);
+
+    // Fraction of pixels less than or equal to value
+    double k = std::floor(value) - m_ExactOrigin;
+    if(k < 0)
+      return 0.0f;
+    if(k >= m_ExactCumulative.size())
+      return 1.0f;
+    return m_ExactCumulative[(size_t) k] * 1.0 / m_ExactCumulative.back();
+    }
+
+  unsigned GetTotalWeight() const
+    { return IsExact() ? m_ExactCumulative.back() : m_Digest.size(); }
+
+  /** Whether the statistics are exact, i.e., counted from every pixel */
+  bool IsExact() const { return !m_ExactCumulative.empty(); }
+
+  /** Number of pixels with the given value, only for exact statistics */
+  unsigned long GetExactFrequency(long value) const
+    {
+    long k = value - m_ExactOrigin;
+    if(k < 0 || k >= (long) m_ExactCumulative.size())
+      return 0;
+    return m_ExactCumulative[k] - (k > 0 ? m_ExactCumulative[k-1] : 0);
+    }
+
+  /** Write the statistics to a binary stream */
+  void Write(std::ostream &os) const;
+
+  /** Read statistics written by Write(). Returns false if the data are invalid */
+  bool Read(std::istream &is);
+
+  /** Copy the statistics from another object */
+  void CopyStatistics(const TDigestDataObject *source);
 
   template <class TInputImage> friend class TDigestImageFilter;
 
@@ -40,6 +102,11 @@ protected:
   // The number of NaN pixels
   unsigned long m_NaNCount = 0;
 
+  // For exact statistics, the cumulative counts of the values between the
+  // image minimum (m_ExactOrigin) and maximum. Empty if the digest is used.
+  std::vector<unsigned long> m_ExactCumulative;
+  long m_ExactOrigin = 0;
+
   // Intensity transform
   double m_TransformScale, m_TransformShift;
 };
@@ -88,6 +155,15 @@ public:
   using IsVector = std::is_base_of<itk::VectorImage<InternalPixelType, InputImageDimension>, TInputImage>;
   using ComponentType = typename std::conditional<IsVector::value, InternalPixelType, PixelType>::type;
 
+  /**
+   * Whether all component values are counted instead of digested. This is
+   * the case for integer components of up to 16 bits, for which a histogram
+   * over the full range of the type is small, and counting is both exact
+   * and faster than t-digest insertion.
+   */
+  static constexpr bool UseExactHistogram =
+      std::is_integral<ComponentType>::value && sizeof(ComponentType) <= 2;
+
   /**
    *  For compatibility with older code, the filter also outputs image
    *  minimum and maximum as itk::DataObjects
@@ -117,9 +193,19 @@ public:
    * number generator to skip pixels. Min, max and the number of NaN values are still
    * computed from the entire image. Sampling is recommended for very large images
    * for performance reasons, since TDigest insertion is around 60ns per pixel.
+   * Images that use an exact histogram (see UseExactHistogram) are not sampled.
    */
   void SetLog2SamplingRate(int log_2_sampling_rate);
 
+  /**
+   * Only read every n-th slice (along the third image dimension). This is
+   * used for images backed by a file, so that computing the statistics does
+   * not page the whole image into memory. The default is 1 (all slices).
+   * Unlike SetLog2SamplingRate, this also applies to exact histograms, which
+   * are then exact for the slices read.
+   */
+  void SetSliceSamplingStride(unsigned int stride);
+
   /**
    * Get the t-digest output, wrapped as an itk::DataObject. Before using this object
    * call Update() on it.
@@ -132,17 +218,28 @@ public:
   /** Get the image min as an itk::DataObject for use in pipelines */
   const MinMaxObjectType *GetImageMax() const { return m_ImageMaxDataObject; }
 
+  /**
+   * Provide statistics computed earlier for the same image, e.g., read from
+   * a cache. They are used instead of a pass over the image until the input
+   * image is modified.
+   */
+  void SetCachedStatistics(const TDigestDataObject *stats);
+
 protected:
 
   TDigestImageFilter();
   virtual ~TDigestImageFilter() {}
   void PrintSelf(std::ostream & os, itk::Indent indent) const ITK_OVERRIDE;
 
+  virtual void GenerateData() override;
   virtual void BeforeStreamedGenerateData() override;
   virtual void AfterStreamedGenerateData() override;
   virtual void ThreadedStreamedGenerateData(const RegionType &) override;
   virtual void StreamedGenerateData(unsigned int inputRequestedRegionNumber) override;
 
+  /** Digest a region, called by ThreadedStreamedGenerateData */
+  void DigestRegion(const RegionType &region);
+
 private:
 
   TDigestImageFilter(const Self &); //purposely not implemented
@@ -157,12 +254,23 @@ private:
   // Intensity transform
   double m_TransformScale, m_TransformShift;
 
-  // Sampling rate
+  // Sampling rate and slice stride
   int m_Log2SamplingRate;
+  unsigned int m_SliceSamplingStride;
 
   // Mutex for combining digests
   std::mutex m_Mutex;
 
+  // Counts of all values of the component type, for exact statistics
+  std::vector<unsigned long> m_ExactCounts;
+
+  // Statistics provided by SetCachedStatistics, and the input MTime then
+  typename TDigestDataObject::Pointer m_CachedStatistics;
+  itk::ModifiedTimeType m_CachedStatisticsInputTime = 0;
+
+  // Set the min/max outputs from the digest output
+  void UpdateMinMaxOutputs();
+
 };
 
 #ifndef ITK_MANUAL_INSTANTIATION
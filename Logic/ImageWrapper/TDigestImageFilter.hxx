@@ -8,6 +8,8 @@
 #include <itkVectorImage.h>
 #include <random>
 #include <chrono>
+#include <numeric>
+#include <limits>
 
 // Type-specific functions are placed in their own namespace
 namespace TDigestImageFilter_impl {
@@ -167,6 +169,7 @@ TDigestImageFilter<TInputImage>
   m_TransformScale = 1.0;
   m_TransformShift = 0.0;
   m_Log2SamplingRate = 0;
+  m_SliceSamplingStride = 1;
 }
 
 template <class TInputImage>
@@ -226,6 +229,38 @@ TDigestImageFilter<TInputImage>
 }
 
 
+template <class TInputImage>
+void
+TDigestImageFilter<TInputImage>
+::SetCachedStatistics(const TDigestDataObject *stats)
+{
+  m_CachedStatistics = TDigestDataObject::New();
+  m_CachedStatistics->CopyStatistics(stats);
+  m_CachedStatisticsInputTime = this->GetInput() ? this->GetInput()->GetMTime() : 0;
+  this->Modified();
+}
+
+template< class TInputImage >
+void
+TDigestImageFilter<TInputImage>
+::GenerateData()
+{
+  // Use the cached statistics if the image has not changed since they were set
+  if(m_CachedStatistics)
+    {
+    if(this->GetInput()->GetMTime() <= m_CachedStatisticsInputTime)
+      {
+      m_TDigestDataObject->CopyStatistics(m_CachedStatistics);
+      m_TDigestDataObject->Modified();
+      this->UpdateMinMaxOutputs();
+      return;
+      }
+    m_CachedStatistics = nullptr;
+    }
+
+  Superclass::GenerateData();
+}
+
 template< class TInputImage >
 void
 TDigestImageFilter<TInputImage>
@@ -233,12 +268,51 @@ TDigestImageFilter<TInputImage>
 {
   m_TDigestDataObject->m_Digest.reset();
   m_TDigestDataObject->m_NaNCount = 0;
+  m_TDigestDataObject->m_ExactCumulative.clear();
+
+  if constexpr (UseExactHistogram)
+    m_ExactCounts.assign(1ul << (8 * sizeof(ComponentType)), 0);
+}
+
+template <class TInputImage>
+void
+TDigestImageFilter<TInputImage>
+::SetSliceSamplingStride(unsigned int stride)
+{
+  this->m_SliceSamplingStride = std::max(1u, stride);
+  this->Modified();
 }
 
 template< class TInputImage >
 void
 TDigestImageFilter<TInputImage>
 ::ThreadedStreamedGenerateData(const RegionType &region)
+{
+  if(m_SliceSamplingStride <= 1 || InputImageDimension < 3)
+    {
+    this->DigestRegion(region);
+    return;
+    }
+
+  // Digest the selected slices one at a time
+  long z_first = this->GetInput()->GetLargestPossibleRegion().GetIndex(2);
+  long z0 = region.GetIndex(2), z1 = z0 + (long) region.GetSize(2);
+  for(long z = z0; z < z1; z++)
+    {
+    if((z - z_first) % m_SliceSamplingStride == 0)
+      {
+      RegionType slice = region;
+      slice.SetIndex(2, z);
+      slice.SetSize(2, 1);
+      this->DigestRegion(slice);
+      }
+    }
+}
+
+template< class TInputImage >
+void
+TDigestImageFilter<TInputImage>
+::DigestRegion(const RegionType &region)
 {
   // Get the input image
   const TInputImage *img = this->GetInput();
@@ -268,6 +342,25 @@ TDigestImageFilter<TInputImage>
   // Allocate the buffer
   ComponentType *buffer = new ComponentType[buffer_size];
 
+  // For small integer types, count every value
+  if constexpr (UseExactHistogram)
+    {
+    std::vector<unsigned long> thread_counts(m_ExactCounts.size(), 0);
+    const long origin = std::numeric_limits<ComponentType>::min();
+    while(!it.IsAtEnd())
+      {
+      HelperType::to_buffer(it, buffer, buffer_size, buffer_read);
+      for(int i = 0; i < buffer_read; i++)
+        thread_counts[buffer[i] - origin]++;
+      }
+    delete[] buffer;
+
+    std::lock_guard<std::mutex> guard(m_Mutex);
+    for(size_t k = 0; k < thread_counts.size(); k++)
+      m_ExactCounts[k] += thread_counts[k];
+    return;
+    }
+
   // Split depending on whether we are randomly sampling or not
   if(sampling_rate == 1)
     {
@@ -342,12 +435,44 @@ void
 TDigestImageFilter<TInputImage>
 ::AfterStreamedGenerateData()
 {
+  // Keep the cumulative counts between the smallest and largest values
+  if constexpr (UseExactHistogram)
+    {
+    auto first = std::find_if(m_ExactCounts.begin(), m_ExactCounts.end(),
+                              [](unsigned long c) { return c > 0; });
+    if(first != m_ExactCounts.end())
+      {
+      auto last = std::find_if(m_ExactCounts.rbegin(), m_ExactCounts.rend(),
+                               [](unsigned long c) { return c > 0; }).base();
+      auto &cum = m_TDigestDataObject->m_ExactCumulative;
+      cum.resize(last - first);
+      std::partial_sum(first, last, cum.begin());
+      m_TDigestDataObject->m_ExactOrigin =
+          (long) std::numeric_limits<ComponentType>::min() + (first - m_ExactCounts.begin());
+      }
+    m_ExactCounts.clear();
+    m_ExactCounts.shrink_to_fit();
+    }
+
   // Mark the output as modified (do we need to?)
   m_TDigestDataObject->Modified();
 
+  this->UpdateMinMaxOutputs();
+}
+
+template< class TInputImage >
+void
+TDigestImageFilter<TInputImage>
+::UpdateMinMaxOutputs()
+{
   // Get the image min and max. Here we have to cast to the original data
   // type and there is a small possibility of rounding errors.
-  if constexpr (std::is_floating_point<ComponentType>::value)
+  if constexpr (UseExactHistogram)
+    {
+    m_ImageMinDataObject->Set((ComponentType) m_TDigestDataObject->GetImageMinimum());
+    m_ImageMaxDataObject->Set((ComponentType) m_TDigestDataObject->GetImageMaximum());
+    }
+  else if constexpr (std::is_floating_point<ComponentType>::value)
     {
     m_ImageMinDataObject->Set(m_TDigestDataObject->GetImageMinimum());
     m_ImageMaxDataObject->Set(m_TDigestDataObject->GetImageMaximum());
@@ -0,0 +1,133 @@
+#ifndef TILEDMATERIALIZATIONIMAGEFILTER_H
+#define TILEDMATERIALIZATIONIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <vector>
+
+/**
+ * This ITK-style filter keeps a persistent copy of its input in a store of
+ * tiles and fills it in on demand. Tiles are slabs of a fixed thickness along
+ * the last image dimension, each held in its own buffer. When a downstream
+ * filter requests a region, only the tiles that overlap the region and are
+ * not yet in the store are pulled from the upstream pipeline (using its
+ * requested region mechanism). The output buffer covers just the requested
+ * region and is filled from the tiles, so several consumers can share the
+ * tiles without each of them paying for a complete pass over the input, and
+ * the full image is never held in a single buffer.
+ *
+ * The number of tiles kept in the store may be limited, in which case the
+ * least recently used tiles are discarded to make room for new ones.
+ *
+ * The tiles are versioned by the pipeline modified time of the input. When the
+ * input changes (e.g., the image is edited, a different time point is selected
+ * or the intensity mapping changes), all tiles are discarded.
+ *
+ * The filter is used by ImageWrapper to share the cast-to-float representation
+ * of a layer between the different pipelines that need it.
+ */
+template <class TImage>
+class TiledMaterializationImageFilter
+    : public itk::ImageToImageFilter<TImage, TImage>
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef TiledMaterializationImageFilter                     Self;
+  typedef itk::ImageToImageFilter<TImage, TImage>             Superclass;
+  typedef itk::SmartPointer< Self >                           Pointer;
+  typedef itk::SmartPointer< const Self >                     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TiledMaterializationImageFilter, ImageToImageFilter)
+
+  /** Image typedef support. */
+  typedef TImage ImageType;
+  typedef typename ImageType::RegionType RegionType;
+  typedef typename ImageType::IndexType IndexType;
+  typedef typename ImageType::SizeType SizeType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
+
+  /** Thickness of each tile (in voxels) along the last image dimension */
+  itkSetMacro(TileThickness, unsigned int)
+  itkGetConstMacro(TileThickness, unsigned int)
+
+  /**
+   * Maximum number of tiles kept in the store, or zero for no limit (default).
+   * The tiles overlapping the current request are always kept.
+   */
+  itkSetMacro(MaximumNumberOfTiles, unsigned int)
+  itkGetConstMacro(MaximumNumberOfTiles, unsigned int)
+
+  /** Number of tiles that currently hold valid data */
+  unsigned int GetNumberOfMaterializedTiles() const;
+
+  /** Total number of tiles in the image */
+  unsigned int GetNumberOfTiles() const { return m_Tiles.size(); }
+
+  /** Discard all materialized tiles */
+  void InvalidateTiles();
+
+  /**
+   * Overridden because this filter has its own logic for pulling the input,
+   * one tile at a time. The requested region is not propagated upstream.
+   */
+  virtual void PropagateRequestedRegion(itk::DataObject *output) override;
+
+  /**
+   * Overridden to fill only the missing tiles overlapping the requested region.
+   * Modeled after itk::StreamingImageFilter::UpdateOutputData.
+   */
+  virtual void UpdateOutputData(itk::DataObject *output) override;
+
+protected:
+
+  TiledMaterializationImageFilter();
+  virtual ~TiledMaterializationImageFilter() {}
+
+  /** Check if a region contains tiles that have not been computed */
+  bool HasMissingTiles(const RegionType &region) const;
+
+  /** Range of tiles overlapping a region */
+  void GetTileRange(const RegionType &region, unsigned int &first, unsigned int &last) const;
+
+  /** Region corresponding to a tile */
+  RegionType GetTileRegion(unsigned int tile) const;
+
+  /** Discard least recently used tiles outside of [first, last) */
+  void EvictTiles(unsigned int first, unsigned int last);
+
+private:
+
+  TiledMaterializationImageFilter(const Self &); //purposely not implemented
+  void operator=(const Self &);                  //purposely not implemented
+
+  // Tile thickness and limit on the number of stored tiles
+  unsigned int m_TileThickness;
+  unsigned int m_MaximumNumberOfTiles;
+
+  // The tile store. Tiles that have not been computed are null
+  std::vector< itk::SmartPointer<ImageType> > m_Tiles;
+
+  // When each tile was last used, for the LRU eviction
+  std::vector<unsigned long> m_TileLastUse;
+  unsigned long m_UseCounter;
+
+  // The region that the tiles were set up for
+  RegionType m_TiledRegion;
+
+  // Pipeline time of the input when the tiles were computed
+  itk::ModifiedTimeType m_MaterializedPipelineMTime;
+
+  // Re-entrance guard
+  bool m_Updating;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "TiledMaterializationImageFilter.hxx"
+#endif
+
+#endif // TILEDMATERIALIZATIONIMAGEFILTER_H
@@ -0,0 +1,214 @@
+#ifndef TILEDMATERIALIZATIONIMAGEFILTER_HXX
+#define TILEDMATERIALIZATIONIMAGEFILTER_HXX
+
+#include "TiledMaterializationImageFilter.h"
+#include <itkImageAlgorithm.h>
+#include <algorithm>
+
+template <class TImage>
+TiledMaterializationImageFilter<TImage>
+::TiledMaterializationImageFilter()
+{
+  m_TileThickness = 8;
+  m_MaximumNumberOfTiles = 0;
+  m_UseCounter = 0;
+  m_MaterializedPipelineMTime = 0;
+  m_Updating = false;
+}
+
+template <class TImage>
+unsigned int
+TiledMaterializationImageFilter<TImage>
+::GetNumberOfMaterializedTiles() const
+{
+  return std::count_if(m_Tiles.begin(), m_Tiles.end(),
+                       [](const itk::SmartPointer<ImageType> &t) { return t.IsNotNull(); });
+}
+
+template <class TImage>
+void
+TiledMaterializationImageFilter<TImage>
+::InvalidateTiles()
+{
+  for(auto &tile : m_Tiles)
+    tile = nullptr;
+}
+
+template <class TImage>
+void
+TiledMaterializationImageFilter<TImage>
+::GetTileRange(const RegionType &region, unsigned int &first, unsigned int &last) const
+{
+  const unsigned int d = ImageDimension - 1;
+  long z0 = m_TiledRegion.GetIndex(d);
+  long r0 = region.GetIndex(d) - z0;
+  long r1 = r0 + (long) region.GetSize(d);
+
+  long n = (long) m_Tiles.size();
+  first = (unsigned int) std::clamp(r0 / (long) m_TileThickness, 0l, n);
+  last = (unsigned int) std::clamp((r1 + m_TileThickness - 1) / (long) m_TileThickness, 0l, n);
+}
+
+template <class TImage>
+typename TiledMaterializationImageFilter<TImage>::RegionType
+TiledMaterializationImageFilter<TImage>
+::GetTileRegion(unsigned int tile) const
+{
+  const unsigned int d = ImageDimension - 1;
+  RegionType region = m_TiledRegion;
+  long z0 = m_TiledRegion.GetIndex(d) + tile * m_TileThickness;
+  long z1 = std::min(z0 + (long) m_TileThickness,
+                     (long) (m_TiledRegion.GetIndex(d) + m_TiledRegion.GetSize(d)));
+  region.SetIndex(d, z0);
+  region.SetSize(d, z1 - z0);
+  return region;
+}
+
+template <class TImage>
+bool
+TiledMaterializationImageFilter<TImage>
+::HasMissingTiles(const RegionType &region) const
+{
+  unsigned int first, last;
+  this->GetTileRange(region, first, last);
+  for(unsigned int k = first; k < last; k++)
+    if(!m_Tiles[k])
+      return true;
+  return false;
+}
+
+template <class TImage>
+void
+TiledMaterializationImageFilter<TImage>
+::EvictTiles(unsigned int first, unsigned int last)
+{
+  if(m_MaximumNumberOfTiles == 0)
+    return;
+
+  unsigned int n_stored = this->GetNumberOfMaterializedTiles();
+  while(n_stored > m_MaximumNumberOfTiles)
+    {
+    // Find the least recently used tile that is not needed now
+    int lru = -1;
+    for(unsigned int k = 0; k < m_Tiles.size(); k++)
+      if(m_Tiles[k] && (k < first || k >= last)
+         && (lru < 0 || m_TileLastUse[k] < m_TileLastUse[lru]))
+        lru = k;
+
+    if(lru < 0)
+      break;
+
+    m_Tiles[lru] = nullptr;
+    n_stored--;
+    }
+}
+
+template <class TImage>
+void
+TiledMaterializationImageFilter<TImage>
+::PropagateRequestedRegion(itk::DataObject *output)
+{
+  // Same as itk::StreamingImageFilter: the input requested region is set
+  // one tile at a time inside UpdateOutputData(), so we stop here.
+  this->GenerateOutputRequestedRegion(output);
+}
+
+template <class TImage>
+void
+TiledMaterializationImageFilter<TImage>
+::UpdateOutputData(itk::DataObject *itkNotUsed(output))
+{
+  // Prevent chasing our tail
+  if(m_Updating)
+    return;
+
+  ImageType *input = const_cast<ImageType *>(this->GetInput());
+  ImageType *output = this->GetOutput();
+  itkAssertOrThrowMacro(input, "Input missing in TiledMaterializationImageFilter");
+
+  // Clear the flag on the way out, also if an exception is thrown upstream
+  struct UpdatingGuard
+  {
+    bool &flag;
+    UpdatingGuard(bool &f) : flag(f) { flag = true; }
+    ~UpdatingGuard() { flag = false; }
+  } guard(m_Updating);
+
+  // Set up the tiles again if the geometry of the output has changed
+  RegionType lpr = output->GetLargestPossibleRegion();
+  if(lpr != m_TiledRegion)
+    {
+    m_TiledRegion = lpr;
+    const unsigned int d = ImageDimension - 1;
+    unsigned int n_tiles = (lpr.GetSize(d) + m_TileThickness - 1) / m_TileThickness;
+    m_Tiles.assign(n_tiles, nullptr);
+    m_TileLastUse.assign(n_tiles, 0);
+    }
+
+  // If the input has been modified, all the tiles are stale
+  if(input->GetPipelineMTime() != m_MaterializedPipelineMTime)
+    {
+    this->InvalidateTiles();
+    m_MaterializedPipelineMTime = input->GetPipelineMTime();
+    }
+
+  // Crop the requested region to the image. The output only holds this region
+  RegionType requested = output->GetRequestedRegion();
+  if(!requested.Crop(lpr))
+    requested = RegionType();
+
+  output->SetBufferedRegion(requested);
+  output->Allocate();
+
+  if(requested.GetNumberOfPixels() > 0)
+    {
+    unsigned int first, last;
+    this->GetTileRange(requested, first, last);
+    bool missing = this->HasMissingTiles(requested);
+    if(missing)
+      {
+      this->InvokeEvent(itk::StartEvent());
+      this->UpdateProgress(0.0f);
+      }
+
+    for(unsigned int k = first; k < last; k++)
+      {
+      RegionType tile_region = this->GetTileRegion(k);
+      if(!m_Tiles[k])
+        {
+        // Pull just this tile from upstream
+        input->SetRequestedRegion(tile_region);
+        input->PropagateRequestedRegion();
+        input->UpdateOutputData();
+
+        // Keep it in the store
+        itk::SmartPointer<ImageType> tile = ImageType::New();
+        tile->CopyInformation(input);
+        tile->SetRegions(tile_region);
+        tile->Allocate();
+        itk::ImageAlgorithm::Copy(input, tile.GetPointer(), tile_region, tile_region);
+        m_Tiles[k] = tile;
+        }
+      m_TileLastUse[k] = ++m_UseCounter;
+
+      // Copy the part of the tile that was requested
+      RegionType overlap = tile_region;
+      overlap.Crop(requested);
+      itk::ImageAlgorithm::Copy(m_Tiles[k].GetPointer(), output, overlap, overlap);
+
+      if(missing)
+        this->UpdateProgress((k + 1.0f - first) / (last - first));
+      }
+
+    // Stay within the limit on the number of tiles
+    this->EvictTiles(first, last);
+
+    if(missing)
+      this->InvokeEvent(itk::EndEvent());
+    }
+
+  // Mark the output as up to date
+  output->DataHasBeenGenerated();
+}
+
+#endif // TILEDMATERIALIZATIONIMAGEFILTER_HXX
@@ -465,6 +465,19 @@ VectorImageWrapper<TTraits>::SetDisplayViewportGeometry(DisplaySliceIndex    ind
   }
 }
 
+template <class TTraits>
+void
+VectorImageWrapper<TTraits>::SetSliceResolutionAdaptive(bool flag)
+{
+  Superclass::SetSliceResolutionAdaptive(flag);
+
+  // Propagate to owned scalar wrappers
+  for (ScalarRepIterator it = m_ScalarReps.begin(); it != m_ScalarReps.end(); ++it)
+  {
+    it->second->SetSliceResolutionAdaptive(flag);
+  }
+}
+
 template <class TTraits>
 void
 VectorImageWrapper<TTraits>
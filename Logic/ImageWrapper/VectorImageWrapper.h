@@ -182,6 +182,8 @@ public:
   virtual void SetDisplayViewportGeometry(DisplaySliceIndex index,
                                           const ImageBaseType *viewport_image) override;
 
+  virtual void SetSliceResolutionAdaptive(bool flag) override;
+
   virtual void SetDirectionMatrix(const vnl_matrix<double> &direction) override;
 
   virtual void CopyImageCoordinateTransform(const ImageWrapperBase *source) override;
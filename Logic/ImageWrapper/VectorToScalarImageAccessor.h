@@ -3,6 +3,8 @@
 
 #include "itkDefaultVectorPixelAccessor.h"
 #include "itkVectorImageToImageAdaptor.h"
+#include <algorithm>
+#include <cmath>
 
 
 namespace itk
@@ -44,6 +46,15 @@ public:
                           const SizeValueType offset) const
     { return Get(Superclass::Get(input, offset)); }
 
+  /**
+   * Compute the quantity for a line of n pixels, where the vectors of
+   * consecutive pixels start stride components apart. This is used by the
+   * slicer, and is much faster than calling Get() for each pixel.
+   */
+  inline void GetLine(const InternalType *input, long stride,
+                      ExternalType *output, unsigned int n) const
+    { m_Functor.GetLine(input, stride, output, n); }
+
   void SetVectorLength(VectorLengthType l)
     {
     m_Functor.SetVectorLength(l);
@@ -103,6 +114,11 @@ public:
 
 protected:
 
+  // Number of pixels processed at a time by the GetLine() methods. The
+  // line methods loop over the components of a block of pixels, with the
+  // inner loop over the pixels, which the compiler is able to vectorize
+  static constexpr long LINE_BLOCK = 256;
+
   // Mapping from internal to native in the wrapped image
   double m_Shift, m_Scale;
   unsigned int m_Length;
@@ -147,6 +163,31 @@ public:
     return static_cast<OutputPixelType>(norm_raw_out);
   }
 
+  void GetLine(const InputPixelType *input, long stride,
+               OutputPixelType *output, unsigned int n) const
+  {
+    double sumT2[LINE_BLOCK], sumT[LINE_BLOCK];
+    for(long x0 = 0; x0 < (long) n; x0 += LINE_BLOCK)
+      {
+      long nb = std::min((long) n - x0, LINE_BLOCK);
+      const InputPixelType *p = input + x0 * stride;
+      std::fill(sumT2, sumT2 + nb, 0.0);
+      std::fill(sumT, sumT + nb, 0.0);
+      for(unsigned int c = 0; c < this->m_Length; c++)
+        {
+        for(long i = 0; i < nb; i++)
+          {
+          double t = p[i * stride + c];
+          sumT2[i] += t * t;
+          sumT[i] += t;
+          }
+        }
+      for(long i = 0; i < nb; i++)
+        output[x0 + i] = static_cast<OutputPixelType>(
+              sqrt(m_CoeffT2 * sumT2[i] + m_CoeffT1 * sumT[i] + m_CoeffT0));
+      }
+  }
+
   virtual void ParametersUpdated()
   {
     m_CoeffT2 = (this->m_Scale * this->m_Scale);
@@ -178,6 +219,24 @@ public:
       mymax = std::max(input[i], mymax);
     return static_cast<OutputPixelType>(mymax * this->m_Scale + this->m_Shift);
   }
+
+  void GetLine(const InputPixelType *input, long stride,
+               OutputPixelType *output, unsigned int n) const
+  {
+    InputPixelType mymax[LINE_BLOCK];
+    for(long x0 = 0; x0 < (long) n; x0 += LINE_BLOCK)
+      {
+      long nb = std::min((long) n - x0, LINE_BLOCK);
+      const InputPixelType *p = input + x0 * stride;
+      for(long i = 0; i < nb; i++)
+        mymax[i] = p[i * stride];
+      for(unsigned int c = 1; c < this->m_Length; c++)
+        for(long i = 0; i < nb; i++)
+          mymax[i] = std::max(p[i * stride + c], mymax[i]);
+      for(long i = 0; i < nb; i++)
+        output[x0 + i] = static_cast<OutputPixelType>(mymax[i] * this->m_Scale + this->m_Shift);
+      }
+  }
 };
 
 template <class TInputPixel, class TOutputPixel>
@@ -200,6 +259,24 @@ public:
     mean /= n_comp;
     return static_cast<OutputPixelType>(mean * this->m_Scale + this->m_Shift);
   }
+
+  void GetLine(const InputPixelType *input, long stride,
+               OutputPixelType *output, unsigned int n) const
+  {
+    double sum[LINE_BLOCK];
+    for(long x0 = 0; x0 < (long) n; x0 += LINE_BLOCK)
+      {
+      long nb = std::min((long) n - x0, LINE_BLOCK);
+      const InputPixelType *p = input + x0 * stride;
+      std::fill(sum, sum + nb, 0.0);
+      for(unsigned int c = 0; c < this->m_Length; c++)
+        for(long i = 0; i < nb; i++)
+          sum[i] += p[i * stride + c];
+      for(long i = 0; i < nb; i++)
+        output[x0 + i] = static_cast<OutputPixelType>(
+              (sum[i] / this->m_Length) * this->m_Scale + this->m_Shift);
+      }
+  }
 };
 
 /**
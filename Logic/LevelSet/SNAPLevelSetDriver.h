@@ -39,6 +39,8 @@
 
 #include "SnakeParameters.h"
 #include "SNAPLevelSetFunction.h"
+#include "RLEImage.h"
+#include <vector>
 // #include "SNAPLevelSetStopAndGoFilter.h"
 
 template <class TFilter> class LevelSetExtensionFilter;
@@ -125,6 +127,9 @@ public:
   typedef itk::Image<float, VDimension>              FloatImageType;
   typedef typename itk::SmartPointer<FloatImageType>      FloatImagePointer;
 
+  /** Run-length encoded image used to keep the initialization */
+  typedef RLEImage<float, VDimension>                CompressedFloatImageType;
+
   /** Type definition for the level set function */
   typedef SNAPLevelSetFunction<ShortImageType, FloatImageType>
                                                        LevelSetFunctionType;
@@ -141,6 +146,14 @@ public:
    * The level_set_image input contains the initial level set and will be
    * updated at each iteration of Run(). A backup copy of level_set_image
    * will be created for rewinding.
+   *
+   * If the parameters request more than one resolution level, the evolution
+   * starts on downsampled copies of the speed image and the initialization.
+   * Each level runs until the contour stops moving, and its level set is
+   * then upsampled to initialize the next finer level. While a coarse level
+   * is evolving, the output image holds the upsampled level set that the
+   * level started from. Coarse levels are not used with an external
+   * advection field.
    */
   SNAPLevelSetDriver(FloatImageType *level_set_image,
                      ShortImageType *speed_image,
@@ -165,9 +178,15 @@ public:
   /** Get the level set function */
   itkGetConstMacro(LevelSetFunction,LevelSetFunctionType *);
 
-  /** Get the number of elapsed iterations */
+  /** Get the number of elapsed iterations, including coarse levels */
   unsigned int GetElapsedIterations() const;
 
+  /**
+   * Get the downsampling factor of the level that is currently evolving, or
+   * 1 if the evolution has reached full resolution
+   */
+  unsigned int GetCurrentResolutionFactor() const;
+
   /** Clean up the snake's state */
   void CleanUp();
 
@@ -195,20 +214,75 @@ private:
   /** Level set function used by the level set filter */
   typename LevelSetFunctionType::Pointer m_LevelSetFunction;
 
-  /** An initialization image */
+  /**
+   * An initialization image. This is the input to the level set filter, but
+   * the filter only reads it when it is (re)initialized. At other times the
+   * image holds no pixels, and the initialization is kept in run-length form
+   * in m_CompressedInitialization, which is small because it only has two
+   * values, inside and outside.
+   */
   FloatImagePointer m_InitializationCopyImage, m_LevelSetImage;
+  typename CompressedFloatImageType::Pointer m_CompressedInitialization;
 
   /** Speed image adaptor */
   typename ShortImageType::Pointer m_SpeedAdaptor;
 
+  /** Full resolution speed image, used to build the coarse levels */
+  typename ShortImageType::Pointer m_SpeedImage;
+
+  /** Whether an external advection field was provided */
+  bool m_ExternalAdvection;
+
+  /** One of the coarse levels of the multiresolution evolution */
+  struct CoarseLevel
+  {
+    unsigned int Factor;
+    typename ShortImageType::Pointer Speed;
+    FloatImagePointer Initialization;
+    typename LevelSetFunctionType::Pointer Function;
+    typename FilterType::Pointer Filter;
+    unsigned long InsideCount;
+  };
+
+  /**
+   * Coarse levels, from the finest (factor 2) to the coarsest, and the index
+   * of the level that is evolving, or -1 once at full resolution
+   */
+  std::vector<CoarseLevel> m_CoarseLevels;
+  int m_CurrentLevel;
+
+  /** Iterations performed at the coarse levels that have been completed */
+  unsigned int m_CoarseIterations;
+
   /** Last accepted snake parameters */
   SnakeParameters m_Parameters;
 
   /** Assign the values of snake parameters to a snake function */
   void AssignParametersToPhi(const SnakeParameters &parms, bool firstTime);
+  void AssignParametersToPhi(LevelSetFunctionType *phi, const SnakeParameters &parms);
 
   /** Internal routines */
   void DoCreateLevelSetFilter();
+  typename FilterType::Pointer CreateLevelSetFilter(
+      FloatImageType *input, LevelSetFunctionType *phi);
+
+  /** Update the filter from the initialization image, which is decoded from
+   * the run-length copy for the duration of the update. If requested, the
+   * coarse levels are rebuilt from the initialization. */
+  void UpdateFromInitialization(bool initCoarseLevels);
+
+  /** Build the coarse levels from the initialization image and start the
+   * evolution at the coarsest one */
+  void InitializeCoarseLevels();
+
+  /** Move from a coarse level that has stopped to the next finer level */
+  void AdvanceToFinerLevel();
+
+  /** Resample a coarse level set onto the grid of the reference image */
+  FloatImagePointer UpsampleLevelSet(FloatImageType *phi, FloatImageType *reference);
+
+  /** Number of pixels inside the contour */
+  static unsigned long CountInsidePixels(FloatImageType *phi);
 };
 
 // Type definitions
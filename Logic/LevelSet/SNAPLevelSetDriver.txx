@@ -49,7 +49,15 @@
 #include "itkNarrowBandLevelSetImageFilter.h"
 #include "itkDenseFiniteDifferenceImageFilter.h"
 #include "LevelSetExtensionFilter.h"
-#include "itkImageDuplicator.h"
+#include "RLERegionOfInterestImageFilter.h"
+#include "RLEDecodeImageFilter.h"
+#include "itkBinShrinkImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborExtrapolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include <algorithm>
 
 #include "itkParallelSparseFieldLevelSetImageFilter.h"
 
@@ -125,13 +133,26 @@ SNAPLevelSetDriver<VDimension>
   if(externalAdvection)
     m_LevelSetFunction->SetAdvectionField(externalAdvection);
 
-  // Create a copy of the level set image for reinitialization
-  // TODO: this is wasteful of memory
-  typedef itk::ImageDuplicator<FloatImageType> Duplicator;
-  typename Duplicator::Pointer dup = Duplicator::New();
-  dup->SetInputImage(level_set_image);
-  dup->Update();
-  m_InitializationCopyImage = dup->GetOutput();
+  // Keep the speed image for building coarse levels
+  m_SpeedImage = speed_image;
+  m_ExternalAdvection = (externalAdvection != NULL);
+  m_CurrentLevel = -1;
+  m_CoarseIterations = 0;
+
+  // Keep a run-length copy of the level set image for reinitialization
+  typedef itk::RegionOfInterestImageFilter<FloatImageType, CompressedFloatImageType> EncoderType;
+  typename EncoderType::Pointer encoder = EncoderType::New();
+  encoder->SetInput(level_set_image);
+  encoder->SetRegionOfInterest(level_set_image->GetBufferedRegion());
+  encoder->Update();
+  m_CompressedInitialization = encoder->GetOutput();
+
+  // The input to the filter initially shares its pixels with the level set
+  // image, whose pixel container is replaced by the output of the filter
+  m_InitializationCopyImage = FloatImageType::New();
+  m_InitializationCopyImage->CopyInformation(level_set_image);
+  m_InitializationCopyImage->SetRegions(level_set_image->GetBufferedRegion());
+  m_InitializationCopyImage->SetPixelContainer(level_set_image->GetPixelContainer());
 
   // Store the pointer to the evolving level set image
   m_LevelSetImage = level_set_image;
@@ -149,35 +170,47 @@ SNAPLevelSetDriver<VDimension>
 ::AssignParametersToPhi(const SnakeParameters &p, bool itkNotUsed(firstTime))
 {
   // Set up the level set function
+  AssignParametersToPhi(m_LevelSetFunction, p);
 
+  // The coarse levels use the same parameters
+  for(unsigned int i = 0; i < m_CoarseLevels.size(); i++)
+    if(m_CoarseLevels[i].Function)
+      AssignParametersToPhi(m_CoarseLevels[i].Function, p);
+
+  // Remember the parameters
+  m_Parameters = p;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::AssignParametersToPhi(LevelSetFunctionType *phi, const SnakeParameters &p)
+{
   // The sign of the advection term is flipped in our equation
-  m_LevelSetFunction->SetAdvectionWeight(- p.GetAdvectionWeight());
-  m_LevelSetFunction->SetAdvectionSpeedExponent(p.GetAdvectionSpeedExponent());
+  phi->SetAdvectionWeight(- p.GetAdvectionWeight());
+  phi->SetAdvectionSpeedExponent(p.GetAdvectionSpeedExponent());
 
   // The curvature exponent for traditional/legacy reasons has a +1 value.
-  m_LevelSetFunction->SetCurvatureSpeedExponent(p.GetCurvatureSpeedExponent()+1);  
-  m_LevelSetFunction->SetCurvatureWeight(p.GetCurvatureWeight());
+  phi->SetCurvatureSpeedExponent(p.GetCurvatureSpeedExponent()+1);
+  phi->SetCurvatureWeight(p.GetCurvatureWeight());
   
-  m_LevelSetFunction->SetPropagationWeight(p.GetPropagationWeight());
-  m_LevelSetFunction->SetPropagationSpeedExponent(p.GetPropagationSpeedExponent());  
-  m_LevelSetFunction->SetLaplacianSmoothingWeight(p.GetLaplacianWeight());
-  m_LevelSetFunction->SetLaplacianSmoothingSpeedExponent(p.GetLaplacianSpeedExponent());  
+  phi->SetPropagationWeight(p.GetPropagationWeight());
+  phi->SetPropagationSpeedExponent(p.GetPropagationSpeedExponent());
+  phi->SetLaplacianSmoothingWeight(p.GetLaplacianWeight());
+  phi->SetLaplacianSmoothingSpeedExponent(p.GetLaplacianSpeedExponent());
   
   // We only need to recompute the internal images if the exponents to those
   // images have changed
-  m_LevelSetFunction->CalculateInternalImages();
+  phi->CalculateInternalImages();
   
   // Call the initialize method
   typename LevelSetFunctionType::RadiusType radius;
   radius.Fill(1);
-  m_LevelSetFunction->Initialize(radius);
+  phi->Initialize(radius);
 
   // Set the time step
-  m_LevelSetFunction->SetTimeStepFactor(
+  phi->SetTimeStepFactor(
     p.GetAutomaticTimeStep() ? 1.0 : p.GetTimeStepFactor());
-
-  // Remember the parameters
-  m_Parameters = p;
 }
 
 template<unsigned int VDimension>
@@ -185,6 +218,22 @@ void
 SNAPLevelSetDriver<VDimension>
 ::DoCreateLevelSetFilter()
 {
+  m_LevelSetFilter = this->CreateLevelSetFilter(m_InitializationCopyImage, m_LevelSetFunction);
+
+  // This code is common to all filters. It causes the filter to initialize
+  // the necessary memory and sets the iteration counter to 0
+  m_LevelSetFilter->SetManualReinitialization(true);
+  m_LevelSetFilter->SetNumberOfIterations(0);
+  this->UpdateFromInitialization(true);
+}
+
+template<unsigned int VDimension>
+typename SNAPLevelSetDriver<VDimension>::FilterType::Pointer
+SNAPLevelSetDriver<VDimension>
+::CreateLevelSetFilter(FloatImageType *input, LevelSetFunctionType *phi)
+{
+  typename FilterType::Pointer result;
+
   // In this method we have the flexibility to create a level set filter
   // of any ITK solver type.  This way, we can plug in different solvers:
   // NarrowBand, ParallelSparseField, even Dense.  
@@ -199,13 +248,13 @@ SNAPLevelSetDriver<VDimension>
 
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
-    filter->SetInput(m_InitializationCopyImage);
+    filter->SetInput(input);
     filter->SetNumberOfLayers(3);
     filter->SetIsoSurfaceValue(0.0f);
-    filter->SetDifferenceFunction(m_LevelSetFunction);
+    filter->SetDifferenceFunction(phi);
     }
 /*
   else if(m_Parameters.GetSolver() == SnakeParameters::NARROW_BAND_SOLVER)
@@ -218,7 +267,7 @@ SNAPLevelSetDriver<VDimension>
 
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
     filter->SetSegmentationFunction(m_LevelSetFunction);
@@ -238,11 +287,11 @@ SNAPLevelSetDriver<VDimension>
     
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
-    filter->SetInput(m_InitializationCopyImage);
-    filter->SetDifferenceFunction(m_LevelSetFunction);
+    filter->SetInput(input);
+    filter->SetDifferenceFunction(phi);
     }
 
   else
@@ -250,15 +299,38 @@ SNAPLevelSetDriver<VDimension>
     throw itk::ExceptionObject(__FILE__,__LINE__,"Unknown level set solver requested");
     }
 
-  // This code is common to all filters. It causes the filter to initialize
-  // the necessary memory and sets the iteration counter to 0
-  m_LevelSetFilter->SetManualReinitialization(true);
-  m_LevelSetFilter->SetNumberOfIterations(0);
-  
+  return result;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::UpdateFromInitialization(bool initCoarseLevels)
+{
+  // Decode the initialization, unless it is still in memory
+  if(m_InitializationCopyImage->GetBufferedRegion() !=
+     m_InitializationCopyImage->GetLargestPossibleRegion())
+    {
+    typedef RLEDecodeImageFilter<CompressedFloatImageType, FloatImageType> DecoderType;
+    typename DecoderType::Pointer decoder = DecoderType::New();
+    decoder->SetInput(m_CompressedInitialization);
+    decoder->Update();
+    m_InitializationCopyImage->SetBufferedRegion(decoder->GetOutput()->GetBufferedRegion());
+    m_InitializationCopyImage->SetPixelContainer(decoder->GetOutput()->GetPixelContainer());
+    }
+
+  // Build the coarse levels while the initialization is in memory
+  if(initCoarseLevels)
+    this->InitializeCoarseLevels();
+
   // Update the largest possible region. The slicer may be changing the 
   // requested region on this image, so it's important that we always 
   // update the entire image
   m_LevelSetFilter->UpdateLargestPossibleRegion();
+
+  // The filter has copied the input to its output, and will not read it
+  // again until it is reinitialized
+  m_InitializationCopyImage->ReleaseData();
 }
 
 template<unsigned int VDimension>
@@ -270,11 +342,191 @@ SNAPLevelSetDriver<VDimension>
   // be performed, and set the number of iterations to 0
   m_LevelSetFilter->SetStateToUninitialized();
   m_LevelSetFilter->SetNumberOfIterations(0);
+  this->UpdateFromInitialization(true);
+}
 
-  // Update the largest possible region. The slicer may be changing the 
-  // requested region on this image, so it's important that we always 
-  // update the entire image
-  m_LevelSetFilter->UpdateLargestPossibleRegion();
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::InitializeCoarseLevels()
+{
+  m_CoarseLevels.clear();
+  m_CurrentLevel = -1;
+  m_CoarseIterations = 0;
+
+  // Coarse levels need a downsampled advection field, which is not supported
+  if(m_ExternalAdvection)
+    return;
+
+  typename FloatImageType::SizeType size =
+      m_InitializationCopyImage->GetLargestPossibleRegion().GetSize();
+
+  typedef itk::BinShrinkImageFilter<ShortImageType, ShortImageType> ShrinkFilter;
+  for(int level = 1; level < m_Parameters.GetMultiResolutionLevels(); level++)
+    {
+    CoarseLevel cl;
+    cl.Factor = 1u << level;
+
+    // Only downsample dimensions that remain at least 16 pixels across, so
+    // that thin ROIs are still downsampled in-plane
+    typename ShrinkFilter::ShrinkFactorsType factors;
+    bool shrinking = false;
+    for(unsigned int d = 0; d < VDimension; d++)
+      {
+      factors[d] = (size[d] >= 16 * cl.Factor) ? cl.Factor : 1;
+      shrinking |= (factors[d] > 1);
+      }
+    if(!shrinking)
+      break;
+
+    // Average the speed image over blocks of pixels
+    typename ShrinkFilter::Pointer shrink = ShrinkFilter::New();
+    shrink->SetInput(m_SpeedImage);
+    shrink->SetShrinkFactors(factors);
+    shrink->Update();
+    cl.Speed = shrink->GetOutput();
+
+    // A coarse pixel is inside the initial contour if any of its pixels is,
+    // so that small bubbles are not lost
+    cl.Initialization = FloatImageType::New();
+    cl.Initialization->CopyInformation(cl.Speed);
+    cl.Initialization->SetRegions(cl.Speed->GetBufferedRegion());
+    cl.Initialization->Allocate();
+
+    typename FloatImageType::RegionType fineRegion = m_InitializationCopyImage->GetBufferedRegion();
+    typename FloatImageType::RegionType coarseRegion = cl.Initialization->GetBufferedRegion();
+    typename FloatImageType::IndexType i0 = fineRegion.GetIndex();
+    typename FloatImageType::IndexType c0 = coarseRegion.GetIndex();
+    itk::ImageRegionIteratorWithIndex<FloatImageType> itc(cl.Initialization, coarseRegion);
+    for(; !itc.IsAtEnd(); ++itc)
+      {
+      // The block of fine pixels covered by this coarse pixel
+      typename FloatImageType::RegionType block;
+      for(unsigned int d = 0; d < VDimension; d++)
+        {
+        block.SetIndex(d, i0[d] + (itc.GetIndex()[d] - c0[d]) * (long) factors[d]);
+        block.SetSize(d, factors[d]);
+        }
+
+      float v = itk::NumericTraits<float>::max();
+      if(block.Crop(fineRegion))
+        {
+        itk::ImageRegionConstIterator<FloatImageType> itf(m_InitializationCopyImage, block);
+        for(; !itf.IsAtEnd(); ++itf)
+          v = std::min(v, itf.Get());
+        }
+      itc.Set(v);
+      }
+
+    // Level set function and filter for this level
+    cl.Function = LevelSetFunctionType::New();
+    cl.Function->SetSpeedImage(cl.Speed);
+    cl.Function->SetSpeedScaleFactor(1.0 / 0x7fff);
+    AssignParametersToPhi(cl.Function, m_Parameters);
+
+    cl.Filter = this->CreateLevelSetFilter(cl.Initialization, cl.Function);
+    cl.Filter->SetManualReinitialization(true);
+    cl.Filter->SetNumberOfIterations(0);
+    cl.Filter->UpdateLargestPossibleRegion();
+    cl.InsideCount = CountInsidePixels(cl.Filter->GetOutput());
+
+    m_CoarseLevels.push_back(cl);
+    }
+
+  // Start at the coarsest level
+  m_CurrentLevel = (int) m_CoarseLevels.size() - 1;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::AdvanceToFinerLevel()
+{
+  CoarseLevel &cl = m_CoarseLevels[m_CurrentLevel];
+  m_CoarseIterations += cl.Filter->GetElapsedIterations();
+
+  // If the contour vanished at this level (e.g., bubbles that were too small
+  // for its resolution), the next level starts from its own initialization
+  FloatImagePointer phi;
+  if(cl.InsideCount > 0)
+    phi = cl.Filter->GetOutput();
+
+  // The coarse level is no longer needed
+  cl.Filter = NULL;
+  cl.Function = NULL;
+  cl.Speed = NULL;
+  cl.Initialization = NULL;
+  m_CurrentLevel--;
+
+  if(m_CurrentLevel >= 0)
+    {
+    CoarseLevel &next = m_CoarseLevels[m_CurrentLevel];
+    if(phi)
+      {
+      FloatImagePointer init = this->UpsampleLevelSet(phi, next.Initialization);
+      next.Initialization->SetPixelContainer(init->GetPixelContainer());
+
+      // Show the contour that the level starts from in the output image. It
+      // is only refreshed when the level changes, since resampling to full
+      // resolution after every batch of iterations defeats the speedup
+      FloatImageType *output = m_LevelSetFilter->GetOutput();
+      FloatImagePointer full = this->UpsampleLevelSet(phi, output);
+      std::copy(full->GetBufferPointer(),
+                full->GetBufferPointer() + full->GetPixelContainer()->Size(),
+                output->GetBufferPointer());
+      output->Modified();
+      }
+    next.Filter->SetStateToUninitialized();
+    next.Filter->SetNumberOfIterations(0);
+    next.Filter->UpdateLargestPossibleRegion();
+    next.InsideCount = CountInsidePixels(next.Filter->GetOutput());
+    }
+  else
+    {
+    // Continue at full resolution. The finer initialization is discarded
+    // after the filter reads it, and Restart() decodes the original one.
+    if(phi)
+      {
+      FloatImagePointer init = this->UpsampleLevelSet(phi, m_LevelSetFilter->GetOutput());
+      m_InitializationCopyImage->SetBufferedRegion(init->GetBufferedRegion());
+      m_InitializationCopyImage->SetPixelContainer(init->GetPixelContainer());
+      }
+    m_LevelSetFilter->SetStateToUninitialized();
+    m_LevelSetFilter->SetNumberOfIterations(0);
+    this->UpdateFromInitialization(false);
+    m_CoarseLevels.clear();
+    }
+}
+
+template<unsigned int VDimension>
+typename SNAPLevelSetDriver<VDimension>::FloatImagePointer
+SNAPLevelSetDriver<VDimension>
+::UpsampleLevelSet(FloatImageType *phi, FloatImageType *reference)
+{
+  typedef itk::ResampleImageFilter<FloatImageType, FloatImageType> ResampleFilter;
+  typedef itk::LinearInterpolateImageFunction<FloatImageType> Interpolator;
+  typedef itk::NearestNeighborExtrapolateImageFunction<FloatImageType> Extrapolator;
+
+  typename ResampleFilter::Pointer resample = ResampleFilter::New();
+  resample->SetInput(phi);
+  resample->SetInterpolator(Interpolator::New());
+  resample->SetExtrapolator(Extrapolator::New());
+  resample->SetOutputParametersFromImage(reference);
+  resample->Update();
+
+  // Level sets are in pixel units, so rescaling by the factor is not needed:
+  // only the zero crossing is used to reinitialize the finer level
+  return resample->GetOutput();
+}
+
+template<unsigned int VDimension>
+unsigned long
+SNAPLevelSetDriver<VDimension>
+::CountInsidePixels(FloatImageType *phi)
+{
+  const float *p = phi->GetBufferPointer();
+  size_t n = phi->GetPixelContainer()->Size();
+  return (unsigned long) std::count_if(p, p + n, [](float v) { return v < 0.0f; });
 }
 
 template<unsigned int VDimension>
@@ -282,6 +534,29 @@ void
 SNAPLevelSetDriver<VDimension>
 ::Run(unsigned int nIterations)
 {
+  // Evolve the current coarse level
+  if(m_CurrentLevel >= 0)
+    {
+    CoarseLevel &cl = m_CoarseLevels[m_CurrentLevel];
+    unsigned int nElapsed = cl.Filter->GetElapsedIterations();
+    cl.Filter->SetNumberOfIterations(nElapsed + nIterations);
+    cl.Filter->UpdateLargestPossibleRegion();
+
+    // The level has stopped when the enclosed volume changes by less than
+    // 0.1% per iteration. Levels are also capped at 1000 iterations, because
+    // the curvature term can keep the contour jittering in place.
+    unsigned long count = CountInsidePixels(cl.Filter->GetOutput());
+    unsigned long change = (count > cl.InsideCount) ? count - cl.InsideCount : cl.InsideCount - count;
+    cl.InsideCount = count;
+    unsigned int nLevel = cl.Filter->GetElapsedIterations();
+    bool stopped = (nLevel >= 10 && change <= 0.001 * count * nIterations) || nLevel >= 1000;
+
+    if(stopped)
+      this->AdvanceToFinerLevel();
+
+    return;
+    }
+
   // Increment the number of iterations 
   unsigned int nElapsed = m_LevelSetFilter->GetElapsedIterations();
   m_LevelSetFilter->SetNumberOfIterations(nElapsed + nIterations);
@@ -297,6 +572,9 @@ bool
 SNAPLevelSetDriver<VDimension>
 ::IsEvolutionConverged()
 {
+  if(m_CurrentLevel >= 0)
+    return false;
+
   if(m_LevelSetFilter->GetElapsedIterations() == 0)
     return false;
 
@@ -310,7 +588,18 @@ unsigned int
 SNAPLevelSetDriver<VDimension>
 ::GetElapsedIterations() const
 {
-  return m_LevelSetFilter->GetElapsedIterations();
+  if(m_CurrentLevel >= 0)
+    return m_CoarseIterations + m_CoarseLevels[m_CurrentLevel].Filter->GetElapsedIterations();
+
+  return m_CoarseIterations + m_LevelSetFilter->GetElapsedIterations();
+}
+
+template<unsigned int VDimension>
+unsigned int
+SNAPLevelSetDriver<VDimension>
+::GetCurrentResolutionFactor() const
+{
+  return m_CurrentLevel >= 0 ? m_CoarseLevels[m_CurrentLevel].Factor : 1;
 }
 
 template<unsigned int VDimension>
@@ -323,6 +612,8 @@ SNAPLevelSetDriver<VDimension>
   // function to free memory
   m_LevelSetFilter = NULL;
   m_LevelSetFunction = NULL;
+  m_CoarseLevels.clear();
+  m_CurrentLevel = -1;
 }
 
 template<unsigned int VDimension>
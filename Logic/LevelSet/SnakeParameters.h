@@ -184,6 +184,18 @@ public:
     this->m_AdvectionSpeedExponent = value;
   }
 
+  /**
+   * Number of resolution levels for coarse-to-fine evolution. With more than
+   * one level, the contour first evolves on a speed image downsampled by a
+   * factor of 2^(levels-1), then on successively finer images, and finally at
+   * full resolution. A value of 1 evolves at full resolution only.
+   */
+  itkGetConstMacro(MultiResolutionLevels,int);
+  void SetMultiResolutionLevels( int value )
+  {
+    this->m_MultiResolutionLevels = value;
+  }
+
 private:
   float m_TimeStepFactor;
   float m_Ground;
@@ -206,6 +218,8 @@ private:
   int m_AdvectionSpeedExponent;   
 
   SolverType m_Solver;
+
+  int m_MultiResolutionLevels;
 };
 
 #endif // __SnakeParameters_h_
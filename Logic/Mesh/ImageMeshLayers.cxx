@@ -122,7 +122,7 @@ ImageMeshLayers::Unload()
 
 int
 ImageMeshLayers
-::UpdateActiveMeshLayer(itk::Command *progressCmd)
+::UpdateActiveMeshLayer(itk::Command *progressCmd, TaskCancellationToken *token)
 {
   assert(progressCmd);
 
@@ -145,14 +145,16 @@ ImageMeshLayers
 
       lsMesh->UpdateMeshes(lsImg, app->GetCursorTimePoint(),
                            app->GetGlobalState()->GetDrawingColorLabel(),
-                           app->GetSNAPImageData()->GetLevelSetPipelineMutex());
+                           app->GetSNAPImageData()->GetLevelSetPipelineMutex(),
+                           token);
       }
     else
       {
       auto lsMesh = AddLevelSetMeshLayer(lsImg);
       lsMesh->UpdateMeshes(lsImg, app->GetCursorTimePoint(),
                            app->GetGlobalState()->GetDrawingColorLabel(),
-                           app->GetSNAPImageData()->GetLevelSetPipelineMutex());
+                           app->GetSNAPImageData()->GetLevelSetPipelineMutex(),
+                           token);
       }
     }
   else
@@ -166,13 +168,13 @@ ImageMeshLayers
       auto segMesh = static_cast<SegmentationMeshWrapper*>
           (m_ImageToMeshMap[segImg->GetUniqueId()]);
 
-      segMesh->UpdateMeshes(progressCmd, app->GetCursorTimePoint());
+      segMesh->UpdateMeshes(progressCmd, app->GetCursorTimePoint(), token);
       }
     else
       {
       // If the layer doesn't exist yet, add a segmentation layer
       auto meshLayer = AddSegmentationMeshLayer(segImg);
-      meshLayer->UpdateMeshes(progressCmd, app->GetCursorTimePoint());
+      meshLayer->UpdateMeshes(progressCmd, app->GetCursorTimePoint(), token);
       }
     }
 
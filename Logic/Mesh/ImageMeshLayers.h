@@ -13,6 +13,7 @@ class GenericImageData;
 class LabelImageWrapper;
 class SegmentationMeshWrapper;
 class LevelSetMeshWrapper;
+class TaskCancellationToken;
 
 /**
  * \class ImageMeshLayers
@@ -87,8 +88,11 @@ public:
    *  Return 1 if failed or nothing to update, to avoid triggering events
    *  The caller of this method is responsible to check if mesh is necessary
    *  to update (dirty);
+   *  If a cancellation token is given, the update throws
+   *  TaskCancelledException when the token is cancelled
    */
-  int UpdateActiveMeshLayer(itk::Command *progressCmd);
+  int UpdateActiveMeshLayer(itk::Command *progressCmd,
+                            TaskCancellationToken *token = nullptr);
 
   /** Return the active layer Modified Time */
   unsigned long GetActiveMeshMTime();
@@ -79,15 +79,16 @@ LevelSetMeshPipeline
 
 void
 LevelSetMeshPipeline
-::UpdateMesh(std::mutex *mutex)
+::UpdateMesh(std::mutex *mutex, TaskCancellationToken *token)
 {
   // We need to generate a new mesh object. Otherwise, if there is concurrent
   // rendering and mesh computation, the mesh would be accessed by two threads
   // at the same time, which is a problem.
-  m_Mesh = vtkSmartPointer<vtkPolyData>::New();
+  vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
 
   // Run the pipeline
-  m_VTKPipeline->ComputeMesh(m_Mesh, 0, mutex);
+  m_VTKPipeline->ComputeMesh(mesh, 0, mutex, token);
+  m_Mesh = mesh;
 
   // Set the modified flag so that we can use the MTime() of this object for dirty checks
   this->Modified();
@@ -51,6 +51,7 @@ namespace itk {
 class MeshOptions;
 class VTKMeshPipeline;
 class vtkPolyData;
+class TaskCancellationToken;
 
 /**
  * \class LevelSetMeshPipeline
@@ -78,8 +79,10 @@ public:
   /** Compute the mesh for the segmentation level set. An optional pointer
       to a mutex lock can be provided. If passed in, the portion of the code
       where the image data is accessed will be locked. This is to prevent mesh
-      update clashing with level set evolution iteration. */
-  void UpdateMesh(std::mutex *mutex = nullptr);
+      update clashing with level set evolution iteration. If a cancellation
+      token is given, the update may be aborted, and then throws
+      TaskCancelledException and keeps the previous mesh. */
+  void UpdateMesh(std::mutex *mutex = nullptr, TaskCancellationToken *token = nullptr);
 
   /** Get the stored mesh */
   vtkPolyData *GetMesh();
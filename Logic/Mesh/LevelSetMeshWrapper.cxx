@@ -36,10 +36,10 @@ LevelSetMeshAssembly
 
 void
 LevelSetMeshAssembly
-::UpdateMeshAssembly(LabelType id, std::mutex *mutex)
+::UpdateMeshAssembly(LabelType id, std::mutex *mutex, TaskCancellationToken *token)
 {
   // Run the UpdateMesh for the current tp assembly
-  m_Pipeline->UpdateMesh(mutex);
+  m_Pipeline->UpdateMesh(mutex, token);
 
   // Post Update. Update mesh assmebly
   vtkPolyData *mesh = m_Pipeline->GetMesh();
@@ -155,7 +155,8 @@ LevelSetMeshWrapper
 
 void
 LevelSetMeshWrapper
-::UpdateMeshes(LevelSetImageWrapper *lsImg, unsigned int timepoint, LabelType id, std::mutex *mutex)
+::UpdateMeshes(LevelSetImageWrapper *lsImg, unsigned int timepoint, LabelType id, std::mutex *mutex,
+               TaskCancellationToken *token)
 {
   if (!m_MeshAssemblyMap.count(timepoint))
     {
@@ -165,7 +166,7 @@ LevelSetMeshWrapper
   auto assembly = static_cast<LevelSetMeshAssembly*>(
         m_MeshAssemblyMap[timepoint].GetPointer());
 
-  assembly->UpdateMeshAssembly(id, mutex);
+  assembly->UpdateMeshAssembly(id, mutex, token);
 
 }
 
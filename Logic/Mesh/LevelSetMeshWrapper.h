@@ -17,7 +17,8 @@ public:
 
   LevelSetMeshPipeline *GetPipeline();
 
-  void UpdateMeshAssembly(LabelType id, std::mutex *mutex = nullptr);
+  void UpdateMeshAssembly(LabelType id, std::mutex *mutex = nullptr,
+                          TaskCancellationToken *token = nullptr);
 
   void SetMeshOptions(const MeshOptions *options);
 
@@ -75,7 +76,8 @@ public:
   //-----------------------------------------------------
 
   // Layer level method should always handle timepoint
-  void UpdateMeshes(LevelSetImageWrapper *lsImg, unsigned int timepoint, LabelType id, std::mutex *mutex);
+  void UpdateMeshes(LevelSetImageWrapper *lsImg, unsigned int timepoint, LabelType id, std::mutex *mutex,
+                    TaskCancellationToken *token = nullptr);
 
   void Initialize(MeshOptions* meshOptions, ColorLabelTable *colorTable);
 
@@ -187,6 +187,12 @@ MeshManager
       // Pass the options to the pipeline
     pipeline->SetMeshOptions(m_GlobalState->GetMeshOptions());
 
+    // If the edits made since the last update are known, the pipeline can
+    // limit the remeshing to the modified parts of the segmentation
+    LabelImageModifiedRegions modified;
+    if(wrapper->GetModifiedRegionsSince(timepoint, pipeline->GetInputMTimeAtLastUpdate(), modified))
+      pipeline->SetModifiedRegions(modified);
+
     // Update the meshes
     pipeline->UpdateMeshes(command);
     }
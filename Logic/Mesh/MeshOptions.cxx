@@ -74,6 +74,10 @@ MeshOptions
     NewSimpleProperty("MeshSmoothingFeatureEdgeSmoothing", false);
   m_MeshSmoothingBoundarySmoothingModel = 
     NewSimpleProperty("MeshSmoothingBoundarySmoothing", false);
+
+  // Begin multi-label extraction params
+  m_UseMultiLabelSurfaceExtractionModel =
+    NewSimpleProperty("UseMultiLabelSurfaceExtraction", false);
 }
 
 /*
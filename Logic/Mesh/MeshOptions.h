@@ -69,6 +69,9 @@ public:
   irisSimplePropertyAccessMacro(MeshSmoothingFeatureEdgeSmoothing,bool)
   irisSimplePropertyAccessMacro(MeshSmoothingBoundarySmoothing,bool)
 
+  // Extract the surfaces of all labels in a single pass (surface nets)
+  irisSimplePropertyAccessMacro(UseMultiLabelSurfaceExtraction,bool)
+
 protected:
   MeshOptions();
 
@@ -95,6 +98,9 @@ private:
   SmartPtr<ConcreteRangedFloatProperty> m_MeshSmoothingFeatureAngleModel;
   SmartPtr<ConcreteSimpleBooleanProperty> m_MeshSmoothingFeatureEdgeSmoothingModel;
   SmartPtr<ConcreteSimpleBooleanProperty> m_MeshSmoothingBoundarySmoothingModel;
+
+  // Begin multi-label extraction params
+  SmartPtr<ConcreteSimpleBooleanProperty> m_UseMultiLabelSurfaceExtractionModel;
 };
 
 #endif // __MeshOptions_h_
@@ -11,6 +11,11 @@
 #include <vtkPlane.h>
 #include <vtkPlaneCutter.h>
 #include <vtkStripper.h>
+#include <vtkCellArray.h>
+#include <vtkCellArrayIterator.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 // ========================================
 //  PolyDataWrapper Implementation
@@ -29,6 +34,119 @@ PolyDataWrapper::GetPolyData()
   return m_PolyData;
 }
 
+bool
+PlaneCutterAssembly::UpdateIndex(vtkPolyData *mesh, const Vector3d &normal)
+{
+  // Check if the existing index is still good
+  if(mesh == m_IndexedMesh && mesh->GetMTime() == m_IndexedMeshMTime
+     && dot_product(normal, m_IndexedNormal) > 1.0 - 1e-12)
+    return m_IndexValid;
+
+  m_IndexedMesh = mesh;
+  m_IndexedMeshMTime = mesh->GetMTime();
+  m_IndexedNormal = normal;
+  m_ContourCache.clear();
+  m_CellMin.clear();
+  m_CellMax.clear();
+  m_BinStart.clear();
+  m_BinCells.clear();
+
+  // Only meshes made up of polygons are indexed
+  vtkCellArray *polys = mesh->GetPolys();
+  vtkIdType n_cells = polys ? polys->GetNumberOfCells() : 0;
+  m_IndexValid = n_cells > 0 && mesh->GetNumberOfCells() == n_cells;
+  if(!m_IndexValid)
+    return false;
+
+  // Project the points onto the normal
+  vtkPoints *points = mesh->GetPoints();
+  std::vector<double> proj(points->GetNumberOfPoints());
+  for(vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    double *x = points->GetPoint(i);
+    proj[i] = normal[0] * x[0] + normal[1] * x[1] + normal[2] * x[2];
+  }
+
+  // Compute the extent of each polygon along the normal
+  m_CellMin.resize(n_cells);
+  m_CellMax.resize(n_cells);
+  double lo = std::numeric_limits<double>::max(), hi = -lo;
+  vtkIdType npts;
+  const vtkIdType *pts;
+  auto it = vtkSmartPointer<vtkCellArrayIterator>::Take(polys->NewIterator());
+  vtkIdType c = 0;
+  for(it->GoToFirstCell(); !it->IsDoneWithTraversal(); it->GoToNextCell(), c++)
+  {
+    it->GetCurrentCell(npts, pts);
+    double cmin = std::numeric_limits<double>::max(), cmax = -cmin;
+    for(vtkIdType j = 0; j < npts; j++)
+    {
+      cmin = std::min(cmin, proj[pts[j]]);
+      cmax = std::max(cmax, proj[pts[j]]);
+    }
+    m_CellMin[c] = cmin;
+    m_CellMax[c] = cmax;
+    lo = std::min(lo, cmin);
+    hi = std::max(hi, cmax);
+  }
+
+  // A plane crosses on the order of sqrt(n) polygons of a surface, so the
+  // same number of bins keeps both the bins and the polygon spans short
+  vtkIdType n_bins = std::max((vtkIdType) 1, (vtkIdType) (2 * std::sqrt((double) n_cells)));
+  m_BinOrigin = lo;
+  m_BinWidth = (hi > lo) ? (hi - lo) / n_bins : 1.0;
+  auto bin_of = [&](double v) {
+    return std::min(n_bins - 1, std::max((vtkIdType) 0, (vtkIdType) ((v - m_BinOrigin) / m_BinWidth)));
+  };
+
+  // Count the polygons overlapping each bin, then fill the bins
+  m_BinStart.assign(n_bins + 1, 0);
+  for(c = 0; c < n_cells; c++)
+    for(vtkIdType b = bin_of(m_CellMin[c]); b <= bin_of(m_CellMax[c]); b++)
+      m_BinStart[b + 1]++;
+  for(vtkIdType b = 0; b < n_bins; b++)
+    m_BinStart[b + 1] += m_BinStart[b];
+
+  m_BinCells.resize(m_BinStart[n_bins]);
+  std::vector<vtkIdType> fill(m_BinStart.begin(), m_BinStart.end() - 1);
+  for(c = 0; c < n_cells; c++)
+    for(vtkIdType b = bin_of(m_CellMin[c]); b <= bin_of(m_CellMax[c]); b++)
+      m_BinCells[fill[b]++] = c;
+
+  // The submesh shares the points of the mesh
+  m_SubMesh = vtkSmartPointer<vtkPolyData>::New();
+  m_SubMesh->SetPoints(points);
+  m_SubMesh->SetPolys(vtkSmartPointer<vtkCellArray>::New());
+
+  return true;
+}
+
+void
+PlaneCutterAssembly::ExtractCandidates(double d)
+{
+  vtkNew<vtkCellArray> cells;
+  vtkIdType n_bins = (vtkIdType) m_BinStart.size() - 1;
+  double lo = m_BinOrigin, hi = m_BinOrigin + n_bins * m_BinWidth;
+  if(d >= lo && d <= hi)
+  {
+    vtkIdType b = std::min(n_bins - 1, (vtkIdType) ((d - m_BinOrigin) / m_BinWidth));
+    vtkIdType npts;
+    const vtkIdType *pts;
+    auto it = vtkSmartPointer<vtkCellArrayIterator>::Take(m_IndexedMesh->GetPolys()->NewIterator());
+    for(vtkIdType k = m_BinStart[b]; k < m_BinStart[b + 1]; k++)
+    {
+      vtkIdType c = m_BinCells[k];
+      if(m_CellMin[c] <= d && m_CellMax[c] >= d)
+      {
+        it->GetCellAtId(c, npts, pts);
+        cells->InsertNextCell(npts, pts);
+      }
+    }
+  }
+
+  m_SubMesh->SetPolys(cells);
+}
+
 vtkPolyData *
 PolyDataWrapper::GetIntersectionWithSlicePlane(DisplaySliceIndex            index,
                                                const DisplayViewportGeometryType *geometry)
@@ -53,7 +171,6 @@ PolyDataWrapper::GetIntersectionWithSlicePlane(DisplaySliceIndex            inde
   }
 
   // Configure the plane
-  // TODO: check if these have actually changed from the last call to the pipeline!
   auto plane = cut_assembly->m_Plane;
 
   // Origin is modified to account for the RAS/LPS transformation
@@ -64,12 +181,13 @@ PolyDataWrapper::GetIntersectionWithSlicePlane(DisplaySliceIndex            inde
 
   // auto origin_lps = geometry->GetOrigin();
   // plane->SetOrigin(-origin_lps[0], -origin_lps[1], origin_lps[2]);
-  plane->SetOrigin(-lps0[0], -lps0[1], lps0[2]);
+  Vector3d origin(-lps0[0], -lps0[1], lps0[2]);
+  plane->SetOrigin(origin.data_block());
 
   // The normal is just the z direction
-  vnl_vector_fixed<double, 3> n_lps(lps1[0] - lps0[0], lps1[1] - lps0[1], lps1[2] - lps0[2]);
-  n_lps.normalize();
-  plane->SetNormal(-n_lps[0], -n_lps[1], n_lps[2]);
+  Vector3d normal(-(lps1[0] - lps0[0]), -(lps1[1] - lps0[1]), lps1[2] - lps0[2]);
+  normal.normalize();
+  plane->SetNormal(normal.data_block());
 
   /*
   auto dir_lps = geometry->GetDirection().GetVnlMatrix().get_row(2);
@@ -78,12 +196,39 @@ PolyDataWrapper::GetIntersectionWithSlicePlane(DisplaySliceIndex            inde
   plane->SetNormal(dir_ras[0], dir_ras[1], dir_ras[2]);
   */
 
-  // Perform the cutting
-  cut_assembly->m_Cutter->SetInputData(m_PolyData);
+  // Cut the whole mesh if it cannot be indexed
+  if(!cut_assembly->UpdateIndex(m_PolyData, normal))
+  {
+    cut_assembly->m_Cutter->SetInputData(m_PolyData);
+    cut_assembly->m_Stripper->UpdateWholeExtent();
+    return dynamic_cast<vtkPolyData *>(cut_assembly->m_Stripper->GetOutput());
+  }
+
+  // Reuse the contour if this position was visited recently
+  double d = dot_product(normal, origin);
+  auto &cache = cut_assembly->m_ContourCache;
+  for(auto it = cache.begin(); it != cache.end(); ++it)
+  {
+    if(it->first == d)
+    {
+      cache.splice(cache.end(), cache, it);
+      return cache.back().second;
+    }
+  }
+
+  // Cut only the polygons that straddle the plane
+  cut_assembly->ExtractCandidates(d);
+  cut_assembly->m_Cutter->SetInputData(cut_assembly->m_SubMesh);
   cut_assembly->m_Stripper->UpdateWholeExtent();
 
-  // Return the resulting polydata
-  return dynamic_cast<vtkPolyData *>(cut_assembly->m_Stripper->GetOutput());
+  // Keep a copy of the contour, since the pipeline output is reused
+  vtkSmartPointer<vtkPolyData> contour = vtkSmartPointer<vtkPolyData>::New();
+  contour->DeepCopy(dynamic_cast<vtkPolyData *>(cut_assembly->m_Stripper->GetOutput()));
+  if(cache.size() >= PlaneCutterAssembly::CONTOUR_CACHE_SIZE)
+    cache.pop_front();
+  cache.push_back(std::make_pair(d, contour));
+
+  return contour;
 }
 
 void
@@ -11,6 +11,8 @@
 #include "ColorMap.h"
 #include "ThreadedHistogramImageFilter.h"
 #include "vtkPolyData.h"
+#include <list>
+#include <vector>
 
 class AbstractMeshIODelegate;
 class MeshDisplayMappingPolicy;
@@ -24,17 +26,58 @@ namespace itk {
 template <unsigned int VDim> class ImageBase;
 }
 
+/**
+ * Pipeline that cuts a mesh with one of the display slice planes. To avoid
+ * cutting the whole mesh each time the slice moves, the polygons are indexed
+ * by their extent along the plane normal: the range of the mesh along the
+ * normal is split into bins, and each bin lists the polygons that overlap it.
+ * Only the polygons that straddle the plane are passed to the cutter. The
+ * index is rebuilt when the mesh or the direction of the normal changes, and
+ * the contours for recently visited slice positions are cached.
+ */
 class PlaneCutterAssembly : public itk::Object
 {
 public:
   irisITKObjectMacro(PlaneCutterAssembly, itk::Object);
   friend class PolyDataWrapper;
+
+  /** Number of slice positions for which contours are cached */
+  static constexpr unsigned int CONTOUR_CACHE_SIZE = 32;
+
 protected:
+  PlaneCutterAssembly() {}
+  virtual ~PlaneCutterAssembly() {}
+
+  /** Index the polygons of the mesh along the normal. Returns false if the
+   * mesh has cells other than polygons, which are not indexed */
+  bool UpdateIndex(vtkPolyData *mesh, const Vector3d &normal);
+
+  /** Fill the submesh with the polygons that straddle the plane n.x = d */
+  void ExtractCandidates(double d);
 
   vtkSmartPointer<vtkPlaneCutter> m_Cutter;
   vtkSmartPointer<vtkPlane> m_Plane;
   vtkSmartPointer<vtkStripper> m_Stripper;
   vtkSmartPointer<vtkCleanPolyData> m_Cleaner;
+
+  // The mesh, normal and mesh modified time for which the index was built
+  vtkPolyData *m_IndexedMesh = nullptr;
+  vtkMTimeType m_IndexedMeshMTime = 0;
+  Vector3d m_IndexedNormal;
+  bool m_IndexValid = false;
+
+  // Polygon extents along the normal
+  std::vector<double> m_CellMin, m_CellMax;
+
+  // Bins along the normal, storing the ids of overlapping polygons
+  double m_BinOrigin = 0.0, m_BinWidth = 1.0;
+  std::vector<vtkIdType> m_BinStart, m_BinCells;
+
+  // The part of the mesh near the plane, which shares the mesh points
+  vtkSmartPointer<vtkPolyData> m_SubMesh;
+
+  // Contours for recently visited plane positions, oldest first
+  std::list<std::pair<double, vtkSmartPointer<vtkPolyData>>> m_ContourCache;
 };
 
 /**
@@ -43,11 +43,22 @@
 // SNAP includes
 #include "IRISVectorTypesToITKConversion.h"
 #include "VTKMeshPipeline.h"
+#include "MultiLabelSurfaceExtractor.h"
 #include "MeshOptions.h"
+#include "LabelImageWrapper.h"
+#include "SNAPInstrumentation.h"
+#include "TaskExecutionService.h"
 #include "vtkUnsignedShortArray.h"
+#include "vtkAppendPolyData.h"
+#include "vtkCleanPolyData.h"
+#include "vtkPolyDataNormals.h"
 
 // ITK includes
 #include "itkBinaryThresholdImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
@@ -73,6 +84,12 @@ MultiLabelMeshPipeline
   // Set the initial mesh options
   m_MeshOptions = MeshOptions::New();
   m_VTKPipeline->SetMeshOptions(m_MeshOptions);
+
+  // The single-pass engine used when all labels are extracted at once
+  m_SurfaceExtractor = MultiLabelSurfaceExtractor::New();
+  m_SurfaceExtractor->SetMeshOptions(m_MeshOptions);
+
+  m_InputMTimeAtLastUpdate = 0;
 }
 
 MultiLabelMeshPipeline
@@ -93,6 +110,7 @@ MultiLabelMeshPipeline
 
     // Apply the options to the internal pipeline
     m_VTKPipeline->SetMeshOptions(m_MeshOptions);
+    m_SurfaceExtractor->SetMeshOptions(m_MeshOptions);
 
     // Clear the cached stuff
     m_MeshInfo.clear();
@@ -140,6 +158,7 @@ MultiLabelMeshPipeline
   m_ThrehsoldFilter->UpdateLargestPossibleRegion();
 
   // Graft the polydata to the last filter in the pipeline
+  m_VTKPipeline->ClearBlockExtent();
   m_VTKPipeline->SetImage(m_ThrehsoldFilter->GetOutput());
   m_VTKPipeline->ComputeMesh(outMesh, label);
 
@@ -201,8 +220,11 @@ void MultiLabelMeshPipeline::UpdateMeshInfoHelper(
   current_meshinfo->Count += run_length;
 }
 
-void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
+void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand,
+                                          TaskCancellationToken *token)
 {
+  irisInstrumentScopeMacro("Mesh", "Label mesh update");
+
   // Create a temporary table of mesh info
   MeshInfoMap meshmap;
 
@@ -262,6 +284,9 @@ void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
   SmartPtr<AllPurposeProgressAccumulator> progress = AllPurposeProgressAccumulator::New();
   progress->AddObserver(itk::ProgressEvent(), progressCommand);
 
+  // Are all the labels extracted in one pass?
+  bool one_pass = m_MeshOptions->GetUseMultiLabelSurfaceExtraction();
+
   // Next we check which meshes are new or updated and mark them as needing to
   // be recomputed
   for(MeshInfoMap::const_iterator it = meshmap.begin(); it != meshmap.end(); ++it)
@@ -272,6 +297,14 @@ void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
     // Compare the values
     if(info.Count != it->second.Count || info.CheckSum != it->second.CheckSum)
       {
+      // If the label has been meshed before and we know where it was
+      // modified, only the blocks around the modified region are recomputed
+      info.ModifiedRegion = InputImageType::RegionType();
+      if(info.Mesh && m_ModifiedRegions)
+        info.ModifiedRegion = m_ModifiedRegions->GetRegionForLabel(it->first);
+      if(info.ModifiedRegion.GetNumberOfPixels() == 0)
+        info.BlockMeshes.clear();
+
       // Cache the current information
       info.CheckSum = it->second.CheckSum;
       info.Count = it->second.Count;
@@ -282,55 +315,378 @@ void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
       //auto src = m_VTKPipeline->GetProgressAccumulator();
 
       // Capture progress from this mesh
-      progress->RegisterSource(m_VTKPipeline->GetProgressAccumulator(), info.Count);
+      if(!one_pass)
+        progress->RegisterSource(m_VTKPipeline->GetProgressAccumulator(), info.Count);
       }
     }
 
+  // The ITK filters of the per-label pipeline observe the cancellation token
+  if(token)
+    {
+    token->WatchFilter(m_ROIFilter);
+    token->WatchFilter(m_ThrehsoldFilter);
+    }
+
+  // The labels that are remeshed below. If the update is cancelled, those
+  // that were not completed are dropped, so that they are remeshed next time
+  std::set<LabelType> pending;
+  for(auto &it : m_MeshInfo)
+    if(it.second.Mesh == NULL)
+      pending.insert(it.first);
+
   // Now compute the meshes
-  for(MeshInfoMap::iterator it = m_MeshInfo.begin(); it != m_MeshInfo.end(); it++)
+  try
     {
-    if(it->second.Mesh == NULL)
+    if(one_pass)
       {
-      // Create the mesh
-      MeshInfo &mi = it->second;
-      mi.Mesh = vtkSmartPointer<vtkPolyData>::New();
+      progress->RegisterSource(m_SurfaceExtractor->GetProgressAccumulator(), 1.0);
+      this->UpdateMeshesInOnePass();
+      progress->StartNextRun(m_SurfaceExtractor->GetProgressAccumulator());
+      if(token)
+        token->ThrowIfCancelled();
+      pending.clear();
+      }
+    else
+      {
+      for(LabelType label : std::set<LabelType>(pending))
+        {
+        MeshInfo &mi = m_MeshInfo[label];
+
+        // Number of blocks spanned by the bounding box
+        unsigned long n_blocks = 1;
+        for(int d = 0; d < 3; d++)
+          n_blocks *= 1 + (mi.BoundingBox[1][d] - mi.BoundingBox[0][d]) / BLOCK_SIZE;
+
+        if(mi.BlockMeshes.size())
+          {
+          // Incremental update of the blocks around the edited region
+          this->UpdateBlockMeshes(label, mi, mi.ModifiedRegion, token);
+          }
+        else if(mi.ModifiedRegion.GetNumberOfPixels() > 0
+                && n_blocks >= MIN_BLOCKS_FOR_BLOCK_MESHING)
+          {
+          // First edit of a large label: compute all the blocks, so that this
+          // and later edits can be incremental. The first meshing of a label
+          // is always done in one piece
+          this->UpdateBlockMeshes(label, mi, m_InputImage->GetLargestPossibleRegion(), token);
+          }
+        else
+          {
+          this->ComputeWholeMesh(label, mi, token);
+          }
+
+        if(token)
+          token->ThrowIfCancelled();
+        pending.erase(label);
+
+        // Update progress
+        progress->StartNextRun(m_VTKPipeline->GetProgressAccumulator());
+        }
+      }
+    }
+  catch(...)
+    {
+    for(LabelType label : pending)
+      m_MeshInfo.erase(label);
+    progress->UnregisterAllSources();
+    throw;
+    }
 
-      // TODO: make this more elegant
-      InputImageType::RegionType bbWiderRegion;
-      for(int d = 0; d < 3; d++)
+  // Clean up the progress
+  progress->UnregisterAllSources();
+
+  // The modified regions have been used up
+  m_ModifiedRegions.reset();
+  m_InputMTimeAtLastUpdate = m_InputImage->GetMTime();
+
+  // Set the modified flag, so we can use the pipeline's MTime
+  this->Modified();
+}
+
+int
+MultiLabelMeshPipeline
+::GetMeshingMargin() const
+{
+  // The margin must cover the support of the Gaussian kernel (the VTK filter
+  // uses a radius of 1.5 sigma), so that block faces are smoothed identically
+  // on both sides
+  int margin = 5;
+  if(m_MeshOptions->GetUseGaussianSmoothing())
+    margin = std::max(margin, 2 + (int) std::ceil(1.5 * m_MeshOptions->GetGaussianStandardDeviation()));
+  return margin;
+}
+
+void
+MultiLabelMeshPipeline
+::ComputeWholeMesh(LabelType label, MeshInfo &mi, TaskCancellationToken *token)
+{
+  // Create the mesh
+  mi.Mesh = vtkSmartPointer<vtkPolyData>::New();
+  mi.BlockMeshes.clear();
+
+  // TODO: make this more elegant
+  InputImageType::RegionType bbWiderRegion;
+  for(int d = 0; d < 3; d++)
+    {
+    unsigned long len =
+        (unsigned long) (1 + mi.BoundingBox[1][d] - mi.BoundingBox[0][d]);
+    bbWiderRegion.SetIndex(d, mi.BoundingBox[0][d]);
+    bbWiderRegion.SetSize(d, len);
+    }
+  bbWiderRegion.PadByRadius(5);
+  bbWiderRegion.Crop(m_InputImage->GetLargestPossibleRegion());
+
+  // Pass the region to the ROI filter and propagate the filter
+  m_ROIFilter->SetInput(m_InputImage);
+  m_ROIFilter->SetRegionOfInterest(bbWiderRegion);
+  m_ROIFilter->Update();
+
+  // Set the parameters for the thresholding filter
+  m_ThrehsoldFilter->SetLowerThreshold(label);
+  m_ThrehsoldFilter->SetUpperThreshold(label);
+  m_ThrehsoldFilter->UpdateLargestPossibleRegion();
+
+  // Graft the polydata to the last filter in the pipeline
+  m_VTKPipeline->ClearBlockExtent();
+  m_VTKPipeline->SetImage(m_ThrehsoldFilter->GetOutput());
+  m_VTKPipeline->ComputeMesh(mi.Mesh, label, nullptr, token);
+}
+
+bool
+MultiLabelMeshPipeline
+::IsLabelPresentInRegion(LabelType label, const itk::ImageRegion<3> &region) const
+{
+  // Scan the run-length encoded lines that cross the region
+  typedef InputImageType::BufferType BufferType;
+  BufferType *buffer = m_InputImage->GetBuffer();
+  itk::ImageRegionConstIterator<BufferType> it(buffer, InputImageType::truncateRegion(region));
+
+  long x0 = region.GetIndex(0), x1 = region.GetUpperIndex()[0];
+  long line_start = m_InputImage->GetBufferedRegion().GetIndex(0);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    const InputImageType::RLLine &line = it.Value();
+    long t = line_start;
+    for(size_t x = 0; x < line.size() && t <= x1; x++)
+      {
+      long t_next = t + line[x].first;
+      if(line[x].second == label && t_next > x0)
+        return true;
+      t = t_next;
+      }
+    }
+
+  return false;
+}
+
+void
+MultiLabelMeshPipeline
+::UpdateBlockMeshes(LabelType label, MeshInfo &mi,
+                    const itk::ImageRegion<3> &modified,
+                    TaskCancellationToken *token)
+{
+  typedef InputImageType::RegionType RegionType;
+  RegionType lpr = m_InputImage->GetLargestPossibleRegion();
+  int margin = this->GetMeshingMargin();
+
+  // Dimensions of the block grid
+  unsigned long n_blocks[3];
+  for(int d = 0; d < 3; d++)
+    n_blocks[d] = (lpr.GetSize(d) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  // The region where the surface of the label can be found
+  RegionType active;
+  for(int d = 0; d < 3; d++)
+    {
+    active.SetIndex(d, mi.BoundingBox[0][d]);
+    active.SetSize(d, 1 + mi.BoundingBox[1][d] - mi.BoundingBox[0][d]);
+    }
+  active.PadByRadius(margin);
+  active.Crop(lpr);
+
+  // The region where the surface may have changed. Smoothing spreads the
+  // effect of an edit by the margin
+  RegionType affected = modified;
+  affected.PadByRadius(margin + 1);
+  if(!affected.Crop(active))
+    affected = RegionType();
+
+  // Drop blocks that are no longer within the bounding box of the label
+  for(auto bit = mi.BlockMeshes.begin(); bit != mi.BlockMeshes.end(); )
+    {
+    unsigned long key = bit->first;
+    RegionType block;
+    block.SetIndex(0, lpr.GetIndex(0) + (key % n_blocks[0]) * BLOCK_SIZE);
+    block.SetIndex(1, lpr.GetIndex(1) + ((key / n_blocks[0]) % n_blocks[1]) * BLOCK_SIZE);
+    block.SetIndex(2, lpr.GetIndex(2) + (key / (n_blocks[0] * n_blocks[1])) * BLOCK_SIZE);
+    block.SetSize({{BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE}});
+    if(block.Crop(active))
+      ++bit;
+    else
+      mi.BlockMeshes.erase(bit++);
+    }
+
+  // Recompute the affected blocks
+  if(affected.GetNumberOfPixels() > 0)
+    {
+    unsigned long b0[3], b1[3];
+    for(int d = 0; d < 3; d++)
+      {
+      b0[d] = (affected.GetIndex(d) - lpr.GetIndex(d)) / BLOCK_SIZE;
+      b1[d] = (affected.GetUpperIndex()[d] - lpr.GetIndex(d)) / BLOCK_SIZE;
+      }
+
+    for(unsigned long bz = b0[2]; bz <= b1[2]; bz++)
+      {
+      for(unsigned long by = b0[1]; by <= b1[1]; by++)
         {
-        unsigned long len =
-            (unsigned long) (1 + mi.BoundingBox[1][d] - mi.BoundingBox[0][d]);
-        bbWiderRegion.SetIndex(d, mi.BoundingBox[0][d]);
-        bbWiderRegion.SetSize(d, len);
+        for(unsigned long bx = b0[0]; bx <= b1[0]; bx++)
+          {
+          unsigned long key = bx + n_blocks[0] * (by + n_blocks[1] * bz);
+
+          // The points passed to marching cubes: the voxels of the block plus
+          // the first layer of the next block, so that the cells of adjacent
+          // blocks tile the image without gaps
+          RegionType voi;
+          voi.SetIndex(0, lpr.GetIndex(0) + bx * BLOCK_SIZE);
+          voi.SetIndex(1, lpr.GetIndex(1) + by * BLOCK_SIZE);
+          voi.SetIndex(2, lpr.GetIndex(2) + bz * BLOCK_SIZE);
+          voi.SetSize({{BLOCK_SIZE + 1, BLOCK_SIZE + 1, BLOCK_SIZE + 1}});
+          voi.Crop(lpr);
+
+          // The input region, padded so smoothing near the faces is exact
+          RegionType roi = voi;
+          roi.PadByRadius(margin);
+          roi.Crop(lpr);
+
+          // Skip blocks where the surface cannot be present
+          if(!this->IsLabelPresentInRegion(label, roi))
+            {
+            mi.BlockMeshes.erase(key);
+            continue;
+            }
+
+          m_ROIFilter->SetInput(m_InputImage);
+          m_ROIFilter->SetRegionOfInterest(roi);
+          m_ROIFilter->Update();
+
+          m_ThrehsoldFilter->SetLowerThreshold(label);
+          m_ThrehsoldFilter->SetUpperThreshold(label);
+          m_ThrehsoldFilter->UpdateLargestPossibleRegion();
+
+          // The extent of the block relative to the ROI
+          int extent[6];
+          for(int d = 0; d < 3; d++)
+            {
+            extent[2*d] = voi.GetIndex(d) - roi.GetIndex(d);
+            extent[2*d+1] = voi.GetUpperIndex()[d] - roi.GetIndex(d);
+            }
+
+          vtkSmartPointer<vtkPolyData> block_mesh = vtkSmartPointer<vtkPolyData>::New();
+          m_VTKPipeline->SetBlockExtent(extent);
+          m_VTKPipeline->SetImage(m_ThrehsoldFilter->GetOutput());
+          m_VTKPipeline->ComputeMesh(block_mesh, label, nullptr, token);
+
+          if(block_mesh->GetNumberOfPoints() > 0)
+            mi.BlockMeshes[key] = block_mesh;
+          else
+            mi.BlockMeshes.erase(key);
+          }
         }
-      bbWiderRegion.PadByRadius(5);
-      bbWiderRegion.Crop(m_InputImage->GetLargestPossibleRegion());
+      }
+    }
 
-      // Pass the region to the ROI filter and propagate the filter
-      m_ROIFilter->SetInput(m_InputImage);
-      m_ROIFilter->SetRegionOfInterest(bbWiderRegion);
-      m_ROIFilter->Update();
+  // Stitch the blocks together. Neighboring blocks both generate the points
+  // on their common face, so these are merged to make the mesh watertight
+  vtkSmartPointer<vtkAppendPolyData> append = vtkSmartPointer<vtkAppendPolyData>::New();
+  for(auto &bit : mi.BlockMeshes)
+    append->AddInputData(bit.second);
+
+  vtkSmartPointer<vtkCleanPolyData> clean = vtkSmartPointer<vtkCleanPolyData>::New();
+  clean->SetInputConnection(append->GetOutputPort());
+  clean->PointMergingOn();
+  clean->SetTolerance(0.0);
+
+  // The normals of each block only see the block, so they differ on the two
+  // sides of a face and the merged points keep just one of them. Recompute
+  // them on the stitched mesh so the shading is continuous across blocks
+  vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+  normals->SetInputConnection(clean->GetOutputPort());
+  normals->SplittingOff();
+  normals->ConsistencyOff();
+  normals->ComputePointNormalsOn();
+  normals->ComputeCellNormalsOff();
+
+  mi.Mesh = vtkSmartPointer<vtkPolyData>::New();
+  if(mi.BlockMeshes.size())
+    {
+    normals->Update();
+    mi.Mesh->ShallowCopy(normals->GetOutput());
+    }
+
+  mi.ModifiedRegion = RegionType();
+}
+
+void
+MultiLabelMeshPipeline
+::SetModifiedRegions(const LabelImageModifiedRegions &regions)
+{
+  m_ModifiedRegions.reset(new LabelImageModifiedRegions(regions));
+}
 
-      // Set the parameters for the thresholding filter
-      m_ThrehsoldFilter->SetLowerThreshold(it->first);
-      m_ThrehsoldFilter->SetUpperThreshold(it->first);
-      m_ThrehsoldFilter->UpdateLargestPossibleRegion();
+void
+MultiLabelMeshPipeline
+::UpdateMeshesInOnePass()
+{
+  // Collect the labels that need to be remeshed and the region containing them
+  std::set<LabelType> labels;
+  InputImageType::RegionType region;
+  for(auto &it : m_MeshInfo)
+    {
+    if(it.second.Mesh == NULL)
+      {
+      InputImageType::RegionType bbox;
+      for(int d = 0; d < 3; d++)
+        {
+        bbox.SetIndex(d, it.second.BoundingBox[0][d]);
+        bbox.SetSize(d, 1 + it.second.BoundingBox[1][d] - it.second.BoundingBox[0][d]);
+        }
 
-      // Graft the polydata to the last filter in the pipeline
-      m_VTKPipeline->SetImage(m_ThrehsoldFilter->GetOutput());
-      m_VTKPipeline->ComputeMesh(it->second.Mesh, it->first);
+      if(labels.empty())
+        {
+        region = bbox;
+        }
+      else
+        {
+        InputImageType::IndexType lower, upper;
+        for(int d = 0; d < 3; d++)
+          {
+          lower[d] = std::min(region.GetIndex(d), bbox.GetIndex(d));
+          upper[d] = std::max(region.GetUpperIndex()[d], bbox.GetUpperIndex()[d]);
+          }
+        region.SetIndex(lower);
+        region.SetUpperIndex(upper);
+        }
 
-      // Update progress
-      progress->StartNextRun(m_VTKPipeline->GetProgressAccumulator());
+      labels.insert(it.first);
       }
     }
 
-  // Clean up the progress
-  progress->UnregisterAllSources();
+  if(labels.empty())
+    return;
 
-  // Set the modified flag, so we can use the pipeline's MTime
-  this->Modified();
+  // Extract all the surfaces at once
+  MultiLabelSurfaceExtractor::MeshCollection meshes;
+  m_SurfaceExtractor->SetImage(m_InputImage);
+  m_SurfaceExtractor->ComputeMeshes(labels, region, meshes);
+
+  for(auto &it : meshes)
+    {
+    MeshInfo &mi = m_MeshInfo[it.first];
+    mi.Mesh = it.second;
+    mi.BlockMeshes.clear();
+    mi.ModifiedRegion = InputImageType::RegionType();
+    }
 }
 
 void 
@@ -341,6 +697,8 @@ MultiLabelMeshPipeline
     {
     m_InputImage = image;
     m_MeshInfo.clear();
+    m_ModifiedRegions.reset();
+    m_InputMTimeAtLastUpdate = 0;
     }
 }
 
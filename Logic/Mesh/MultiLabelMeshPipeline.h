@@ -44,6 +44,8 @@
 #include "ImageWrapperTraits.h"
 #include "RLERegionOfInterestImageFilter.h"
 #include "RLEImageScanlineIterator.h"
+#include <memory>
+#include <set>
 
 
 // Forward reference to itk classes
@@ -57,8 +59,11 @@ namespace itk {
 // Forward references
 class MeshOptions;
 class VTKMeshPipeline;
+class MultiLabelSurfaceExtractor;
 class vtkPolyData;
 class AllPurposeProgressAccumulator;
+class TaskCancellationToken;
+struct LabelImageModifiedRegions;
 
 
 /**
@@ -70,6 +75,16 @@ class AllPurposeProgressAccumulator;
  * whether it has been updated relative to the corresponding mesh. This makes
  * it possible for selective mesh recomputation, leading to fast mesh computation
  * even for big segmentations.
+ *
+ * Each label is first meshed in one piece. When a label with a large bounding
+ * box is edited and the modified regions are known (see SetModifiedRegions),
+ * it is remeshed in blocks of fixed size and the mesh is stitched together
+ * from the block meshes. Later edits then only recompute the blocks near the
+ * modified regions.
+ *
+ * Alternatively (see MeshOptions::GetUseMultiLabelSurfaceExtraction), all the
+ * labels that need updating are extracted together in a single pass over the
+ * image by MultiLabelSurfaceExtractor.
  */
 class MultiLabelMeshPipeline : public itk::Object
 {
@@ -90,6 +105,13 @@ public:
     // The number of voxels
     unsigned long Count;
 
+    // For labels meshed in blocks, the meshes of the non-empty blocks, keyed
+    // by the position of the block in a grid aligned with the image
+    std::map<unsigned long, vtkSmartPointer<vtkPolyData> > BlockMeshes;
+
+    // Region modified since the mesh was last computed (for block updates)
+    itk::ImageRegion<3> ModifiedRegion;
+
     MeshInfo();
     ~MeshInfo();
   };
@@ -129,8 +151,24 @@ public:
    * the color label is not present in the image */
   bool ComputeMesh(LabelType label, vtkPolyData *outData);
 
-  /** Update the meshes */
-  void UpdateMeshes(itk::Command *progressCommand);
+  /**
+   * Specify the regions of the image modified since the last call to
+   * UpdateMeshes(). This is optional, and makes it possible to only remesh
+   * the blocks affected by the edits. The information is used by the next
+   * call to UpdateMeshes() and then discarded.
+   */
+  void SetModifiedRegions(const LabelImageModifiedRegions &regions);
+
+  /** Get the modified time of the input image at the last mesh update */
+  itk::ModifiedTimeType GetInputMTimeAtLastUpdate() const
+    { return m_InputMTimeAtLastUpdate; }
+
+  /**
+   * Update the meshes. If a cancellation token is given, the filters are
+   * aborted when it is cancelled, and TaskCancelledException is thrown. The
+   * labels whose meshes were not completed are then remeshed next time.
+   */
+  void UpdateMeshes(itk::Command *progressCommand, TaskCancellationToken *token = nullptr);
 
   /** Get the collection of computed meshes */
   std::map<LabelType, vtkSmartPointer<vtkPolyData> > GetMeshCollection();
@@ -184,6 +222,41 @@ private:
   // The VTK pipeline
   VTKMeshPipeline *           m_VTKPipeline;
 
+  // Engine for extracting the surfaces of all labels in one pass
+  SmartPtr<MultiLabelSurfaceExtractor> m_SurfaceExtractor;
+
+  // Regions modified since the last update, if known
+  std::unique_ptr<LabelImageModifiedRegions> m_ModifiedRegions;
+
+  // Modified time of the input at last update
+  itk::ModifiedTimeType       m_InputMTimeAtLastUpdate;
+
+  // Size of the blocks used for block-wise meshing
+  static constexpr unsigned int BLOCK_SIZE = 64;
+
+  // Labels whose bounding box spans at least this many blocks are remeshed
+  // block-wise after edits. All labels are meshed in one piece the first
+  // time, and smaller labels always are
+  static constexpr unsigned int MIN_BLOCKS_FOR_BLOCK_MESHING = 8;
+
+  // Compute the mesh for a label in one piece
+  void ComputeWholeMesh(LabelType label, MeshInfo &mi, TaskCancellationToken *token);
+
+  // Recompute the blocks of a label that intersect the modified region, and
+  // stitch the blocks into the mesh for the label
+  void UpdateBlockMeshes(LabelType label, MeshInfo &mi,
+                         const itk::ImageRegion<3> &modified,
+                         TaskCancellationToken *token);
+
+  // Compute the meshes of all labels that need updating in a single pass
+  void UpdateMeshesInOnePass();
+
+  // Number of voxels by which the input to the VTK pipeline is padded
+  int GetMeshingMargin() const;
+
+  // Check if a label is present in a region of the input image
+  bool IsLabelPresentInRegion(LabelType label, const itk::ImageRegion<3> &region) const;
+
   // Helper routine for the update command
   void UpdateMeshInfoHelper(
       MeshInfo *current_meshinfo,
@@ -0,0 +1,323 @@
+#include "MultiLabelSurfaceExtractor.h"
+#include "MeshOptions.h"
+#include "ImageWrapperBase.h"
+#include "SNAPInstrumentation.h"
+#include "itkMultiThreaderBase.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDecimatePro.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSurfaceNets3D.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+MultiLabelSurfaceExtractor
+::MultiLabelSurfaceExtractor()
+{
+  m_MeshOptions = MeshOptions::New();
+  m_Transform = vtkSmartPointer<vtkTransform>::New();
+
+  // Surface nets produces triangles and, for each triangle, the pair of labels
+  // on either side of it (cell scalars named BoundaryLabels)
+  m_SurfaceNets = vtkSmartPointer<vtkSurfaceNets3D>::New();
+  m_SurfaceNets->SetBackgroundLabel(0);
+  m_SurfaceNets->SetOutputMeshTypeToTriangles();
+  m_SurfaceNets->SetOutputStyleToSelected();
+  m_SurfaceNets->ComputeScalarsOn();
+
+  m_Progress = AllPurposeProgressAccumulator::New();
+  m_Progress->RegisterSource(m_SurfaceNets, 10.0f);
+}
+
+MultiLabelSurfaceExtractor
+::~MultiLabelSurfaceExtractor()
+{
+}
+
+void
+MultiLabelSurfaceExtractor
+::SetImage(const InputImageType *image)
+{
+  m_InputImage = image;
+
+  // The label volume uses the origin and spacing of the input image, so the
+  // same VTK to NIFTI transform applies as in VTKMeshPipeline
+  vnl_matrix_fixed<double, 4, 4> vtk2nii =
+    ImageWrapperBase::ConstructVTKtoNiftiTransform(image->GetDirection().GetVnlMatrix().as_ref(),
+                                                   image->GetOrigin().GetVnlVector(),
+                                                   image->GetSpacing().GetVnlVector());
+  m_Transform->SetMatrix(vtk2nii.data_block());
+}
+
+void
+MultiLabelSurfaceExtractor
+::SetMeshOptions(const MeshOptions *options)
+{
+  m_MeshOptions->DeepCopy(options);
+
+  // Gaussian smoothing of the binary image and Laplacian smoothing of the
+  // mesh both map onto the constrained smoothing of surface nets. The default
+  // Gaussian sigma (0.8) corresponds to the default number of iterations (16)
+  bool smooth = options->GetUseGaussianSmoothing() || options->GetUseMeshSmoothing();
+  m_SurfaceNets->SetSmoothing(smooth);
+  if(options->GetUseMeshSmoothing())
+    {
+    m_SurfaceNets->SetNumberOfIterations(options->GetMeshSmoothingIterations());
+    }
+  else if(options->GetUseGaussianSmoothing())
+    {
+    int iter = (int) std::ceil(20.0 * options->GetGaussianStandardDeviation());
+    m_SurfaceNets->SetNumberOfIterations(std::max(iter, 1));
+    }
+}
+
+void
+MultiLabelSurfaceExtractor
+::FillLabelVolume(const RegionType &region, vtkImageData *volume,
+                  std::set<LabelType> &present)
+{
+  static_assert(sizeof(LabelType) == sizeof(unsigned short),
+                "The label volume stores labels as VTK_UNSIGNED_SHORT");
+
+  // Allocate the volume, which may extend past the image by the padding
+  int extent[6];
+  for(int d = 0; d < 3; d++)
+    {
+    extent[2*d] = region.GetIndex(d);
+    extent[2*d+1] = region.GetUpperIndex()[d];
+    }
+  volume->SetExtent(extent);
+  volume->SetOrigin(m_InputImage->GetOrigin().GetDataPointer());
+  volume->SetSpacing(m_InputImage->GetSpacing().GetDataPointer());
+  volume->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+
+  LabelType *data = static_cast<LabelType *>(volume->GetScalarPointer());
+  long nx = region.GetSize(0), ny = region.GetSize(1);
+  std::memset(data, 0, sizeof(LabelType) * nx * ny * region.GetSize(2));
+
+  // The part of the region that is inside the image
+  RegionType inside = region;
+  if(!inside.Crop(m_InputImage->GetLargestPossibleRegion()))
+    return;
+
+  long x0 = inside.GetIndex(0), x1 = inside.GetUpperIndex()[0] + 1;
+  long line_start = m_InputImage->GetBufferedRegion().GetIndex(0);
+  const InputImageType::BufferType *buffer = m_InputImage->GetBuffer();
+
+  // Decode the runs, one z slice per work unit
+  std::mutex mutex;
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(
+        inside.GetIndex(2), inside.GetIndex(2) + inside.GetSize(2),
+        [&](itk::SizeValueType z)
+    {
+    std::set<LabelType> slice_labels;
+    for(long y = inside.GetIndex(1); y <= inside.GetUpperIndex()[1]; y++)
+      {
+      itk::Index<3> idx = {{ x0, y, (itk::IndexValueType) z }};
+      const InputImageType::RLLine &line =
+          buffer->GetPixel(InputImageType::truncateIndex(idx));
+
+      long iy = y - region.GetIndex(1), iz = (long) z - region.GetIndex(2);
+      LabelType *row = data + nx * (iy + ny * iz) - region.GetIndex(0);
+      long t = line_start;
+      for(size_t i = 0; i < line.size() && t < x1; i++)
+        {
+        long t_next = t + line[i].first;
+        LabelType label = line[i].second;
+        if(label != 0 && t_next > x0)
+          {
+          std::fill(row + std::max(t, x0), row + std::min(t_next, x1), label);
+          slice_labels.insert(label);
+          }
+        t = t_next;
+        }
+      }
+
+    std::lock_guard<std::mutex> guard(mutex);
+    present.insert(slice_labels.begin(), slice_labels.end());
+    }, nullptr);
+}
+
+void
+MultiLabelSurfaceExtractor
+::ComputeMeshes(const std::set<LabelType> &labels,
+                const RegionType &region,
+                MeshCollection &meshes)
+{
+  for(LabelType label : labels)
+    meshes[label] = vtkSmartPointer<vtkPolyData>::New();
+
+  if(labels.empty())
+    return;
+
+  // Pad the region by one voxel, so that surfaces touching the edge of the
+  // image are closed
+  RegionType padded = region;
+  padded.PadByRadius(1);
+
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  std::set<LabelType> present;
+  irisInstrumentNamedScopeMacro(tFill, "Mesh", "Surface nets label volume fill");
+  this->FillLabelVolume(padded, volume, present);
+  tFill.Stop();
+
+  // Every label present in the volume must be known to surface nets (other
+  // values are treated as background), but only the requested labels are
+  // output
+  m_SurfaceNets->SetNumberOfLabels(present.size());
+  int k = 0;
+  for(LabelType label : present)
+    m_SurfaceNets->SetLabel(k++, label);
+
+  m_SurfaceNets->InitializeSelectedLabelsList();
+  for(LabelType label : labels)
+    m_SurfaceNets->AddSelectedLabel(label);
+
+  m_Progress->ResetProgress();
+  m_SurfaceNets->SetInputData(volume);
+  irisInstrumentNamedScopeMacro(tNets, "Mesh", "Surface nets extraction");
+  m_SurfaceNets->Update();
+  tNets.Stop();
+
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->ShallowCopy(m_SurfaceNets->GetOutput());
+  m_SurfaceNets->SetInputData(nullptr);
+
+  if(surface->GetNumberOfPoints() == 0)
+    return;
+
+  // Map the shared points to patient coordinates once for all labels
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  m_Transform->TransformPoints(surface->GetPoints(), points);
+  surface->SetPoints(points);
+
+  irisInstrumentScopeMacro("Mesh", "Surface nets split by label");
+  this->SplitByLabel(surface, labels, meshes);
+}
+
+void
+MultiLabelSurfaceExtractor
+::SplitByLabel(vtkPolyData *surface, const std::set<LabelType> &labels,
+               MeshCollection &meshes)
+{
+  vtkDataArray *boundary = surface->GetCellData()->GetArray("BoundaryLabels");
+  if(!boundary)
+    boundary = surface->GetCellData()->GetScalars();
+
+  // Assign each triangle to the requested labels on either side of it. The
+  // triangles are oriented consistently with the order of the boundary labels,
+  // so a triangle is reversed for one of its two labels
+  typedef std::vector<vtkIdType> CellList;
+  std::map<LabelType, std::pair<CellList, CellList> > buckets;
+  for(LabelType label : labels)
+    buckets[label];
+
+  vtkIdType n_cells = surface->GetNumberOfCells();
+  for(vtkIdType i = 0; i < n_cells; i++)
+    {
+    LabelType l0 = (LabelType) boundary->GetComponent(i, 0);
+    LabelType l1 = (LabelType) boundary->GetComponent(i, 1);
+    auto b0 = buckets.find(l0);
+    if(b0 != buckets.end())
+      b0->second.first.push_back(i);
+    auto b1 = buckets.find(l1);
+    if(b1 != buckets.end())
+      b1->second.second.push_back(i);
+    }
+
+  std::vector<LabelType> label_list(labels.begin(), labels.end());
+  std::vector<vtkSmartPointer<vtkPolyData> > result(label_list.size());
+  vtkPoints *src_points = surface->GetPoints();
+  vtkCellArray *src_polys = surface->GetPolys();
+  const MeshOptions *options = m_MeshOptions;
+
+  // Build the mesh for each label with its own compacted set of points
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, label_list.size(), [&](itk::SizeValueType j)
+    {
+    const auto &bucket = buckets.at(label_list[j]);
+    vtkNew<vtkIdList> ids;
+
+    // Signed volume enclosed by the surface (the surface is closed), used to
+    // make the normals point outward, including when the transform is a flip
+    double volume = 0.0;
+    for(int side = 0; side < 2; side++)
+      {
+      const CellList &cells = side ? bucket.second : bucket.first;
+      for(vtkIdType c : cells)
+        {
+        src_polys->GetCellAtId(c, ids);
+        double p[3][3];
+        for(int q = 0; q < 3; q++)
+          src_points->GetPoint(ids->GetId(q), p[q]);
+        double det =
+            p[0][0] * (p[1][1] * p[2][2] - p[1][2] * p[2][1]) -
+            p[0][1] * (p[1][0] * p[2][2] - p[1][2] * p[2][0]) +
+            p[0][2] * (p[1][0] * p[2][1] - p[1][1] * p[2][0]);
+        volume += side ? -det : det;
+        }
+      }
+    bool flip_all = volume < 0.0;
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->AllocateEstimate(bucket.first.size() + bucket.second.size(), 3);
+    std::unordered_map<vtkIdType, vtkIdType> point_map;
+
+    for(int side = 0; side < 2; side++)
+      {
+      const CellList &cells = side ? bucket.second : bucket.first;
+      bool flip = (side == 1) != flip_all;
+      for(vtkIdType c : cells)
+        {
+        src_polys->GetCellAtId(c, ids);
+        vtkIdType tri[3];
+        for(int q = 0; q < 3; q++)
+          {
+          vtkIdType src_id = ids->GetId(q);
+          auto it = point_map.find(src_id);
+          if(it == point_map.end())
+            it = point_map.emplace(src_id, points->InsertNextPoint(src_points->GetPoint(src_id))).first;
+          tri[flip ? 2 - q : q] = it->second;
+          }
+        polys->InsertNextCell(3, tri);
+        }
+      }
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->SetPolys(polys);
+
+    // Optional decimation, same parameters as VTKMeshPipeline
+    if(options->GetUseDecimation() && polys->GetNumberOfCells() > 0)
+      {
+      vtkNew<vtkDecimatePro> decimate;
+      decimate->SetInputData(mesh);
+      decimate->SetTargetReduction(options->GetDecimateTargetReduction());
+      decimate->SetMaximumError(options->GetDecimateMaximumError());
+      decimate->SetFeatureAngle(options->GetDecimateFeatureAngle());
+      decimate->SetPreserveTopology(options->GetDecimatePreserveTopology());
+      decimate->Update();
+      mesh = vtkSmartPointer<vtkPolyData>::New();
+      mesh->ShallowCopy(decimate->GetOutput());
+      }
+
+    result[j] = mesh;
+    }, nullptr);
+
+  for(size_t j = 0; j < label_list.size(); j++)
+    meshes[label_list[j]] = result[j];
+}
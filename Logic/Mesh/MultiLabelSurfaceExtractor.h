@@ -0,0 +1,98 @@
+#ifndef MULTILABELSURFACEEXTRACTOR_H
+#define MULTILABELSURFACEEXTRACTOR_H
+
+#include "SNAPCommon.h"
+#include "ImageWrapperTraits.h"
+#include "AllPurposeProgressAccumulator.h"
+#include "itkImageRegion.h"
+#include "vtkSmartPointer.h"
+#include <map>
+#include <set>
+
+class MeshOptions;
+class vtkImageData;
+class vtkPolyData;
+class vtkSurfaceNets3D;
+class vtkTransform;
+
+/**
+ * \class MultiLabelSurfaceExtractor
+ * \brief Extracts the surfaces of many labels of a segmentation in one pass.
+ *
+ * The per-label pipeline (ROI, threshold, Gaussian, marching cubes) visits the
+ * bounding box of every label separately, so its cost grows with the number
+ * of labels times the volume of their bounding boxes. This class instead
+ * copies the run-length encoded segmentation into a single label volume (in
+ * parallel over z slabs) and extracts the boundaries of all the labels at
+ * once using the surface nets algorithm. Adjacent labels share the vertices
+ * on their common boundary. The output is then split into a separate mesh for
+ * each label, also in parallel.
+ *
+ * Gaussian and mesh smoothing in MeshOptions are mapped onto the constrained
+ * smoothing built into surface nets, and decimation is applied per label.
+ */
+class MultiLabelSurfaceExtractor : public itk::Object
+{
+public:
+
+  irisITKObjectMacro(MultiLabelSurfaceExtractor, itk::Object)
+
+  /** Input image type */
+  typedef LabelImageWrapperTraits::ImageType InputImageType;
+  typedef itk::ImageRegion<3> RegionType;
+
+  /** Output: a mesh for each label */
+  typedef std::map<LabelType, vtkSmartPointer<vtkPolyData> > MeshCollection;
+
+  /** Set the input segmentation image */
+  void SetImage(const InputImageType *image);
+
+  /** Set the mesh options */
+  void SetMeshOptions(const MeshOptions *options);
+
+  /**
+   * Compute the meshes for a set of labels. The region must contain all the
+   * voxels of these labels. Other labels present in the region are not meshed
+   * but still define the boundaries they share with the requested labels.
+   * Each requested label gets an entry in the output (possibly empty).
+   */
+  void ComputeMeshes(const std::set<LabelType> &labels,
+                     const RegionType &region,
+                     MeshCollection &meshes);
+
+  /** Get the progress accumulator */
+  AllPurposeProgressAccumulator *GetProgressAccumulator()
+    { return m_Progress; }
+
+protected:
+
+  MultiLabelSurfaceExtractor();
+  virtual ~MultiLabelSurfaceExtractor();
+
+  // Copy the labels in a region into a VTK image. The image is padded by one
+  // voxel of background outside of the segmentation, so that all surfaces are
+  // closed. Also returns the set of labels found in the region.
+  void FillLabelVolume(const RegionType &region, vtkImageData *volume,
+                       std::set<LabelType> &present);
+
+  // Split the output of surface nets into meshes for individual labels
+  void SplitByLabel(vtkPolyData *surface, const std::set<LabelType> &labels,
+                    MeshCollection &meshes);
+
+  // Current set of mesh options
+  SmartPtr<MeshOptions> m_MeshOptions;
+
+  // The input image
+  itk::SmartPointer<const InputImageType> m_InputImage;
+
+  // The surface extraction filter
+  vtkSmartPointer<vtkSurfaceNets3D> m_SurfaceNets;
+
+  // Transform from VTK coordinates to NIFTI/RAS coordinates
+  vtkSmartPointer<vtkTransform> m_Transform;
+
+  // Progress event monitor
+  AllPurposeProgressAccumulator::Pointer m_Progress;
+};
+
+#endif // MULTILABELSURFACEEXTRACTOR_H
@@ -25,14 +25,15 @@ GetPipeline()
 
 void
 SegmentationMeshAssembly::
-UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options)
+UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options,
+                   TaskCancellationToken *token)
 {
   // Get the image from current tp and feed the pipeline
   m_Pipeline->SetImage(img);
   m_Pipeline->SetMeshOptions(options);
 
   // Run the UpdateMesh for the current tp assembly
-  m_Pipeline->UpdateMeshes(progress);
+  m_Pipeline->UpdateMeshes(progress, token);
 
   // Post Update. Update mesh assmebly
   auto collection = m_Pipeline->GetMeshCollection();
@@ -134,7 +135,8 @@ CreateNewAssembly(unsigned int timepoint)
 }
 
 void
-SegmentationMeshWrapper::UpdateMeshes(itk::Command *progressCmd, unsigned int timepoint)
+SegmentationMeshWrapper::UpdateMeshes(itk::Command *progressCmd, unsigned int timepoint,
+                                      TaskCancellationToken *token)
 {
   if (!m_MeshAssemblyMap.count(timepoint))
     {
@@ -147,7 +149,7 @@ SegmentationMeshWrapper::UpdateMeshes(itk::Command *progressCmd, unsigned int ti
 
 
   auto img = m_ImagePointer->GetImageByTimePoint(timepoint);
-  assembly->UpdateMeshAssembly(progressCmd, img, m_MeshOptions);
+  assembly->UpdateMeshAssembly(progressCmd, img, m_MeshOptions, token);
 }
 
 void
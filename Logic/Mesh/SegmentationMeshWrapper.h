@@ -17,7 +17,8 @@ public:
 
   MultiLabelMeshPipeline *GetPipeline();
 
-  void UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options);
+  void UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options,
+                          TaskCancellationToken *token = nullptr);
 protected:
   SegmentationMeshAssembly();
   virtual ~SegmentationMeshAssembly();
@@ -60,7 +61,8 @@ public:
   //  End of virtual methods implementation
   //-----------------------------------------------------
 
-  void UpdateMeshes(itk::Command *progressCmd, unsigned int timepoint);
+  void UpdateMeshes(itk::Command *progressCmd, unsigned int timepoint,
+                    TaskCancellationToken *token = nullptr);
 
   void Initialize(LabelImageWrapper *segImg, MeshOptions* meshOptions);
 
@@ -37,8 +37,9 @@
 #include "ImageWrapper.h"
 #include "MeshOptions.h"
 #include "SNAPExportITKToVTK.h"
+#include "SNAPInstrumentation.h"
+#include "TaskExecutionService.h"
 #include <map>
-#include <chrono>
 #include <vtkCellArrayIterator.h>
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -176,6 +177,11 @@ VTKMeshPipeline
   m_MarchingCubesFilter->SetNumberOfContours(1);
   m_MarchingCubesFilter->SetValue(0,0.0f);
 
+  // Extent extraction for block-wise meshing
+  m_ExtractVOIFilter = vtkExtractVOI::New();
+  m_ExtractVOIFilter->ReleaseDataFlagOn();
+  m_BlockMode = false;
+
   // Face flip filter - much faster than vtkPolyDataNormals
   m_FlipPolyFaces = vtkFlipPolyFaces::New();
 
@@ -230,6 +236,14 @@ VTKMeshPipeline
     m_VTKGaussianFilter->SetRadiusFactors(1.5, 1.5, 1.5);
     }
 
+  // 1.5 In block mode, crop the (smoothed) image to the block
+  if(m_BlockMode)
+    {
+    m_ExtractVOIFilter->SetInputConnection(m_Pipeline.back()->GetOutputPort());
+    m_Progress->RegisterSource(m_ExtractVOIFilter, 1.0f);
+    m_Pipeline.push_back(m_ExtractVOIFilter);
+    }
+
   // 2. Set input to the appropriate contour filter
 
   // Marching cubes gets the tail
@@ -269,6 +283,9 @@ VTKMeshPipeline
     m_DecimateFilter->SetPreserveTopology(
       options->GetDecimatePreserveTopology());
 
+    // Vertices on the faces of a block are shared with the neighbor block
+    m_DecimateFilter->SetBoundaryVertexDeletion(!m_BlockMode);
+
     } // If decimate enabled
 
   // 4. Compute the normals (non-patented only)
@@ -295,7 +312,7 @@ VTKMeshPipeline
       options->GetMeshSmoothingFeatureEdgeSmoothing());
 
     m_PolygonSmoothingFilter->SetBoundarySmoothing(
-      options->GetMeshSmoothingBoundarySmoothing());
+      options->GetMeshSmoothingBoundarySmoothing() && !m_BlockMode);
 
     m_PolygonSmoothingFilter->SetConvergence(
       options->GetMeshSmoothingConvergence());
@@ -307,10 +324,32 @@ VTKMeshPipeline
   m_Pipeline.push_back(m_StripperFilter);
 }
 
+void
+VTKMeshPipeline::SetBlockExtent(const int extent[6])
+{
+  m_ExtractVOIFilter->SetVOI(extent[0], extent[1], extent[2], extent[3], extent[4], extent[5]);
+  if(!m_BlockMode)
+    {
+    m_BlockMode = true;
+    this->SetMeshOptions(m_MeshOptions);
+    }
+}
+
+void
+VTKMeshPipeline::ClearBlockExtent()
+{
+  if(m_BlockMode)
+    {
+    m_BlockMode = false;
+    this->SetMeshOptions(m_MeshOptions);
+    }
+}
+
 #include <ctime>
 
 void
-VTKMeshPipeline ::ComputeMesh(vtkPolyData *outMesh, long mesh_id, std::mutex *mutex)
+VTKMeshPipeline ::ComputeMesh(vtkPolyData *outMesh, long mesh_id, std::mutex *mutex,
+                               TaskCancellationToken *token)
 {
   // Reset the progress meter
   m_Progress->ResetProgress();
@@ -329,24 +368,25 @@ VTKMeshPipeline ::ComputeMesh(vtkPolyData *outMesh, long mesh_id, std::mutex *mu
   m_FlipPolyFaces->SetFlipFaces(m_Transform->GetMatrix()->Determinant() < 0);
 
   // Run and time each portion of the pipeline
-  // std::cout << "VTKMeshPipeline::ComputeMesh "
-  //           << " label " << mesh_id << " timings: " << std::endl;
   for (auto *algorithm : m_Pipeline)
   {
+    InstrumentationHistogram *&hist = m_PipelineTimers[algorithm];
+    if (!hist)
+      hist = SNAPInstrumentation::GetInstance()->GetTimer("Mesh", algorithm->GetClassName());
+
+    if (token)
+      token->WatchAlgorithm(algorithm);
+
     if (algorithm == m_VTKImporter && mutex)
       mutex->lock();
 
-    auto t0 = std::chrono::system_clock::now();
-    algorithm->Update();
-    auto t1 = std::chrono::system_clock::now();
+    {
+      ScopedInstrumentationTimer timer(hist);
+      algorithm->Update();
+    }
 
     if (algorithm == m_VTKImporter && mutex)
       mutex->unlock();
-
-    // TODO: collect this timing information somewhere we can show to the user
-    // const std::chrono::duration<double, std::milli> fp_ms_t = t1 - t0;
-    // std::cout << "  " << std::setw(40) << algorithm->GetClassName() << ": " << fp_ms_t.count()
-    //          << " ms." << std::endl;
   }
 
   // In the case that the jacobian of the transform is negative,
@@ -355,6 +395,10 @@ VTKMeshPipeline ::ComputeMesh(vtkPolyData *outMesh, long mesh_id, std::mutex *mu
 
   // Disconnect pipeline
   last_filter->SetOutput(nullptr);
+
+  // Aborted filters leave an incomplete mesh behind
+  if (token)
+    token->ThrowIfCancelled();
 }
 
 void
@@ -60,8 +60,11 @@
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkTransform.h>
 #include <vtkPolyDataNormals.h>
+#include <vtkExtractVOI.h>
 class vtkFlipPolyFaces;
+class InstrumentationHistogram;
 
+#include <map>
 #include <mutex>
 
 #ifndef vtkFloatingPointType
@@ -71,6 +74,7 @@ typedef float vtkFloatingPointType;
 
 class MeshOptions;
 class VTKProgressAccumulator;
+class TaskCancellationToken;
 
 /**
  * \class VTKMeshPipeline
@@ -91,8 +95,26 @@ public:
   /** Set the mesh options for this filter */
   void SetMeshOptions(MeshOptions *options);
 
-  /** Compute a mesh for a particular color label */
-  void ComputeMesh(vtkPolyData *outData, long mesh_id, std::mutex *mutex = nullptr);
+  /**
+   * Compute a mesh for a particular color label. If a cancellation token is
+   * given, the filters are aborted when it is cancelled, and the method then
+   * throws TaskCancelledException instead of returning an incomplete mesh.
+   */
+  void ComputeMesh(vtkPolyData *outData, long mesh_id, std::mutex *mutex = nullptr,
+                   TaskCancellationToken *token = nullptr);
+
+  /**
+   * Restrict marching cubes to a sub-extent of the input image, given in the
+   * index space of the input image. This is used to mesh an image in blocks:
+   * the input is padded so that smoothing near the block faces is the same as
+   * for the whole image, and adjacent blocks whose extents share a face will
+   * produce matching vertices on that face. In block mode, decimation and mesh
+   * smoothing leave the vertices on the open block boundary in place.
+   */
+  void SetBlockExtent(const int extent[6]);
+
+  /** Go back to meshing the whole input image */
+  void ClearBlockExtent();
 
   /** Get the progress accumulator */
   AllPurposeProgressAccumulator *GetProgressAccumulator()
@@ -136,6 +158,12 @@ protected:
   // Marching cubes filter
   vtkSmartPointer<vtkMarchingCubes> m_MarchingCubesFilter;
 
+  // Extent extraction filter, used in block mode
+  vtkSmartPointer<vtkExtractVOI> m_ExtractVOIFilter;
+
+  // Whether we are in block mode
+  bool m_BlockMode;
+
   // Transform filter used to map to RAS space
   vtkSmartPointer<vtkTransformPolyDataFilter> m_TransformFilter;
 
@@ -150,6 +178,9 @@ protected:
 
   // Current pipeline - list of chained filters in order
   std::list<vtkAlgorithm *> m_Pipeline;
+
+  // Timers for the filters in the pipeline, looked up once per filter
+  std::map<vtkAlgorithm *, InstrumentationHistogram *> m_PipelineTimers;
 };
 
 #endif // __VTKMeshPipeline_h_
@@ -1,4 +1,5 @@
 #include "EMGaussianMixtures.h"
+#include "SNAPInstrumentation.h"
 #include <iostream>
 #include <ctime>
 
@@ -139,16 +140,16 @@ double ** EMGaussianMixtures::Update(void)
 
 double ** EMGaussianMixtures::UpdateOnce(void)
 {
-  long start = 0;
-  long end = 0;
-  start = clock();
-  EvaluatePDF();
-  end = clock();
-  std::cout << "evaluate pdf spending " << (end-start)/1000 << std::endl;
-  start = clock();
+  irisInstrumentScopeMacro("GMM", "EM iteration");
+    {
+    irisInstrumentScopeMacro("GMM", "Evaluate PDF");
+    EvaluatePDF();
+    }
+
+  irisInstrumentNamedScopeMacro(tLikelihood, "GMM", "Evaluate likelihood");
   double currentLogLikelihood = EvaluateLogLikelihood();
-  end = clock();
-  std::cout << "evaluate likelihood spending " << (end-start)/1000 << std::endl;
+  tLikelihood.Stop();
+
   if (m_logLikelihood < currentLogLikelihood)
     {
     m_fail = 1;
@@ -166,24 +167,22 @@ double ** EMGaussianMixtures::UpdateOnce(void)
   ++m_numOfIteration;
   m_logLikelihood = currentLogLikelihood;
   
-  start = clock();
-  UpdateLatent();
-  end = clock();
-  std::cout << "latent spending " << (end-start)/1000 << std::endl;
-  start = clock();
-  UpdateMean();
-  end = clock();
-  std::cout << "mean spending " << (end-start)/1000 << std::endl;
-  start = clock();
-  UpdateCovariance();
-  end = clock();
-  std::cout << "covariance spending " << (end-start)/1000 << std::endl;
+    {
+    irisInstrumentScopeMacro("GMM", "Update latent");
+    UpdateLatent();
+    }
+    {
+    irisInstrumentScopeMacro("GMM", "Update mean");
+    UpdateMean();
+    }
+    {
+    irisInstrumentScopeMacro("GMM", "Update covariance");
+    UpdateCovariance();
+    }
   if (m_setPriorFlag == 0)
     {
-    start = clock();
+    irisInstrumentScopeMacro("GMM", "Update weight");
     UpdateWeight();
-    end = clock();
-    std::cout << "weight spending " << (end-start)/1000 << std::endl;
     }
 
   std::cout << std::endl <<"=====================" << std::endl;
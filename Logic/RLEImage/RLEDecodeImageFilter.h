@@ -0,0 +1,60 @@
+#ifndef RLEDecodeImageFilter_h
+#define RLEDecodeImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkSmartPointer.h"
+#include "RLEImage.h"
+
+/** \class RLEDecodeImageFilter
+ * \brief Decodes an RLEImage into an itk::Image with the same geometry.
+ *
+ * Unlike the RLEImage to itk::Image specialization of
+ * RegionOfInterestImageFilter, this filter only decodes the requested region
+ * of its output. Downstream filters that stream their input, such as
+ * itk::ImageFileWriter with multiple stream divisions, can therefore write an
+ * RLEImage without expanding all of it in memory.
+ */
+template< typename TInputImage, typename TOutputImage >
+class RLEDecodeImageFilter :
+    public itk::ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+    /** Standard class typedefs. */
+    typedef RLEDecodeImageFilter                                Self;
+    typedef itk::ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+    typedef itk::SmartPointer< Self >                           Pointer;
+    typedef itk::SmartPointer< const Self >                     ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self);
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro(RLEDecodeImageFilter, ImageToImageFilter);
+
+    typedef TInputImage                          RLEImageType;
+    typedef TOutputImage                         ImageType;
+    typedef typename ImageType::RegionType       RegionType;
+    typedef typename ImageType::IndexType        IndexType;
+    typedef typename ImageType::SizeValueType    SizeValueType;
+
+    itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+protected:
+    RLEDecodeImageFilter() { this->DynamicMultiThreadingOn(); }
+    ~RLEDecodeImageFilter() {}
+
+    /** The input is already in memory, so it is requested in full */
+    virtual void GenerateInputRequestedRegion() override;
+
+    virtual void DynamicThreadedGenerateData(const RegionType & outputRegionForThread) override;
+
+private:
+    RLEDecodeImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);       //purposely not implemented
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "RLEDecodeImageFilter.txx"
+#endif
+
+#endif //RLEDecodeImageFilter_h
@@ -0,0 +1,65 @@
+#ifndef RLEDecodeImageFilter_txx
+#define RLEDecodeImageFilter_txx
+
+#include "RLEDecodeImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include <algorithm>
+#include <cassert>
+
+template< typename TInputImage, typename TOutputImage >
+void RLEDecodeImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion()
+{
+    Superclass::GenerateInputRequestedRegion();
+
+    RLEImageType *inputPtr = const_cast< RLEImageType * >( this->GetInput() );
+    if ( inputPtr )
+        inputPtr->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template< typename TInputImage, typename TOutputImage >
+void RLEDecodeImageFilter< TInputImage, TOutputImage >
+::DynamicThreadedGenerateData(const RegionType & outputRegionForThread)
+{
+    const RLEImageType *in = this->GetInput();
+    ImageType *out = this->GetOutput();
+
+    // Range of the region along the run-length lines
+    SizeValueType x0 = outputRegionForThread.GetIndex(0) - in->GetBufferedRegion().GetIndex(0);
+    SizeValueType x1 = x0 + outputRegionForThread.GetSize(0);
+    SizeValueType lineLength = outputRegionForThread.GetSize(0);
+
+    // Iterate over the lines of the RLE image that intersect the region
+    typename RLEImageType::BufferType::RegionType lineRegion =
+        RLEImageType::truncateRegion(outputRegionForThread);
+    itk::ImageRegionConstIterator<typename RLEImageType::BufferType> lIt(in->GetBuffer(), lineRegion);
+
+    for (; !lIt.IsAtEnd(); ++lIt)
+    {
+        // Output pixels for this line are contiguous in memory
+        IndexType idx = outputRegionForThread.GetIndex();
+        for (unsigned int d = 1; d < ImageDimension; d++)
+            idx[d] = lIt.GetIndex()[d - 1];
+        typename ImageType::PixelType *p = out->GetBufferPointer() + out->ComputeOffset(idx);
+        typename ImageType::PixelType *pEnd = p + lineLength;
+
+        // Walk the segments, clipping them to [x0, x1)
+        const typename RLEImageType::RLLine &line = lIt.Value();
+        SizeValueType segStart = 0;
+        for (SizeValueType s = 0; s < line.size() && segStart < x1; s++)
+        {
+            SizeValueType segEnd = segStart + line[s].first;
+            if (segEnd > x0)
+            {
+                SizeValueType a = std::max(segStart, x0), b = std::min(segEnd, x1);
+                std::fill(p, p + (b - a), line[s].second);
+                p += b - a;
+            }
+            segStart = segEnd;
+        }
+        assert(p == pEnd);
+        (void) pEnd;
+    }
+}
+
+#endif //RLEDecodeImageFilter_txx
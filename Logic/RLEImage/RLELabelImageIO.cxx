@@ -0,0 +1,385 @@
+#include "RLELabelImageIO.h"
+#include "itksys/SystemTools.hxx"
+#include <algorithm>
+#include <fstream>
+
+const char RLELabelImageIO::MAGIC[8] = { 'S', 'N', 'A', 'P', 'R', 'L', 'E', '\0' };
+const uint32_t RLELabelImageIO::VERSION = 1;
+
+namespace
+{
+// Size of the fixed part of the header: magic, five 32-bit fields, the size,
+// spacing, origin and 4x4 direction matrix, and the number of blocks
+const size_t HEADER_SIZE = 8 + 5 * 4 + 4 * 8 + 24 * 8 + 8;
+
+template< typename T > void WriteValue(std::ostream &out, T value)
+{
+    itk::ByteSwapper< T >::SwapFromSystemToLittleEndian(&value);
+    out.write(reinterpret_cast< const char * >(&value), sizeof(T));
+}
+
+template< typename T > T ReadValue(std::istream &in)
+{
+    T value = T();
+    in.read(reinterpret_cast< char * >(&value), sizeof(T));
+    itk::ByteSwapper< T >::SwapFromSystemToLittleEndian(&value);
+    return value;
+}
+}
+
+RLELabelImageIO
+::RLELabelImageIO()
+    : m_LabelSize(0)
+{
+    for (unsigned int d = 0; d < 4; d++)
+        m_Size[d] = 1;
+    this->AddSupportedReadExtension(".rle");
+    this->AddSupportedWriteExtension(".rle");
+}
+
+bool RLELabelImageIO
+::CanReadFile(const char *filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    char magic[8];
+    return in.read(magic, 8) && std::memcmp(magic, MAGIC, 8) == 0;
+}
+
+bool RLELabelImageIO
+::CanWriteFile(const char *filename)
+{
+    return itksys::SystemTools::LowerCase(
+        itksys::SystemTools::GetFilenameLastExtension(filename)) == ".rle";
+}
+
+void RLELabelImageIO
+::ReadImageInformation()
+{
+    std::ifstream in(this->GetFileName(), std::ios::binary);
+    char magic[8];
+    if (!in.read(magic, 8) || std::memcmp(magic, MAGIC, 8) != 0)
+        itkExceptionMacro(<< "File " << this->GetFileName() << " is not a run-length label image");
+
+    uint32_t version = ReadValue< uint32_t >(in);
+    uint32_t ndim = ReadValue< uint32_t >(in);
+    uint32_t label_size = ReadValue< uint32_t >(in);
+    uint32_t label_signed = ReadValue< uint32_t >(in);
+    uint32_t counter_size = ReadValue< uint32_t >(in);
+    if (!in || version > VERSION || ndim < 1 || ndim > 4 || counter_size != sizeof(CounterType))
+        itkExceptionMacro(<< "Unsupported run-length label image " << this->GetFileName());
+
+    // Geometry, always stored in 4D
+    double spacing[4], origin[4], direction[16];
+    for (unsigned int d = 0; d < 4; d++)
+        m_Size[d] = (size_t) ReadValue< uint64_t >(in);
+    for (unsigned int d = 0; d < 4; d++)
+        spacing[d] = ReadValue< double >(in);
+    for (unsigned int d = 0; d < 4; d++)
+        origin[d] = ReadValue< double >(in);
+    for (unsigned int i = 0; i < 16; i++)
+        direction[i] = ReadValue< double >(in);
+
+    this->SetNumberOfDimensions(ndim);
+    for (unsigned int d = 0; d < ndim; d++)
+    {
+        this->SetDimensions(d, m_Size[d]);
+        this->SetSpacing(d, spacing[d]);
+        this->SetOrigin(d, origin[d]);
+        std::vector< double > axis(ndim);
+        for (unsigned int e = 0; e < ndim; e++)
+            axis[e] = direction[e * 4 + d];
+        this->SetDirection(d, axis);
+    }
+
+    m_LabelSize = label_size;
+    switch (label_size)
+    {
+        case 1: this->SetComponentType(label_signed ? itk::IOComponentEnum::CHAR : itk::IOComponentEnum::UCHAR); break;
+        case 2: this->SetComponentType(label_signed ? itk::IOComponentEnum::SHORT : itk::IOComponentEnum::USHORT); break;
+        case 4: this->SetComponentType(label_signed ? itk::IOComponentEnum::INT : itk::IOComponentEnum::UINT); break;
+        default:
+            itkExceptionMacro(<< "Unsupported label size in " << this->GetFileName());
+    }
+    this->SetPixelType(itk::IOPixelEnum::SCALAR);
+    this->SetNumberOfComponents(1);
+
+    // The offset index
+    uint64_t n_blocks = ReadValue< uint64_t >(in);
+    if (n_blocks != m_Size[2] * m_Size[3])
+        itkExceptionMacro(<< "Corrupt block index in " << this->GetFileName());
+
+    m_BlockOffsets.resize(n_blocks + 1);
+    for (uint64_t b = 0; b <= n_blocks; b++)
+    {
+        m_BlockOffsets[b] = ReadValue< uint64_t >(in);
+        if (b > 0 && m_BlockOffsets[b] < m_BlockOffsets[b - 1])
+            itkExceptionMacro(<< "Corrupt block index in " << this->GetFileName());
+    }
+
+    if (!in)
+        itkExceptionMacro(<< "Unable to read header of " << this->GetFileName());
+}
+
+size_t RLELabelImageIO
+::GetLinesPerBlock() const
+{
+    return m_Size[1];
+}
+
+size_t RLELabelImageIO
+::GetNumberOfBlocks() const
+{
+    return m_BlockOffsets.size() ? m_BlockOffsets.size() - 1 : 0;
+}
+
+void RLELabelImageIO
+::CheckLabelSize(size_t label_size) const
+{
+    if (label_size != m_LabelSize)
+        itkExceptionMacro(<< "Labels in " << this->GetFileName() << " have " << m_LabelSize
+                          << " bytes, but " << label_size << " were expected");
+}
+
+void RLELabelImageIO
+::ReadBlocks(size_t first, size_t n, BlockData &data)
+{
+    if (first + n > this->GetNumberOfBlocks())
+        itkExceptionMacro(<< "Blocks requested beyond the end of " << this->GetFileName());
+
+    // The blocks are consecutive in the file
+    uint64_t start = m_BlockOffsets[first];
+    data.offsets.resize(n + 1);
+    for (size_t k = 0; k <= n; k++)
+        data.offsets[k] = m_BlockOffsets[first + k] - start;
+    data.bytes.resize(data.offsets[n]);
+
+    std::ifstream in(this->GetFileName(), std::ios::binary);
+    in.seekg(start);
+    if (!in.read(data.bytes.data(), data.bytes.size()))
+        itkExceptionMacro(<< "Unable to read run tables from " << this->GetFileName());
+}
+
+void RLELabelImageIO
+::WriteBlocks(const std::vector< std::vector< char > > &blocks)
+{
+    unsigned int ndim = this->GetNumberOfDimensions();
+    if (ndim < 1 || ndim > 4)
+        itkExceptionMacro(<< "Run-length label images must have between 1 and 4 dimensions");
+
+    size_t size[4] = { 1, 1, 1, 1 };
+    for (unsigned int d = 0; d < ndim; d++)
+        size[d] = this->GetDimensions(d);
+    if (blocks.size() != size[2] * size[3])
+        itkExceptionMacro(<< "Wrong number of blocks for image of size " << size[0] << "x"
+                          << size[1] << "x" << size[2] << "x" << size[3]);
+
+    std::ofstream out(this->GetFileName(), std::ios::binary);
+    if (!out)
+        itkExceptionMacro(<< "Unable to open " << this->GetFileName() << " for writing");
+
+    // Fixed part of the header
+    bool is_signed = false;
+    switch (this->GetComponentType())
+    {
+        case itk::IOComponentEnum::CHAR:
+        case itk::IOComponentEnum::SHORT:
+        case itk::IOComponentEnum::INT:
+            is_signed = true;
+            break;
+        default:
+            break;
+    }
+
+    out.write(MAGIC, 8);
+    WriteValue< uint32_t >(out, VERSION);
+    WriteValue< uint32_t >(out, ndim);
+    WriteValue< uint32_t >(out, (uint32_t) this->GetComponentSize());
+    WriteValue< uint32_t >(out, is_signed ? 1 : 0);
+    WriteValue< uint32_t >(out, sizeof(CounterType));
+    for (unsigned int d = 0; d < 4; d++)
+        WriteValue< uint64_t >(out, size[d]);
+    for (unsigned int d = 0; d < 4; d++)
+        WriteValue< double >(out, d < ndim ? this->GetSpacing(d) : 1.0);
+    for (unsigned int d = 0; d < 4; d++)
+        WriteValue< double >(out, d < ndim ? this->GetOrigin(d) : 0.0);
+    for (unsigned int i = 0; i < 4; i++)
+        for (unsigned int j = 0; j < 4; j++)
+            WriteValue< double >(out, (i < ndim && j < ndim) ? this->GetDirection(j)[i] : (i == j ? 1.0 : 0.0));
+
+    // The offset index, followed by the blocks
+    WriteValue< uint64_t >(out, blocks.size());
+    uint64_t offset = HEADER_SIZE + (blocks.size() + 1) * sizeof(uint64_t);
+    for (size_t b = 0; b <= blocks.size(); b++)
+    {
+        WriteValue< uint64_t >(out, offset);
+        if (b < blocks.size())
+            offset += blocks[b].size();
+    }
+
+    for (const std::vector< char > &block : blocks)
+        out.write(block.data(), block.size());
+
+    if (!out)
+        itkExceptionMacro(<< "Error writing to " << this->GetFileName());
+}
+
+template< typename TLabel >
+void RLELabelImageIO
+::DoRead(void *buffer)
+{
+    this->CheckLabelSize(sizeof(TLabel));
+
+    // Extent of the IO region in 4D
+    size_t index[4] = { 0, 0, 0, 0 }, size[4] = { 1, 1, 1, 1 };
+    for (unsigned int d = 0; d < m_IORegion.GetImageDimension() && d < 4; d++)
+    {
+        index[d] = m_IORegion.GetIndex(d);
+        size[d] = m_IORegion.GetSize(d);
+    }
+
+    size_t x0 = index[0], x1 = index[0] + size[0];
+    size_t ny = m_Size[1], nz = m_Size[2];
+    TLabel *out = static_cast< TLabel * >(buffer);
+    itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+
+    std::atomic< bool > valid(true);
+    for (size_t t = index[3]; t < index[3] + size[3]; t++)
+    {
+        // Only the slices in the region are read from disk
+        BlockData data;
+        this->ReadBlocks(index[2] + nz * t, size[2], data);
+
+        mt->ParallelizeArray(0, size[2], [&](itk::SizeValueType k)
+        {
+            const char *block = data.bytes.data() + data.offsets[k];
+            const char *end = data.bytes.data() + data.offsets[k + 1];
+            TLabel *slice = out + ((t - index[3]) * size[2] + k) * size[1] * size[0];
+            bool ok = ForEachLine< TLabel >(block, end, ny, [&](size_t j, const char *runs, size_t n)
+            {
+                if (j < index[1] || j >= index[1] + size[1])
+                    return;
+
+                // Fill the part of each run that falls into [x0, x1)
+                TLabel *p = slice + (j - index[1]) * size[0];
+                size_t start = 0;
+                for (size_t s = 0; s < n && start < x1; s++)
+                {
+                    CounterType count;
+                    TLabel label;
+                    const char *run = runs + s * (sizeof(CounterType) + sizeof(TLabel));
+                    std::memcpy(&count, run, sizeof(CounterType));
+                    std::memcpy(&label, run + sizeof(CounterType), sizeof(TLabel));
+                    itk::ByteSwapper< CounterType >::SwapFromSystemToLittleEndian(&count);
+                    itk::ByteSwapper< TLabel >::SwapFromSystemToLittleEndian(&label);
+
+                    size_t a = std::max(start, x0), b = std::min(start + count, x1);
+                    if (b > a)
+                    {
+                        std::fill(p, p + (b - a), label);
+                        p += b - a;
+                    }
+                    start += count;
+                }
+                if (p != slice + (j - index[1] + 1) * size[0])
+                    valid = false;
+            });
+            if (!ok)
+                valid = false;
+        }, nullptr);
+    }
+
+    if (!valid)
+        itkExceptionMacro(<< "Corrupt run table in file " << this->GetFileName());
+}
+
+void RLELabelImageIO
+::Read(void *buffer)
+{
+    switch (this->GetComponentType())
+    {
+        case itk::IOComponentEnum::UCHAR:  this->DoRead< unsigned char >(buffer);  break;
+        case itk::IOComponentEnum::CHAR:   this->DoRead< signed char >(buffer);    break;
+        case itk::IOComponentEnum::USHORT: this->DoRead< unsigned short >(buffer); break;
+        case itk::IOComponentEnum::SHORT:  this->DoRead< short >(buffer);          break;
+        case itk::IOComponentEnum::UINT:   this->DoRead< unsigned int >(buffer);   break;
+        case itk::IOComponentEnum::INT:    this->DoRead< int >(buffer);            break;
+        default:
+            itkExceptionMacro(<< "Unsupported component type in " << this->GetFileName());
+    }
+}
+
+template< typename TLabel >
+void RLELabelImageIO
+::DoWrite(const void *buffer)
+{
+    size_t size[4] = { 1, 1, 1, 1 };
+    for (unsigned int d = 0; d < this->GetNumberOfDimensions() && d < 4; d++)
+        size[d] = this->GetDimensions(d);
+    if (size[0] > std::numeric_limits< CounterType >::max())
+        itkExceptionMacro(<< "Image lines are too long for the run-length file format");
+
+    // Encode each block in parallel
+    size_t nx = size[0], ny = size[1], n_blocks = size[2] * size[3];
+    const TLabel *in = static_cast< const TLabel * >(buffer);
+    std::vector< std::vector< char > > blocks(n_blocks);
+    const size_t run_size = sizeof(CounterType) + sizeof(TLabel);
+
+    itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+    mt->ParallelizeArray(0, n_blocks, [&](itk::SizeValueType b)
+    {
+        std::vector< char > &block = blocks[b];
+        block.resize(ny * sizeof(uint32_t));
+        for (size_t j = 0; j < ny; j++)
+        {
+            const TLabel *p = in + (b * ny + j) * nx, *end = p + nx;
+            uint32_t n_runs = 0;
+            while (p < end)
+            {
+                const TLabel *q = p;
+                while (q < end && *q == *p)
+                    ++q;
+
+                CounterType count = (CounterType) (q - p);
+                TLabel label = *p;
+                itk::ByteSwapper< CounterType >::SwapFromSystemToLittleEndian(&count);
+                itk::ByteSwapper< TLabel >::SwapFromSystemToLittleEndian(&label);
+                size_t pos = block.size();
+                block.resize(pos + run_size);
+                std::memcpy(block.data() + pos, &count, sizeof(CounterType));
+                std::memcpy(block.data() + pos + sizeof(CounterType), &label, sizeof(TLabel));
+                n_runs++;
+                p = q;
+            }
+
+            itk::ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian(&n_runs);
+            std::memcpy(block.data() + j * sizeof(uint32_t), &n_runs, sizeof(uint32_t));
+        }
+    }, nullptr);
+
+    this->WriteBlocks(blocks);
+}
+
+void RLELabelImageIO
+::Write(const void *buffer)
+{
+    // Streamed writing is not supported, so the buffer holds the whole image
+    switch (this->GetComponentType())
+    {
+        case itk::IOComponentEnum::UCHAR:  this->DoWrite< unsigned char >(buffer);  break;
+        case itk::IOComponentEnum::CHAR:   this->DoWrite< signed char >(buffer);    break;
+        case itk::IOComponentEnum::USHORT: this->DoWrite< unsigned short >(buffer); break;
+        case itk::IOComponentEnum::SHORT:  this->DoWrite< short >(buffer);          break;
+        case itk::IOComponentEnum::UINT:   this->DoWrite< unsigned int >(buffer);   break;
+        case itk::IOComponentEnum::INT:    this->DoWrite< int >(buffer);            break;
+        default:
+            itkExceptionMacro(<< "Only integer labels can be saved in the run-length format");
+    }
+}
+
+void RLELabelImageIO
+::PrintSelf(std::ostream & os, itk::Indent indent) const
+{
+    Superclass::PrintSelf(os, indent);
+    os << indent << "LabelSize: " << m_LabelSize << std::endl;
+    os << indent << "NumberOfBlocks: " << this->GetNumberOfBlocks() << std::endl;
+}
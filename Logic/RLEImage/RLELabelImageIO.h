@@ -0,0 +1,308 @@
+#ifndef RLELabelImageIO_h
+#define RLELabelImageIO_h
+
+#include "itkImageIOBase.h"
+#include "itkByteSwapper.h"
+#include "itkMultiThreaderBase.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/** \class RLELabelImageIO
+ * \brief Reads and writes label images in a run-length encoded format that
+ * maps directly onto the lines of an RLEImage.
+ *
+ * The file (extension .rle) consists of a fixed-size header with the image
+ * geometry, an index of file offsets and the run tables. The runs are stored
+ * in blocks, one per z-slice of each time point, i.e., in the same order as
+ * the lines of RLEImage::BufferType. Each block holds the number of runs in
+ * each of its lines, followed by the (count, label) pairs of the runs. All
+ * values are little-endian.
+ *
+ * Because of the offset index, any range of slices or time points can be
+ * read without touching the rest of the file. Through the ImageIOBase
+ * interface, the IO can be used with any dense scalar integer image and
+ * supports streamed reading. RLE images can bypass the dense representation
+ * altogether using ReadRLEImage() and WriteRLEImage(), which copy the runs
+ * between the file and the lines of the image. Encoding and decoding of the
+ * blocks is done in parallel.
+ */
+class RLELabelImageIO : public itk::ImageIOBase
+{
+public:
+    /** Standard class typedefs. */
+    typedef RLELabelImageIO            Self;
+    typedef itk::ImageIOBase           Superclass;
+    typedef itk::SmartPointer< Self >  Pointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self);
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro(RLELabelImageIO, ImageIOBase);
+
+    /** Type used to store run lengths in the file */
+    typedef uint16_t CounterType;
+
+    /** Raw contents of a range of blocks, with the offset of each block */
+    struct BlockData
+    {
+        std::vector< char > bytes;
+        std::vector< uint64_t > offsets;
+    };
+
+    virtual bool CanReadFile(const char *) override;
+    virtual void ReadImageInformation() override;
+    virtual void Read(void *buffer) override;
+
+    virtual bool CanWriteFile(const char *) override;
+    virtual void WriteImageInformation() override {}
+    virtual void Write(const void *buffer) override;
+
+    /** Only the blocks that intersect the IO region are read */
+    virtual bool CanStreamRead() override { return true; }
+
+    /** Number of lines in each block, i.e., the size of the image in y */
+    size_t GetLinesPerBlock() const;
+
+    /** Number of blocks in the file, i.e., the number of z-slices times the
+     * number of time points */
+    size_t GetNumberOfBlocks() const;
+
+    /**
+     * Read the runs into the lines of an RLE image. The image must have its
+     * regions and geometry set and be allocated. Only the part of the file
+     * that corresponds to the buffered region is read, so a single time point
+     * can be loaded from a 4D file. The buffered region must span the image in
+     * x and y. ReadImageInformation() must have been called.
+     */
+    template< typename TRLEImage > void ReadRLEImage(TRLEImage *image);
+
+    /**
+     * Write an RLE image, taking the geometry from the image and the runs
+     * directly from its lines. The buffered region must be the whole image.
+     */
+    template< typename TRLEImage > void WriteRLEImage(const TRLEImage *image);
+
+protected:
+    RLELabelImageIO();
+    ~RLELabelImageIO() {}
+    void PrintSelf(std::ostream & os, itk::Indent indent) const override;
+
+    /** Read blocks [first, first + n) of the file into memory */
+    void ReadBlocks(size_t first, size_t n, BlockData &data);
+
+    /** Write the header, the offset index and the given blocks */
+    void WriteBlocks(const std::vector< std::vector< char > > &blocks);
+
+    /** Check that the labels in the file have the given size */
+    void CheckLabelSize(size_t label_size) const;
+
+    template< typename TLabel > void DoRead(void *buffer);
+    template< typename TLabel > void DoWrite(const void *buffer);
+
+    /** Parse the lines of one block, calling op(line_index, segments, n) */
+    template< typename TLabel, typename TOp >
+    static bool ForEachLine(const char *block, const char *end, size_t n_lines, TOp op);
+
+    /** Sizes of the image in x, y, z, t */
+    size_t m_Size[4];
+
+    /** Offsets of the blocks in the file, plus the end of the last block */
+    std::vector< uint64_t > m_BlockOffsets;
+
+    /** Byte size of the labels stored in the file */
+    uint32_t m_LabelSize;
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION;
+
+private:
+    RLELabelImageIO(const Self &); //purposely not implemented
+    void operator=(const Self &);  //purposely not implemented
+};
+
+
+template< typename TLabel, typename TOp >
+bool RLELabelImageIO
+::ForEachLine(const char *block, const char *end, size_t n_lines, TOp op)
+{
+    // The block starts with the run count of each line
+    const size_t run_size = sizeof(CounterType) + sizeof(TLabel);
+    const char *runs = block + n_lines * sizeof(uint32_t);
+    if (runs > end)
+        return false;
+
+    for (size_t j = 0; j < n_lines; j++)
+    {
+        uint32_t n_runs;
+        std::memcpy(&n_runs, block + j * sizeof(uint32_t), sizeof(uint32_t));
+        itk::ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian(&n_runs);
+        if (n_runs == 0 || runs + n_runs * run_size > end)
+            return false;
+        op(j, runs, (size_t) n_runs);
+        runs += n_runs * run_size;
+    }
+    return true;
+}
+
+template< typename TRLEImage >
+void RLELabelImageIO
+::ReadRLEImage(TRLEImage *image)
+{
+    typedef typename TRLEImage::RLSegment RLSegment;
+    typedef typename TRLEImage::RLLine RLLine;
+    typedef typename RLSegment::first_type ImageCounterType;
+    typedef typename RLSegment::second_type LabelType;
+    this->CheckLabelSize(sizeof(LabelType));
+
+    // Blocks that are covered by the buffered region. When it spans the whole
+    // image in z, these are consecutive in the file
+    typename TRLEImage::RegionType region = image->GetBufferedRegion();
+    size_t ny = m_Size[1], nz = m_Size[2];
+    const unsigned int VDim = TRLEImage::ImageDimension;
+    if (region.GetSize(0) != m_Size[0] || (VDim > 1 && region.GetSize(1) != ny))
+        itkExceptionMacro(<< "Run-length images can only be read in whole lines and slices");
+
+    size_t z0 = VDim > 2 ? region.GetIndex(2) : 0, sz = VDim > 2 ? region.GetSize(2) : 1;
+    size_t t0 = VDim > 3 ? region.GetIndex(3) : 0, st = VDim > 3 ? region.GetSize(3) : 1;
+
+    RLLine *lines = image->GetBuffer()->GetBufferPointer();
+    itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+    const bool direct = sizeof(ImageCounterType) == sizeof(CounterType)
+        && sizeof(RLSegment) == sizeof(CounterType) + sizeof(LabelType)
+        && !itk::ByteSwapper< CounterType >::SystemIsBigEndian();
+
+    std::atomic< bool > valid(true);
+    for (size_t t = t0; t < t0 + st; t++)
+    {
+        BlockData data;
+        this->ReadBlocks(z0 + nz * t, sz, data);
+        RLLine *blockLines = lines + (t - t0) * sz * ny;
+
+        mt->ParallelizeArray(0, sz, [&](itk::SizeValueType k)
+        {
+            const char *block = data.bytes.data() + data.offsets[k];
+            const char *end = data.bytes.data() + data.offsets[k + 1];
+            RLLine *out = blockLines + k * ny;
+            bool ok = ForEachLine< LabelType >(block, end, ny,
+                [&](size_t j, const char *runs, size_t n)
+            {
+                RLLine &line = out[j];
+                line.resize(n);
+                if (direct)
+                {
+                    // The file layout is the same as in memory
+                    std::memcpy(line.data(), runs, n * sizeof(RLSegment));
+                }
+                else
+                {
+                    for (size_t s = 0; s < n; s++, runs += sizeof(CounterType) + sizeof(LabelType))
+                    {
+                        CounterType count;
+                        LabelType label;
+                        std::memcpy(&count, runs, sizeof(CounterType));
+                        std::memcpy(&label, runs + sizeof(CounterType), sizeof(LabelType));
+                        itk::ByteSwapper< CounterType >::SwapFromSystemToLittleEndian(&count);
+                        itk::ByteSwapper< LabelType >::SwapFromSystemToLittleEndian(&label);
+                        line[s] = RLSegment(count, label);
+                    }
+                }
+
+                // The runs must add up to the length of the line
+                size_t length = 0;
+                for (const RLSegment &seg : line)
+                    length += seg.first;
+                if (length != m_Size[0])
+                    valid = false;
+            });
+            if (!ok)
+                valid = false;
+        }, nullptr);
+    }
+
+    if (!valid)
+        itkExceptionMacro(<< "Corrupt run table in file " << this->GetFileName());
+}
+
+template< typename TRLEImage >
+void RLELabelImageIO
+::WriteRLEImage(const TRLEImage *image)
+{
+    typedef typename TRLEImage::RLSegment RLSegment;
+    typedef typename TRLEImage::RLLine RLLine;
+    typedef typename RLSegment::first_type ImageCounterType;
+    typedef typename RLSegment::second_type LabelType;
+    const unsigned int VDim = TRLEImage::ImageDimension;
+
+    // Geometry of the image
+    this->SetNumberOfDimensions(VDim);
+    this->SetPixelTypeInfo(static_cast< const LabelType * >(nullptr));
+    for (unsigned int d = 0; d < VDim; d++)
+    {
+        this->SetDimensions(d, image->GetLargestPossibleRegion().GetSize(d));
+        this->SetSpacing(d, image->GetSpacing()[d]);
+        this->SetOrigin(d, image->GetOrigin()[d]);
+        std::vector< double > axis(VDim);
+        for (unsigned int e = 0; e < VDim; e++)
+            axis[e] = image->GetDirection()[e][d];
+        this->SetDirection(d, axis);
+    }
+
+    if (image->GetBufferedRegion() != image->GetLargestPossibleRegion())
+        itkExceptionMacro(<< "Only whole run-length images can be written");
+    if (image->GetLargestPossibleRegion().GetSize(0) > std::numeric_limits< CounterType >::max())
+        itkExceptionMacro(<< "Image lines are too long for the run-length file format");
+
+    // Encode the blocks in parallel
+    size_t ny = VDim > 1 ? image->GetLargestPossibleRegion().GetSize(1) : 1;
+    size_t n_blocks = image->GetBuffer()->GetBufferedRegion().GetNumberOfPixels() / ny;
+    const RLLine *lines = image->GetBuffer()->GetBufferPointer();
+    const bool direct = sizeof(ImageCounterType) == sizeof(CounterType)
+        && sizeof(RLSegment) == sizeof(CounterType) + sizeof(LabelType)
+        && !itk::ByteSwapper< CounterType >::SystemIsBigEndian();
+
+    std::vector< std::vector< char > > blocks(n_blocks);
+    itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+    mt->ParallelizeArray(0, n_blocks, [&](itk::SizeValueType b)
+    {
+        const RLLine *in = lines + b * ny;
+        size_t n_runs = 0;
+        for (size_t j = 0; j < ny; j++)
+            n_runs += in[j].size();
+
+        std::vector< char > &block = blocks[b];
+        block.resize(ny * sizeof(uint32_t) + n_runs * (sizeof(CounterType) + sizeof(LabelType)));
+        char *runs = block.data() + ny * sizeof(uint32_t);
+        for (size_t j = 0; j < ny; j++)
+        {
+            uint32_t n = (uint32_t) in[j].size();
+            itk::ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian(&n);
+            std::memcpy(block.data() + j * sizeof(uint32_t), &n, sizeof(uint32_t));
+            if (direct)
+            {
+                std::memcpy(runs, in[j].data(), in[j].size() * sizeof(RLSegment));
+                runs += in[j].size() * sizeof(RLSegment);
+            }
+            else
+            {
+                for (const RLSegment &seg : in[j])
+                {
+                    CounterType count = seg.first;
+                    LabelType label = seg.second;
+                    itk::ByteSwapper< CounterType >::SwapFromSystemToLittleEndian(&count);
+                    itk::ByteSwapper< LabelType >::SwapFromSystemToLittleEndian(&label);
+                    std::memcpy(runs, &count, sizeof(CounterType));
+                    std::memcpy(runs + sizeof(CounterType), &label, sizeof(LabelType));
+                    runs += sizeof(CounterType) + sizeof(LabelType);
+                }
+            }
+        }
+    }, nullptr);
+
+    this->WriteBlocks(blocks);
+}
+
+#endif //RLELabelImageIO_h
@@ -0,0 +1,26 @@
+#include "RLELabelImageIOFactory.h"
+#include "RLELabelImageIO.h"
+#include "itkCreateObjectFunction.h"
+#include "itkVersion.h"
+
+RLELabelImageIOFactory
+::RLELabelImageIOFactory()
+{
+    this->RegisterOverride("itkImageIOBase",
+                           "RLELabelImageIO",
+                           "Run-Length Label Image IO",
+                           1,
+                           itk::CreateObjectFunction< RLELabelImageIO >::New());
+}
+
+const char *RLELabelImageIOFactory
+::GetITKSourceVersion() const
+{
+    return ITK_SOURCE_VERSION;
+}
+
+const char *RLELabelImageIOFactory
+::GetDescription() const
+{
+    return "Run-length encoded label image IO factory";
+}
@@ -0,0 +1,44 @@
+#ifndef RLELabelImageIOFactory_h
+#define RLELabelImageIOFactory_h
+
+#include "itkObjectFactoryBase.h"
+#include "itkImageIOBase.h"
+
+/** \class RLELabelImageIOFactory
+ * \brief Create instances of RLELabelImageIO objects using an object factory.
+ */
+class RLELabelImageIOFactory : public itk::ObjectFactoryBase
+{
+public:
+    /** Standard class typedefs. */
+    typedef RLELabelImageIOFactory             Self;
+    typedef itk::ObjectFactoryBase             Superclass;
+    typedef itk::SmartPointer< Self >          Pointer;
+    typedef itk::SmartPointer< const Self >    ConstPointer;
+
+    /** Class methods used to interface with the registered factories. */
+    virtual const char *GetITKSourceVersion() const override;
+    virtual const char *GetDescription() const override;
+
+    /** Method for class instantiation. */
+    itkFactorylessNewMacro(Self);
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro(RLELabelImageIOFactory, ObjectFactoryBase);
+
+    /** Register one factory of this type  */
+    static void RegisterOneFactory()
+    {
+        itk::ObjectFactoryBase::RegisterFactory(RLELabelImageIOFactory::New());
+    }
+
+protected:
+    RLELabelImageIOFactory();
+    ~RLELabelImageIOFactory() {}
+
+private:
+    RLELabelImageIOFactory(const Self &); //purposely not implemented
+    void operator=(const Self &);         //purposely not implemented
+};
+
+#endif //RLELabelImageIOFactory_h
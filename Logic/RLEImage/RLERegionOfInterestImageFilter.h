@@ -4,10 +4,27 @@
 #include "itkImageToImageFilter.h"
 #include "itkSmartPointer.h"
 #include "itkRegionOfInterestImageFilter.h"
+#include "itkImageRegionSplitterDirection.h"
 #include "RLEImage.h"
 
 namespace itk
 {
+/**
+ * Region splitter for filters that read or write RLEImages. Work units are
+ * slabs of complete run-length lines, split along the slowest dimension, so
+ * that no line is shared between threads.
+ */
+inline const ImageRegionSplitterBase *GetRLELineRegionSplitter()
+{
+    static ImageRegionSplitterDirection::Pointer splitter = []()
+    {
+        ImageRegionSplitterDirection::Pointer s = ImageRegionSplitterDirection::New();
+        s->SetDirection(0);
+        return s;
+    }();
+    return splitter;
+}
+
 /** \class RegionOfInterestImageFilter
  * \brief Extract a region of interest from the input image
  * or convert between itk::Image and RLEImage (a custom region can be used).
@@ -90,6 +107,9 @@ protected:
   /** RegionOfInterestImageFilter can be implemented as a multithreaded filter.  */
   void DynamicThreadedGenerateData(const RegionType & outputRegionForThread) override;
 
+  /** Split the output into slabs of whole run-length lines */
+  virtual const ImageRegionSplitterBase *GetImageRegionSplitter() const override;
+
 private:
   RegionOfInterestImageFilter(const Self &); //purposely not implemented
   void operator=(const Self &);              //purposely not implemented
@@ -165,6 +185,9 @@ protected:
     /** RegionOfInterestImageFilter can be implemented as a multithreaded filter. */
     void DynamicThreadedGenerateData(const RegionType & outputRegionForThread) override;
 
+    /** Split the region into slabs of whole run-length lines */
+    virtual const ImageRegionSplitterBase *GetImageRegionSplitter() const override;
+
 private:
     RegionOfInterestImageFilter(const Self &); //purposely not implemented
     void operator=(const Self &);              //purposely not implemented
@@ -240,6 +263,9 @@ protected:
     /** RegionOfInterestImageFilter can be implemented as a multithreaded filter. */
     void DynamicThreadedGenerateData(const RegionType & outputRegionForThread) override;
 
+    /** Split the region into slabs of whole run-length lines */
+    virtual const ImageRegionSplitterBase *GetImageRegionSplitter() const override;
+
 private:
     RegionOfInterestImageFilter(const Self &); //purposely not implemented
     void operator=(const Self &);              //purposely not implemented
@@ -6,6 +6,8 @@
 #include "itkObjectFactory.h"
 #include "itkProgressReporter.h"
 #include "itkImage.h"
+#include <algorithm>
+#include <cassert>
 
 namespace itk
 {
@@ -130,51 +132,28 @@ void RegionOfInterestImageFilter<RLEImage<TPixel, VImageDimension, CounterType>,
     {
         if (copyLines)
             oIt.Set(iIt.Get());
-        else //determine begin and end iterator and copy range
+        else //copy the segments that overlap [start, end), clipping the outer ones
         {
             typename RLEImageType::RLLine &oLine = oIt.Value();
-            oLine.clear();
             const typename RLEImageType::RLLine &iLine = iIt.Value();
-            CounterType t = 0;
-            SizeValueType x = 0;
-            //find start
-            for (; x < iLine.size(); x++)
-            {
-                t += iLine[x].first;
-                if (t > start[0])
-                    break;
-            }
-            assert(x < iLine.size());
 
-            SizeValueType begin = x;
-            if (t >= end[0]) //both begin and end are in this segment
-            {
-                oLine.push_back(
-                    typename RLEImageType::RLSegment(end[0] - start[0], iLine[x].second));
-                ++iIt;
-                ++oIt;
-                continue; //next line
-            }
-            else if (t - start[0] < iLine[x].first) //not the first pixel in segment
+            // Find the segments containing the first and the last pixel
+            SizeValueType xFirst = 0, tFirst = 0;
+            while (tFirst + iLine[xFirst].first <= SizeValueType(start[0]))
+                tFirst += iLine[xFirst++].first;
+            SizeValueType xLast = xFirst, tLast = tFirst;
+            while (tLast + iLine[xLast].first < SizeValueType(end[0]))
+                tLast += iLine[xLast++].first;
+            assert(xLast < iLine.size());
+
+            // Size the line once, reusing its storage
+            oLine.assign(iLine.begin() + xFirst, iLine.begin() + xLast + 1);
+            if (xFirst == xLast)
+                oLine.front().first = CounterType(end[0] - start[0]);
+            else
             {
-                oLine.push_back(typename RLEImageType::RLSegment(t - start[0], iLine[x].second));
-                begin++; //start copying from next segment
-            }
-
-            //if (t < end[0])
-                for (x++; x < iLine.size(); x++)
-                {
-                    t += iLine[x].first;
-                    if (t >= end[0])
-                        break;
-                }
-            if (t == end[0])
-                oLine.insert(oLine.end(), iLine.begin() + begin, iLine.begin() + x + 1);
-            else //we need to take special care of the last segment
-            {
-                oLine.insert(oLine.end(), iLine.begin() + begin, iLine.begin() + x);
-                oLine.push_back(
-                    typename RLEImageType::RLSegment(end[0] + iLine[x].first - t, iLine[x].second));
+                oLine.front().first = CounterType(tFirst + iLine[xFirst].first - start[0]);
+                oLine.back().first = CounterType(end[0] - tLast);
             }
         }
         ++iIt;
@@ -295,29 +274,33 @@ void RegionOfInterestImageFilter<Image<TPixel, VImageDimension>,
     inputRegionForThread.SetIndex(start);
 
     typename RLEImageType::BufferType::RegionType oReg = RLEImageType::truncateRegion(outputRegionForThread);
-    ImageRegionConstIterator<ImageType> iIt(in, inputRegionForThread);
     ImageRegionIterator<typename RLEImageType::BufferType> oIt(out->GetBuffer(), oReg);
     SizeValueType size0 = outputRegionForThread.GetSize(0);
-    typename RLEImageType::RLLine temp;
-    temp.reserve(size0); //pessimistically preallocate buffer, otherwise reallocations can occur
 
-    while (!oIt.IsAtEnd())
+    for (; !oIt.IsAtEnd(); ++oIt)
     {
-        SizeValueType x = 0;
-        temp.clear();
-        while (x < size0)
+        // The input pixels of this line are contiguous in memory
+        IndexType idx = start;
+        for (unsigned int d = 1; d < VImageDimension; d++)
+            idx[d] = roiStart[d] + oIt.GetIndex()[d - 1];
+        const TPixel *p = in->GetBufferPointer() + in->ComputeOffset(idx);
+        const TPixel *pEnd = p + size0;
+
+        // Count the runs, so that the line is sized exactly once
+        SizeValueType nRuns = 1;
+        for (const TPixel *q = p + 1; q < pEnd; ++q)
+            if (!(*q == *(q - 1)))
+                nRuns++;
+
+        // Fill in the runs, reusing the storage of the line
+        typename RLEImageType::RLLine &oLine = oIt.Value();
+        oLine.resize(nRuns);
+        for (SizeValueType r = 0; r < nRuns; r++)
         {
-            typename RLEImageType::RLSegment s(0, iIt.Value());
-            while (x < size0 && iIt.Value() == s.second)
-            {
-                x++;
-                s.first++;
-                ++(iIt);
-            }
-            temp.push_back(s);
+            const TPixel *runStart = p;
+            for (++p; p < pEnd && *p == *runStart; ++p) {}
+            oLine[r] = typename RLEImageType::RLSegment(CounterType(p - runStart), *runStart);
         }
-        oIt.Value() = temp;
-        ++oIt;
     }
 }
 
@@ -435,60 +418,60 @@ void RegionOfInterestImageFilter<RLEImage<TPixel, VImageDimension, CounterType>,
 
   typename RLEImageType::BufferType::RegionType iReg = RLEImageType::truncateRegion(inputRegionForThread);
   ImageRegionConstIterator<typename RLEImageType::BufferType> iIt(in->GetBuffer(), iReg);
-  ImageRegionIterator<ImageType> oIt(out, outputRegionForThread);
+  SizeValueType x0 = start[0], x1 = end[0];
 
-  while (!iIt.IsAtEnd())
+  for (; !iIt.IsAtEnd(); ++iIt)
   {
-    const typename RLEImageType::RLLine &iLine = iIt.Value();
-    CounterType t = 0;
-    SizeValueType x = 0;
-    //find start
-    for (; x < iLine.size(); x++)
-    {
-        t += iLine[x].first;
-        if (t > start[0])
-            break;
-    }
-    assert(x < iLine.size());
+    // The output pixels of this line are contiguous in memory
+    IndexType idx = threadStart;
+    for (unsigned int d = 1; d < VImageDimension; d++)
+      idx[d] = iIt.GetIndex()[d - 1] - roiStart[d];
+    TPixel *p = out->GetBufferPointer() + out->ComputeOffset(idx);
 
-    SizeValueType begin = x;
-    if (t >= end[0]) //both begin and end are in this segment
-    {
-        for (SizeValueType i = start[0]; i < end[0]; i++)
-        {
-            oIt.Set(iLine[x].second);
-            ++oIt;
-        }
-        ++iIt;
-        continue; //next line
-    }
-    //else handle the beginning segment
-    for (SizeValueType i = start[0]; i < t; i++)
-    {
-        oIt.Set(iLine[x].second);
-        ++oIt;
-    }
-    //now handle middle segments
-    for (x++; x < iLine.size(); x++)
-    {
-        t += iLine[x].first;
-        if (t >= end[0])
-            break;
-        for (SizeValueType i = 0; i < iLine[x].first; i++)
-        {
-            oIt.Set(iLine[x].second);
-            ++oIt;
-        }
-    }
-    //handle the last segment
-    for (SizeValueType i = 0; i < end[0] + iLine[x].first - t; i++)
+    // Walk the segments, clipping them to [x0, x1)
+    const typename RLEImageType::RLLine &iLine = iIt.Value();
+    SizeValueType segStart = 0;
+    for (SizeValueType s = 0; s < iLine.size() && segStart < x1; s++)
     {
-        oIt.Set(iLine[x].second);
-        ++oIt;
+      SizeValueType segEnd = segStart + iLine[s].first;
+      if (segEnd > x0)
+      {
+        SizeValueType a = std::max(segStart, x0), b = std::min(segEnd, x1);
+        std::fill(p, p + (b - a), iLine[s].second);
+        p += b - a;
+      }
+      segStart = segEnd;
     }
-    ++iIt;
   }
 }
+
+// Region splitters for the three conversions
+template< typename TPixel, unsigned int VImageDimension, typename CounterType >
+const ImageRegionSplitterBase *
+RegionOfInterestImageFilter<RLEImage<TPixel, VImageDimension, CounterType>,
+    RLEImage<TPixel, VImageDimension, CounterType> >
+::GetImageRegionSplitter() const
+{
+  return GetRLELineRegionSplitter();
+}
+
+template< typename TPixel, unsigned int VImageDimension, typename CounterType >
+const ImageRegionSplitterBase *
+RegionOfInterestImageFilter<Image<TPixel, VImageDimension>,
+    RLEImage<TPixel, VImageDimension, CounterType> >
+::GetImageRegionSplitter() const
+{
+  return GetRLELineRegionSplitter();
+}
+
+template< typename TPixel, unsigned int VImageDimension, typename CounterType >
+const ImageRegionSplitterBase *
+RegionOfInterestImageFilter<RLEImage<TPixel, VImageDimension, CounterType>,
+    Image<TPixel, VImageDimension> >
+::GetImageRegionSplitter() const
+{
+  return GetRLELineRegionSplitter();
+}
 } // end namespace itk
 
 #endif //RLERegionOfInterestImageFilter_txx
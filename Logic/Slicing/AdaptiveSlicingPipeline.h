@@ -144,6 +144,21 @@ public:
   virtual void SetUseOrthogonalSlicing(bool value);
   itkGetMacro(UseOrthogonalSlicing, bool)
 
+  /**
+   * Resolution-adaptive mode. The oblique slicer always samples at the
+   * resolution of the viewport given by the oblique reference image. In this
+   * mode, the orthogonal slicer does too when the view is zoomed out: when a
+   * screen pixel spans two or more voxels, the slice is sampled with the
+   * largest power of two step that does not exceed that number, averaging
+   * the voxels in each block. The slice is only regenerated when the step
+   * changes. When the view is zoomed in, the native resolution is used.
+   */
+  virtual void SetResolutionAdaptive(bool value);
+  itkGetMacro(ResolutionAdaptive, bool)
+
+  /** The step at which the orthogonal slicer samples the image */
+  unsigned int GetSamplingStep() const { return m_OrthogonalSlicer->GetSamplingStep(); }
+
   /** Get the slice index for the orthogonal slicer */
   itkGetMacro(SliceIndex, IndexType)
 
@@ -166,6 +181,8 @@ protected:
 
   virtual void VerifyInputInformation() const ITK_OVERRIDE {}
 
+  virtual void UpdateOutputInformation() ITK_OVERRIDE;
+
   virtual void GenerateOutputInformation() ITK_OVERRIDE;
 
   virtual void PropagateRequestedRegion(itk::DataObject *object) ITK_OVERRIDE;
@@ -181,9 +198,14 @@ protected:
 
   bool m_UseOrthogonalSlicing;
 
+  bool m_ResolutionAdaptive;
+
   IndexType m_SliceIndex;
 
   void MapInputsToSlicers();
+
+  // Sampling step of the orthogonal slicer for the current viewport
+  unsigned int ComputeSamplingStep();
 };
 
 
@@ -45,6 +45,7 @@
 
 #include "AdaptiveSlicingPipeline.h"
 #include "IRISVectorTypesToITKConversion.h"
+#include <algorithm>
 
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
 AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::AdaptiveSlicingPipeline()
@@ -55,6 +56,9 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::AdaptiveSlici
 
   // Initially use the ortho
   m_UseOrthogonalSlicing = true;
+
+  // Slice at native resolution unless asked otherwise
+  m_ResolutionAdaptive = false;
 }
 
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
@@ -130,6 +134,55 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::SetSliceIndex
 }
 
 
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+unsigned int
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::ComputeSamplingStep()
+{
+  // Without a viewport or an image, sample at native resolution
+  const NonOrthogonalSliceReferenceSpace *viewport = m_ObliqueReferenceImage;
+  const InputImageType                   *input = this->GetInput();
+  if (!viewport || !input || !this->GetOrthogonalTransformInput() ||
+      viewport->GetLargestPossibleRegion().GetNumberOfPixels() == 0)
+    return 1;
+
+  // Make sure the slicer knows which image axes are displayed
+  this->MapInputsToSlicers();
+
+  // Number of voxels spanned by a screen pixel in each direction. The spacing
+  // of the viewport is the size of a screen pixel in physical units
+  double ratio = std::min(
+    viewport->GetSpacing()[0] / input->GetSpacing()[m_OrthogonalSlicer->GetPixelDirectionImageAxis()],
+    viewport->GetSpacing()[1] / input->GetSpacing()[m_OrthogonalSlicer->GetLineDirectionImageAxis()]);
+
+  // Largest power of two that does not exceed the ratio, allowing for roundoff
+  unsigned int step = 1;
+  while (2.0 * step <= ratio * (1.0 + 1.0e-6))
+    step *= 2;
+
+  return step;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::UpdateOutputInformation()
+{
+  // The viewport geometry is changed in place when the view is zoomed or
+  // panned and it is not an input to the pipeline in orthogonal mode, so we
+  // check here whether the zoom calls for a different sampling step. The
+  // pipeline is only modified when it does, so panning does not reslice.
+  if (m_ResolutionAdaptive && m_UseOrthogonalSlicing)
+  {
+    unsigned int step = this->ComputeSamplingStep();
+    if (step != m_OrthogonalSlicer->GetSamplingStep())
+    {
+      m_OrthogonalSlicer->SetSamplingStep(step);
+      this->Modified();
+    }
+  }
+
+  Superclass::UpdateOutputInformation();
+}
+
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
 void
 AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::GenerateOutputInformation()
@@ -227,6 +280,22 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::SetUseOrthogo
   }
 }
 
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::SetResolutionAdaptive(bool value)
+{
+  if (m_ResolutionAdaptive != value)
+  {
+    m_ResolutionAdaptive = value;
+
+    // Go back to native resolution right away; the adaptive step is computed
+    // on the next update
+    if (!m_ResolutionAdaptive && m_OrthogonalSlicer->GetSamplingStep() != 1)
+      m_OrthogonalSlicer->SetSamplingStep(1);
+    this->Modified();
+  }
+}
+
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
 const typename AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::NonOrthogonalSliceReferenceSpace *
 AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::GetObliqueReferenceImage() const
@@ -42,6 +42,9 @@
 #include <itkImageSliceConstIteratorWithIndex.h>
 #include <itkImageRegionIteratorWithIndex.h>
 #include <itkImageLinearIteratorWithIndex.h>
+#include <list>
+#include <utility>
+#include <vector>
 
 /**
  * \class IRISSlicer
@@ -119,6 +122,27 @@ public:
   itkSetMacro(PixelTraverseForward,bool);
   itkGetMacro(PixelTraverseForward,bool);
 
+  /**
+   * Set the sampling step. With a step of k, a line of n voxels of the input
+   * slice is split into ceil(n/k) blocks of k or k-1 voxels, which exactly
+   * cover it. Each pixel of the output slice covers one block in each
+   * direction, and the output spacing is scaled accordingly. Voxels of
+   * arithmetic types are averaged over the block, other pixels take the
+   * value of the voxel at the center of the block. The default is 1.
+   */
+  itkSetMacro(SamplingStep,unsigned int);
+  itkGetMacro(SamplingStep,unsigned int);
+
+  /**
+   * Set the number of recently generated slices that are kept, so that
+   * returning to one of them copies it instead of slicing the input again.
+   * The default is zero, except for inputs whose pixel accessor computes
+   * a derived quantity, such as the magnitude of a vector image, for which
+   * recomputing a slice is costly.
+   */
+  itkSetMacro(SliceCacheSize,unsigned int);
+  itkGetMacro(SliceCacheSize,unsigned int);
+
   /** Add a second `preview' input to the slicer. The slicer will check if
     the preview input is newer than the main input, and if so, will obtain
     the data from the preview input. This is used in the speed preview
@@ -170,6 +194,24 @@ protected:
 
   template <class TSourceImage> void DoGenerateData(const TSourceImage *source);
 
+  /** First voxel of the i-th block along direction d of the output slice,
+    * counted in the direction of traversal */
+  long GetBlockStart(long i, unsigned int d) const;
+
+  // What a cached slice was generated from
+  struct SliceCacheKey
+  {
+    const itk::DataObject *source;
+    itk::ModifiedTimeType source_mtime;
+    unsigned int slice_index, axes[3], step;
+    bool forward[2];
+    OutputImageRegionType region;
+
+    bool operator == (const SliceCacheKey &other) const;
+  };
+
+  SliceCacheKey GetSliceCacheKey(const itk::DataObject *source) const;
+
 private:
   IRISSlicer(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -194,6 +236,13 @@ private:
 
   // Whether the main input should always be bypassed
   bool m_BypassMainInput;
+
+  // Number of voxels combined into one output pixel along each direction
+  unsigned int m_SamplingStep;
+
+  // Recently generated slices, the most recent first
+  unsigned int m_SliceCacheSize;
+  std::list<std::pair<SliceCacheKey, std::vector<OutputComponentType> > > m_SliceCache;
   
   // The worker methods in this filter
   // void CopySliceLineForwardPixelForward(InputIteratorType, OutputImageType *);
@@ -266,6 +315,15 @@ public:
   itkSetMacro(PixelTraverseForward, bool);
   itkGetMacro(PixelTraverseForward, bool);
 
+  /**
+   * Set the sampling step. The slice is split into blocks as in the generic
+   * slicer, and each pixel of the output slice is the voxel at the center of
+   * its block, which is read from the runs without decoding the full slice.
+   * Labels are not averaged. The default is 1.
+   */
+  itkSetMacro(SamplingStep, unsigned int);
+  itkGetMacro(SamplingStep, unsigned int);
+
   /** Add a second `preview' input to the slicer. The slicer will check if
     the preview input is newer than the main input, and if so, will obtain
     the data from the preview input. This is used in the speed preview
@@ -337,6 +395,13 @@ protected:
         }
   }
 
+  /** First voxel of the i-th block along direction d of the output slice,
+    * counted in the direction of traversal */
+  long GetBlockStart(long i, unsigned int d) const;
+
+  /** Generate the output slice when the sampling step is more than one */
+  void GenerateSampledData(const InputImageType *inputPtr);
+
 private:
   IRISSlicer(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -362,6 +427,9 @@ private:
   // Whether the main input should always be bypassed
   bool m_BypassMainInput;
 
+  // Number of voxels combined into one output pixel along each direction
+  unsigned int m_SamplingStep;
+
 };
 
 #ifndef ITK_MANUAL_INSTANTIATION
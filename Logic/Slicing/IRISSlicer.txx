@@ -38,6 +38,10 @@
 #include "itkImage.h"
 #include "itkVectorImage.h"
 #include "itkVectorImageToImageAdaptor.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
 
 template <class TImage>
 class IRISSlicerComponentHelper
@@ -57,6 +61,99 @@ public:
 };
 
 
+/**
+ * Detects pixel accessors that can compute a whole line of a slice at once
+ * through a GetLine() method, such as the accessors that compute derived
+ * quantities (magnitude, maximum, mean) of vector images.
+ */
+template <class TAccessor, class TComponent, class TOutputPixel, class Enable = void>
+class IRISSlicerLineAccess
+{
+public:
+  static const bool HasLineAccess = false;
+};
+
+template <class TAccessor, class TComponent, class TOutputPixel>
+class IRISSlicerLineAccess<TAccessor, TComponent, TOutputPixel, std::void_t<decltype(
+    std::declval<const TAccessor &>().GetLine(
+      std::declval<const TComponent *>(), 0L, std::declval<TOutputPixel *>(), 0u))> >
+{
+public:
+  static const bool HasLineAccess = true;
+};
+
+/**
+ * Combines the voxels of a block into one pixel when the slice is sampled
+ * with a step greater than one. Pixels of arithmetic types and vectors of
+ * them are averaged; other types are not, and the voxel at the center of
+ * the block is used instead.
+ */
+template <class TPixel, class Enable = void>
+class IRISSlicerBlockAverager
+{
+public:
+  static const bool IsAveraging = false;
+  void Reset() {}
+  void Add(const TPixel &) {}
+  TPixel Get() const { return TPixel(); }
+};
+
+template <class TPixel>
+class IRISSlicerBlockAverager<TPixel, typename std::enable_if<std::is_arithmetic<TPixel>::value>::type>
+{
+public:
+  static const bool IsAveraging = true;
+  void Reset() { m_Sum = 0.0; m_Count = 0; }
+  void Add(const TPixel &value) { m_Sum += value; m_Count++; }
+  TPixel Get() const
+  {
+    double mean = m_Sum / m_Count;
+    return std::is_integral<TPixel>::value
+        ? static_cast<TPixel>(std::floor(mean + 0.5))
+        : static_cast<TPixel>(mean);
+  }
+
+private:
+  double m_Sum = 0.0;
+  unsigned int m_Count = 0;
+};
+
+template <class TComponent>
+class IRISSlicerBlockAverager<itk::VariableLengthVector<TComponent>,
+                              typename std::enable_if<std::is_arithmetic<TComponent>::value>::type>
+{
+public:
+  typedef itk::VariableLengthVector<TComponent> PixelType;
+
+  static const bool IsAveraging = true;
+  void Reset() { m_Sum.clear(); m_Count = 0; }
+  void Add(const PixelType &value)
+  {
+    if(m_Sum.empty())
+      m_Sum.resize(value.Size(), 0.0);
+    for(unsigned int c = 0; c < m_Sum.size(); c++)
+      m_Sum[c] += value[c];
+    m_Count++;
+  }
+
+  PixelType Get() const
+  {
+    PixelType result(m_Sum.size());
+    for(unsigned int c = 0; c < m_Sum.size(); c++)
+      {
+      double mean = m_Sum[c] / m_Count;
+      result[c] = std::is_integral<TComponent>::value
+          ? static_cast<TComponent>(std::floor(mean + 0.5))
+          : static_cast<TComponent>(mean);
+      }
+    return result;
+  }
+
+private:
+  std::vector<double> m_Sum;
+  unsigned int m_Count = 0;
+};
+
 template <class TInputImage, class TOutputImage, class TPreviewImage>
 IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
 ::IRISSlicer()
@@ -83,6 +180,14 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   m_SliceIndex = 0;
 
   m_BypassMainInput = false;
+
+  // Sample at the resolution of the input
+  m_SamplingStep = 1;
+
+  // Only keep the slices of derived quantities, which are costly to compute
+  typedef IRISSlicerLineAccess<typename InputImageType::AccessorType,
+                               InputComponentType, OutputPixelType> LineAccess;
+  m_SliceCacheSize = LineAccess::HasLineAccess ? 4 : 0;
 }
 
 template <class TInputImage, class TOutputImage, class TPreviewImage>
@@ -104,16 +209,22 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   double outputSpacing[2];
   double outputOrigin[2] = {0.0,0.0};
 
-  // Initialize the output image region
+  // Initialize the output image region. With a sampling step, there is one
+  // pixel for each block of voxels
   OutputImageRegionType outputRegion;
   outputRegion.SetIndex(0,inputRegion.GetIndex(m_PixelDirectionImageAxis));
-  outputRegion.SetSize(0,inputRegion.GetSize(m_PixelDirectionImageAxis));
+  outputRegion.SetSize(0,
+    (inputRegion.GetSize(m_PixelDirectionImageAxis) + m_SamplingStep - 1) / m_SamplingStep);
   outputRegion.SetIndex(1,inputRegion.GetIndex(m_LineDirectionImageAxis));
-  outputRegion.SetSize(1,inputRegion.GetSize(m_LineDirectionImageAxis));
+  outputRegion.SetSize(1,
+    (inputRegion.GetSize(m_LineDirectionImageAxis) + m_SamplingStep - 1) / m_SamplingStep);
 
-  // Set the origin and spacing
-  outputSpacing[0] = inputPtr->GetSpacing()[m_PixelDirectionImageAxis];
-  outputSpacing[1] = inputPtr->GetSpacing()[m_LineDirectionImageAxis];
+  // Set the origin and spacing. The blocks exactly cover the input slice, so
+  // that the output slice has the same physical extent
+  outputSpacing[0] = inputPtr->GetSpacing()[m_PixelDirectionImageAxis]
+      * inputRegion.GetSize(m_PixelDirectionImageAxis) / std::max(1ul, (unsigned long) outputRegion.GetSize(0));
+  outputSpacing[1] = inputPtr->GetSpacing()[m_LineDirectionImageAxis]
+      * inputRegion.GetSize(m_LineDirectionImageAxis) / std::max(1ul, (unsigned long) outputRegion.GetSize(1));
 
   // Set the region of the output slice
   outputPtr->SetLargestPossibleRegion(outputRegion);
@@ -144,41 +255,39 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   // the case when the output region is not equal to the largest possible
   // region (i.e., we are requesting a partial slice)
 
-  // The size of the region does not depend of the direction of axis
-  // traversal
-  destRegion.SetSize(m_PixelDirectionImageAxis,srcRegion.GetSize(0));
-  destRegion.SetSize(m_LineDirectionImageAxis,srcRegion.GetSize(1));
-
-  // However, the index of the region does depend on the direction!
-  if(m_PixelTraverseForward)
-    {
-    destRegion.SetIndex(m_PixelDirectionImageAxis,srcRegion.GetIndex(0));
-    }
-  else
+  // Each output pixel covers a block of voxels, so the range [i,...,i+s-1]
+  // in the output image corresponds to the range [t0,...,t1-1] along the
+  // direction of traversal, from the first voxel of block i to the last voxel
+  // of block i+s-1. The size of the region does not depend of the direction
+  // of axis traversal
+  const unsigned int axes[2] = { m_PixelDirectionImageAxis, m_LineDirectionImageAxis };
+  const bool forward[2] = { m_PixelTraverseForward, m_LineTraverseForward };
+  for(unsigned int d = 0; d < 2; d++)
     {
-    // This case is a bit trickier.  The axis direction is reversed, so
-    // range [i,...,i+s-1] in the output image corresponds to the range
-    // [S-(i+s),S-(i+1)] in the input image, where i is the in-slice index,
-    // S is the largest size of the input and s is the requested size of the
-    // output
-    destRegion.SetIndex(
-      m_PixelDirectionImageAxis,
-      this->GetInput()->GetLargestPossibleRegion().GetSize(m_PixelDirectionImageAxis)
-      - (srcRegion.GetIndex(0) + srcRegion.GetSize(0)));
+    long S = this->GetInput()->GetLargestPossibleRegion().GetSize(axes[d]);
+    long t0 = this->GetBlockStart(srcRegion.GetIndex(d), d);
+    long t1 = this->GetBlockStart(srcRegion.GetIndex(d) + srcRegion.GetSize(d), d);
+    destRegion.SetSize(axes[d], t1 - t0);
+
+    // However, the index of the region does depend on the direction! When
+    // the axis direction is reversed, range [t0,...,t1-1] of the traversal
+    // corresponds to the range [S-t1,...,S-t0-1] in the input image, where S
+    // is the largest size of the input
+    destRegion.SetIndex(axes[d], forward[d] ? t0 : S - t1);
     }
+}
 
-  // Same as above for line index
-  if(m_LineTraverseForward)
-    {
-    destRegion.SetIndex(m_LineDirectionImageAxis,srcRegion.GetIndex(1));
-    }
-  else
-    {
-    destRegion.SetIndex(
-      m_LineDirectionImageAxis,
-      this->GetInput()->GetLargestPossibleRegion().GetSize(m_LineDirectionImageAxis)
-      - (srcRegion.GetIndex(1) + srcRegion.GetSize(1)));
-    }
+template <class TInputImage, class TOutputImage, class TPreviewImage>
+long
+IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
+::GetBlockStart(long i, unsigned int d) const
+{
+  // A line of n voxels is split into m = ceil(n/k) blocks, block i starting
+  // at voxel floor(i*n/m). The blocks have k or k-1 voxels
+  unsigned int axis = d == 0 ? m_PixelDirectionImageAxis : m_LineDirectionImageAxis;
+  long n = this->GetInput()->GetLargestPossibleRegion().GetSize(axis);
+  long m = (n + m_SamplingStep - 1) / m_SamplingStep;
+  return m > 0 ? std::clamp(i, 0l, m) * n / m : 0;
 }
 
 template <class TInputImage, class TOutputImage, class TPreviewImage>
@@ -303,6 +412,60 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   // Position the source at the first component of the first voxel to traverse
   pSource += iStart;
 
+  // When sampling with a step, each output pixel combines a block of voxels
+  if(m_SamplingStep > 1)
+    {
+    typedef IRISSlicerBlockAverager<OutputPixelType> AveragerType;
+    AveragerType averager;
+
+    auto read_voxel = [&](long pixel, long line) -> OutputPixelType
+      {
+      const ComponentType *p = pSource + pixel * sPixel + line * sLine;
+      accessor_functor.SetBegin(p);
+      return accessor_functor.Get(*p);
+      };
+
+    // The blocks are numbered from the start of the largest possible region,
+    // which the buffered region of the output may not start at
+    typename OutputImageType::IndexType idxStart =
+        outputPtr->GetLargestPossibleRegion().GetIndex();
+    for(; !it_out.IsAtEnd(); it_out.NextLine())
+      {
+      long j = it_out.GetIndex()[1] - idxStart[1];
+      long l0 = this->GetBlockStart(j, 1), l1 = this->GetBlockStart(j + 1, 1);
+      for(; !it_out.IsAtEndOfLine(); ++it_out)
+        {
+        long i = it_out.GetIndex()[0] - idxStart[0];
+        long p0 = this->GetBlockStart(i, 0), p1 = this->GetBlockStart(i + 1, 0);
+        if(AveragerType::IsAveraging)
+          {
+          averager.Reset();
+          for(long l = l0; l < l1; l++)
+            for(long p = p0; p < p1; p++)
+              averager.Add(read_voxel(p, l));
+          it_out.Set(averager.Get());
+          }
+        else
+          {
+          it_out.Set(read_voxel((p0 + p1) / 2, (l0 + l1) / 2));
+          }
+        }
+      }
+    return;
+    }
+
+  // Accessors that compute derived quantities do so for a line at a time
+  typedef IRISSlicerLineAccess<AccessorType, ComponentType, OutputPixelType> LineAccess;
+  if constexpr(LineAccess::HasLineAccess)
+    {
+    const OutputImageRegionType &rOut = outputPtr->GetBufferedRegion();
+    long width = rOut.GetSize(0), height = rOut.GetSize(1);
+    OutputPixelType *pOut = outputPtr->GetBufferPointer();
+    for(long j = 0; j < height; j++, pSource += sLine, pOut += width)
+      accessor.GetLine(pSource, sPixel, pOut, width);
+    return;
+    }
+
   // Main loop: copy data from source to target
   while(!it_out.IsAtEnd())
     {
@@ -336,8 +499,30 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   const PreviewImageType *preview =
       (PreviewImageType *) this->GetInputs()[1].GetPointer();
 
-  if(preview &&
-     (m_BypassMainInput || preview->GetMTime() > inputPtr->GetMTime()))
+  bool use_preview = preview &&
+      (m_BypassMainInput || preview->GetMTime() > inputPtr->GetMTime());
+
+  // Reuse a recently generated slice if there is one
+  SliceCacheKey key{};
+  if(m_SliceCacheSize > 0)
+    {
+    key = this->GetSliceCacheKey(use_preview
+                                 ? static_cast<const itk::DataObject *>(preview)
+                                 : static_cast<const itk::DataObject *>(inputPtr));
+    for(auto it = m_SliceCache.begin(); it != m_SliceCache.end(); ++it)
+      {
+      if(it->first == key)
+        {
+        this->AllocateOutputs();
+        std::copy(it->second.begin(), it->second.end(),
+                  this->GetOutput()->GetBufferPointer());
+        m_SliceCache.splice(m_SliceCache.begin(), m_SliceCache, it);
+        return;
+        }
+      }
+    }
+
+  if(use_preview)
     {
     this->DoGenerateData(preview);
     }
@@ -345,6 +530,49 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
     {
     this->DoGenerateData(inputPtr);
     }
+
+  // Keep the new slice, dropping the least recently used one
+  if(m_SliceCacheSize > 0)
+    {
+    OutputImageType *output = this->GetOutput();
+    const OutputComponentType *buffer = output->GetBufferPointer();
+    m_SliceCache.emplace_front(
+          key, std::vector<OutputComponentType>(
+            buffer, buffer + output->GetPixelContainer()->Size()));
+    while(m_SliceCache.size() > m_SliceCacheSize)
+      m_SliceCache.pop_back();
+    }
+}
+
+template <class TInputImage, class TOutputImage, class TPreviewImage>
+typename IRISSlicer<TInputImage, TOutputImage, TPreviewImage>::SliceCacheKey
+IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
+::GetSliceCacheKey(const itk::DataObject *source) const
+{
+  SliceCacheKey key;
+  key.source = source;
+  key.source_mtime = source->GetMTime();
+  key.slice_index = m_SliceIndex;
+  key.axes[0] = m_PixelDirectionImageAxis;
+  key.axes[1] = m_LineDirectionImageAxis;
+  key.axes[2] = m_SliceDirectionImageAxis;
+  key.step = m_SamplingStep;
+  key.forward[0] = m_PixelTraverseForward;
+  key.forward[1] = m_LineTraverseForward;
+  key.region = this->GetOutput()->GetRequestedRegion();
+  return key;
+}
+
+template <class TInputImage, class TOutputImage, class TPreviewImage>
+bool
+IRISSlicer<TInputImage, TOutputImage, TPreviewImage>::SliceCacheKey
+::operator == (const SliceCacheKey &other) const
+{
+  return source == other.source && source_mtime == other.source_mtime
+      && slice_index == other.slice_index && step == other.step
+      && std::equal(axes, axes + 3, other.axes)
+      && std::equal(forward, forward + 2, other.forward)
+      && region == other.region;
 }
 
 template <class TInputImage, class TOutputImage, class TPreviewImage>
@@ -360,6 +588,8 @@ IRISSlicer<TInputImage, TOutputImage, TPreviewImage>
   os << indent << "Lines Traversed Forward: " << m_LineTraverseForward << std::endl;
   os << indent << "Pixel Image Axis: " << m_PixelDirectionImageAxis << std::endl;
   os << indent << "Pixels Traversed Forward: " << m_PixelTraverseForward << std::endl;
+  os << indent << "Sampling Step: " << m_SamplingStep << std::endl;
+  os << indent << "Slice Cache Size: " << m_SliceCacheSize << std::endl;
 }
 
 template <class TInputImage, class TOutputImage, class TPreviewImage>
@@ -38,6 +38,8 @@
 #include "itkImage.h"
 #include "itkVectorImage.h"
 #include "itkVectorImageToImageAdaptor.h"
+#include <algorithm>
+#include <vector>
 
 //now goes version specialized for RLEImage
 template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
@@ -64,6 +66,9 @@ IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
 
   // Initialize to a zero slice index
   m_SliceIndex = 0;
+
+  // Sample at the resolution of the input
+  m_SamplingStep = 1;
 }
 
 template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
@@ -84,16 +89,22 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
   double outputSpacing[2];
   double outputOrigin[2] = { 0.0, 0.0 };
 
-  // Initialize the output image region
+  // Initialize the output image region. With a sampling step, there is one
+  // pixel for each block of voxels
   OutputImageRegionType outputRegion;
   outputRegion.SetIndex(0, inputRegion.GetIndex(m_PixelDirectionImageAxis));
-  outputRegion.SetSize(0, inputRegion.GetSize(m_PixelDirectionImageAxis));
+  outputRegion.SetSize(0,
+    (inputRegion.GetSize(m_PixelDirectionImageAxis) + m_SamplingStep - 1) / m_SamplingStep);
   outputRegion.SetIndex(1, inputRegion.GetIndex(m_LineDirectionImageAxis));
-  outputRegion.SetSize(1, inputRegion.GetSize(m_LineDirectionImageAxis));
+  outputRegion.SetSize(1,
+    (inputRegion.GetSize(m_LineDirectionImageAxis) + m_SamplingStep - 1) / m_SamplingStep);
 
-  // Set the origin and spacing
-  outputSpacing[0] = inputPtr->GetSpacing()[m_PixelDirectionImageAxis];
-  outputSpacing[1] = inputPtr->GetSpacing()[m_LineDirectionImageAxis];
+  // Set the origin and spacing. The blocks exactly cover the input slice, so
+  // that the output slice has the same physical extent
+  outputSpacing[0] = inputPtr->GetSpacing()[m_PixelDirectionImageAxis]
+      * inputRegion.GetSize(m_PixelDirectionImageAxis) / std::max(1ul, (unsigned long) outputRegion.GetSize(0));
+  outputSpacing[1] = inputPtr->GetSpacing()[m_LineDirectionImageAxis]
+      * inputRegion.GetSize(m_LineDirectionImageAxis) / std::max(1ul, (unsigned long) outputRegion.GetSize(1));
 
   // Set the region of the output slice
   outputPtr->SetLargestPossibleRegion(outputRegion);
@@ -118,40 +129,25 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
   // the case when the output region is not equal to the largest possible
   // region (i.e., we are requesting a partial slice)
 
-  // The size of the region does not depend of the direction of axis
-  // traversal
-  destRegion.SetSize(m_PixelDirectionImageAxis, srcRegion.GetSize(0));
-  destRegion.SetSize(m_LineDirectionImageAxis, srcRegion.GetSize(1));
-
-  // However, the index of the region does depend on the direction!
-  if (m_PixelTraverseForward)
+  // Each output pixel covers a block of voxels, so the range [i,...,i+s-1]
+  // in the output image corresponds to the range [t0,...,t1-1] along the
+  // direction of traversal, from the first voxel of block i to the last voxel
+  // of block i+s-1. The size of the region does not depend of the direction
+  // of axis traversal
+  const unsigned int axes[2] = { m_PixelDirectionImageAxis, m_LineDirectionImageAxis };
+  const bool forward[2] = { m_PixelTraverseForward, m_LineTraverseForward };
+  for (unsigned int d = 0; d < 2; d++)
     {
-    destRegion.SetIndex(m_PixelDirectionImageAxis, srcRegion.GetIndex(0));
-    }
-  else
-    {
-    // This case is a bit trickier.  The axis direction is reversed, so
-    // range [i,...,i+s-1] in the output image corresponds to the range
-    // [S-(i+s),S-(i+1)] in the input image, where i is the in-slice index,
-    // S is the largest size of the input and s is the requested size of the
-    // output
-    destRegion.SetIndex(
-          m_PixelDirectionImageAxis,
-          this->GetInput()->GetLargestPossibleRegion().GetSize(m_PixelDirectionImageAxis)
-          - (srcRegion.GetIndex(0) + srcRegion.GetSize(0)));
-    }
-
-  // Same as above for line index
-  if (m_LineTraverseForward)
-    {
-    destRegion.SetIndex(m_LineDirectionImageAxis, srcRegion.GetIndex(1));
-    }
-  else
-    {
-    destRegion.SetIndex(
-          m_LineDirectionImageAxis,
-          this->GetInput()->GetLargestPossibleRegion().GetSize(m_LineDirectionImageAxis)
-          - (srcRegion.GetIndex(1) + srcRegion.GetSize(1)));
+    long S = this->GetInput()->GetLargestPossibleRegion().GetSize(axes[d]);
+    long t0 = this->GetBlockStart(srcRegion.GetIndex(d), d);
+    long t1 = this->GetBlockStart(srcRegion.GetIndex(d) + srcRegion.GetSize(d), d);
+    destRegion.SetSize(axes[d], t1 - t0);
+
+    // However, the index of the region does depend on the direction! When
+    // the axis direction is reversed, range [t0,...,t1-1] of the traversal
+    // corresponds to the range [S-t1,...,S-t0-1] in the input image, where S
+    // is the largest size of the input
+    destRegion.SetIndex(axes[d], forward[d] ? t0 : S - t1);
     }
 }
 
@@ -217,6 +213,13 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
 
   this->AllocateOutputs();
 
+  // Sampling with a step is handled separately
+  if (m_SamplingStep > 1)
+    {
+    this->GenerateSampledData(inputPtr);
+    return;
+    }
+
   // Important: the size needs to be cast to long to avoid problems with
   // pointer arithmetic on some MSVC versions!
   long szVol[3];
@@ -315,6 +318,101 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
     }
 }
 
+template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
+long IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
+::GetBlockStart(long i, unsigned int d) const
+{
+  // Same blocks as in the generic slicer: a line of n voxels is split into
+  // m = ceil(n/k) blocks, block i starting at voxel floor(i*n/m)
+  unsigned int axis = d == 0 ? m_PixelDirectionImageAxis : m_LineDirectionImageAxis;
+  long n = this->GetInput()->GetLargestPossibleRegion().GetSize(axis);
+  long m = (n + m_SamplingStep - 1) / m_SamplingStep;
+  return m > 0 ? std::clamp(i, 0l, m) * n / m : 0;
+}
+
+template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
+void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
+::GenerateSampledData(const InputImageType *inputPtr)
+{
+  OutputImageType *outputPtr = this->GetOutput();
+  typedef typename OutputImageType::PixelType OutputPixelType;
+
+  // Labels can not be averaged, so each output pixel takes the value of the
+  // voxel at the center of its block. Find the image coordinates of these
+  // voxels for the pixel (d = 0) and line (d = 1) directions of the slice
+  const OutputImageRegionType &rOut = outputPtr->GetBufferedRegion();
+  const typename OutputImageType::IndexType idxStart = outputPtr->GetLargestPossibleRegion().GetIndex();
+  const unsigned int axes[2] = { m_PixelDirectionImageAxis, m_LineDirectionImageAxis };
+  const bool forward[2] = { m_PixelTraverseForward, m_LineTraverseForward };
+  long szSlice[2];
+  std::vector<long> center[2];
+  for (unsigned int d = 0; d < 2; d++)
+    {
+    long n = inputPtr->GetLargestPossibleRegion().GetSize(axes[d]);
+    szSlice[d] = rOut.GetSize(d);
+    center[d].resize(szSlice[d]);
+    for (long i = 0; i < szSlice[d]; i++)
+      {
+      long b = rOut.GetIndex(d) + i - idxStart[d];
+      long t = (this->GetBlockStart(b, d) + this->GetBlockStart(b + 1, d)) / 2;
+      center[d][i] = forward[d] ? t : n - 1 - t;
+      }
+    }
+
+  OutputPixelType *outSlice = outputPtr->GetBufferPointer();
+  if (m_SliceDirectionImageAxis == 0) //slicing along x, one voxel from each line
+    {
+#pragma omp parallel for
+    for (long j = 0; j < szSlice[1]; j++)
+      for (long i = 0; i < szSlice[0]; i++)
+        {
+        long pos[3];
+        pos[axes[0]] = center[0][i];
+        pos[axes[1]] = center[1][j];
+        typename InputImageType::BufferType::IndexType lineIndex = { { pos[1], pos[2] } };
+        const typename InputImageType::RLLine & line = inputPtr->GetBuffer()->GetPixel(lineIndex);
+        long t = 0;
+        for (size_t r = 0; r < line.size(); r++)
+          {
+          t += line[r].first;
+          if (t > m_SliceIndex)
+            {
+            outSlice[j * szSlice[0] + i] = line[r].second;
+            break;
+            }
+          }
+        }
+    }
+  else
+    {
+    // The run-length lines are along x, which is the pixel or the line
+    // direction of the slice (dx). Each sampled line fills a row or a column
+    // of the output, walking its runs once to pick the sampled voxels
+    unsigned int dx = (axes[0] == 0) ? 0 : 1, dy = 1 - dx;
+#pragma omp parallel for
+    for (long b = 0; b < szSlice[dy]; b++)
+      {
+      long pos[3];
+      pos[m_SliceDirectionImageAxis] = m_SliceIndex;
+      pos[axes[dy]] = center[dy][b];
+      typename InputImageType::BufferType::IndexType lineIndex = { { pos[1], pos[2] } };
+      const typename InputImageType::RLLine & line = inputPtr->GetBuffer()->GetPixel(lineIndex);
+
+      // Visit the sampled voxels in the order of increasing x
+      size_t r = 0;
+      long run_end = line[0].first;
+      for (long q = 0; q < szSlice[dx]; q++)
+        {
+        long a = forward[dx] ? q : szSlice[dx] - 1 - q;
+        while (center[dx][a] >= run_end)
+          run_end += line[++r].first;
+        long i = (dx == 0) ? a : b, j = (dx == 0) ? b : a;
+        outSlice[j * szSlice[0] + i] = line[r].second;
+        }
+      }
+    }
+}
+
 //template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
 //void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
 //::AfterThreadedGenerateData()
@@ -334,6 +432,7 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
   os << indent << "Lines Traversed Forward: " << m_LineTraverseForward << std::endl;
   os << indent << "Pixel Image Axis: " << m_PixelDirectionImageAxis << std::endl;
   os << indent << "Pixels Traversed Forward: " << m_PixelTraverseForward << std::endl;
+  os << indent << "Sampling Step: " << m_SamplingStep << std::endl;
 }
 
 template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
@@ -54,6 +54,32 @@ RGBALookupTableIntensityMappingFilter<TInputImage>
     }
 }
 
+template<class TInputImage>
+void
+RGBALookupTableIntensityMappingFilter<TInputImage>
+::MapLineXYZtoRGB(
+    const InputPixelType *xin0, const InputPixelType *xin1, const InputPixelType *xin2,
+    long n, const LookupTableType *lut, bool zero_out_of_range, OutputPixelType *xout)
+{
+    // Same as MapPixelXYZtoRGB, with the channels written directly into the
+    // interleaved output so that no pixel objects are constructed
+    unsigned char *out = reinterpret_cast<unsigned char *>(xout);
+    for(long i = 0; i < n; i++, out += 4)
+    {
+        if(zero_out_of_range && xin0[i] == 0 && xin1[i] == 0 && xin2[i] == 0)
+        {
+            out[0] = out[1] = out[2] = out[3] = 0;
+        }
+        else
+        {
+            out[0] = lut->MapIntensityToDisplay(xin0[i]);
+            out[1] = lut->MapIntensityToDisplay(xin1[i]);
+            out[2] = lut->MapIntensityToDisplay(xin2[i]);
+            out[3] = 255; // alpha = 1
+        }
+    }
+}
+
 template<class TInputImage>
 void
 RGBALookupTableIntensityMappingFilter<TInputImage>
@@ -136,30 +162,22 @@ RGBALookupTableIntensityMappingFilter<TInputImage>
   }
   else
   {
-      // Standard XYZ to RGB mapping mode
-
-      // Get all the inputs
-      std::vector<const InputImageType *> inputs(3);
+      // Standard XYZ to RGB mapping mode. The three slices have the same
+      // layout as the output, so the mapping is done a line at a time
+      const InputImageType *inputs[3];
       for(int d = 0; d < 3; d++)
           inputs[d] = this->GetInput(d);
 
-      // Define the iterators
-      typedef itk::ImageRegionConstIterator<InputImageType> InputIteratorType;
-      InputIteratorType it0(inputs[0], region);
-      InputIteratorType it1(inputs[1], region);
-      InputIteratorType it2(inputs[2], region);
-
-      // Perform the intensity mapping using the LUT (no bounds checking!)
-      while( !outputIt.IsAtEnd() )
+      long width = region.GetSize(0);
+      typename OutputImageType::IndexType idx = region.GetIndex();
+      for(unsigned long j = 0; j < region.GetSize(1); j++, idx[1]++)
       {
-          OutputPixelType xout;
-          InputPixelType xin0 = it0.Get();
-          InputPixelType xin1 = it1.Get();
-          InputPixelType xin2 = it2.Get();
-          this->MapPixelXYZtoRGB(xin0, xin1, xin2, lut, zero_out_of_range, xout);
-          outputIt.Set(xout);
-          ++it0; ++it1; ++it2;
-          ++outputIt;
+          this->MapLineXYZtoRGB(
+                inputs[0]->GetBufferPointer() + inputs[0]->ComputeOffset(idx),
+                inputs[1]->GetBufferPointer() + inputs[1]->ComputeOffset(idx),
+                inputs[2]->GetBufferPointer() + inputs[2]->ComputeOffset(idx),
+                width, lut, zero_out_of_range,
+                output->GetBufferPointer() + output->ComputeOffset(idx));
       }
   }
 }
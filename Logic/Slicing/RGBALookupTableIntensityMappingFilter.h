@@ -67,6 +67,9 @@ protected:
   void MapPixelXYZtoRGB(
       InputPixelType xin0, InputPixelType xin1, InputPixelType xin2,
       const LookupTableType *lut, bool zero_out_of_range, OutputPixelType &xout);
+  void MapLineXYZtoRGB(
+      const InputPixelType *xin0, const InputPixelType *xin1, const InputPixelType *xin2,
+      long n, const LookupTableType *lut, bool zero_out_of_range, OutputPixelType *xout);
   void MapPixelXYtoHSV(
       InputPixelType xin0, InputPixelType xin1,
       const LookupTableType *lut, bool zero_out_of_range, OutputPixelType &xout);
@@ -2,6 +2,11 @@
 #include <sstream>
 #include <fstream>
 #include <cstdarg>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 #include "IRISException.h"
 #include "itksys/SystemTools.hxx"
 #include "itksys/MD5.h"
@@ -35,16 +40,17 @@ progress_callback(void *clientp, double dltotal, double dlnow, double ultotal, d
   return 0;
 }
 
+// The client data is an array of mutexes, one for each curl_lock_data
 void mutex_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *clientp)
 {
   std::mutex* m = static_cast<std::mutex*>(clientp);
-  m->lock();
+  m[data].lock();
 }
 
 void mutex_unlock(CURL *handle, curl_lock_data data, curl_lock_access access, void *clientp)
 {
   std::mutex* m = static_cast<std::mutex*>(clientp);
-  m->unlock();
+  m[data].unlock();
 }
 
 
@@ -55,8 +61,16 @@ using namespace std;
 template <class ServerTraits>
 RESTSharedData<ServerTraits>::RESTSharedData()
 {
+  static_assert(CURL_LOCK_DATA_LAST <= NumberOfLocks, "Not enough locks for CURL shared data");
+
+  // Must happen before clients are used on several threads
+  curl_global_init(CURL_GLOBAL_DEFAULT);
   m_CurlShare = curl_share_init();
 
+  // Keep name lookups between requests. The connection cache is not shared,
+  // because curl does not support using it from several threads at once.
+  curl_share_setopt(m_CurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
   if constexpr(ServerTraits::IncludeCookiesInCurlShare)
     curl_share_setopt(m_CurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
 
@@ -65,7 +79,7 @@ RESTSharedData<ServerTraits>::RESTSharedData()
 
   curl_share_setopt(m_CurlShare, CURLSHOPT_LOCKFUNC, RESTClient_internal::mutex_lock);
   curl_share_setopt(m_CurlShare, CURLSHOPT_UNLOCKFUNC, RESTClient_internal::mutex_unlock);
-  curl_share_setopt(m_CurlShare, CURLSHOPT_USERDATA, &m_Mutex);
+  curl_share_setopt(m_CurlShare, CURLSHOPT_USERDATA, m_Mutex);
 }
 
 template <class ServerTraits>
@@ -74,8 +88,12 @@ RESTSharedData<ServerTraits>::~RESTSharedData()
   curl_share_setopt(m_CurlShare, CURLSHOPT_LOCKFUNC, nullptr);
   curl_share_setopt(m_CurlShare, CURLSHOPT_UNLOCKFUNC, nullptr);
   curl_share_cleanup(m_CurlShare);
+  curl_global_cleanup();
 }
 
+template <class ServerTraits>
+typename RESTClient<ServerTraits>::SharedData *RESTClient<ServerTraits>::m_DefaultSharedData = nullptr;
+
 
 template <typename ServerTraits>
 RESTClient<ServerTraits>::RESTClient(SharedData *sd)
@@ -84,10 +102,12 @@ RESTClient<ServerTraits>::RESTClient(SharedData *sd)
   m_Curl = curl_easy_init();
 
   // Sharing business
+  if(!sd)
+    sd = m_DefaultSharedData;
   if(sd)
   {
     m_SharedData = sd;
-    curl_easy_setopt(m_Curl, CURLOPT_SHARE, m_SharedData);
+    curl_easy_setopt(m_Curl, CURLOPT_SHARE, m_SharedData->GetShare());
   }
 
   // Error buffer
@@ -515,6 +535,336 @@ RESTClient<ServerTraits>::UploadFile(const char              *rel_url,
   return m_HTTPCode == 200L;
 }
 
+namespace RESTClient_internal
+{
+
+/** MD5 hash of a block of memory as a hex string */
+std::string md5_hex(const char *data, size_t size)
+{
+  char hex_code[33];
+  hex_code[32] = 0;
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, (const unsigned char *) data, (int) size);
+  itksysMD5_FinalizeHex(md5, hex_code);
+  itksysMD5_Delete(md5);
+  return hex_code;
+}
+
+/** MD5 hash of a file as a hex string, reading the file a block at a time */
+std::string md5_hex_file(const std::string &filename)
+{
+  std::ifstream fin(filename.c_str(), std::ios::binary);
+  if(!fin)
+    throw IRISException("Unable to read file %s", filename.c_str());
+
+  char hex_code[33];
+  hex_code[32] = 0;
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  std::vector<char> buffer(1 << 20);
+  while(fin)
+  {
+    fin.read(buffer.data(), buffer.size());
+    if(fin.gcount() > 0)
+      itksysMD5_Append(md5, (const unsigned char *) buffer.data(), (int) fin.gcount());
+  }
+  itksysMD5_FinalizeHex(md5, hex_code);
+  itksysMD5_Delete(md5);
+  return hex_code;
+}
+
+/** A file being sent by UploadFiles */
+struct UploadFileInfo
+{
+  std::string full_path, name, md5;
+  size_t size = 0, n_chunks = 1;
+};
+
+/** A single transfer (whole file or chunk) made by UploadFiles */
+struct UploadTransfer
+{
+  UploadFileInfo *file = nullptr;
+  size_t chunk = 0, offset = 0, size = 0;
+  unsigned int attempts = 0;
+  std::chrono::steady_clock::time_point not_before;
+
+  CURL *handle = nullptr;
+  curl_mime *mime = nullptr;
+  std::string response;
+  char error[CURL_ERROR_SIZE];
+};
+
+size_t upload_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+  static_cast<std::string *>(userp)->append((char *) contents, size * nmemb);
+  return size * nmemb;
+}
+
+} // namespace RESTClient_internal
+
+template <typename ServerTraits>
+bool
+RESTClient<ServerTraits>::UploadFiles(const char *rel_url, const std::vector<std::string> &filenames, ...)
+{
+  using namespace RESTClient_internal;
+  typedef std::chrono::steady_clock Clock;
+
+  // Expand the URL
+  std::va_list args;
+  va_start(args, filenames);
+  char url_buffer[4096];
+  vsnprintf(url_buffer, 4096, rel_url, args);
+  va_end(args);
+  string url = this->GetServerURL() + "/" + url_buffer;
+
+  // Describe the files and split the large ones into chunks. The MD5 of the
+  // whole file is only needed to assemble chunks on the server
+  std::vector<UploadFileInfo> files(filenames.size());
+  std::vector<UploadTransfer> transfers;
+  size_t total_bytes = 0;
+  for(size_t i = 0; i < filenames.size(); i++)
+  {
+    UploadFileInfo &fi = files[i];
+    fi.full_path = SystemTools::CollapseFullPath(filenames[i]);
+    fi.name = SystemTools::GetFilenameName(filenames[i]);
+    if(!SystemTools::FileExists(fi.full_path, true))
+      throw IRISException("Unable to read file %s", fi.full_path.c_str());
+    fi.size = (size_t) SystemTools::FileLength(fi.full_path);
+    total_bytes += fi.size;
+
+    if(m_UploadChunkSize > 0 && fi.size > m_UploadChunkSize)
+    {
+      fi.n_chunks = (fi.size + m_UploadChunkSize - 1) / m_UploadChunkSize;
+      fi.md5 = md5_hex_file(fi.full_path);
+    }
+
+    for(size_t c = 0; c < fi.n_chunks; c++)
+    {
+      UploadTransfer tr;
+      tr.file = &fi;
+      tr.chunk = c;
+      tr.offset = c * m_UploadChunkSize;
+      tr.size = (fi.n_chunks > 1) ? std::min(m_UploadChunkSize, fi.size - tr.offset) : fi.size;
+      transfers.push_back(tr);
+    }
+  }
+
+  // Transfers waiting to be started, in order, and transfers in flight
+  std::list<UploadTransfer *> queue, active;
+  for(auto &tr : transfers)
+    queue.push_back(&tr);
+
+  // Header stating that Expect: 100-continue is not wanted
+  struct curl_slist *headerlist = curl_slist_append(nullptr, "Expect:");
+
+  CURLM *multi = curl_multi_init();
+  size_t bytes_done = 0, bytes_sent = 0;
+  auto t_start = Clock::now();
+
+  // Release a transfer's CURL resources
+  auto release = [&](UploadTransfer *tr) {
+    curl_multi_remove_handle(multi, tr->handle);
+    curl_easy_cleanup(tr->handle);
+    curl_mime_free(tr->mime);
+    tr->handle = nullptr;
+    tr->mime = nullptr;
+  };
+
+  // Release everything that is still in flight
+  auto release_all = [&]() {
+    for(auto *tr : active)
+      release(tr);
+    active.clear();
+    curl_multi_cleanup(multi);
+    curl_slist_free_all(headerlist);
+  };
+
+  // Set up and start the transfer for a file or chunk
+  auto start = [&](UploadTransfer *tr) {
+    // Read the chunk before setting up the transfer
+    std::vector<char> buffer;
+    if(tr->file->n_chunks > 1)
+    {
+      buffer.resize(tr->size);
+      std::ifstream fin(tr->file->full_path.c_str(), std::ios::binary);
+      fin.seekg(tr->offset);
+      if(!fin.read(buffer.data(), tr->size))
+        throw IRISException("Unable to read file %s", tr->file->full_path.c_str());
+    }
+
+    tr->handle = curl_easy_init();
+    tr->error[0] = 0;
+    tr->response.clear();
+    tr->attempts++;
+
+    curl_easy_setopt(tr->handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(tr->handle, CURLOPT_ERRORBUFFER, tr->error);
+    if(m_SharedData)
+      curl_easy_setopt(tr->handle, CURLOPT_SHARE, m_SharedData->GetShare());
+    m_Traits.SetupCookies(m_SharedData ? m_SharedData->GetShare() : nullptr,
+                          tr->handle, GetServerURL().c_str(), m_ReceiveCookieMode);
+
+    // Same fields as UploadFile, plus the chunk description
+    tr->mime = curl_mime_init(tr->handle);
+    curl_mimepart *part = curl_mime_addpart(tr->mime);
+    curl_mime_name(part, "myfile");
+    curl_mime_filename(part, tr->file->name.c_str());
+    if(tr->file->n_chunks == 1)
+    {
+      curl_mime_filedata(part, tr->file->full_path.c_str());
+    }
+    else
+    {
+      curl_mime_data(part, buffer.data(), tr->size);
+      curl_mime_type(part, "application/octet-stream");
+
+      std::map<string, string> fields;
+      fields["chunk"] = std::to_string(tr->chunk);
+      fields["chunks"] = std::to_string(tr->file->n_chunks);
+      fields["offset"] = std::to_string(tr->offset);
+      fields["chunk_md5"] = md5_hex(buffer.data(), tr->size);
+      fields["file_md5"] = tr->file->md5;
+      fields["file_size"] = std::to_string(tr->file->size);
+      for(auto &it : fields)
+      {
+        part = curl_mime_addpart(tr->mime);
+        curl_mime_name(part, it.first.c_str());
+        curl_mime_data(part, it.second.c_str(), CURL_ZERO_TERMINATED);
+      }
+    }
+
+    part = curl_mime_addpart(tr->mime);
+    curl_mime_name(part, "filename");
+    curl_mime_data(part, tr->file->name.c_str(), CURL_ZERO_TERMINATED);
+
+    part = curl_mime_addpart(tr->mime);
+    curl_mime_name(part, "submit");
+    curl_mime_data(part, "send", CURL_ZERO_TERMINATED);
+
+    curl_easy_setopt(tr->handle, CURLOPT_HTTPHEADER, headerlist);
+    curl_easy_setopt(tr->handle, CURLOPT_MIMEPOST, tr->mime);
+    curl_easy_setopt(tr->handle, CURLOPT_WRITEFUNCTION, upload_write_callback);
+    curl_easy_setopt(tr->handle, CURLOPT_WRITEDATA, &tr->response);
+
+    curl_multi_add_handle(multi, tr->handle);
+    active.push_back(tr);
+  };
+
+  try
+  {
+    m_HTTPCode = 200L;
+    while(queue.size() || active.size())
+    {
+      // Start the transfers that are due, up to the maximum in flight
+      auto now = Clock::now();
+      for(auto it = queue.begin(); it != queue.end() && active.size() < m_MaxConcurrentUploads; )
+      {
+        if((*it)->not_before <= now)
+        {
+          start(*it);
+          it = queue.erase(it);
+        }
+        else ++it;
+      }
+
+      // Only delayed retries remain: wait for the first of them
+      if(active.empty())
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
+      }
+
+      // Make progress on the transfers and wait for activity
+      int running = 0;
+      curl_multi_perform(multi, &running);
+      curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+
+      // Handle the completed transfers
+      CURLMsg *msg;
+      int msgs_left;
+      while((msg = curl_multi_info_read(multi, &msgs_left)))
+      {
+        if(msg->msg != CURLMSG_DONE)
+          continue;
+
+        auto it = std::find_if(active.begin(), active.end(),
+                               [msg](UploadTransfer *tr) { return tr->handle == msg->easy_handle; });
+        UploadTransfer *tr = *it;
+        active.erase(it);
+
+        CURLcode res = msg->data.result;
+        long code = 0L;
+        double upload_size = 0.0;
+        curl_easy_getinfo(tr->handle, CURLINFO_RESPONSE_CODE, &code);
+        curl_easy_getinfo(tr->handle, CURLINFO_SIZE_UPLOAD, &upload_size);
+        bytes_sent += (size_t) upload_size;
+        string error = tr->error[0] ? tr->error : curl_easy_strerror(res);
+        release(tr);
+
+        if(res == CURLE_OK && code == 200L)
+        {
+          bytes_done += tr->size;
+        }
+        else if((res != CURLE_OK || code >= 500L || code == 422L)
+                && tr->attempts <= m_MaxUploadRetries)
+        {
+          // Resend this transfer later, waiting longer after each failure
+          int delay_s = std::min(1 << (tr->attempts - 1), 30);
+          tr->not_before = Clock::now() + std::chrono::seconds(delay_s);
+          queue.push_front(tr);
+        }
+        else if(res != CURLE_OK)
+        {
+          throw IRISException("CURL library error uploading %s: %s",
+                              tr->file->name.c_str(), error.c_str());
+        }
+        else
+        {
+          // The server rejected the file, report its response
+          m_HTTPCode = code;
+          m_Output = tr->response;
+          release_all();
+          return false;
+        }
+      }
+
+      // Report progress, counting the partial uploads of active transfers
+      if(m_CallbackInfo.second && total_bytes > 0)
+      {
+        size_t bytes_partial = 0;
+        for(auto *tr : active)
+        {
+          double ul = 0.0;
+          curl_easy_getinfo(tr->handle, CURLINFO_SIZE_UPLOAD, &ul);
+          bytes_partial += std::min((size_t) ul, tr->size);
+        }
+        m_CallbackInfo.second(m_CallbackInfo.first,
+                              (bytes_done + bytes_partial) * 1.0 / total_bytes);
+      }
+    }
+  }
+  catch(...)
+  {
+    release_all();
+    throw;
+  }
+
+  release_all();
+
+  // Get the upload statistics
+  double upload_time = std::chrono::duration<double>(Clock::now() - t_start).count();
+  snprintf(m_UploadMessageBuffer,
+           sizeof(m_UploadMessageBuffer),
+           "%d files, %.1f Mb in %.1f s",
+           (int) files.size(),
+           bytes_sent / 1.0e6,
+           upload_time);
+
+  m_Output.clear();
+  return true;
+}
+
 template <typename ServerTraits>
 const char *
 RESTClient<ServerTraits>::GetOutput()
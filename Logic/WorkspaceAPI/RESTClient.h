@@ -5,8 +5,14 @@
 #include <cstdarg>
 #include <map>
 #include <mutex>
+#include <vector>
 
-/** Engine based on CURLSH for storing cookies in memory */
+/**
+ * Engine based on CURLSH for storing cookies in memory. Clients that use the
+ * same shared data also share DNS lookups and, depending on the server
+ * traits, TLS sessions, so later connections to the server are quicker to
+ * set up. The shared data may be used by clients on several threads.
+ */
 template <class ServerTraits>
 class RESTSharedData
 {
@@ -18,7 +24,10 @@ public:
 
 protected:
   void *m_CurlShare = nullptr;
-  std::mutex m_Mutex;
+
+  // One lock for each kind of shared data (indexed by curl_lock_data)
+  static constexpr int NumberOfLocks = 16;
+  std::mutex m_Mutex[NumberOfLocks];
 
 };
 
@@ -50,6 +59,7 @@ class DSSServerTraits
 public:
   static constexpr char DirectoryPrefix[] = "~/.alfabis";
   static constexpr char ServerURLEnvironmentVariable[] = "ITKSNAP_WT_DSS_SERVER";
+  static constexpr char UploadChunkSizeEnvironmentVariable[] = "ITKSNAP_WT_DSS_UPLOAD_CHUNK_SIZE";
   static constexpr bool UseGlobalServerURL = true;
   constexpr static bool IncludeCookiesInCurlShare = false;
   constexpr static bool IncludeSSLSessionInCurlShare = true;
@@ -135,6 +145,10 @@ class RESTClient
 public:
   using SharedData = RESTSharedData<ServerTraits>;
 
+  /**
+   * Create a client. If no shared data is given, the default shared data is
+   * used, if it has been set.
+   */
   RESTClient(SharedData *sd = nullptr);
 
   ~RESTClient();
@@ -198,6 +212,29 @@ public:
   bool UploadFile(const char *rel_url, const char *filename,
     std::map<std::string,std::string> extra_fields, ...);
 
+  /**
+   * Upload several files to the same URL, keeping several transfers in flight
+   * at once. Files that are larger than the chunk size are sent as a series of
+   * multipart posts, one per chunk, with the fields "chunk", "chunks", "offset",
+   * "chunk_md5", "file_md5" and "file_size" so that the server can verify and
+   * assemble them. A server that finds a chunk does not match its "chunk_md5"
+   * should answer 422. A chunk or file that fails with a network error, a
+   * server error (5xx) or a 422 is resent after a delay that doubles with each
+   * attempt, so an interruption only costs the chunks that were in flight. The
+   * progress callback receives the fraction of all bytes sent. The URL may have
+   * printf-like expressions.
+   */
+  bool UploadFiles(const char *rel_url, const std::vector<std::string> &filenames, ...);
+
+  /** Set the chunk size for UploadFiles, or zero to send whole files (default) */
+  void SetUploadChunkSize(size_t bytes) { m_UploadChunkSize = bytes; }
+
+  /** Set the number of transfers that UploadFiles keeps in flight (default 4) */
+  void SetMaximumConcurrentUploads(unsigned int n) { m_MaxConcurrentUploads = n > 0 ? n : 1; }
+
+  /** Set how many times UploadFiles resends a failed chunk (default 3) */
+  void SetMaximumUploadRetries(unsigned int n) { m_MaxUploadRetries = n; }
+
   /**
    * Upload raw bytes to the server, similar to file upload but without having
    * to store the data on disk
@@ -221,6 +258,14 @@ public:
    */
   static std::string ReadServerURLFromFile();
 
+  /**
+   * Set the shared data used by clients that are created without one. This
+   * lets a program share name lookups and TLS sessions across all of the
+   * clients that it creates. The shared data must outlive the clients.
+   * This should be set before any clients are created on other threads.
+   */
+  static void SetDefaultSharedData(SharedData *sd) { m_DefaultSharedData = sd; }
+
 
 protected:
   /** The traits object - implementation specific data */
@@ -232,6 +277,9 @@ protected:
   /** The shared data */
   SharedData *m_SharedData = nullptr;
 
+  /** The shared data for clients created without one */
+  static SharedData *m_DefaultSharedData;
+
   /** Optional file for output */
   FILE *m_OutputFile;
 
@@ -255,6 +303,11 @@ protected:
   /** Callback stuff */
   std::pair<void *, ProgressCallbackFunction> m_CallbackInfo;
 
+  /** Settings for UploadFiles */
+  size_t m_UploadChunkSize = 0;
+  unsigned int m_MaxConcurrentUploads = 4;
+  unsigned int m_MaxUploadRetries = 3;
+
   static std::string GetDataDirectory();
 
   static std::string GetCookieFile(const char *server_url);
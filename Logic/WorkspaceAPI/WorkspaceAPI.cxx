@@ -1097,6 +1097,56 @@ string WorkspaceAPI::GetTempDirName()
 }
 
 #include "AllPurposeProgressAccumulator.h"
+#include <fstream>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+/**
+ * Compute the MD5 hash of a file's bytes, streaming over the file. If a
+ * target filename is given, the bytes are also copied to the target.
+ */
+static string StreamFileMD5(const string &source, const string *target = nullptr)
+{
+  std::ifstream fin(source.c_str(), std::ios::binary);
+  if(!fin)
+    throw IRISException("Unable to read file %s", source.c_str());
+
+  std::ofstream fout;
+  if(target)
+    {
+    fout.open(target->c_str(), std::ios::binary);
+    if(!fout)
+      throw IRISException("Unable to write file %s", target->c_str());
+    }
+
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+
+  std::vector<char> buffer(1 << 20);
+  while(fin)
+    {
+    fin.read(buffer.data(), buffer.size());
+    std::streamsize n = fin.gcount();
+    if(n <= 0)
+      break;
+    itksysMD5_Append(md5, reinterpret_cast<unsigned char *>(buffer.data()), (int) n);
+    if(target)
+      fout.write(buffer.data(), n);
+    }
+
+  char hex[33];
+  itksysMD5_FinalizeHex(md5, hex);
+  hex[32] = 0;
+  itksysMD5_Delete(md5);
+
+  if(target && !fout)
+    throw IRISException("Unable to write file %s", target->c_str());
+
+  return string(hex);
+}
 
 void WorkspaceAPI::ExportWorkspace(const char *new_workspace,
                                    CommandType *cmd_progress,
@@ -1123,61 +1173,176 @@ void WorkspaceAPI::ExportWorkspace(const char *new_workspace,
   // Iterate over all the layers stored in the workspace
   int n_layers = wsexp.GetNumberOfLayers();
 
-  // Report progress
-  progress->StartProgress(n_layers);
-
-  // Load all of the layers in the current project
+  // The work to be done for each layer
+  struct LayerExport
+  {
+    string fn_source, basename, ext, fn_temp, hash;
+    Registry io_hints;
+    bool pass_through = false;
+    std::exception_ptr error;
+  };
+  std::vector<LayerExport> jobs(n_layers);
+
+  // Gather the layer files and decide which can be copied as they are. The
+  // registry is only accessed on this thread.
   for(int i = 0; i < n_layers; i++)
     {
-    // Get the folder corresponding to the layer
+    LayerExport &job = jobs[i];
     Registry &f_layer = wsexp.GetLayerFolder(i);
+    job.fn_source = wsexp.GetLayerActualPath(f_layer);
+    job.basename = SystemTools::GetFilenameWithoutExtension(job.fn_source);
 
-    // The the (possibly moved) absolute filename
-    string fn_layer = wsexp.GetLayerActualPath(f_layer);
+    Registry *layer_io_hints;
+    if((layer_io_hints = wsexp.GetLayerIOHints(f_layer)))
+      job.io_hints.Update(*layer_io_hints);
 
-    // Get the current layer base filename
-    string fn_layer_basename = SystemTools::GetFilenameWithoutExtension(fn_layer);
+    // Files in the formats that we export to are copied without decoding
+    GuidedNativeImageIO::FileFormat fmt = GuidedNativeImageIO::GetFileFormat(job.io_hints);
+    if(fmt == GuidedNativeImageIO::FORMAT_COUNT)
+      fmt = GuidedNativeImageIO::GuessFormatForFileName(job.fn_source, true);
 
-    // The IO hints for the file
-    Registry io_hints, *layer_io_hints;
-    if((layer_io_hints = wsexp.GetLayerIOHints(f_layer)))
-      io_hints.Update(*layer_io_hints);
+    string fn_lower = SystemTools::LowerCase(job.fn_source);
+    if(fmt == GuidedNativeImageIO::FORMAT_RLE)
+      {
+      job.ext = "rle";
+      job.pass_through = true;
+      }
+    else
+      {
+      job.ext = "nii.gz";
+      job.pass_through = (fmt == GuidedNativeImageIO::FORMAT_NIFTI
+                          && SystemTools::StringEndsWith(fn_lower, ".nii.gz"));
+      }
+
+    // The file is written under a temporary name until its hash is known
+    char fn_temp[4096];
+    snprintf(fn_temp, 4096, "%s/layer_%03d_export.%s", wsdir.c_str(), i, job.ext.c_str());
+    job.fn_temp = fn_temp;
+    }
 
-    // Create a native image IO object for this image
-    SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
+  // The first IO object initializes static data, so create it on this thread
+  GuidedNativeImageIO::New();
 
-    // Load the header of the image and the image data
-    io->ReadNativeImage(fn_layer.c_str(), io_hints);
+  // Report progress
+  progress->StartProgress(n_layers);
 
-    // Report progress
-    progress->AddProgress(0.5);
+  // Export the layers concurrently. Progress is reported on this thread as
+  // layers complete, since observers may not be thread-safe
+  std::mutex mutex;
+  std::condition_variable cv_done;
+  int next_job = 0, n_done = 0;
 
-    // Compute the hash of the image data to generate filename
-    if(scramble_filenames)
+  auto worker = [&]()
+    {
+    for(;;)
       {
-      // Use the hash as the basename
-      fn_layer_basename = io->GetNativeImageMD5Hash();
+      int i;
+        {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(next_job >= n_layers)
+          return;
+        i = next_job++;
+        }
+
+      LayerExport &job = jobs[i];
+      try
+        {
+        if(job.pass_through)
+          {
+          job.hash = StreamFileMD5(job.fn_source, &job.fn_temp);
+          }
+        else
+          {
+          // Load the image and save it in NIFTI format. The format is
+          // determined by the extension, so we don't need any hints
+          SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
+          io->ReadNativeImage(job.fn_source.c_str(), job.io_hints);
+          Registry dummy_hints;
+          io->SaveNativeImage(job.fn_temp.c_str(), dummy_hints);
+          io = NULL;
+          job.hash = StreamFileMD5(job.fn_temp);
+          }
+        }
+      catch(...)
+        {
+        job.error = std::current_exception();
+        }
+
+        {
+        std::lock_guard<std::mutex> lock(mutex);
+        n_done++;
+        }
+      cv_done.notify_one();
       }
+    };
+
+  unsigned int n_threads = std::min((unsigned int) n_layers,
+                                    std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for(unsigned int k = 0; k < n_threads; k++)
+    threads.emplace_back(worker);
+
+  for(int reported = 0; reported < n_layers; )
+    {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv_done.wait(lock, [&]() { return n_done > reported; });
+    int n_new = n_done - reported;
+    reported = n_done;
+    lock.unlock();
+    progress->AddProgress(n_new);
+    }
 
-    // Create a filename that combines the layer index with the hash code
-    char fn_layer_new[4096];
-    snprintf(fn_layer_new, 4096, "%s/layer_%03d_%s.nii.gz", wsdir.c_str(), i, fn_layer_basename.c_str());
+  for(std::thread &t : threads)
+    t.join();
 
-    // Save the layer there. Since we are saving as a NIFTI, we don't need to
-    // provide any hints
-    Registry dummy_hints;
-    io->SaveNativeImage(fn_layer_new, dummy_hints);
+  // Give the files their final names in layer order. Layers whose files are
+  // identical share the file of the first such layer
+  std::map<string, string> hash_to_file;
+  std::exception_ptr first_error;
+  for(int i = 0; i < n_layers; i++)
+    {
+    LayerExport &job = jobs[i];
+    if(job.error)
+      {
+      SystemTools::RemoveFile(job.fn_temp);
+      if(!first_error)
+        first_error = job.error;
+      continue;
+      }
 
-    // Report progress
-    progress->AddProgress(0.5);
+    string fn_layer_new;
+    auto it_dup = hash_to_file.find(job.hash);
+    if(it_dup != hash_to_file.end())
+      {
+      fn_layer_new = it_dup->second;
+      SystemTools::RemoveFile(job.fn_temp);
+      }
+    else
+      {
+      // Create a filename that combines the layer index with the hash code
+      // or the original filename
+      char fn_buffer[4096];
+      snprintf(fn_buffer, 4096, "%s/layer_%03d_%s.%s", wsdir.c_str(), i,
+               scramble_filenames ? job.hash.c_str() : job.basename.c_str(),
+               job.ext.c_str());
+      fn_layer_new = fn_buffer;
+      SystemTools::RemoveFile(fn_layer_new);
+      if(!SystemTools::RenameFile(job.fn_temp, fn_layer_new))
+        throw IRISException("Unable to write file %s", fn_layer_new.c_str());
+      hash_to_file[job.hash] = fn_layer_new;
+      }
 
     // Update the layer folder with the new path
+    Registry &f_layer = wsexp.GetLayerFolder(i);
     f_layer["AbsolutePath"] << fn_layer_new;
 
-    // There are no hints necessary for NIFTI
+    // There are no hints necessary for NIFTI or run-length files
     f_layer.Folder("IOHints").Clear();
     }
 
+  if(first_error)
+    std::rethrow_exception(first_error);
+
   // Write the updated project
   wsexp.SaveAsXMLFile(new_workspace);
 
@@ -1185,6 +1350,24 @@ void WorkspaceAPI::ExportWorkspace(const char *new_workspace,
   progress->EndProgress();
 }
 
+size_t WorkspaceAPI::GetUploadChunkSize()
+{
+  // Chunked uploads need a server that assembles the chunks (see
+  // RESTClient::UploadFiles). They are turned on with an environment variable,
+  // giving the chunk size in megabytes. By default, whole files are sent.
+  const char *env = SystemTools::GetEnv(DSSServerTraits::UploadChunkSizeEnvironmentVariable);
+  if(!env)
+    return 0;
+
+  char *end = nullptr;
+  double mb = strtod(env, &end);
+  if(end == env || *end || mb < 0.0)
+    throw IRISException("Invalid chunk size '%s' in %s", env,
+                        DSSServerTraits::UploadChunkSizeEnvironmentVariable);
+
+  return (size_t) (mb * 1024 * 1024);
+}
+
 void WorkspaceAPI::UploadWorkspace(const char *url, int ticket_id,
                                    const char *wsfile_suffix,
                                    CommandType *cmd_progress) const
@@ -1226,29 +1409,20 @@ void WorkspaceAPI::UploadWorkspace(const char *url, int ticket_id,
   cout << "Exported workspace to " << ws_fname_buffer << endl;
 
   // Create a source for transfer progress
-  void *transfer_progress_src = accum_upload->RegisterGenericSource(fn_to_upload.size(), 1.0);
-
-  // For each of the files in the directory upload it
-  for(int i = 0; i < fn_to_upload.size(); i++)
-    {
-    const char *fn = fn_to_upload[i].c_str();
-
-    DSSRESTClient rcu;
-
-    // Set progress callback
-    rcu.SetProgressCallback(transfer_progress_src,
-                            AllPurposeProgressAccumulator::GenericProgressCallback);
-
-    // TODO: this is disgraceful!
-    std::map<string, string> empty_map;
-    if(!rcu.UploadFile(url, fn, empty_map, ticket_id))
-      throw IRISException("Failed up upload file %s (%s)", fn, rcu.GetResponseText());
-
-    // Reset progress counter for next run
-    accum_upload->StartNextRun(transfer_progress_src);
-
-    cout << "Upload " << fn << " (" << rcu.GetUploadStatistics() << ")" << endl;
-    }
+  void *transfer_progress_src = accum_upload->RegisterGenericSource(1, 1.0);
+
+  // Upload all the files at once. If chunked uploads are configured, large
+  // images are sent in chunks, so that a dropped connection only requires the
+  // affected chunks to be sent again. Otherwise whole files are sent.
+  DSSRESTClient rcu;
+  rcu.SetProgressCallback(transfer_progress_src,
+                          AllPurposeProgressAccumulator::GenericProgressCallback);
+  rcu.SetUploadChunkSize(GetUploadChunkSize());
+  rcu.SetMaximumConcurrentUploads(4);
+  if(!rcu.UploadFiles(url, fn_to_upload, ticket_id))
+    throw IRISException("Failed to upload files (%s)", rcu.GetResponseText());
+
+  cout << "Upload " << ws_fname_buffer << " (" << rcu.GetUploadStatistics() << ")" << endl;
 
   // Finish with the progress
   accum_upload->UnregisterAllSources();
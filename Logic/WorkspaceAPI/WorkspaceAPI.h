@@ -251,9 +251,23 @@ public:
   /** Cross-platform way of getting a temporary path */
   static std::string GetTempDirName();
 
-  /** Export the workspace */
+  /**
+   * Export the workspace and its layers to a new location. Layers are exported
+   * concurrently. Files that are already NIFTI (.nii.gz) or run-length label
+   * files are copied byte for byte, and the rest are converted to NIFTI. Layers
+   * whose exported files are identical share a single file. When filenames are
+   * scrambled, they are based on the MD5 hash of the exported file.
+   */
   void ExportWorkspace(const char *new_workspace, CommandType *cmd_progress = NULL, bool scramble_filenames = true) const;
 
+  /**
+   * Chunk size for uploads to the DSS server, in bytes, or zero to send whole
+   * files. This is set in megabytes with the ITKSNAP_WT_DSS_UPLOAD_CHUNK_SIZE
+   * environment variable, and should only be set for servers that assemble
+   * chunked uploads.
+   */
+  static size_t GetUploadChunkSize();
+
   /** Upload the workspace */
   void UploadWorkspace(const char *url, int ticket_id, const char *wsfile_suffix,
                        CommandType *cmd_progress = NULL) const;
@@ -0,0 +1,432 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "RESTClient.h"
+#include "itksys/MD5.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static bool check(bool condition, const char *what)
+{
+    if (!condition)
+        cerr << "FAILED: " << what << endl;
+    return condition;
+}
+
+static string md5_hex(const string &data)
+{
+    char hex_code[33];
+    hex_code[32] = 0;
+    itksysMD5 *md5 = itksysMD5_New();
+    itksysMD5_Initialize(md5);
+    itksysMD5_Append(md5, (const unsigned char *) data.data(), (int) data.size());
+    itksysMD5_FinalizeHex(md5, hex_code);
+    itksysMD5_Delete(md5);
+    return hex_code;
+}
+
+/**
+ * A stand-in for the upload endpoint of the server. It accepts multipart
+ * posts, checks the chunk fields and checksums sent by UploadFiles, and
+ * assembles the files. It can be told to answer some posts with errors.
+ */
+class UploadServer
+{
+public:
+    UploadServer()
+    {
+        m_Socket = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(m_Socket, (sockaddr *) &addr, len) < 0 || listen(m_Socket, 16) < 0
+            || getsockname(m_Socket, (sockaddr *) &addr, &len) < 0)
+            throw std::runtime_error("Unable to start the test server");
+        m_Port = ntohs(addr.sin_port);
+        m_Acceptor = std::thread([this]() { this->Accept(); });
+    }
+
+    ~UploadServer()
+    {
+        shutdown(m_Socket, SHUT_RDWR);
+        close(m_Socket);
+        m_Acceptor.join();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (int fd : m_Connections)
+                shutdown(fd, SHUT_RDWR);
+        }
+        for (std::thread &t : m_Handlers)
+            t.join();
+        for (int fd : m_Connections)
+            close(fd);
+    }
+
+    string GetURL() const { return "http://127.0.0.1:" + std::to_string(m_Port); }
+
+    // Answer the next n posts of a file (or chunk of a file) with a 503
+    void FailWithServerError(const string &key, int n) { m_ServerErrors[key] = n; }
+
+    // Corrupt the first copy of a file (or chunk) that arrives
+    void CorruptOnce(const string &key) { m_Corrupt[key] = 1; }
+
+    // A post that reached the server
+    struct Post
+    {
+        string key;
+        int code;
+        Clock::time_point time;
+    };
+
+    std::vector<Post> GetPosts()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Posts;
+    }
+
+    std::vector<Post> GetPosts(const string &key)
+    {
+        std::vector<Post> result;
+        for (Post &p : GetPosts())
+            if (p.key == key)
+                result.push_back(p);
+        return result;
+    }
+
+    // Contents of an uploaded file, if all of it has arrived
+    bool GetFile(const string &name, string &data)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Files.find(name);
+        if (it == m_Files.end() || it->second.received.size() != it->second.chunks)
+            return false;
+        data = it->second.data;
+        return true;
+    }
+
+    // Errors in the posts (bad fields, bad MD5 of an assembled file)
+    std::vector<string> GetErrors()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Errors;
+    }
+
+protected:
+    struct File
+    {
+        string data, md5;
+        size_t chunks = 1;
+        std::map<size_t, bool> received;
+    };
+
+    int m_Socket, m_Port;
+    std::thread m_Acceptor;
+    std::vector<std::thread> m_Handlers;
+    std::vector<int> m_Connections;
+    std::mutex m_Mutex;
+    std::map<string, int> m_ServerErrors, m_Corrupt;
+    std::vector<Post> m_Posts;
+    std::map<string, File> m_Files;
+    std::vector<string> m_Errors;
+
+    void Accept()
+    {
+        int fd;
+        while ((fd = accept(m_Socket, nullptr, nullptr)) >= 0)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Connections.push_back(fd);
+            m_Handlers.emplace_back([this, fd]() { this->Serve(fd); });
+        }
+    }
+
+    // Read from the connection until the buffer holds n bytes
+    static bool Fill(int fd, string &buffer, size_t n)
+    {
+        char block[65536];
+        while (buffer.size() < n)
+        {
+            ssize_t k = recv(fd, block, sizeof(block), 0);
+            if (k <= 0)
+                return false;
+            buffer.append(block, k);
+        }
+        return true;
+    }
+
+    void Serve(int fd)
+    {
+        string buffer;
+        while (true)
+        {
+            // Read the request headers
+            size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == string::npos)
+                if (!Fill(fd, buffer, buffer.size() + 1))
+                    return;
+
+            string headers = buffer.substr(0, end);
+            buffer.erase(0, end + 4);
+
+            size_t length = 0;
+            string boundary;
+            std::istringstream iss(headers);
+            for (string line; std::getline(iss, line);)
+            {
+                if (line.size() && line.back() == '\r')
+                    line.pop_back();
+                if (!strncasecmp(line.c_str(), "Content-Length:", 15))
+                    length = std::stoul(line.substr(15));
+                size_t pb = line.find("boundary=");
+                if (!strncasecmp(line.c_str(), "Content-Type:", 13) && pb != string::npos)
+                    boundary = line.substr(pb + 9);
+            }
+
+            if (!Fill(fd, buffer, length))
+                break;
+            string body = buffer.substr(0, length);
+            buffer.erase(0, length);
+
+            int code = this->HandlePost(this->ParseMultipart(body, boundary));
+            string response = code == 200 ? "OK" : "Error";
+            string reply = "HTTP/1.1 " + std::to_string(code) + (code == 200 ? " OK" : " Error")
+                         + "\r\nContent-Length: " + std::to_string(response.size())
+                         + "\r\n\r\n" + response;
+            send(fd, reply.data(), reply.size(), 0);
+        }
+    }
+
+    static std::map<string, string> ParseMultipart(const string &body, const string &boundary)
+    {
+        std::map<string, string> fields;
+        string delim = "--" + boundary;
+        size_t pos = body.find(delim);
+        while (pos != string::npos)
+        {
+            size_t start = pos + delim.size() + 2;
+            size_t next = body.find("\r\n" + delim, start);
+            if (next == string::npos)
+                break;
+
+            string part = body.substr(start, next - start);
+            size_t hdr_end = part.find("\r\n\r\n");
+            size_t pn = part.find("name=\"");
+            if (hdr_end != string::npos && pn != string::npos && pn < hdr_end)
+            {
+                string name = part.substr(pn + 6, part.find('"', pn + 6) - pn - 6);
+                fields[name] = part.substr(hdr_end + 4);
+            }
+            pos = next + 2;
+        }
+        return fields;
+    }
+
+    int HandlePost(std::map<string, string> fields)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        string name = fields["filename"];
+        bool chunked = fields.count("chunk") > 0;
+        string key = chunked ? name + ":" + fields["chunk"] : name;
+        string &data = fields["myfile"];
+
+        int code = 200;
+        if (m_ServerErrors[key] > 0)
+        {
+            m_ServerErrors[key]--;
+            code = 503;
+        }
+        else if (chunked)
+        {
+            if (m_Corrupt[key] > 0)
+            {
+                m_Corrupt[key]--;
+                data[0] ^= 0x01;
+            }
+
+            // The chunk must match its checksum, or it is asked for again
+            if (md5_hex(data) != fields["chunk_md5"])
+            {
+                code = 422;
+            }
+            else
+            {
+                File &file = m_Files[name];
+                size_t file_size = std::stoul(fields["file_size"]);
+                size_t offset = std::stoul(fields["offset"]);
+                file.chunks = std::stoul(fields["chunks"]);
+                file.md5 = fields["file_md5"];
+                file.data.resize(file_size);
+                if (offset + data.size() > file_size)
+                    m_Errors.push_back("Chunk outside of the file: " + key);
+                else
+                    file.data.replace(offset, data.size(), data);
+                file.received[std::stoul(fields["chunk"])] = true;
+
+                if (file.received.size() == file.chunks && md5_hex(file.data) != file.md5)
+                    m_Errors.push_back("Assembled file does not match its MD5: " + name);
+            }
+        }
+        else
+        {
+            File &file = m_Files[name];
+            file.data = data;
+            file.received[0] = true;
+        }
+
+        m_Posts.push_back({ key, code, Clock::now() });
+        return code;
+    }
+};
+
+static string write_test_file(const string &dir, const string &name, size_t size)
+{
+    string data(size, 0);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char) ((i * 7919 + i / 251) & 0xff);
+
+    string path = dir + "/" + name;
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out.write(data.data(), data.size());
+    return path;
+}
+
+static double g_LastProgress = 0.0;
+
+static void progress_callback(void *, double progress)
+{
+    g_LastProgress = progress;
+}
+
+static double seconds_between(const UploadServer::Post &a, const UploadServer::Post &b)
+{
+    return std::chrono::duration<double>(b.time - a.time).count();
+}
+
+// Uploads files to a local stand-in server with RESTClient::UploadFiles:
+// whole files, files in chunks, chunks that arrive corrupted, and chunks that
+// fail with server errors and are resent after increasing delays.
+// Usage: RESTClientUploadTest temp_dir
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " temp_dir" << endl;
+        return 1;
+    }
+
+    string dir = argv[1];
+    std::vector<string> files;
+    files.push_back(write_test_file(dir, "small.nii.gz", 1000));
+    files.push_back(write_test_file(dir, "large.nii.gz", 100000));
+    files.push_back(write_test_file(dir, "exact.nii.gz", 16384));
+
+    typedef RESTClient<DLSServerTraits> Client;
+    bool ok = true;
+    try
+    {
+        // Whole files
+        {
+            UploadServer server;
+            Client rc;
+            rc.SetServerURL(server.GetURL().c_str());
+            ok &= check(rc.UploadFiles("api/tickets/%d/files/input", files, 1), "whole file upload");
+            ok &= check(server.GetPosts().size() == 3, "one post per whole file");
+
+            string data;
+            ok &= check(server.GetFile("large.nii.gz", data) && data.size() == 100000,
+                        "whole file received");
+        }
+
+        // Chunks, with one chunk corrupted on the way and one that fails twice
+        {
+            UploadServer server;
+            server.CorruptOnce("large.nii.gz:2");
+            server.FailWithServerError("large.nii.gz:4", 2);
+
+            Client rc;
+            rc.SetServerURL(server.GetURL().c_str());
+            rc.SetUploadChunkSize(16384);
+            rc.SetMaximumConcurrentUploads(3);
+            rc.SetProgressCallback(nullptr, progress_callback);
+            g_LastProgress = 0.0;
+            ok &= check(rc.UploadFiles("api/tickets/%d/files/input", files, 2), "chunked upload");
+            ok &= check(g_LastProgress == 1.0, "progress reaches one");
+
+            for (const string &fn : files)
+            {
+                string name = fn.substr(dir.size() + 1), data, expected;
+                std::ifstream in(fn.c_str(), std::ios::binary);
+                expected.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                ok &= check(server.GetFile(name, data) && data == expected,
+                            ("file assembled correctly: " + name).c_str());
+            }
+            ok &= check(server.GetErrors().empty(), "chunk fields and file MD5 are consistent");
+
+            // Files up to the chunk size are sent whole, the large file in 7 chunks
+            ok &= check(server.GetPosts("small.nii.gz").size() == 1, "small file sent whole");
+            ok &= check(server.GetPosts("exact.nii.gz").size() == 1, "file of chunk size sent whole");
+            ok &= check(server.GetPosts("large.nii.gz:6").size() == 1, "last chunk sent once");
+
+            // The corrupted chunk is sent again
+            std::vector<UploadServer::Post> corrupt = server.GetPosts("large.nii.gz:2");
+            ok &= check(corrupt.size() == 2 && corrupt[0].code == 422 && corrupt[1].code == 200,
+                        "corrupted chunk is resent");
+
+            // The failing chunk is resent after one and then two seconds
+            std::vector<UploadServer::Post> failing = server.GetPosts("large.nii.gz:4");
+            ok &= check(failing.size() == 3 && failing[2].code == 200, "failed chunk is resent");
+            if (failing.size() == 3)
+            {
+                ok &= check(seconds_between(failing[0], failing[1]) >= 0.9, "first retry is delayed");
+                ok &= check(seconds_between(failing[1], failing[2]) >= 1.9, "second retry waits longer");
+            }
+
+            // Only the chunks that failed are sent more than once
+            ok &= check(server.GetPosts().size() == 2 + 7 + 1 + 2, "no other chunks are resent");
+        }
+
+        // A chunk that keeps failing makes the upload fail once retries run out
+        {
+            UploadServer server;
+            server.FailWithServerError("large.nii.gz:0", 10);
+
+            Client rc;
+            rc.SetServerURL(server.GetURL().c_str());
+            rc.SetUploadChunkSize(16384);
+            rc.SetMaximumUploadRetries(1);
+            ok &= check(!rc.UploadFiles("api/tickets/%d/files/input", files, 3), "upload gives up");
+            ok &= check(rc.GetHTTPCode() == 503, "server error is reported");
+            ok &= check(server.GetPosts("large.nii.gz:0").size() == 2, "failing chunk sent twice");
+        }
+    }
+    catch (std::exception &exc)
+    {
+        cerr << "Exception: " << exc.what() << endl;
+        ok = false;
+    }
+
+    for (const string &fn : files)
+        remove(fn.c_str());
+
+    cout << (ok ? "PASSED" : "FAILED") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+#include "RLERegionOfInterestImageFilter.h"
+#include "RLEDecodeImageFilter.h"
+#include "RLELabelImageIO.h"
+
+typedef itk::Image<short, 3> Seg3DImageType;
+typedef RLEImage<short> RLEImage3D;
+
+// Saves a segmentation in the run-length format and reads it back, both
+// directly into an RLE image and through the dense ImageIOBase interface.
+// Usage: RLELabelImageIOTest input.nii.gz temp.rle output.nii.gz
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        cerr << "Usage: " << argv[0] << " input temp.rle output" << endl;
+        return 1;
+    }
+
+    try
+    {
+        typedef itk::ImageFileReader<Seg3DImageType> ReaderType;
+        ReaderType::Pointer reader = ReaderType::New();
+        reader->SetFileName(argv[1]);
+        reader->Update();
+        Seg3DImageType::Pointer input = reader->GetOutput();
+
+        typedef itk::RegionOfInterestImageFilter<Seg3DImageType, RLEImage3D> EncoderType;
+        EncoderType::Pointer encoder = EncoderType::New();
+        encoder->SetInput(input);
+        encoder->SetRegionOfInterest(input->GetLargestPossibleRegion());
+        encoder->Update();
+
+        RLELabelImageIO::Pointer io = RLELabelImageIO::New();
+        io->SetFileName(argv[2]);
+        io->WriteRLEImage(encoder->GetOutput());
+
+        // Read the runs back directly
+        RLELabelImageIO::Pointer rio = RLELabelImageIO::New();
+        rio->SetFileName(argv[2]);
+        rio->ReadImageInformation();
+        RLEImage3D::Pointer rle = RLEImage3D::New();
+        rle->CopyInformation(encoder->GetOutput());
+        rle->SetRegions(encoder->GetOutput()->GetLargestPossibleRegion());
+        rle->Allocate();
+        rio->ReadRLEImage(rle.GetPointer());
+
+        typedef RLEDecodeImageFilter<RLEImage3D, Seg3DImageType> DecoderType;
+        DecoderType::Pointer decoder = DecoderType::New();
+        decoder->SetInput(rle);
+
+        typedef itk::ImageFileWriter<Seg3DImageType> WriterType;
+        WriterType::Pointer writer = WriterType::New();
+        writer->SetInput(decoder->GetOutput());
+        writer->SetFileName(argv[3]);
+        writer->Update();
+
+        // Read the file as a dense image, one slab at a time
+        ReaderType::Pointer dense = ReaderType::New();
+        dense->SetImageIO(RLELabelImageIO::New());
+        dense->SetFileName(argv[2]);
+        dense->UpdateLargestPossibleRegion();
+
+        itk::ImageRegionConstIterator<Seg3DImageType> it1(input, input->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator<Seg3DImageType> it2(dense->GetOutput(), input->GetLargestPossibleRegion());
+        for (; !it1.IsAtEnd(); ++it1, ++it2)
+        {
+            if (it1.Get() != it2.Get())
+            {
+                cerr << "Mismatch at " << it1.GetIndex() << endl;
+                return 1;
+            }
+        }
+    }
+    catch (itk::ExceptionObject &exc)
+    {
+        cerr << exc << endl;
+        return 1;
+    }
+
+    return 0;
+}
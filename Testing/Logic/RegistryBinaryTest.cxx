@@ -0,0 +1,136 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#include "Registry.h"
+
+static bool check(bool condition, const char *what)
+{
+    if (!condition)
+        cerr << "FAILED: " << what << endl;
+    return condition;
+}
+
+static string print(Registry &reg)
+{
+    ostringstream oss;
+    reg.Print(oss);
+    return oss.str();
+}
+
+// Writes a registry in binary format and reads it back, with and without
+// accessing its folders before writing it again. The registry is also saved
+// as XML and read back, and both copies must match.
+// Usage: RegistryBinaryTest temp.reg temp.xml
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: " << argv[0] << " temp.reg temp.xml" << endl;
+        return 1;
+    }
+
+    Registry reg;
+    reg["Version"] << 20240101;
+    reg["Negative"] << -42;
+    reg["LeadingZero"] << "007";
+    reg["MinusZero"] << "-0";
+    reg["Double"] << 0.25;
+    reg["SmallDouble"] << -1.5e-07;
+    reg["Vector"] << Vector3d(0.5, 0.333333, 1.2);
+    reg["IntVector"] << Vector3i(256, -256, 180);
+    reg["Mixed"] << "0.5 x 2";
+    reg["Empty"] << "";
+    reg["Special"] << "<a & \"b\">";
+    for (int i = 0; i < 20; i++)
+    {
+        Registry &layer = reg.Folder(Registry::Key("Layers.Layer[%03d]", i));
+        layer["AbsolutePath"] << Registry::Key("/data/image_%03d.nii.gz", i);
+        layer["Role"] << (i == 0 ? "MainRole" : "OverlayRole");
+        layer.Folder("LayerMetaData.DisplayMapping")["Opacity"] << 0.5 * i;
+        layer.Folder("TimePointProperties")["Count"] << i * 1000000;
+    }
+
+    bool ok = true;
+    try
+    {
+        reg.WriteToBinaryFile(argv[1]);
+        reg.WriteToXMLFile(argv[2]);
+        ok &= check(Registry::IsBinary(argv[1]), "IsBinary on binary file");
+        ok &= check(!Registry::IsBinary(argv[2]), "IsBinary on XML file");
+
+        // Full round trip
+        Registry bin;
+        bin.ReadFromBinaryFile(argv[1]);
+        ok &= check(bin == reg, "binary round trip");
+
+        Registry xml;
+        xml.ReadFromXMLFile(argv[2]);
+        ok &= check(print(xml) == print(bin), "XML matches binary");
+
+        // Unparsed folders are copied when written back
+        Registry lazy;
+        lazy.ReadFromBinaryFile(argv[1]);
+        ostringstream out1, out2;
+        reg.WriteToBinaryStream(out1);
+        lazy.WriteToBinaryStream(out2);
+        ok &= check(out1.str() == out2.str(), "unmodified registry written back unchanged");
+
+        // Modify one folder, add a new key and read back
+        lazy.Folder("Layers.Layer[005]")["NewKey"] << "value";
+        reg.Folder("Layers.Layer[005]")["NewKey"] << "value";
+        ostringstream out3;
+        lazy.WriteToBinaryStream(out3);
+        istringstream in3(out3.str());
+        Registry modified;
+        modified.ReadFromBinaryStream(in3);
+        ok &= check(modified == reg, "partially modified round trip");
+
+        // Folders are parsed on first access, also by const methods called
+        // from several threads at once
+        Registry shared;
+        shared.ReadFromBinaryFile(argv[1]);
+        const Registry &cshared = shared;
+        vector<thread> threads;
+        vector<int> found(8, 0);
+        for (int t = 0; t < 8; t++)
+            threads.emplace_back([&cshared, &found, t]() {
+                for (int i = 0; i < 20; i++)
+                {
+                    string layer = Registry::Key("Layers.Layer[%03d]", i);
+                    found[t] += cshared.HasFolder(layer + ".LayerMetaData.DisplayMapping");
+                    found[t] += cshared.HasEntry(layer + ".TimePointProperties.Count");
+                }
+            });
+        for (auto &th : threads)
+            th.join();
+        for (int t = 0; t < 8; t++)
+            ok &= check(found[t] == 40, "concurrent lookups of unparsed folders");
+        ok &= check(shared == reg, "round trip after concurrent lookups");
+
+        // Truncated data must be rejected
+        string data = out1.str();
+        istringstream trunc(data.substr(0, data.size() / 2));
+        Registry bad;
+        bool thrown = false;
+        try { bad.ReadFromBinaryStream(trunc); }
+        catch (Registry::IOException &) { thrown = true; }
+        ok &= check(thrown, "truncated data rejected");
+    }
+    catch (std::exception &exc)
+    {
+        cerr << "Exception: " << exc.what() << endl;
+        return 1;
+    }
+    catch (Registry::IOException &exc)
+    {
+        cerr << "Registry exception: " << exc << endl;
+        return 1;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -35,6 +35,16 @@
 #include <fstream>
 #include <string>
 #include <cstdarg>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "CSVParser.h"
 #include "WorkspaceAPI.h"
@@ -86,6 +96,13 @@ int usage(int rc)
   cout << "  -A <dest_dir>                     : Package workspace preserving filenames" << endl;
   cout << "  -p <prefix>                       : Set the output prefix for the next command only" << endl;
   cout << "  -P                                : No printing of prefix for output commands" << endl;
+  cout << "Batch processing: " << endl;
+  cout << "  -batch <script> [n_threads]       : Run each line of the script as a separate chain of commands," << endl;
+  cout << "                                      as if itksnap-wt had been called with it. Use '-' to read the" << endl;
+  cout << "                                      script from standard input. Jobs that name the same workspace" << endl;
+  cout << "                                      file (with -i, -o, -a or -A) run in order, other jobs run in" << endl;
+  cout << "                                      parallel. The output of each job is printed in script order." << endl;
+  cout << "                                      Parsed workspaces are reused between jobs." << endl;
   cout << "Informational commands: " << endl;
   cout << "  -dump                             : Dump workspace in human-readable format" << endl;
   cout << "  -registry-get <key>               : Get the value of a specified key" << endl;
@@ -201,6 +218,8 @@ int usage(int rc)
   cout << "  ITKSNAP_WT_DSS_SERVER             : URL of the server to use. When you authenticate with -dss-auth" << endl;
   cout << "                                      the server is stored in a config file. When this variable is set" << endl;
   cout << "                                      the config file is ignored and this server is used instead." << endl;
+  cout << "  ITKSNAP_WT_DSS_UPLOAD_CHUNK_SIZE  : Send uploads larger than this many megabytes in chunks. Only for" << endl;
+  cout << "                                      servers that assemble chunked uploads. By default whole files are sent." << endl;
   return rc;
 }
 
@@ -247,7 +266,7 @@ void print_string_with_prefix(ostream &sout, const string &text, const string &p
     sout << prefix << line << endl;
 }
 
-void simple_rest_get(const char *url, const char *exception_message, const char *prefix, ...)
+void simple_rest_get(ostream &sout, const char *url, const char *exception_message, const char *prefix, ...)
 {
   // Handle the ...
   std::va_list args;
@@ -268,10 +287,10 @@ void simple_rest_get(const char *url, const char *exception_message, const char
   }
 
   // Print CSV
-  print_string_with_prefix(cout, rc.GetFormattedCSVOutput(false), prefix);
+  print_string_with_prefix(sout, rc.GetFormattedCSVOutput(false), prefix);
 }
 
-void simple_rest_post(const char *url, const char *params, const char *exception_message, const char *prefix, ...)
+void simple_rest_post(ostream &sout, const char *url, const char *params, const char *exception_message, const char *prefix, ...)
 {
   // Handle the ...
   std::va_list args;
@@ -281,7 +300,7 @@ void simple_rest_post(const char *url, const char *params, const char *exception
   DSSRESTClient rc;
 
   // Try calling command
-  std::cout << "prefix: " << prefix << std::endl;
+  sout << "prefix: " << prefix << std::endl;
   try {
     if(!rc.PostVA(url, params, args))
       throw IRISException("%s: %s", exception_message, rc.GetResponseText());
@@ -292,13 +311,13 @@ void simple_rest_post(const char *url, const char *params, const char *exception
     throw;
   }
 
-  cout << prefix << rc.GetOutput() << endl;
+  sout << prefix << rc.GetOutput() << endl;
 }
 
 /** 
  * Print ticket log with attachments and nice formatting
  */
-int PrintTicketLog(int ticket_id, int id_start = 0)
+int PrintTicketLog(ostream &sout, int ticket_id, int id_start = 0)
 {
   DSSRESTClient rc;
 
@@ -329,7 +348,7 @@ int PrintTicketLog(int ticket_id, int id_start = 0)
       int n_attach = atoi(ft(i, 3).c_str());
 
       // Print the row
-      ft.PrintRow(cout, i, "", col_filter);
+      ft.PrintRow(sout, i, "", col_filter);
 
       // Process the attachments
       if(n_attach > 0)
@@ -343,7 +362,7 @@ int PrintTicketLog(int ticket_id, int id_start = 0)
 
         for(int k = 0; k < fta.Rows(); k++)
           {
-          printf("  @ %s : %s\n", fta(k, 3).c_str(), fta(k, 1).c_str());
+          sout << "  @ " << fta(k, 3) << " : " << fta(k, 1) << endl;
           }
         }
       }
@@ -353,14 +372,369 @@ int PrintTicketLog(int ticket_id, int id_start = 0)
 } 
 
 
-int main(int argc, char *argv[])
+/**
+ * Parsed workspaces kept between the jobs of a batch, so that a workspace
+ * that is read by many jobs is only parsed once. A cached workspace is used
+ * only while the modification time and size of its file are unchanged.
+ */
+class WorkspaceCache
 {
-  // There must be some commands!
-  if(argc < 2)
-    return usage(-1);
+public:
+  WorkspaceCache(unsigned int max_size = 64) : m_MaxSize(max_size) {}
 
-  // Command line parsing helper
-  CommandLineHelper cl(argc, argv);
+  /** Read a workspace file, or copy it from the cache */
+  void Read(const string &filename, WorkspaceAPI &ws)
+  {
+    string path = SystemTools::CollapseFullPath(filename);
+    FileStamp stamp = GetFileStamp(path);
+
+    std::shared_ptr<const WorkspaceAPI> cached;
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Entries.find(path);
+    if(it != m_Entries.end() && it->second.stamp == stamp)
+      {
+      cached = it->second.ws;
+      it->second.last_use = ++m_UseCounter;
+      }
+    }
+
+    if(cached)
+      {
+      ws = *cached;
+      return;
+      }
+
+    ws.ReadFromXMLFile(filename.c_str());
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Entry &entry = m_Entries[path];
+    entry.ws = std::make_shared<const WorkspaceAPI>(ws);
+    entry.stamp = stamp;
+    entry.last_use = ++m_UseCounter;
+
+    // Drop the least recently used workspaces
+    while(m_Entries.size() > m_MaxSize)
+      {
+      auto lru = m_Entries.begin();
+      for(auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        if(it->second.last_use < lru->second.last_use)
+          lru = it;
+      m_Entries.erase(lru);
+      }
+  }
+
+  /** Forget a workspace file that has been written */
+  void Invalidate(const string &filename)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.erase(SystemTools::CollapseFullPath(filename));
+  }
+
+protected:
+  typedef std::pair<long, unsigned long> FileStamp;
+
+  static FileStamp GetFileStamp(const string &path)
+  {
+    return FileStamp(SystemTools::ModifiedTime(path), SystemTools::FileLength(path));
+  }
+
+  struct Entry
+  {
+    std::shared_ptr<const WorkspaceAPI> ws;
+    FileStamp stamp;
+    unsigned long last_use;
+  };
+
+  std::map<string, Entry> m_Entries;
+  unsigned long m_UseCounter = 0;
+  unsigned int m_MaxSize;
+  std::mutex m_Mutex;
+};
+
+/**
+ * Run a chain of commands. Output goes to the given streams. In batch mode,
+ * the cache is used to read workspaces, and interactive commands are not
+ * allowed. Returns zero on success.
+ */
+int RunCommands(CommandLineHelper &cl, ostream &sout, ostream &serr, WorkspaceCache *cache);
+
+/**
+ * Split a line of a batch script into arguments. Arguments are separated by
+ * white space and may be quoted with single or double quotes, as in a shell.
+ * A backslash escapes the next character, except inside single quotes, and
+ * a '#' outside of an argument starts a comment. Returns false if a quote is
+ * not closed.
+ */
+bool split_batch_line(const string &line, vector<string> &args)
+{
+  args.clear();
+  string current;
+  bool in_arg = false;
+  char quote = 0;
+  for(size_t i = 0; i < line.size(); i++)
+    {
+    char c = line[i];
+    if(quote == '\'')
+      {
+      if(c == '\'')
+        quote = 0;
+      else
+        current += c;
+      }
+    else if(c == '\\' && i + 1 < line.size()
+            && (quote == 0 || line[i+1] == '"' || line[i+1] == '\\'))
+      {
+      current += line[++i];
+      in_arg = true;
+      }
+    else if(quote == '"')
+      {
+      if(c == '"')
+        quote = 0;
+      else
+        current += c;
+      }
+    else if(c == '\'' || c == '"')
+      {
+      quote = c;
+      in_arg = true;
+      }
+    else if(isspace((unsigned char) c))
+      {
+      if(in_arg)
+        args.push_back(current);
+      current.clear();
+      in_arg = false;
+      }
+    else if(c == '#' && !in_arg)
+      {
+      break;
+      }
+    else
+      {
+      current += c;
+      in_arg = true;
+      }
+    }
+
+  if(quote)
+    return false;
+
+  if(in_arg)
+    args.push_back(current);
+
+  return true;
+}
+
+/**
+ * Runs the jobs of a batch script on a pool of threads. Each line of the
+ * script is a job, i.e., a chain of commands that is run as if itksnap-wt
+ * had been called with it. A job that names a workspace file with -i, -o,
+ * -a or -A waits for the earlier jobs that name the same file, other jobs
+ * run in parallel. The output of each job is printed when it and all the
+ * jobs before it have completed, so the output is in script order.
+ */
+class WorkspaceBatchRunner
+{
+public:
+  WorkspaceBatchRunner(unsigned int n_threads) : m_Threads(std::max(1u, n_threads)) {}
+
+  /** Run the jobs read from a stream. Returns the number of failed jobs */
+  int Run(istream &sin, ostream &sout, ostream &serr)
+  {
+    m_Out = &sout;
+    m_Err = &serr;
+    m_InputDone = false;
+    m_Failed = 0;
+
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < m_Threads; i++)
+      workers.emplace_back(&WorkspaceBatchRunner::WorkerLoop, this);
+
+    // Jobs are queued while they are read, so that a script on standard
+    // input is processed as it arrives
+    string line;
+    int line_number = 0;
+    while(getline(sin, line))
+      {
+      Job job;
+      job.line = ++line_number;
+      if(!split_batch_line(line, job.args))
+        {
+        job.state = Job::DONE;
+        job.rc = -1;
+        job.err = "Unterminated quote in batch script\n";
+        }
+      else if(job.args.empty())
+        {
+        continue;
+        }
+      else
+        {
+        for(size_t i = 0; i + 1 < job.args.size(); i++)
+          {
+          const string &a = job.args[i];
+          if(a == "-i" || a == "-o" || a == "-a" || a == "-A")
+            job.files.insert(SystemTools::CollapseFullPath(job.args[i+1]));
+          }
+        }
+
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Condition.wait(lock, [this]() { return m_Jobs.size() < MaxQueuedJobs; });
+      m_Jobs.push_back(std::move(job));
+      this->FlushCompletedJobs();
+      m_Condition.notify_all();
+      }
+
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_InputDone = true;
+    }
+    m_Condition.notify_all();
+
+    for(auto &w : workers)
+      w.join();
+
+    return m_Failed;
+  }
+
+protected:
+  struct Job
+  {
+    enum State { PENDING, RUNNING, DONE };
+    int line = 0;
+    vector<string> args;
+    std::set<string> files;
+    State state = PENDING;
+    int rc = 0;
+    string out, err;
+  };
+
+  // Bound on the number of jobs read ahead of the output
+  static constexpr size_t MaxQueuedJobs = 1024;
+
+  // Find the first pending job that does not share a file with an earlier
+  // unfinished job. Called with the mutex locked.
+  Job *NextRunnableJob()
+  {
+    std::set<string> busy_files;
+    for(Job &job : m_Jobs)
+      {
+      if(job.state == Job::DONE)
+        continue;
+
+      if(job.state == Job::PENDING)
+        {
+        bool conflict = false;
+        for(const string &f : job.files)
+          conflict |= busy_files.count(f) > 0;
+        if(!conflict)
+          return &job;
+        }
+
+      busy_files.insert(job.files.begin(), job.files.end());
+      }
+    return nullptr;
+  }
+
+  bool HasPendingJobs() const
+  {
+    for(const Job &job : m_Jobs)
+      if(job.state == Job::PENDING)
+        return true;
+    return false;
+  }
+
+  // Print the output of the completed jobs at the front of the queue. Called
+  // with the mutex locked.
+  void FlushCompletedJobs()
+  {
+    while(!m_Jobs.empty() && m_Jobs.front().state == Job::DONE)
+      {
+      Job &job = m_Jobs.front();
+      *m_Out << job.out;
+      *m_Err << job.err;
+      if(job.rc != 0)
+        {
+        *m_Err << "Batch job on line " << job.line << " failed" << endl;
+        m_Failed++;
+        }
+      m_Jobs.pop_front();
+      }
+    m_Out->flush();
+  }
+
+  void WorkerLoop()
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while(true)
+      {
+      Job *job = this->NextRunnableJob();
+      if(!job)
+        {
+        if(m_InputDone && !this->HasPendingJobs())
+          break;
+        m_Condition.wait(lock);
+        continue;
+        }
+
+      job->state = Job::RUNNING;
+      lock.unlock();
+
+      ostringstream out, err;
+      int rc = this->RunJob(*job, out, err);
+
+      lock.lock();
+      job->rc = rc;
+      job->out = out.str();
+      job->err = err.str();
+      job->state = Job::DONE;
+      this->FlushCompletedJobs();
+      m_Condition.notify_all();
+      }
+  }
+
+  int RunJob(Job &job, ostream &sout, ostream &serr)
+  {
+    // The command line helper expects a main-style argument list
+    vector<char *> argv;
+    argv.push_back(const_cast<char *>("itksnap-wt"));
+    for(string &a : job.args)
+      argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    try
+      {
+      CommandLineHelper cl((int) argv.size() - 1, argv.data());
+      return RunCommands(cl, sout, serr, &m_Cache);
+      }
+    catch(std::exception &exc)
+      {
+      serr << "System exception on line " << job.line << " : " << exc.what() << endl;
+      }
+    catch(...)
+      {
+      serr << "Unknown exception on line " << job.line << endl;
+      }
+    return -1;
+  }
+
+  unsigned int m_Threads;
+  std::list<Job> m_Jobs;
+  bool m_InputDone = false;
+  int m_Failed = 0;
+  ostream *m_Out = nullptr, *m_Err = nullptr;
+  WorkspaceCache m_Cache;
+  std::mutex m_Mutex;
+  std::condition_variable m_Condition;
+};
+
+
+int RunCommands(CommandLineHelper &cl, ostream &sout, ostream &serr, WorkspaceCache *cache)
+{
+  // Batch jobs share the cache
+  bool batch = (cache != nullptr);
 
   // Current workspace object
   WorkspaceAPI ws;
@@ -404,12 +778,20 @@ int main(int argc, char *argv[])
       // Read a workspace
       if(arg == "-i")
         {
-        ws.ReadFromXMLFile(cl.read_existing_filename().c_str());
+        // A second workspace is merged into the first, so it is not cached
+        string filename = cl.read_existing_filename();
+        if(cache && ws.GetRegistry().IsEmpty())
+          cache->Read(filename, ws);
+        else
+          ws.ReadFromXMLFile(filename.c_str());
         }
 
       else if(arg == "-o")
         {
-        ws.SaveAsXMLFile(cl.read_output_filename().c_str());
+        string filename = cl.read_output_filename();
+        ws.SaveAsXMLFile(filename.c_str());
+        if(cache)
+          cache->Invalidate(filename);
         }
 
       // Archive the current workspace build
@@ -438,16 +820,43 @@ int main(int argc, char *argv[])
         prefix_disabled = true;
         }
 
+      // Run a batch script
+      else if(arg == "-batch")
+        {
+        if(batch)
+          throw IRISException("Command %s can not be used in batch mode", arg.c_str());
+
+        string script = cl.read_string();
+        int n_threads = cl.command_arg_count() > 0 ? cl.read_integer() : 0;
+        WorkspaceBatchRunner runner(n_threads > 0 ? n_threads : std::thread::hardware_concurrency());
+
+        int n_failed;
+        if(script == "-")
+          {
+          n_failed = runner.Run(cin, sout, serr);
+          }
+        else
+          {
+          ifstream fin(script.c_str());
+          if(!fin.good())
+            throw IRISException("Unable to read batch script %s", script.c_str());
+          n_failed = runner.Run(fin, sout, serr);
+          }
+
+        if(n_failed > 0)
+          throw IRISException("%d batch jobs failed", n_failed);
+        }
+
       // Dump the workspace contents
       else if(arg == "-dump")
         {
-        ws.GetRegistry().Print(cout, "  ", prefix);
+        ws.GetRegistry().Print(sout, "  ", prefix);
         }
 
       else if(arg == "-registry-get")
         {
         string key = cl.read_string();
-        cout << prefix << ws.GetRegistry()[key][""] << endl;
+        sout << prefix << ws.GetRegistry()[key][""] << endl;
         }
 
       else if(arg == "-registry-set")
@@ -455,19 +864,19 @@ int main(int argc, char *argv[])
         string key = cl.read_string();
         string value = cl.read_string();
         ws.GetRegistry()[key] << value;
-        cout << "INFO: set registry entry '" << key << "' to '" << ws.GetRegistry()[key][""] << "'" << endl;
+        sout << "INFO: set registry entry '" << key << "' to '" << ws.GetRegistry()[key][""] << "'" << endl;
         }
 
       // List all layers
       else if(arg == "-layers-list" || arg == "-ll")
         {
-        ws.PrintLayerList(cout, prefix);
+        ws.PrintLayerList(sout, prefix);
         }
 
       // List the files associated with a specific tag
       else if(arg == "-layers-list-files" || arg == "-llf")
         {
-        ws.ListLayerFilesForTag(cl.read_string(), cout, prefix);
+        ws.ListLayerFilesForTag(cl.read_string(), sout, prefix);
         }
 
       // Select a layer - the selected layer is target for various property commands
@@ -475,7 +884,7 @@ int main(int argc, char *argv[])
         {
         string layer_id = cl.read_string();
         layer_folder = ws.LayerSpecToKey(layer_id.c_str());
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       else if(arg == "-layers-pick-by-tag" || arg == "-lpt" || arg == "-lpbt")
@@ -488,7 +897,7 @@ int main(int argc, char *argv[])
 
         layer_folder = layers.front();
 
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       // Add a layer - the layer will be added in the anatomical role
@@ -497,7 +906,7 @@ int main(int argc, char *argv[])
         string filename = cl.read_existing_filename();
         string key = ws.AddLayer("AnatomicalRole", filename.c_str());
         layer_folder = key;
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       // Add a layer - the layer will be added in the segmentation role
@@ -506,7 +915,7 @@ int main(int argc, char *argv[])
         string filename = cl.read_existing_filename();
         string key = ws.AddLayer("SegmentationRole", filename.c_str());
         layer_folder = key;
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       // Add a layer - the layer will be added in the mesh role
@@ -516,7 +925,7 @@ int main(int argc, char *argv[])
         unsigned int tp = cl.read_integer();
         string key = ws.AddMeshLayer(filename, tp);
         layer_folder = key;
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       // Set the main layer
@@ -525,7 +934,7 @@ int main(int argc, char *argv[])
         string filename = cl.read_existing_filename();
         string key = ws.SetLayer("MainRole", filename.c_str());
         layer_folder = key;
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       // Set the main layer
@@ -534,7 +943,7 @@ int main(int argc, char *argv[])
         string filename = cl.read_existing_filename();
         string key = ws.SetLayer("SegmentationRole", filename.c_str());
         layer_folder = key;
-        cout << "INFO: picked layer " << layer_folder << endl;
+        sout << "INFO: picked layer " << layer_folder << endl;
         }
 
       else if(arg == "-props-get-filename" || arg == "-pgf")
@@ -542,7 +951,7 @@ int main(int argc, char *argv[])
         if(!ws.IsKeyValidLayer(layer_folder))
           throw IRISException("Selected object %s is not a valid layer", layer_folder.c_str());
 
-        cout << prefix << ws.GetLayerActualPath(ws.GetFolder(layer_folder)) << endl;
+        sout << prefix << ws.GetLayerActualPath(ws.GetFolder(layer_folder)) << endl;
         }
 
       else if(arg == "-props-get-mesh-filename" || arg == "-pgmf")
@@ -559,7 +968,7 @@ int main(int argc, char *argv[])
         if (polyId < 0)
           throw IRISException("Invalid polydata_id value %d. Polydata Id should start from 0.", polyId);
 
-        cout << prefix << ws.GetMeshLayerPolyDataPath(layer_folder, tp, polyId) << endl;
+        sout << prefix << ws.GetMeshLayerPolyDataPath(layer_folder, tp, polyId) << endl;
         }
 
       else if(arg == "-props-add-mesh-polydata" || arg == "-pamp")
@@ -575,7 +984,7 @@ int main(int argc, char *argv[])
 
         unsigned int newPolyId = ws.AddMeshPolyData(layer_folder, tp, filename);
 
-        cout << "INFO: polydata added to timepoint: " << tp
+        sout << "INFO: polydata added to timepoint: " << tp
              << "; New polydata id: " << newPolyId << std::endl;
         }
 
@@ -585,7 +994,7 @@ int main(int argc, char *argv[])
           throw IRISException("Selected object %s is not a valid layer", layer_folder.c_str());
 
         string key = cl.read_string();
-        cout << prefix << ws.GetRegistry().Folder(layer_folder)[key][""] << endl;
+        sout << prefix << ws.GetRegistry().Folder(layer_folder)[key][""] << endl;
         }
 
       else if(arg == "-props-registry-set" || arg == "-prs")
@@ -596,7 +1005,7 @@ int main(int argc, char *argv[])
         string key = cl.read_string();
         string value = cl.read_string();
         ws.GetRegistry().Folder(layer_folder)[key] << value;
-        cout << "INFO: set registry entry '" << key << "' to '" << ws.GetRegistry().Folder(layer_folder)[key][""] << "'" << endl;
+        sout << "INFO: set registry entry '" << key << "' to '" << ws.GetRegistry().Folder(layer_folder)[key][""] << "'" << endl;
         }
 
       else if(arg == "-props-registry-dump" || arg == "-prd")
@@ -671,7 +1080,7 @@ int main(int argc, char *argv[])
         // Print the matrix
         for(unsigned int i = 0; i < 4; i++)
           {
-          cout << prefix << Q(i,0) << " " << Q(i,1) << " " << Q(i,2) << " " << Q(i,3) << endl;
+          sout << prefix << Q(i,0) << " " << Q(i,1) << " " << Q(i,2) << " " << Q(i,3) << endl;
           }
         }
 
@@ -742,7 +1151,7 @@ int main(int argc, char *argv[])
         while (cit != found.cend())
           oss << "," << *cit++;
 
-        cout << prefix << oss.str() << endl;
+        sout << prefix << oss.str() << endl;
         }
 
       else if(arg == "-timepoints-pick-by-name")
@@ -755,12 +1164,12 @@ int main(int argc, char *argv[])
 
         unsigned int tp = found.front();
 
-        cout << prefix << tp << endl;
+        sout << prefix << tp << endl;
         }
 
       else if(arg == "-timepoints-list")
         {
-        ws.PrintTimePointList(cout, prefix);
+        ws.PrintTimePointList(sout, prefix);
         }
 
       else if(arg == "-labels-set")
@@ -799,17 +1208,21 @@ int main(int argc, char *argv[])
         }
       else if(arg == "-annot-list")
         {
-        ws.PrintAnnotationList(cout, prefix);
+        ws.PrintAnnotationList(sout, prefix);
         }
       else if(arg == "-dss-auth")
         {
         // Read the url of the server
         string url = cl.read_string();
 
+        // The token is read from the terminal
+        if(batch)
+          throw IRISException("Command %s can not be used in batch mode", arg.c_str());
+
         // Tell the user where to go
         string token_string;
-        printf("Paste this link into your browser to obtain a token:  %s/token\n", url.c_str());
-        printf("  Enter the token: ");
+        sout << "Paste this link into your browser to obtain a token:  " << url << "/token" << endl;
+        sout << "  Enter the token: " << flush;
         std::cin >> token_string;
 
         // Authenticate with the token
@@ -818,13 +1231,13 @@ int main(int argc, char *argv[])
         if(!rc.Authenticate(token_string.c_str()))
           throw IRISException("Authentication error: %s", rc.GetResponseText());
         else
-          printf("Success: %s", rc.GetOutput());
+          sout << "Success: " << rc.GetOutput();
         }
       else if(arg == "-dss-services-list")
         {
         DSSRESTClient rc;
         if(rc.Get("api/services"))
-          print_string_with_prefix(cout, rc.GetFormattedCSVOutput(false), prefix);
+          print_string_with_prefix(sout, rc.GetFormattedCSVOutput(false), prefix);
         else
           throw IRISException("Error listing services: %s", rc.GetResponseText());
         }
@@ -833,7 +1246,7 @@ int main(int argc, char *argv[])
         string service_githash = cl.read_string();
         DSSRESTClient rc;
         if(rc.Get("api/services/%s/detail", service_githash.c_str()))
-          print_string_with_prefix(cout, rc.GetOutput(), prefix);
+          print_string_with_prefix(sout, rc.GetOutput(), prefix);
         else
           throw IRISException("Error getting service detail: %s", rc.GetResponseText());
 
@@ -842,13 +1255,13 @@ int main(int argc, char *argv[])
         {
         string service_githash = cl.read_string();
         int ticket_id = ws.CreateWorkspaceTicket(service_githash.c_str());
-        cout << prefix << ticket_id << endl;
+        sout << prefix << ticket_id << endl;
         }
       else if(arg == "-dss-tickets-list" || arg == "-dtl")
         {
         DSSRESTClient rc;
         if(rc.Get("api/tickets"))
-          print_string_with_prefix(cout, rc.GetFormattedCSVOutput(false), prefix);
+          print_string_with_prefix(sout, rc.GetFormattedCSVOutput(false), prefix);
         else
           throw IRISException("Error listing tickets: %s", rc.GetResponseText());
         }
@@ -857,7 +1270,7 @@ int main(int argc, char *argv[])
         int ticket_id = cl.read_integer();
         DSSRESTClient rc;
         if(rc.Get("api/tickets/%d/delete", ticket_id))
-          cout << prefix << rc.GetOutput() << endl;
+          sout << prefix << rc.GetOutput() << endl;
         else
           throw IRISException("Error deleting ticket %d: %s", ticket_id, rc.GetResponseText());
 
@@ -865,14 +1278,14 @@ int main(int argc, char *argv[])
       else if(arg == "-dss-tickets-log" || arg == "-dt-log")
         {
         int ticket_id = cl.read_integer();
-        PrintTicketLog(ticket_id);
+        PrintTicketLog(sout, ticket_id);
         }
       else if(arg == "-dss-tickets-progress")
         {
         int ticket_id = cl.read_integer();
         DSSRESTClient rc;
         if(rc.Get("api/tickets/%d/progress", ticket_id))
-          cout << prefix << rc.GetOutput() << endl;
+          sout << prefix << rc.GetOutput() << endl;
         else
           throw IRISException("Error getting progress for ticket %d: %s", ticket_id, rc.GetResponseText());
         }
@@ -883,8 +1296,7 @@ int main(int argc, char *argv[])
         int timeout = cl.command_arg_count() > 0 ? cl.read_integer() : 10000;
 
         // Main loop
-        clock_t t_start = clock();
-        clock_t t_end = t_start + timeout * CLOCKS_PER_SEC;
+        auto t_end = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
 
         // Use a single REST client
         DSSRESTClient rc;
@@ -900,11 +1312,13 @@ int main(int argc, char *argv[])
         // Keep a loop counter
         int loop_counter = 0;
 
+        // The progress bar is only shown on the terminal, not in batch output
         bool timed_out = true;
-        while(clock() < t_end && n_conseq_fail < 5)
+        while(std::chrono::steady_clock::now() < t_end && n_conseq_fail < 5)
           {
           // Go to the begin of line - to erase the current progress
-          printf("\r");
+          if(!batch)
+            sout << "\r";
 
           // Count a consecutive failure
           n_conseq_fail++;
@@ -926,18 +1340,16 @@ int main(int argc, char *argv[])
               for(int i = 0; i < log_entry.size(); i++)
                 {
                 last_log = log_entry[i].get("id", (int) last_log).asLargestInt();
-                printf("%20s %10s %s\n",
-                       log_entry[i].get("atime","").asString().c_str(),
-                       log_entry[i].get("category","").asString().c_str(),
-                       log_entry[i].get("message","").asString().c_str());
+                sout << setw(20) << log_entry[i].get("atime","").asString() << " "
+                     << setw(10) << log_entry[i].get("category","").asString() << " "
+                     << log_entry[i].get("message","").asString() << endl;
 
 
                 const Json::Value att_entry = log_entry[i]["attachments"];
                 for(int i = 0; i < att_entry.size(); i++)
                   {
-                  printf("  @ %s : %s\n",
-                         att_entry[i].get("url","").asString().c_str(),
-                         att_entry[i].get("description","").asString().c_str());
+                  sout << "  @ " << att_entry[i].get("url","").asString()
+                       << " : " << att_entry[i].get("description","").asString() << endl;
                   }
                 }
 
@@ -947,25 +1359,26 @@ int main(int argc, char *argv[])
             }
 
           // Display the progress nicely
-          for(int i = 0; i < 78; i++)
-            if(i <=  progress * 78 )
-              printf("#");
-            else
-              printf(" ");
-          printf(" %3d%% ", (int) (100 * progress));
+          if(!batch)
+            {
+            for(int i = 0; i < 78; i++)
+              sout << (i <= progress * 78 ? '#' : ' ');
+            sout << " " << setw(3) << (int) (100 * progress) << "% ";
+            }
 
           // If status is something terminal, exit
           if(status == "failed" || status == "success" || status == "timeout" || status == "deleted")
             {
             timed_out = false;
-            printf("\n");
+            if(!batch)
+              sout << endl;
             break;
             }
 
           // Show a blop
           const char blop[] = "|/-\\";
-            printf("%c", blop[(loop_counter++) % 4]);
-          fflush(stdout);
+          if(!batch)
+            sout << blop[(loop_counter++) % 4] << flush;
 
           // Sleep (time depends on failures)
           sleep(n_conseq_fail == 0 ? 5 : 10);
@@ -974,19 +1387,19 @@ int main(int argc, char *argv[])
         // Print additional information
         if(timed_out)
           {
-          printf("\nTimed out\n");
+          sout << endl << "Timed out" << endl;
           return -1;
           }
         else
           {
-          printf("\nTicket completed with status: %s\n", status.c_str());
+          sout << endl << "Ticket completed with status: " << status << endl;
           }
         }
       else if(arg == "-dssp-services-list")
         {
         DSSRESTClient rc;
         if(rc.Get("api/pro/services"))
-          print_string_with_prefix(cout, rc.GetFormattedCSVOutput(false), prefix);
+          print_string_with_prefix(sout, rc.GetFormattedCSVOutput(false), prefix);
         else
           throw IRISException("Error listing services: %s", rc.GetResponseText());
         }
@@ -1014,14 +1427,14 @@ int main(int argc, char *argv[])
           int ticket_id;
           if(ft.Rows() == 1 && (ticket_id = atoi(ft(0, 0).c_str())) > 0)
             {
-            ft.Print(cout, prefix);
+            ft.Print(sout, prefix);
             context_ticket_id = ticket_id;
             break;
             }
           else if(tnow + twait > timeout)
             {
-            cerr << "Timed out waiting for available tickets" << endl;
-            exit(1);
+            serr << "Timed out waiting for available tickets" << endl;
+            return 1;
             }
           else
             {
@@ -1035,14 +1448,14 @@ int main(int argc, char *argv[])
         int ticket_id = cl.read_integer();
         string output_path = cl.read_string();
         string file_list = WorkspaceAPI::DownloadTicketFiles(ticket_id, output_path.c_str(), false, "results");
-        print_string_with_prefix(cout, file_list, prefix);
+        print_string_with_prefix(sout, file_list, prefix);
         }
       else if(arg == "-dssp-tickets-download")
         {
         int ticket_id = cl.read_integer();
         string output_path = cl.read_string();
         string file_list = WorkspaceAPI::DownloadTicketFiles(ticket_id, output_path.c_str(), true, "input");
-        print_string_with_prefix(cout, file_list, prefix);
+        print_string_with_prefix(sout, file_list, prefix);
         }
       else if(arg == "-dssp-tickets-fail")
         {
@@ -1056,7 +1469,7 @@ int main(int argc, char *argv[])
         DSSRESTClient rc;
         if (rc.Post("api/pro/tickets/%d/status","status=failed", ticket_id))
           {
-          cout << prefix << rc.GetOutput() << endl;
+          sout << prefix << rc.GetOutput() << endl;
           }
         else
           throw IRISException("Error marking ticket %d as failed: %s", 
@@ -1069,7 +1482,7 @@ int main(int argc, char *argv[])
         DSSRESTClient rc;
         if (rc.Post("api/pro/tickets/%d/status","status=success", ticket_id))
           {
-          cout << prefix << rc.GetOutput() << endl;
+          sout << prefix << rc.GetOutput() << endl;
           }
         else
           throw IRISException("Error marking ticket %d as completed: %s", 
@@ -1082,7 +1495,7 @@ int main(int argc, char *argv[])
         if(!rc.Get("api/pro/tickets/%d/status", ticket_id))
           throw IRISException("Error checking status of ticket %d: %s",
             ticket_id, rc.GetResponseText());
-        cout << prefix << rc.GetOutput() << endl;
+        sout << prefix << rc.GetOutput() << endl;
         }
       else if(arg == "-dssp-tickets-set-progress")
         {
@@ -1093,7 +1506,7 @@ int main(int argc, char *argv[])
         double chunk_prog = cl.read_double();
         if(rc.Post("api/pro/tickets/%d/progress","chunk_start=%f&chunk_end=%f&progress=%f", 
             ticket_id, chunk_start, chunk_end, chunk_prog))
-          cout << rc.GetOutput() << endl;
+          sout << rc.GetOutput() << endl;
         else
           throw IRISException("Error setting progress for ticket %d: %s", 
             ticket_id, rc.GetResponseText());
@@ -1121,55 +1534,55 @@ int main(int argc, char *argv[])
         }
       else if(arg == "-dssa-providers-list")
         {
-        simple_rest_get("api/admin/providers", "Error listing providers", prefix.c_str());
+        simple_rest_get(sout, "api/admin/providers", "Error listing providers", prefix.c_str());
         }
       else if(arg == "-dssa-providers-add")
         {
         std::string pname = cl.read_string();
-        simple_rest_post("api/admin/providers", "name=%s", "Error adding provider", prefix.c_str(), pname.c_str());
+        simple_rest_post(sout, "api/admin/providers", "name=%s", "Error adding provider", prefix.c_str(), pname.c_str());
         }
       else if(arg == "-dssa-providers-delete")
         {
         std::string pname = cl.read_string();
-        simple_rest_post("api/admin/providers/%s/delete", NULL, "Error deleting provider", prefix.c_str(), pname.c_str());
+        simple_rest_post(sout, "api/admin/providers/%s/delete", NULL, "Error deleting provider", prefix.c_str(), pname.c_str());
         }
       else if(arg == "-dssa-providers-users-list")
         {
         std::string pname = cl.read_string();
-        simple_rest_get("api/admin/providers/%s/users", "Error listing provider's users", prefix.c_str(), pname.c_str());
+        simple_rest_get(sout, "api/admin/providers/%s/users", "Error listing provider's users", prefix.c_str(), pname.c_str());
         }
       else if(arg == "-dssa-providers-users-add")
         {
         std::string pname = cl.read_string();
         std::string email = cl.read_string();
-        simple_rest_post("api/admin/providers/%s/users", "email=%s", "Error adding user to provider", prefix.c_str(), 
+        simple_rest_post(sout, "api/admin/providers/%s/users", "email=%s", "Error adding user to provider", prefix.c_str(), 
                          pname.c_str(), email.c_str());
         }
       else if(arg == "-dssa-providers-users-delete")
         {
         std::string pname = cl.read_string();
         int user_id = cl.read_integer();
-        simple_rest_post("api/admin/providers/%s/users/%d/delete", NULL, "Error deleting user from provider", prefix.c_str(), 
+        simple_rest_post(sout, "api/admin/providers/%s/users/%d/delete", NULL, "Error deleting user from provider", prefix.c_str(), 
                          pname.c_str(), user_id);
         }
       else if(arg == "-dssa-providers-services-list")
         {
         std::string pname = cl.read_string();
-        simple_rest_get("api/admin/providers/%s/services", "Error listing provider's services", prefix.c_str(), pname.c_str());
+        simple_rest_get(sout, "api/admin/providers/%s/services", "Error listing provider's services", prefix.c_str(), pname.c_str());
         }
       else if(arg == "-dssa-providers-services-add")
         {
         std::string pname = cl.read_string();
         std::string repo = cl.read_string();
         std::string ref = cl.read_string();
-        simple_rest_post("api/admin/providers/%s/services", "repo=%s&ref=%s", "Error adding service to provider", prefix.c_str(), 
+        simple_rest_post(sout, "api/admin/providers/%s/services", "repo=%s&ref=%s", "Error adding service to provider", prefix.c_str(), 
                          pname.c_str(), repo.c_str(), ref.c_str());
         }
       else if(arg == "-dssa-providers-services-delete")
         {
         std::string pname = cl.read_string();
         std::string githash = cl.read_string();
-        simple_rest_post("api/admin/providers/%s/services/%s/delete", NULL, "Error deleting user from provider", prefix.c_str(), 
+        simple_rest_post(sout, "api/admin/providers/%s/services/%s/delete", NULL, "Error deleting user from provider", prefix.c_str(), 
                          pname.c_str(), githash.c_str());
         }
 
@@ -1178,12 +1591,12 @@ int main(int argc, char *argv[])
       }
     catch(IRISException &exc)
       {
-      cerr << "ITK-SNAP exception for command " << arg << " : " << exc.what() << endl;
+      serr << "ITK-SNAP exception for command " << arg << " : " << exc.what() << endl;
       return -1;
       }
     catch(std::exception &sexc)
       {
-      cerr << "System exception for command " << arg << " : " << sexc.what() << endl;
+      serr << "System exception for command " << arg << " : " << sexc.what() << endl;
       return -1;
       }
 
@@ -1193,3 +1606,22 @@ int main(int argc, char *argv[])
 
   return 0;
 }
+
+int main(int argc, char *argv[])
+{
+  // There must be some commands!
+  if(argc < 2)
+    return usage(-1);
+
+  // All server requests share name lookups and TLS sessions
+  RESTSharedData<DSSServerTraits> rest_shared_data;
+  DSSRESTClient::SetDefaultSharedData(&rest_shared_data);
+
+  // Command line parsing helper
+  CommandLineHelper cl(argc, argv);
+
+  int rc = RunCommands(cl, cout, cerr, nullptr);
+
+  DSSRESTClient::SetDefaultSharedData(nullptr);
+  return rc;
+}